@@ -0,0 +1,115 @@
+#ifndef __ACCUM_CPP
+#define __ACCUM_CPP
+
+#include "accum.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* An accumulator gathers the slices its incoming edges select into one vector, which it passes on unchanged. */
+Accum::Accum(unsigned int inputs)
+  {
+    unsigned int i;
+
+    this->inputs = inputs;
+    if((out = (double*)calloc((inputs > 0) ? inputs : 1, sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Accumulator layer's output array\n";
+        exit(1);
+      }
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+Accum::~Accum()
+  {
+    free(out);
+  }
+
+/**************************************************************************************************
+ Setters  */
+
+/* Set the name of this layer. */
+void Accum::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* Accum::name() const
+  {
+    return (char*)layerName;
+  }
+
+/*  */
+void Accum::print() const
+  {
+    printf("Input Length = %d\n", inputs);
+    return;
+  }
+
+/**************************************************************************************************
+ Run  */
+
+/*  */
+unsigned int Accum::outputLen() const
+  {
+    return inputs;
+  }
+
+/*  */
+double* Accum::output() const
+  {
+    return out;
+  }
+
+/* Copy the input through. */
+unsigned int Accum::run(double* x)
+  {
+    memcpy(out, x, inputs * sizeof(double));
+    return inputs;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input length, then name. Return false if writing fails. */
+bool Accum::write(FILE* fp) const
+  {
+    bool ok = true;
+
+    ok = ok && fwrite(&inputs, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same input length.
+   Return false if reading fails or the length differs. */
+bool Accum::read(FILE* fp)
+  {
+    unsigned int in;
+    bool ok = true;
+
+    ok = ok && fread(&in, sizeof(int), 1, fp) == 1;
+    if(!ok || in != inputs)
+      {
+        cout << "ERROR: Stored Accumulator layer does not match this layer's shape\n";
+        return false;
+      }
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+
+    return ok;
+  }
+
+#endif
@@ -37,10 +37,15 @@ class Accum
       char* name() const;
       void print() const;
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
 
     private:
       unsigned int inputs;                                          //  Number of inputs--ACCUMULATORS GET NO bias-1
-      char name[LAYER_NAME_LEN];
+      char layerName[LAYER_NAME_LEN];
       double* out;
-  };
\ No newline at end of file
+  };
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef __ARENA_CPP
+#define __ARENA_CPP
+
+#include "arena.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* An empty Arena: the first allocation creates the first chunk. */
+Arena::Arena()
+  {
+    chunks = NULL;
+    chunksLen = 0;
+  }
+
+Arena::~Arena()
+  {
+    clear();
+  }
+
+/**************************************************************************************************
+ Allocation  */
+
+/* Return an ARENA_ALIGN-aligned block of 'len' doubles. Blocks are never freed individually. */
+double* Arena::alloc(unsigned int len)
+  {
+    double* ptr;
+
+    len = padded(len);
+    if(chunksLen == 0 || chunks[chunksLen - 1].len - chunks[chunksLen - 1].used < len)
+      grow((len > ARENA_CHUNK) ? len : ARENA_CHUNK);
+
+    ptr = chunks[chunksLen - 1].base + chunks[chunksLen - 1].used;
+    chunks[chunksLen - 1].used += len;
+
+    return ptr;
+  }
+
+/* If the current chunk cannot hold 'len' more doubles, start one sized exactly for them. */
+void Arena::reserve(unsigned int len)
+  {
+    if(chunksLen == 0 || chunks[chunksLen - 1].len - chunks[chunksLen - 1].used < padded(len))
+      grow(len);
+    return;
+  }
+
+/* Free every chunk. Everything previously returned by alloc() is invalid afterward. */
+void Arena::clear()
+  {
+    unsigned int i;
+
+    for(i = 0; i < chunksLen; i++)
+      free(chunks[i].base);
+    if(chunksLen > 0)
+      free(chunks);
+    chunks = NULL;
+    chunksLen = 0;
+    return;
+  }
+
+/*  */
+unsigned int Arena::used() const
+  {
+    unsigned int i;
+    unsigned int u = 0;
+
+    for(i = 0; i < chunksLen; i++)
+      u += chunks[i].used;
+
+    return u;
+  }
+
+/*  */
+unsigned int Arena::capacity() const
+  {
+    unsigned int i;
+    unsigned int c = 0;
+
+    for(i = 0; i < chunksLen; i++)
+      c += chunks[i].len;
+
+    return c;
+  }
+
+/* Round 'len' doubles up so that the block after it stays ARENA_ALIGN-aligned. */
+unsigned int Arena::padded(unsigned int len)
+  {
+    unsigned int per = ARENA_ALIGN / sizeof(double);
+    return ((len + per - 1) / per) * per;
+  }
+
+/* An ARENA_ALIGN-aligned block of 'len' doubles, not part of any Arena. Release it with free(). */
+double* Arena::alignedAlloc(unsigned int len)
+  {
+    void* ptr = NULL;
+
+    if(len == 0)
+      len = 1;
+    if(posix_memalign(&ptr, ARENA_ALIGN, padded(len) * sizeof(double)) != 0)
+      {
+        cout << "ERROR: Unable to allocate aligned block\n";
+        exit(1);
+      }
+
+    return (double*)ptr;
+  }
+
+/* Append a chunk of 'len' doubles, rounded up to alignment, and make it current. */
+void Arena::grow(unsigned int len)
+  {
+    len = padded(len);
+    if((chunks = (ArenaChunk*)realloc(chunks, (chunksLen + 1) * sizeof(ArenaChunk))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Arena's chunk array\n";
+        exit(1);
+      }
+    chunks[chunksLen].base = alignedAlloc(len);
+    chunks[chunksLen].len = len;
+    chunks[chunksLen].used = 0;
+    chunksLen++;
+
+    return;
+  }
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __ARENA_H
+#define __ARENA_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ A bump allocator for layer parameters. Memory is handed out from large chunks, every block aligned to
+ ARENA_ALIGN bytes, and is only ever released all at once. Layers that place their weights in the same Arena
+ end up side by side in memory, so walking a network's parameters streams through one region.
+
+ reserve() guarantees that the next allocations totalling up to the given amount come from a single chunk;
+ call it with the size of everything about to be placed to make the whole placement contiguous.
+
+ An Arena never moves what it has handed out, and it is not thread-safe: fill it, then read from it freely.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <iostream>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN  64                                             /* Bytes: one cache line, and enough for any SIMD load */
+#define ARENA_CHUNK  65536                                          /* Default chunk length, in doubles */
+
+/*
+#define __ARENA_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct ArenaChunkType
+  {
+    double* base;                                                   //  ARENA_ALIGN-aligned block
+    unsigned int len;                                               //  Capacity of the block, in doubles
+    unsigned int used;                                              //  Doubles handed out so far
+  } ArenaChunk;
+
+/**************************************************************************************************
+ Arena  */
+class Arena
+  {
+    public:
+      Arena();                                                      //  Constructor(s)
+      ~Arena();                                                     //  Destructor
+
+      double* alloc(unsigned int);                                  //  An aligned block of this many doubles
+      void reserve(unsigned int);                                   //  Make the next allocations, up to this many doubles, contiguous
+      void clear();                                                 //  Release everything
+      unsigned int used() const;                                    //  Doubles handed out, including alignment padding
+      unsigned int capacity() const;                                //  Doubles held in all chunks
+
+      static unsigned int padded(unsigned int);                     //  Round a length up to a whole number of aligned blocks
+      static double* alignedAlloc(unsigned int);                    //  A standalone aligned block; release with free()
+
+    private:
+      ArenaChunk* chunks;                                           //  Array of chunks, the last one current
+      unsigned int chunksLen;                                       //  Length of that array
+
+      void grow(unsigned int);                                      //  Start a new chunk of at least this many doubles
+  };
+
+#endif
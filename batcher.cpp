@@ -0,0 +1,308 @@
+#ifndef __BATCHER_CPP
+#define __BATCHER_CPP
+
+#include "batcher.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Serve 'net' in batches of at most 'maxBatch' samples, holding a request back at most 'maxDelay' microseconds.
+   If the network is not batchable, every future is fulfilled at once with a NULL output. */
+Batcher::Batcher(NeuralNet* net, unsigned int maxBatch, unsigned int maxDelay)
+  {
+    unsigned int i;
+
+    this->net = net;
+    inputs = net->inputLen();
+    refused = !net->batchable();
+    if(refused)
+      cout << "ERROR: Networks with recurrent layers cannot be batched\n";
+
+    batchMax = (maxBatch > 0) ? maxBatch : 1;
+    delayMax = maxDelay;
+
+    queueCap = 2 * batchMax;
+    queueHead = 0;
+    queueLen = 0;
+    if((queue = (BatchRequest*)malloc(queueCap * sizeof(BatchRequest))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate batcher's request queue\n";
+        exit(1);
+      }
+    stopping = false;
+
+    for(i = 0; i < BATCH_HIST_LEN; i++)
+      {
+        depthHist[i] = 0;
+        sizeHist[i] = 0;
+      }
+    served = 0;
+    batchCount = 0;
+
+    X = NULL;
+    XLen = 0;
+    if(!refused)
+      worker = thread(&Batcher::serve, this);
+  }
+
+Batcher::~Batcher()
+  {
+    lock.lock();
+    stopping = true;
+    lock.unlock();
+    ready.notify_one();
+    if(worker.joinable())
+      worker.join();
+
+    free(queue);
+    if(X != NULL)
+      free(X);
+  }
+
+/**************************************************************************************************
+ Requests  */
+
+/* Queue a copy of the 'inputs'-long input 'x'. The future yields its output once its batch has run. */
+future<BatchResult> Batcher::submit(double* x)
+  {
+    unsigned int i;
+    BatchRequest r;
+    BatchRequest* tmp;
+    future<BatchResult> f;
+
+    r.result = new promise<BatchResult>();
+    f = r.result->get_future();
+    if(refused)
+      {
+        r.result->set_value({NULL, 0});
+        delete r.result;
+        return f;
+      }
+
+    if((r.x = (double*)malloc(inputs * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate batched request\n";
+        exit(1);
+      }
+    memcpy(r.x, x, inputs * sizeof(double));
+
+    lock.lock();
+    depthHist[bucket(queueLen)]++;
+    if(queueLen == queueCap)                                        //  Grow the ring, unwrapping it
+      {
+        if((tmp = (BatchRequest*)malloc(2 * queueCap * sizeof(BatchRequest))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate batcher's request queue\n";
+            exit(1);
+          }
+        for(i = 0; i < queueLen; i++)
+          tmp[i] = queue[(queueHead + i) % queueCap];
+        free(queue);
+        queue = tmp;
+        queueHead = 0;
+        queueCap *= 2;
+      }
+    r.queued = chrono::steady_clock::now();
+    queue[(queueHead + queueLen) % queueCap] = r;
+    queueLen++;
+    lock.unlock();
+    ready.notify_one();
+
+    return f;
+  }
+
+/* Worker thread: wait for a full batch or for the oldest request's deadline, run, and scatter the results. */
+void Batcher::serve()
+  {
+    unsigned int b, n;
+    unsigned int len;
+    unsigned int limit;
+    chrono::steady_clock::time_point deadline;
+    promise<BatchResult>** results = NULL;
+    unsigned int resultsLen = 0;
+    double* Z;
+    double* z;
+    unique_lock<mutex> held(lock);
+
+    while(true)
+      {
+        while(queueLen == 0 && !stopping)
+          ready.wait(held);
+        if(queueLen == 0)                                           //  Stopping, and nothing left to serve
+          break;
+
+        deadline = queue[queueHead].queued + chrono::microseconds(delayMax.load());
+        while(queueLen < batchMax.load() && !stopping && chrono::steady_clock::now() < deadline)
+          ready.wait_until(held, deadline);
+
+        limit = batchMax.load();
+        n = (queueLen < limit) ? queueLen : limit;
+        if(XLen < n * inputs)
+          {
+            XLen = n * inputs;
+            if((X = (double*)realloc(X, XLen * sizeof(double))) == NULL)
+              {
+                cout << "ERROR: Unable to re-allocate batcher's input array\n";
+                exit(1);
+              }
+          }
+        if(resultsLen < n)
+          {
+            resultsLen = n;
+            if((results = (promise<BatchResult>**)realloc(results, resultsLen * sizeof(promise<BatchResult>*))) == NULL)
+              {
+                cout << "ERROR: Unable to re-allocate batcher's result array\n";
+                exit(1);
+              }
+          }
+        for(b = 0; b < n; b++)                                      //  Dequeue the oldest n
+          {
+            memcpy(X + b * inputs, queue[queueHead].x, inputs * sizeof(double));
+            free(queue[queueHead].x);
+            results[b] = queue[queueHead].result;
+            queueHead = (queueHead + 1) % queueCap;
+            queueLen--;
+          }
+        sizeHist[bucket(n)]++;                                      //  Count the batch before any caller can see its result
+        served += n;
+        batchCount++;
+        held.unlock();                                              //  Callers may queue while this batch runs
+
+        len = net->runBatch(X, n, &Z);
+        for(b = 0; b < n; b++)
+          {
+            if((z = (double*)malloc(len * sizeof(double))) == NULL)
+              {
+                cout << "ERROR: Unable to allocate batched result\n";
+                exit(1);
+              }
+            memcpy(z, Z + b * len, len * sizeof(double));
+            results[b]->set_value({z, len});
+            delete results[b];
+          }
+        free(Z);
+
+        held.lock();
+      }
+
+    if(results != NULL)
+      free(results);
+    return;
+  }
+
+/**************************************************************************************************
+ Tuning  */
+
+/*  */
+void Batcher::setMaxBatch(unsigned int n)
+  {
+    if(n > 0)
+      batchMax = n;
+    ready.notify_one();
+    return;
+  }
+
+/*  */
+void Batcher::setMaxDelay(unsigned int usec)
+  {
+    delayMax = usec;
+    ready.notify_one();
+    return;
+  }
+
+/*  */
+unsigned int Batcher::maxBatch() const
+  {
+    return batchMax.load();
+  }
+
+/*  */
+unsigned int Batcher::maxDelay() const
+  {
+    return delayMax.load();
+  }
+
+/**************************************************************************************************
+ Statistics  */
+
+/*  */
+unsigned long long Batcher::requests() const
+  {
+    return served.load();
+  }
+
+/*  */
+unsigned long long Batcher::batches() const
+  {
+    return batchCount.load();
+  }
+
+/* Copy the queue-depth histogram into 'hist', which must hold BATCH_HIST_LEN counts. */
+void Batcher::queueDepthHistogram(unsigned long long* hist) const
+  {
+    lock.lock();
+    memcpy(hist, depthHist, sizeof(depthHist));
+    lock.unlock();
+    return;
+  }
+
+/* Copy the batch-size histogram into 'hist', which must hold BATCH_HIST_LEN counts. */
+void Batcher::batchSizeHistogram(unsigned long long* hist) const
+  {
+    lock.lock();
+    memcpy(hist, sizeHist, sizeof(sizeHist));
+    lock.unlock();
+    return;
+  }
+
+/*  */
+void Batcher::clearHistograms()
+  {
+    unsigned int i;
+
+    lock.lock();
+    for(i = 0; i < BATCH_HIST_LEN; i++)
+      {
+        depthHist[i] = 0;
+        sizeHist[i] = 0;
+      }
+    lock.unlock();
+    return;
+  }
+
+/*  */
+void Batcher::print() const
+  {
+    unsigned int i;
+    unsigned long long depth[BATCH_HIST_LEN];
+    unsigned long long size[BATCH_HIST_LEN];
+
+    queueDepthHistogram(depth);
+    batchSizeHistogram(size);
+
+    printf("Max batch = %d, Max delay = %d usec\n", batchMax.load(), delayMax.load());
+    printf("Requests = %llu, Batches = %llu\n", served.load(), batchCount.load());
+    printf("        From         To  Queue depth   Batch size\n");
+    for(i = 0; i < BATCH_HIST_LEN; i++)
+      {
+        if(depth[i] > 0 || size[i] > 0)
+          printf("  %10llu %10llu %12llu %12llu\n", (i == 0) ? 0ULL : (1ULL << i), (1ULL << (i + 1)) - 1, depth[i], size[i]);
+      }
+    return;
+  }
+
+/* Power-of-two bucket of 'v': floor(log2(v)), with 0 in bucket 0. */
+unsigned int Batcher::bucket(unsigned int v)
+  {
+    unsigned int k = 0;
+
+    while(v > 1 && k < BATCH_HIST_LEN - 1)
+      {
+        v >>= 1;
+        k++;
+      }
+
+    return k;
+  }
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __BATCHER_H
+#define __BATCHER_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ A Batcher groups single-sample requests from many threads into batches for NeuralNet::runBatch().
+  maxBatch = most samples in one batch
+  maxDelay = longest, in microseconds, that the oldest waiting request is held back for others to join it
+
+ submit() copies the input, queues it, and returns a future. One worker thread waits until either 'maxBatch'
+ requests are waiting or the oldest has waited 'maxDelay', runs them as one batch, and fulfils each future with
+ its own malloc'd output, which the caller must free. Both limits may be changed while requests are flowing, so
+ each model's Batcher can be tuned to its own latency target.
+
+ Every submit() records the queue depth it found, and every batch records its size, in histograms of
+ BATCH_HIST_LEN power-of-two buckets: bucket k counts values v with 2^k <= v < 2^(k + 1), and bucket 0 also
+ counts v = 0.
+
+ The Batcher owns the network's run path: nothing else may call run() or runBatch() on it meanwhile.
+ Networks with LSTM or GRU layers are refused, since their outputs depend on the order of samples.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "neuron.h"
+
+#define BATCH_HIST_LEN  32                                          /* Power-of-two histogram buckets */
+
+/*
+#define __BATCHER_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct BatchResultType
+  {
+    double* z;                                                      //  malloc'd output, or NULL if refused
+    unsigned int len;                                               //  Length of 'z'
+  } BatchResult;
+
+typedef struct BatchRequestType
+  {
+    double* x;                                                      //  Copy of the input
+    promise<BatchResult>* result;                                   //  Fulfilled by the worker
+    chrono::steady_clock::time_point queued;                        //  When submit() queued it
+  } BatchRequest;
+
+/**************************************************************************************************
+ Batcher  */
+class Batcher
+  {
+    public:
+      Batcher(NeuralNet*, unsigned int, unsigned int);              //  Constructor(s): network, max batch, max delay (usec)
+      ~Batcher();                                                   //  Destructor: serves what is queued, then stops
+
+      future<BatchResult> submit(double*);                          //  Queue one input
+      void setMaxBatch(unsigned int);
+      void setMaxDelay(unsigned int);
+      unsigned int maxBatch() const;
+      unsigned int maxDelay() const;
+
+      unsigned long long requests() const;                          //  Requests served
+      unsigned long long batches() const;                           //  Batches run
+      void queueDepthHistogram(unsigned long long*) const;          //  Copy out BATCH_HIST_LEN counts
+      void batchSizeHistogram(unsigned long long*) const;           //  Copy out BATCH_HIST_LEN counts
+      void clearHistograms();
+      void print() const;
+
+    private:
+      NeuralNet* net;
+      unsigned int inputs;                                          //  Length of one input
+      bool refused;                                                 //  The network cannot be batched
+
+      atomic<unsigned int> batchMax;
+      atomic<unsigned int> delayMax;                                //  Microseconds
+
+      BatchRequest* queue;                                          //  Ring buffer of waiting requests
+      unsigned int queueCap;                                        //  Length of that array
+      unsigned int queueHead;                                       //  Oldest waiting request
+      unsigned int queueLen;                                        //  Number waiting
+      mutable mutex lock;                                           //  Guards the queue and the histograms
+      condition_variable ready;                                     //  Signals the worker
+      bool stopping;
+
+      unsigned long long depthHist[BATCH_HIST_LEN];
+      unsigned long long sizeHist[BATCH_HIST_LEN];
+      atomic<unsigned long long> served;
+      atomic<unsigned long long> batchCount;
+
+      double* X;                                                    //  Batch input assembly, (batchMax x inputs)
+      unsigned int XLen;                                            //  Length of that array
+      thread worker;
+
+      void serve();                                                 //  Body of the worker thread
+      static unsigned int bucket(unsigned int);
+  };
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef __CACHE_CPP
+#define __CACHE_CPP
+
+#include "cache.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Cache results for inputs of length 'inputs', holding at most 'capacity' of them. */
+RunCache::RunCache(unsigned int inputs, unsigned int capacity)
+  {
+    unsigned int i;
+
+    this->inputs = inputs;
+    cap = (capacity > 0) ? capacity : 1;
+    count = 0;
+    head = CACHE_NONE;
+    tail = CACHE_NONE;
+    hitCount = 0;
+    missCount = 0;
+
+    bucketLen = 1;                                                  //  At least twice the capacity keeps chains short
+    while(bucketLen < 2 * cap)
+      bucketLen <<= 1;
+
+    if((entries = (CacheEntry*)malloc(cap * sizeof(CacheEntry))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate result cache entries\n";
+        exit(1);
+      }
+    if((buckets = (unsigned int*)malloc(bucketLen * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate result cache buckets\n";
+        exit(1);
+      }
+    for(i = 0; i < cap; i++)
+      {
+        if((entries[i].x = (double*)malloc(inputs * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate result cache key\n";
+            exit(1);
+          }
+        entries[i].z = NULL;
+        entries[i].zlen = 0;
+        entries[i].zcap = 0;
+      }
+    for(i = 0; i < bucketLen; i++)
+      buckets[i] = CACHE_NONE;
+  }
+
+RunCache::~RunCache()
+  {
+    unsigned int i;
+
+    for(i = 0; i < cap; i++)
+      {
+        free(entries[i].x);
+        if(entries[i].z != NULL)
+          free(entries[i].z);
+      }
+    free(entries);
+    free(buckets);
+  }
+
+/**************************************************************************************************
+ Lookup and insertion  */
+
+/* If 'x' is cached, mark it most recently used, point '*z' to a malloc'd copy of its output (the caller frees it),
+   write the output's length to 'len', and return true. Otherwise return false. Either way, count it. */
+bool RunCache::lookup(double* x, double** z, unsigned int* len)
+  {
+    unsigned long long h = hash(x);
+    unsigned int e;
+
+    lock.lock();
+    e = find(x, h);
+    if(e == CACHE_NONE)
+      {
+        lock.unlock();
+        missCount++;
+        return false;
+      }
+
+    if(e != head)
+      {
+        unlink(e);
+        pushFront(e);
+      }
+    if(((*z) = (double*)malloc(entries[e].zlen * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate network output array\n";
+        exit(1);
+      }
+    memcpy((*z), entries[e].z, entries[e].zlen * sizeof(double));
+    *len = entries[e].zlen;
+    lock.unlock();
+
+    hitCount++;
+    return true;
+  }
+
+/* Store output 'z' of length 'len' for input 'x'. If 'x' is already cached (another caller got there first),
+   refresh it; otherwise take a free entry or evict the least recently used one. */
+void RunCache::insert(double* x, double* z, unsigned int len)
+  {
+    unsigned long long h = hash(x);
+    unsigned int e;
+    unsigned int b;
+
+    lock.lock();
+    e = find(x, h);
+    if(e != CACHE_NONE)
+      unlink(e);
+    else
+      {
+        if(count < cap)
+          e = count++;
+        else
+          {
+            e = tail;
+            unlink(e);
+            unchain(e);
+          }
+
+        entries[e].hash = h;
+        memcpy(entries[e].x, x, inputs * sizeof(double));
+        b = (unsigned int)(h & (bucketLen - 1));
+        entries[e].chain = buckets[b];
+        buckets[b] = e;
+      }
+
+    if(entries[e].zcap < len)
+      {
+        entries[e].zcap = len;
+        if((entries[e].z = (double*)realloc(entries[e].z, len * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate result cache value\n";
+            exit(1);
+          }
+      }
+    memcpy(entries[e].z, z, len * sizeof(double));
+    entries[e].zlen = len;
+    pushFront(e);
+    lock.unlock();
+
+    return;
+  }
+
+/* Drop every entry. Buffers are kept for reuse, as are the hit and miss counters. */
+void RunCache::clear()
+  {
+    unsigned int i;
+
+    lock.lock();
+    for(i = 0; i < bucketLen; i++)
+      buckets[i] = CACHE_NONE;
+    count = 0;
+    head = CACHE_NONE;
+    tail = CACHE_NONE;
+    lock.unlock();
+
+    return;
+  }
+
+/**************************************************************************************************
+ Counters  */
+
+/*  */
+unsigned int RunCache::capacity() const
+  {
+    return cap;
+  }
+
+/*  */
+unsigned int RunCache::size()
+  {
+    unsigned int n;
+
+    lock.lock();
+    n = count;
+    lock.unlock();
+
+    return n;
+  }
+
+/*  */
+unsigned long long RunCache::hits() const
+  {
+    return hitCount;
+  }
+
+/*  */
+unsigned long long RunCache::misses() const
+  {
+    return missCount;
+  }
+
+/**************************************************************************************************
+ Internals (call with 'lock' held)  */
+
+/* 64-bit FNV-1a over the bytes of the input. */
+unsigned long long RunCache::hash(double* x) const
+  {
+    const unsigned char* b = (const unsigned char*)x;
+    unsigned long long h = 14695981039346656037ULL;
+    unsigned int i;
+
+    for(i = 0; i < inputs * sizeof(double); i++)
+      {
+        h ^= b[i];
+        h *= 1099511628211ULL;
+      }
+
+    return h;
+  }
+
+/* Return the entry holding 'x', or CACHE_NONE. */
+unsigned int RunCache::find(double* x, unsigned long long h) const
+  {
+    unsigned int e = buckets[h & (bucketLen - 1)];
+
+    while(e != CACHE_NONE)
+      {
+        if(entries[e].hash == h && memcmp(entries[e].x, x, inputs * sizeof(double)) == 0)
+          return e;
+        e = entries[e].chain;
+      }
+
+    return CACHE_NONE;
+  }
+
+/* Remove entry 'e' from the recency list. */
+void RunCache::unlink(unsigned int e)
+  {
+    if(entries[e].prev != CACHE_NONE)
+      entries[entries[e].prev].next = entries[e].next;
+    else
+      head = entries[e].next;
+
+    if(entries[e].next != CACHE_NONE)
+      entries[entries[e].next].prev = entries[e].prev;
+    else
+      tail = entries[e].prev;
+
+    return;
+  }
+
+/* Remove entry 'e' from its hash chain. */
+void RunCache::unchain(unsigned int e)
+  {
+    unsigned int b = (unsigned int)(entries[e].hash & (bucketLen - 1));
+    unsigned int i;
+
+    if(buckets[b] == e)
+      buckets[b] = entries[e].chain;
+    else
+      {
+        for(i = buckets[b]; entries[i].chain != e; i = entries[i].chain);
+        entries[i].chain = entries[e].chain;
+      }
+
+    return;
+  }
+
+/* Make entry 'e' the most recently used. */
+void RunCache::pushFront(unsigned int e)
+  {
+    entries[e].prev = CACHE_NONE;
+    entries[e].next = head;
+    if(head != CACHE_NONE)
+      entries[head].prev = e;
+    head = e;
+    if(tail == CACHE_NONE)
+      tail = e;
+
+    return;
+  }
+
+#endif
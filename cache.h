@@ -0,0 +1,92 @@
+#ifndef __CACHE_H
+#define __CACHE_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ A bounded, least-recently-used cache of network results, keyed on the exact input vector.
+  inputs = length of every key
+  capacity = most entries held at once
+
+ Entries live in one preallocated array, linked into a doubly linked recency list (most recent at 'head')
+ and into singly linked hash chains. Keys are hashed with 64-bit FNV-1a over their bytes and then compared
+ in full, so a hit always means an identical input. When the cache is full, inserting evicts the entry at 'tail'.
+
+ All operations take one mutex, so a single RunCache may be shared by concurrent callers.
+ Hit and miss counters are atomic and may be read at any time.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_NONE  0xFFFFFFFF                                      /* Null link in the recency list and hash chains */
+
+/*
+#define __CACHE_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct CacheEntryType
+  {
+    unsigned long long hash;                                        //  Hash of the key
+    double* x;                                                      //  Key: copy of the input, 'inputs'-array
+    double* z;                                                      //  Value: copy of the output
+    unsigned int zlen;                                              //  Length of the output
+    unsigned int zcap;                                              //  Allocated length of 'z'
+
+    unsigned int prev;                                              //  Toward the most recently used
+    unsigned int next;                                              //  Toward the least recently used
+    unsigned int chain;                                             //  Next entry in the same hash bucket
+  } CacheEntry;
+
+/**************************************************************************************************
+ RunCache  */
+class RunCache
+  {
+    public:
+      RunCache(unsigned int, unsigned int);                         //  Constructor(s): input length, capacity
+      ~RunCache();                                                  //  Destructor
+
+      bool lookup(double*, double**, unsigned int*);                //  On a hit, write a malloc'd copy of the output
+      void insert(double*, double*, unsigned int);                  //  Add (or refresh) a result
+      void clear();                                                 //  Drop every entry; counters are kept
+      unsigned int capacity() const;
+      unsigned int size();
+      unsigned long long hits() const;
+      unsigned long long misses() const;
+
+    private:
+      unsigned int inputs;                                          //  Length of every key
+      unsigned int cap;                                             //  Capacity
+      unsigned int count;                                           //  Entries in use
+
+      CacheEntry* entries;                                          //  Array of 'cap' entries
+      unsigned int* buckets;                                        //  Head of each hash chain
+      unsigned int bucketLen;                                       //  Length of that array, a power of 2
+
+      unsigned int head;                                            //  Most recently used entry
+      unsigned int tail;                                            //  Least recently used entry
+
+      mutex lock;
+      atomic<unsigned long long> hitCount;
+      atomic<unsigned long long> missCount;
+
+      unsigned long long hash(double*) const;
+      unsigned int find(double*, unsigned long long) const;
+      void unlink(unsigned int);
+      void unchain(unsigned int);
+      void pushFront(unsigned int);
+  };
+
+#endif
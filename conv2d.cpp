@@ -0,0 +1,855 @@
+#ifndef __CONV2D_CPP
+#define __CONV2D_CPP
+
+#include "conv2d.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Input dimensions are width and height. */
+Conv2D::Conv2D(unsigned int w, unsigned int h)
+  {
+    unsigned int i;
+
+    inputW = w;
+    inputH = h;
+    n = 0;
+    fw = NULL;
+    fh = NULL;
+    strideH = NULL;
+    strideV = NULL;
+    f = NULL;
+    alpha = NULL;
+
+    W = NULL;
+    offset = NULL;
+    ownW = false;
+    nCap = 0;
+    wLen = 0;
+    wCap = 0;
+    sorted = true;
+
+    outlen = 0;
+    out = NULL;
+
+    preact = NULL;
+    x0 = NULL;
+    reported = NULL;
+    dirty = NULL;
+    deltaReady = false;
+    deltaRuns = 0;
+    partial = 0;
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+Conv2D::~Conv2D()
+  {
+    if(n > 0)
+      {
+        free(fw);
+        free(fh);
+        free(strideH);
+        free(strideV);
+        free(f);
+        free(alpha);
+        free(offset);
+      }
+    if(ownW)
+      free(W);
+    if(out != NULL)
+      free(out);
+    if(preact != NULL)
+      free(preact);
+    if(x0 != NULL)
+      free(x0);
+    if(reported != NULL)
+      free(reported);
+    if(dirty != NULL)
+      free(dirty);
+  }
+
+/**************************************************************************************************
+ Filters  */
+
+/* Add a (w by h) filter with random weights in [-1.0, 1.0], unit strides, and ReLU activation.
+   The filter's weights are appended to the slab, whose room doubles as needed; the next run(), runDelta() or pack()
+   sorts the slab by shape. Return the number of filters in this layer. */
+unsigned int Conv2D::addFilter(unsigned int w, unsigned int h)
+  {
+    unsigned int i;
+    unsigned int len = w * h + 1;
+    double* slab;
+
+    if(n == nCap)                                                   //  Grow the filter arrays geometrically
+      {
+        nCap = (nCap > 0) ? nCap * 2 : 4;
+        if((fw = (unsigned int*)realloc(fw, nCap * sizeof(int))) == NULL ||
+           (fh = (unsigned int*)realloc(fh, nCap * sizeof(int))) == NULL ||
+           (strideH = (unsigned int*)realloc(strideH, nCap * sizeof(int))) == NULL ||
+           (strideV = (unsigned int*)realloc(strideV, nCap * sizeof(int))) == NULL ||
+           (f = (unsigned char*)realloc(f, nCap * sizeof(char))) == NULL ||
+           (alpha = (double*)realloc(alpha, nCap * sizeof(double))) == NULL ||
+           (offset = (unsigned int*)realloc(offset, nCap * sizeof(int))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Conv2D layer's filter arrays\n";
+            exit(1);
+          }
+      }
+
+    if(!ownW || wLen + len > wCap)                                  //  Grow the slab, or take it back from an Arena
+      {
+        if(wLen + len > wCap)
+          wCap = (wCap * 2 > wLen + len) ? wCap * 2 : wLen + len;
+        slab = Arena::alignedAlloc(wCap);
+        if(wLen > 0)
+          memcpy(slab, W, wLen * sizeof(double));
+        if(ownW)
+          free(W);
+        W = slab;
+        ownW = true;
+      }
+
+    fw[n] = w;
+    fh[n] = h;
+    strideH[n] = 1;
+    strideV[n] = 1;
+    f[n] = RELU;
+    alpha[n] = 1.0;
+    offset[n] = wLen;
+    for(i = 0; i < len; i++)                                        //  Generate random numbers in [ -1.0, 1.0 ]
+      W[wLen + i] = -1.0 + ((double)rand() / ((double)RAND_MAX * 0.5));
+    wLen += len;
+    n++;
+    sorted = false;
+    deltaReady = false;
+
+    return n;
+  }
+
+/* Remove the i-th filter and its output map. Later filters move down one place, and their outputs move up in
+   'out'. The weight slab is rebuilt, still sorted by shape. A layer keeps at least one filter.
+   Return the number of filters left. */
+unsigned int Conv2D::removeFilter(unsigned int i)
+  {
+    unsigned int j;
+    unsigned int* newOffset;
+    unsigned int* oldOffset;
+    double* slab;
+
+    if(i >= n || n == 1)
+      return n;
+
+    oldOffset = offset;                                             //  Weights of filter j are still at oldOffset[j]
+    n--;
+    memmove(oldOffset + i, oldOffset + i + 1, (n - i) * sizeof(int));
+    memmove(fw + i, fw + i + 1, (n - i) * sizeof(int));
+    memmove(fh + i, fh + i + 1, (n - i) * sizeof(int));
+    memmove(strideH + i, strideH + i + 1, (n - i) * sizeof(int));
+    memmove(strideV + i, strideV + i + 1, (n - i) * sizeof(int));
+    memmove(f + i, f + i + 1, (n - i) * sizeof(char));
+    memmove(alpha + i, alpha + i + 1, (n - i) * sizeof(double));
+
+    if((newOffset = (unsigned int*)malloc(n * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Conv2D layer's filter layout\n";
+        exit(1);
+      }
+    wLen = layout(newOffset);
+    slab = Arena::alignedAlloc(wLen);
+    for(j = 0; j < n; j++)
+      memcpy(slab + newOffset[j], W + oldOffset[j], (fw[j] * fh[j] + 1) * sizeof(double));
+
+    if(ownW)
+      free(W);
+    free(oldOffset);
+    W = slab;
+    offset = newOffset;
+    ownW = true;
+    nCap = n;
+    wCap = wLen;
+    sorted = true;
+    deltaReady = false;                                             //  'out' is resized by the next run
+
+    return n;
+  }
+
+/* Sum of the magnitudes of the i-th filter's weights, bias excluded: no input of largest magnitude m can move the
+   filter's pre-activation further than this times m from its bias. */
+double Conv2D::filterNorm_i(unsigned int i) const
+  {
+    unsigned int j;
+    double s = 0.0;
+
+    for(j = 0; j < fw[i] * fh[i]; j++)
+      s += fabs(W[offset[i] + j]);
+
+    return s;
+  }
+
+/* What every output of the i-th filter would be, were its weights all zero. */
+double Conv2D::constant_i(unsigned int i) const
+  {
+    if(f[i] == SOFTMAX)                                             //  exp(b) over the whole map
+      return 1.0 / (double)(outputWidth(i) * outputHeight(i));
+    return activation(i, W[offset[i] + fw[i] * fh[i]]);
+  }
+
+/* Set entirety of the i-th filter: w is length width * height + 1, bias last. */
+void Conv2D::setW_i(double* w, unsigned int i)
+  {
+    unsigned int j;
+
+    if(i < n)
+      {
+        for(j = 0; j < fw[i] * fh[i] + 1; j++)
+          W[offset[i] + j] = w[j];
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Set the j-th weight of the i-th filter. */
+void Conv2D::setW_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < n && j <= fw[i] * fh[i])
+      {
+        W[offset[i] + j] = w;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Set the horizontal stride of the i-th filter. */
+void Conv2D::setHorzStride_i(unsigned int stride, unsigned int i)
+  {
+    if(i < n && stride > 0)
+      {
+        strideH[i] = stride;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Set the vertical stride of the i-th filter. */
+void Conv2D::setVertStride_i(unsigned int stride, unsigned int i)
+  {
+    if(i < n && stride > 0)
+      {
+        strideV[i] = stride;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Set the activation function of the i-th filter. */
+void Conv2D::setF_i(unsigned char func, unsigned int i)
+  {
+    if(i < n && func <= LINEAR)
+      {
+        f[i] = func;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Set the activation function parameter of the i-th filter. */
+void Conv2D::setA_i(double a, unsigned int i)
+  {
+    if(i < n)
+      {
+        alpha[i] = a;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/*  */
+void Conv2D::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/*  */
+unsigned char Conv2D::getF_i(unsigned int i) const
+  {
+    return f[i];
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* Conv2D::name() const
+  {
+    return (char*)layerName;
+  }
+
+/*  */
+void Conv2D::print() const
+  {
+    unsigned int i, x, y;
+
+    printf("Input Shape = (%d, %d)\n", inputW, inputH);
+    for(i = 0; i < n; i++)
+      {
+        printf("Filter %d\n", i);
+        for(y = 0; y < fh[i]; y++)
+          {
+            printf("  [");
+            for(x = 0; x < fw[i]; x++)
+              printf(" %.5f", W[offset[i] + y * fw[i] + x]);
+            printf(" ]\n");
+          }
+        printf("  Bias = %.5f\n", W[offset[i] + fw[i] * fh[i]]);
+        printf("  Stride = (%d, %d)\n", strideH[i], strideV[i]);
+        printf("  Func = ");
+        switch(f[i])
+          {
+            case RELU:                printf("ReLU");                 break;
+            case LEAKY_RELU:          printf("L.ReLU");               break;
+            case SIGMOID:             printf("Sig.");                 break;
+            case HYPERBOLIC_TANGENT:  printf("tanH");                 break;
+            case SOFTMAX:             printf("SoftMx");               break;
+            case SYMMETRICAL_SIGMOID: printf("SymSig");               break;
+            case THRESHOLD:           printf("Thresh");               break;
+            default:                  printf("Linear");               break;
+          }
+        printf(", Param = %.5f\n", alpha[i]);
+      }
+    return;
+  }
+
+/*  */
+unsigned int Conv2D::filterCount() const
+  {
+    return n;
+  }
+
+/*  */
+unsigned int Conv2D::inputWidth() const
+  {
+    return inputW;
+  }
+
+/*  */
+unsigned int Conv2D::inputHeight() const
+  {
+    return inputH;
+  }
+
+/*  */
+unsigned int Conv2D::outputWidth(unsigned int i) const
+  {
+    return (inputW - fw[i]) / strideH[i] + 1;
+  }
+
+/*  */
+unsigned int Conv2D::outputHeight(unsigned int i) const
+  {
+    return (inputH - fh[i]) / strideV[i] + 1;
+  }
+
+/*  */
+double* Conv2D::output() const
+  {
+    return out;
+  }
+
+/* Sum of the areas of every filter's output. */
+unsigned int Conv2D::outputLen() const
+  {
+    unsigned int i;
+    unsigned int len = 0;
+
+    for(i = 0; i < n; i++)
+      len += outputWidth(i) * outputHeight(i);
+
+    return len;
+  }
+
+/**************************************************************************************************
+ Run layer  */
+
+/* Convolve the (inputW * inputH) row-major input 'x' with every filter, concatenating the results in 'out'.
+   SOFTMAX is taken over each filter's entire output. */
+unsigned int Conv2D::run(double* x)
+  {
+    unsigned int i, j;
+    unsigned int pos = 0;
+    unsigned int len;
+    double s;
+
+    settle();
+    if(out == NULL || outlen != outputLen())
+      {
+        outlen = outputLen();
+        if((out = (double*)realloc(out, outlen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Conv2D layer's output buffer\n";
+            exit(1);
+          }
+      }
+
+    for(i = 0; i < n; i++)
+      {
+        len = outputWidth(i) * outputHeight(i);
+        runRegion(i, x, 0, 0, inputW, 0, 0, outputWidth(i), outputHeight(i), out + pos);
+
+        if(f[i] == SOFTMAX)
+          {
+            s = 0.0;
+            for(j = 0; j < len; j++)
+              s += out[pos + j];
+            for(j = 0; j < len; j++)
+              out[pos + j] /= s;
+          }
+
+        pos += len;
+      }
+    deltaReady = false;                                             //  'out' no longer matches 'preact'
+
+    return outlen;
+  }
+
+/* Write to 'rect' = { x0, y0, x1, y1 } the region of the input (right and bottom bounds excluded) that the i-th
+   filter reads to produce output columns [x0, x1) and rows [y0, y1). */
+void Conv2D::inputRegion(unsigned int i, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+                         unsigned int* rect) const
+  {
+    rect[0] = x0 * strideH[i];
+    rect[1] = y0 * strideV[i];
+    rect[2] = (x1 - 1) * strideH[i] + fw[i];
+    rect[3] = (y1 - 1) * strideV[i] + fh[i];
+    return;
+  }
+
+/* Compute output columns [x0, x1) and rows [y0, y1) of the i-th filter into 'dst', row-major and (x1 - x0) wide.
+   'in' holds a region of the input whose top-left corner is (inX, inY) and whose rows are 'inW' long;
+   it must cover at least what inputRegion() reports. SOFTMAX is left un-normalized here: it needs the whole map. */
+void Conv2D::runRegion(unsigned int i, double* in, unsigned int inX, unsigned int inY, unsigned int inW,
+                       unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, double* dst) const
+  {
+    unsigned int j;
+
+    convolve(i, in, inX, inY, inW, x0, y0, x1, y1, dst);
+    for(j = 0; j < (x1 - x0) * (y1 - y0); j++)
+      dst[j] = activation(i, dst[j]);
+
+    return;
+  }
+
+/* Like runRegion(), but write pre-activations: bias plus the weighted sum under the filter. */
+void Conv2D::convolve(unsigned int i, double* in, unsigned int inX, unsigned int inY, unsigned int inW,
+                      unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, double* dst) const
+  {
+    unsigned int x, y, r, c;
+    const double* wt = W + offset[i];                               //  This filter's weights, bias last
+    const unsigned int w = fw[i];
+    const unsigned int h = fh[i];
+    const double* src;
+    double s;
+
+    for(y = y0; y < y1; y++)
+      {
+        for(x = x0; x < x1; x++)
+          {
+            s = wt[w * h];                                          //  Start with the bias
+            for(r = 0; r < h; r++)
+              {
+                src = in + (y * strideV[i] + r - inY) * inW + (x * strideH[i] - inX);
+                for(c = 0; c < w; c++)
+                  s += wt[r * w + c] * src[c];
+              }
+            dst[(y - y0) * (x1 - x0) + (x - x0)] = s;
+          }
+      }
+
+    return;
+  }
+
+/* Apply the i-th filter's activation function to 's'. SOFTMAX returns exp(s), to be normalized by the caller. */
+double Conv2D::activation(unsigned int i, double s) const
+  {
+    switch(f[i])
+      {
+        case RELU:                return (s > 0.0) ? s : 0.0;
+        case LEAKY_RELU:          return (s > 0.0) ? s : s * alpha[i];
+        case SIGMOID:             return 1.0 / (1.0 + exp(-s * alpha[i]));
+        case HYPERBOLIC_TANGENT:  return (2.0 / (1.0 + exp(-2.0 * s * alpha[i]))) - 1.0;
+        case SOFTMAX:             return exp(s);
+        case SYMMETRICAL_SIGMOID: return (1.0 - exp(-s * alpha[i])) / (1.0 + exp(-s * alpha[i]));
+        case THRESHOLD:           return (s > alpha[i]) ? 1.0 : 0.0;
+      }
+    return s * alpha[i];
+  }
+
+/**************************************************************************************************
+ Incremental run  */
+
+/* Like run(), but update the previous pre-activations with only the input pixels that moved by more than 'tol'.
+   A changed pixel touches only the outputs whose receptive fields cover it, so each output under it gets
+   (x - x_prev) times the matching filter weight. Return the number of outputs that moved by more than 'tol'
+   since they were last reported, so that the caller can skip layers downstream of a layer that returns 0.
+   The first call after construction, resetDelta(), or any filter change runs in full and reports every output. */
+unsigned int Conv2D::runDelta(double* x, double tol)
+  {
+    unsigned int i, j, p;
+    unsigned int px, py, ox, oy, oxLo, oxHi, oyLo, oyHi;
+    unsigned int w, h;
+    unsigned int pos;
+    unsigned int changed = 0;
+    unsigned int moved = 0;
+    unsigned int len = inputW * inputH;
+    bool full;
+    double dx, s;
+    const double* wt;
+
+    settle();
+    if(!deltaReady || outlen != outputLen() || out == NULL)
+      {
+        outlen = outputLen();
+        if((out = (double*)realloc(out, outlen * sizeof(double))) == NULL ||
+           (preact = (double*)realloc(preact, outlen * sizeof(double))) == NULL ||
+           (reported = (double*)realloc(reported, outlen * sizeof(double))) == NULL ||
+           (dirty = (bool*)realloc(dirty, outlen * sizeof(bool))) == NULL ||
+           (x0 = (double*)realloc(x0, len * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Conv2D layer's incremental buffers\n";
+            exit(1);
+          }
+        full = true;
+      }
+    else
+      {
+        for(p = 0; p < len; p++)
+          {
+            if(fabs(x[p] - x0[p]) > tol)
+              changed++;
+          }
+        if(changed == 0)
+          return 0;
+        full = (changed > (unsigned int)(DELTA_DENSITY * len) || deltaRuns >= DELTA_REFRESH);
+      }
+
+    if(full)
+      {
+        pos = 0;
+        for(i = 0; i < n; i++)
+          {
+            convolve(i, x, 0, 0, inputW, 0, 0, outputWidth(i), outputHeight(i), preact + pos);
+            pos += outputWidth(i) * outputHeight(i);
+          }
+        memcpy(x0, x, len * sizeof(double));
+        for(j = 0; j < outlen; j++)
+          dirty[j] = true;
+        deltaRuns = 0;
+      }
+    else
+      {
+        for(j = 0; j < outlen; j++)
+          dirty[j] = false;
+
+        for(p = 0; p < len; p++)
+          {
+            dx = x[p] - x0[p];
+            if(fabs(dx) <= tol)
+              continue;
+
+            px = p % inputW;
+            py = p / inputW;
+            pos = 0;
+            for(i = 0; i < n; i++)                                  //  Outputs whose receptive field covers (px, py)
+              {
+                wt = W + offset[i];
+                w = outputWidth(i);
+                h = outputHeight(i);
+                oxLo = (px + 1 > fw[i]) ? (px + 1 - fw[i] + strideH[i] - 1) / strideH[i] : 0;
+                oyLo = (py + 1 > fh[i]) ? (py + 1 - fh[i] + strideV[i] - 1) / strideV[i] : 0;
+                oxHi = (px / strideH[i] < w - 1) ? px / strideH[i] : w - 1;
+                oyHi = (py / strideV[i] < h - 1) ? py / strideV[i] : h - 1;
+                for(oy = oyLo; oy <= oyHi && oyLo <= oyHi; oy++)
+                  {
+                    for(ox = oxLo; ox <= oxHi && oxLo <= oxHi; ox++)
+                      {
+                        preact[pos + oy * w + ox] += dx * wt[(py - oy * strideV[i]) * fw[i] + (px - ox * strideH[i])];
+                        dirty[pos + oy * w + ox] = true;
+                      }
+                  }
+                pos += w * h;
+              }
+            x0[p] = x[p];
+          }
+        deltaRuns++;
+        partial++;
+      }
+
+    pos = 0;
+    for(i = 0; i < n; i++)                                          //  Re-activate what was touched
+      {
+        len = outputWidth(i) * outputHeight(i);
+        if(f[i] == SOFTMAX)                                         //  Any change moves the whole map's normalization
+          {
+            for(j = 0; j < len && !dirty[pos + j]; j++);
+            if(j < len)
+              {
+                s = 0.0;
+                for(j = 0; j < len; j++)
+                  {
+                    out[pos + j] = exp(preact[pos + j]);
+                    s += out[pos + j];
+                    dirty[pos + j] = true;
+                  }
+                for(j = 0; j < len; j++)
+                  out[pos + j] /= s;
+              }
+          }
+        else
+          {
+            for(j = 0; j < len; j++)
+              {
+                if(dirty[pos + j])
+                  out[pos + j] = activation(i, preact[pos + j]);
+              }
+          }
+        pos += len;
+      }
+
+    if(!deltaReady)
+      {
+        memcpy(reported, out, outlen * sizeof(double));
+        deltaReady = true;
+        return outlen;
+      }
+
+    for(j = 0; j < outlen; j++)
+      {
+        if(dirty[j] && fabs(out[j] - reported[j]) > tol)
+          {
+            reported[j] = out[j];
+            moved++;
+          }
+      }
+
+    return moved;
+  }
+
+/*  */
+void Conv2D::resetDelta()
+  {
+    deltaReady = false;
+    return;
+  }
+
+/* Number of runDelta() calls over the layer's life that updated the outputs in place rather than recomputing
+   them: zero means incremental inference has done no incremental work here. */
+unsigned long long Conv2D::partialRuns() const
+  {
+    return partial;
+  }
+
+/**************************************************************************************************
+ Storage  */
+
+/* Length of the weight slab: every filter's (w * h) weights plus its bias. */
+unsigned int Conv2D::weightsLen() const
+  {
+    unsigned int i;
+    unsigned int len = 0;
+
+    for(i = 0; i < n; i++)
+      len += fw[i] * fh[i] + 1;
+
+    return len;
+  }
+
+/* Number of stored parameters: every filter's weights and bias. */
+unsigned int Conv2D::params() const
+  {
+    return weightsLen();
+  }
+
+/* Floating-point operations in one run(), counting a multiply-add as two. Activations are not counted. */
+unsigned long long Conv2D::flops() const
+  {
+    unsigned int i;
+    unsigned long long ops = 0;
+
+    for(i = 0; i < n; i++)
+      ops += 2ULL * fw[i] * fh[i] * outputWidth(i) * outputHeight(i);
+
+    return ops;
+  }
+
+/* Lay out a slab for the current filters, sorted by (height, width) and otherwise in order: write where each
+   filter's weights begin to the n-array 'pos', and return the slab's length. */
+unsigned int Conv2D::layout(unsigned int* pos) const
+  {
+    unsigned int i, j, k;
+    unsigned int len = 0;
+    unsigned int* order;
+
+    if(n == 0)
+      return 0;
+    if((order = (unsigned int*)malloc(n * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Conv2D layer's filter order\n";
+        exit(1);
+      }
+    for(i = 0; i < n; i++)                                          //  Insertion sort by (height, width), stable
+      {
+        k = i;
+        for(j = i; j > 0 && (fh[order[j - 1]] > fh[k] || (fh[order[j - 1]] == fh[k] && fw[order[j - 1]] > fw[k])); j--)
+          order[j] = order[j - 1];
+        order[j] = k;
+      }
+    for(i = 0; i < n; i++)
+      {
+        pos[order[i]] = len;
+        len += fw[order[i]] * fh[order[i]] + 1;
+      }
+    free(order);
+
+    return len;
+  }
+
+/* Lay out the slab sorted by shape, if filters were added since it last was. The slab then fits exactly. */
+void Conv2D::settle()
+  {
+    unsigned int i;
+    unsigned int* newOffset;
+    double* slab;
+
+    if(sorted)
+      return;
+
+    if((newOffset = (unsigned int*)malloc(nCap * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Conv2D layer's filter layout\n";
+        exit(1);
+      }
+    wLen = layout(newOffset);
+    slab = Arena::alignedAlloc(wLen);
+    for(i = 0; i < n; i++)
+      memcpy(slab + newOffset[i], W + offset[i], (fw[i] * fh[i] + 1) * sizeof(double));
+
+    if(ownW)
+      free(W);
+    free(offset);
+    W = slab;
+    offset = newOffset;
+    ownW = true;
+    wCap = wLen;
+    sorted = true;
+
+    return;
+  }
+
+/* Sort the weight slab if need be, then copy it into 'arena' and use it from there; the copy leaves 'offset' as is.
+   The Arena must outlive this layer, or the layer must be packed again elsewhere first.
+   Adding a filter afterward moves the slab back into memory this layer owns. */
+void Conv2D::pack(Arena* arena)
+  {
+    double* slab;
+
+    if(n == 0)
+      return;
+
+    settle();
+    slab = arena->alloc(weightsLen());
+    memcpy(slab, W, weightsLen() * sizeof(double));
+    if(ownW)
+      free(W);
+    W = slab;
+    ownW = false;
+
+    return;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input dimensions, number of filters, then each filter in the order it was
+   added: shape, strides, function, parameter, and its (w * h) weights and bias. Then name.
+   Return false if writing fails. */
+bool Conv2D::write(FILE* fp) const
+  {
+    unsigned int i;
+    unsigned int k;
+    bool ok = true;
+
+    ok = ok && fwrite(&inputW, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&inputH, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&n, sizeof(int), 1, fp) == 1;
+    for(i = 0; i < n && ok; i++)
+      {
+        k = fw[i] * fh[i] + 1;
+        ok = ok && fwrite(fw + i, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(fh + i, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(strideH + i, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(strideV + i, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(f + i, sizeof(char), 1, fp) == 1;
+        ok = ok && fwrite(alpha + i, sizeof(double), 1, fp) == 1;
+        ok = ok && fwrite(W + offset[i], sizeof(double), k, fp) == k;
+      }
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same input dimensions and no filters yet.
+   Return false, leaving the layer unusable, if reading fails or the layer does not fit. */
+bool Conv2D::read(FILE* fp)
+  {
+    unsigned int i, j;
+    unsigned int w, h, count;
+    unsigned int sh, sv;
+    unsigned char func;
+    double a;
+    double* wt;
+    bool ok = true;
+
+    ok = ok && fread(&w, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&h, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&count, sizeof(int), 1, fp) == 1;
+    if(!ok || w != inputW || h != inputH || n > 0)
+      {
+        cout << "ERROR: Stored Conv2D layer does not match this layer\n";
+        return false;
+      }
+    for(i = 0; i < count && ok; i++)
+      {
+        ok = ok && fread(&w, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&h, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&sh, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&sv, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&func, sizeof(char), 1, fp) == 1;
+        ok = ok && fread(&a, sizeof(double), 1, fp) == 1;
+        if(!ok || w == 0 || h == 0 || w > inputW || h > inputH)
+          {
+            cout << "ERROR: Stored Conv2D filter does not fit this layer\n";
+            return false;
+          }
+        addFilter(w, h);
+        setHorzStride_i(sh, i);
+        setVertStride_i(sv, i);
+        setF_i(func, i);
+        setA_i(a, i);
+        wt = W + offset[i];
+        for(j = 0; j < w * h + 1 && ok; j++)
+          ok = fread(wt + j, sizeof(double), 1, fp) == 1;
+      }
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+    deltaReady = false;
+
+    return ok;
+  }
+
+#endif
@@ -19,15 +19,33 @@
 
  Filters needn't be arranged from smallest to largest; this is just for illustration.
 
+ Filter metadata is kept as parallel arrays (structure-of-arrays), and all filters' weights share one aligned,
+ contiguous slab. Within the slab, filters are laid out sorted by shape, so filters of the same size sit side
+ by side; 'offset' maps each filter, in the order it was added, to its weights. addFilter() only appends to the
+ slab, so building a layer filter by filter stays linear; the slab is sorted once, by the next run(), runDelta()
+ or pack(). A NeuralNet may move the slab into its Arena with pack(), so that the filter banks of all its Conv2D
+ layers form one region.
+
+ Each filter slides over the input without padding ("valid" convolution), so the i-th filter's output is
+ ((inputW - w_i) / stride_h_i + 1) wide and ((inputH - h_i) / stride_v_i + 1) tall. Filter outputs are
+ concatenated in 'out' in the order the filters were added.
+
+ runDelta() is an incremental alternative to run() for inputs that change sparsely between calls: only the
+ receptive fields covering input pixels that moved by more than a tolerance are updated. If too many pixels
+ moved, the layer recomputes in full, and it also recomputes every DELTA_REFRESH updates to shed round-off.
+
  Note that this file does NOT seed the randomizer. That should be done by the parent program.
 ***************************************************************************************************/
 
 #include <iostream>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+
 #define RELU                 0                                      /* [ 0.0, inf) */
 #define LEAKY_RELU           1                                      /* (-inf, inf) */
 #define SIGMOID              2                                      /* ( 0.0, 1.0) */
@@ -39,29 +57,15 @@
 
 #define LAYER_NAME_LEN  32                                          /* Length of a Layer 'name' string */
 
+#define DELTA_REFRESH  256                                          /* Incremental updates between full recomputations */
+#define DELTA_DENSITY  0.25                                         /* Above this fraction of changed inputs, recompute in full */
+
 /*
 #define __CONV2D_DEBUG 1
 */
 
 using namespace std;
 
-/**************************************************************************************************
- Typedefs  */
-
-typedef struct Filter2DType
-  {
-    unsigned int w;                                                 //  Width of the filter
-    unsigned int h;                                                 //  Height of the filter
-
-    unsigned int stride_h;                                          //  Stride by which we move the filter left to right
-    unsigned int stride_v;                                          //  Stride by which we move the filter top to bottom
-
-    unsigned char f;                                                //  Function flag, in {RELU, LEAKY_RELU, ..., THRESHOLD, LINEAR}
-    double alpha;                                                   //  Function parameter (not always applicable)
-
-    double* W;                                                      //  Array of (w * h) weights, arranged row-major, +1 for the bias
-  } Filter2D;
-
 /**************************************************************************************************
  Conv2D  */
 class Conv2D
@@ -71,6 +75,7 @@ class Conv2D
       ~Conv2D();                                                    //  Destructor
 
       unsigned int addFilter(unsigned int, unsigned int);           //  Add a filter to the layer
+      unsigned int removeFilter(unsigned int);                      //  Delete a filter and its output map
       void setW_i(double*, unsigned int);                           //  Set entirety of i-th filter; w is length width * height + 1
       void setW_ij(double, unsigned int, unsigned int);             //  Set the j-th weight of the i-th filter
       void setHorzStride_i(unsigned int, unsigned int);             //  Set the horizontal stride of the i-the filter
@@ -78,21 +83,71 @@ class Conv2D
       void setF_i(unsigned char, unsigned int);                     //  Set activation function of i-th filter
       void setA_i(double, unsigned int);                            //  Set activation function parameter of i-th filter
       void setName(char*);
+      unsigned char getF_i(unsigned int) const;                     //  Get activation function of i-th filter
       char* name() const;
       void print() const;
+      unsigned int filterCount() const;
+      unsigned int inputWidth() const;
+      unsigned int inputHeight() const;
+      unsigned int outputWidth(unsigned int) const;                 //  Width of the i-th filter's output
+      unsigned int outputHeight(unsigned int) const;                //  Height of the i-th filter's output
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      unsigned int runDelta(double*, double);                       //  Incremental run; returns the number of outputs that moved
+      void resetDelta();                                            //  Forget the previous input: next runDelta() is in full
+      unsigned long long partialRuns() const;                       //  runDelta() calls answered by an in-place update
+      double filterNorm_i(unsigned int) const;                      //  L1 norm of the i-th filter's weights, bias excluded
+      double constant_i(unsigned int) const;                        //  The i-th filter's output were its weights zero
+      unsigned int params() const;                                  //  Stored weights and biases
+      unsigned long long flops() const;                             //  Floating-point operations per run()
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
+      unsigned int weightsLen() const;                              //  Length of the weight slab, in doubles
+      void pack(Arena*);                                            //  Move the weight slab into an Arena
+                                                                    //  Region of the input needed for a region of the i-th output
+      void inputRegion(unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int*) const;
+                                                                    //  Compute a region of the i-th output from a region of the input
+      void runRegion(unsigned int, double*, unsigned int, unsigned int, unsigned int,
+                     unsigned int, unsigned int, unsigned int, unsigned int, double*) const;
 
     private:
       unsigned int inputW;                                          //  Dimensions of the input
       unsigned int inputH;                                    
       unsigned int n;                                               //  Number of processing units in this layer =
                                                                     //  number of filters in this layer
-      Filter2D* filters;                                            //  Array of 2D filter structs
-
-      char name[LAYER_NAME_LEN];
+      unsigned int* fw;                                             //  Width of each filter, n-array
+      unsigned int* fh;                                             //  Height of each filter, n-array
+      unsigned int* strideH;                                        //  Stride by which each filter moves left to right, n-array
+      unsigned int* strideV;                                        //  Stride by which each filter moves top to bottom, n-array
+      unsigned char* f;                                             //  Function flag of each filter, n-array
+      double* alpha;                                                //  Function parameter of each filter, n-array
+
+      double* W;                                                    //  Every filter's (w * h) row-major weights, then its bias
+      unsigned int* offset;                                         //  Where each filter's weights begin in 'W', n-array
+      bool ownW;                                                    //  Whether 'W' is ours to free, or lives in an Arena
+      unsigned int nCap;                                            //  Filters the parallel arrays have room for
+      unsigned int wLen;                                            //  Doubles of 'W' in use
+      unsigned int wCap;                                            //  Doubles of 'W' allocated, when ours
+      bool sorted;                                                  //  Whether 'W' is laid out by shape yet
+
+      char layerName[LAYER_NAME_LEN];
       unsigned int outlen;                                          //  Length of the output buffer
-      double* out;
+      double* out;                                                  //  Allocated by the first full run()
+
+      double* preact;                                               //  Pre-activations of the last runDelta(), outlen-array
+      double* x0;                                                   //  Input that 'preact' reflects, (inputW * inputH)-array
+      double* reported;                                             //  Outputs as of the last time each was reported moved
+      bool* dirty;                                                  //  Outputs touched by the current runDelta(), outlen-array
+      bool deltaReady;                                              //  Whether 'preact' and 'x0' are current
+      unsigned int deltaRuns;                                       //  Incremental updates since the last full computation
+      unsigned long long partial;                                   //  Lifetime count of in-place updates, for partialRuns()
+
+      void convolve(unsigned int, double*, unsigned int, unsigned int, unsigned int,
+                    unsigned int, unsigned int, unsigned int, unsigned int, double*) const;
+      double activation(unsigned int, double) const;
+      unsigned int layout(unsigned int*) const;                     //  Shape-sorted slab offsets; returns the slab length
+      void settle();                                                //  Lay out filters added since the last call by shape
   };
 
 #endif
\ No newline at end of file
@@ -11,9 +11,23 @@ Dense::Dense(unsigned int inputs, unsigned int nodes)
   {
     unsigned int x, y;
 
-    W = new MatrixXf(inputs + 1, nodes);
-    M = new MatrixXf(inputs + 1, nodes);
-    out = new VectorXf(nodes);
+    this->inputs = inputs;
+    this->nodes = nodes;
+
+    W.resize(inputs + 1, nodes);
+    M.resize(inputs + 1, nodes);
+    out.resize(nodes);
+    preact.resize(nodes);
+    x0.resize(inputs);
+    reported.resize(nodes);
+    deltaReady = false;
+    deltaRuns = 0;
+    partial = 0;
+
+    factorRank = 0;
+    maskRow = NULL;
+    maskCol = NULL;
+    maskVal = NULL;
     if((f = (unsigned char*)malloc(nodes * sizeof(char))) == NULL)
       {
         cout << "ERROR: Unable to allocate Dense layer's internal output array\n";
@@ -34,6 +48,8 @@ Dense::Dense(unsigned int inputs, unsigned int nodes)
           }
       }
 
+    WM = W;                                                         //  Nothing is masked yet
+
     for(x = 0; x < nodes; x++)                                      //  Default all to ReLU with parameter = 1.0
       {
         f[x] = RELU;
@@ -46,65 +62,197 @@ Dense::Dense(unsigned int inputs, unsigned int nodes)
 
 Dense::~Dense()
   {
-    delete W;
-    delete M;
-    delete out;
     free(f);
     free(alpha);
+    if(factorRank > 0)
+      {
+        free(maskRow);
+        free(maskCol);
+        free(maskVal);
+      }
   }
 
 /**************************************************************************************************
  Weight matrix  */
 
-/*  */
-void Dense::setW(double*)
+/* Set the entire ((i + 1) x n) weight matrix from 'w', row-major, biases last. */
+void Dense::setW(double* w)
   {
+    unsigned int x, y;
+
+    unfactorize();
+    for(y = 0; y <= inputs; y++)
+      for(x = 0; x < nodes; x++)
+        W(y, x) = w[y * nodes + x];
+    WM = W.cwiseProduct(M);
+    deltaReady = false;
+    return;
   }
 
-/*  */
-void Dense::setW_i(double*, unsigned int)
+/* Set the (i + 1) weights of the i-th unit, bias last. */
+void Dense::setW_i(double* w, unsigned int i)
   {
+    unsigned int y;
+
+    if(i < nodes)
+      {
+        unfactorize();
+        for(y = 0; y <= inputs; y++)
+          W(y, i) = w[y];
+        WM.col(i) = W.col(i).cwiseProduct(M.col(i));
+        deltaReady = false;
+      }
+    return;
   }
 
 /*  */
-void Dense::setW_ij(double, unsigned int, unsigned int)
+void Dense::setW_ij(double w, unsigned int i, unsigned int j)
   {
+    if(i <= inputs && j < nodes)
+      {
+        if(i == inputs && factorRank > 0)                           //  The bias row is never factorized
+          factorBias(j) = w;
+        else
+          {
+            unfactorize();
+            W(i, j) = w;
+            WM(i, j) = w * M(i, j);
+          }
+        deltaReady = false;
+      }
+    return;
   }
 
 /**************************************************************************************************
  Mask matrix  */
 
-/*  */
-void Dense::setM(bool*)
+/* Set the (i x n) mask matrix from 'm', row-major. Biases are never masked. */
+void Dense::setM(bool* m)
   {
+    unsigned int x, y;
+
+    unfactorize();
+    for(y = 0; y < inputs; y++)
+      for(x = 0; x < nodes; x++)
+        M(y, x) = m[y * nodes + x] ? 1.0 : 0.0;
+    WM = W.cwiseProduct(M);
+    deltaReady = false;
+    return;
   }
 
-/*  */
-void Dense::setM_i(bool*, unsigned int)
+/* Set the i masks of the i-th unit. */
+void Dense::setM_i(bool* m, unsigned int i)
   {
+    unsigned int y;
+
+    if(i < nodes)
+      {
+        unfactorize();
+        for(y = 0; y < inputs; y++)
+          M(y, i) = m[y] ? 1.0 : 0.0;
+        WM.col(i) = W.col(i).cwiseProduct(M.col(i));
+        deltaReady = false;
+      }
+    return;
   }
 
 /*  */
-void Dense::setM_ij(bool, unsigned int, unsigned int)
+void Dense::setM_ij(bool m, unsigned int i, unsigned int j)
   {
+    if(i < inputs && j < nodes)
+      {
+        unfactorize();
+        M(i, j) = m ? 1.0 : 0.0;
+        WM(i, j) = W(i, j) * M(i, j);
+        deltaReady = false;
+      }
+    return;
   }
 
 /**************************************************************************************************
  Other setters  */
 
 /*  */
-void Dense::setF_i(unsigned char, unsigned int)
+void Dense::setF_i(unsigned char func, unsigned int i)
+  {
+    if(i < nodes && func <= LINEAR)
+      {
+        f[i] = func;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/*  */
+void Dense::setA_i(double a, unsigned int i)
   {
+    if(i < nodes)
+      {
+        alpha[i] = a;
+        deltaReady = false;
+      }
+    return;
   }
 
 /*  */
-void Dense::setA_i(double, unsigned int)
+void Dense::setName(char* n)
   {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Getters  */
+
+/* Return element [i, j] of the weight matrix, unmasked. Row 'inputs' holds the biases.
+   A factorized layer has no W: its weights are those of U V. */
+double Dense::getW_ij(unsigned int i, unsigned int j) const
+  {
+    if(factorRank > 0)
+      return (i == inputs) ? factorBias(j) : U.row(i).dot(V.col(j));
+    return W(i, j);
+  }
+
+/* Return whether element [i, j] of the weight matrix is UNmasked. A factorized layer has no M: its masked
+   entries are those listed for unmask(). */
+bool Dense::getM_ij(unsigned int i, unsigned int j) const
+  {
+    unsigned int k;
+
+    if(factorRank > 0)
+      {
+        if(i == inputs)
+          return true;
+        for(k = maskRow[i]; k < maskRow[i + 1]; k++)
+          {
+            if(maskCol[k] == j)
+              return false;
+          }
+        return true;
+      }
+    return (M(i, j) == 1.0);
+  }
+
+/* Return the activation function flag of the i-th unit. */
+unsigned char Dense::getF_i(unsigned int i) const
+  {
+    return f[i];
+  }
+
+/* Return the activation function parameter of the i-th unit. */
+double Dense::getA_i(unsigned int i) const
+  {
+    return alpha[i];
   }
 
 /*  */
-void Dense::setName(char*)
+char* Dense::name() const
   {
+    return (char*)layerName;
   }
 
 /**************************************************************************************************
@@ -115,17 +263,628 @@ void Dense::print() const
   {
   }
 
+/* Number of inputs, NOT counting the bias-1. */
+unsigned int Dense::inputLen() const
+  {
+    return inputs;
+  }
+
 /*  */
 unsigned int Dense::outputLen() const
   {
+    return nodes;
+  }
+
+/*  */
+double* Dense::output() const
+  {
+    return (double*)out.data();
   }
 
 /**************************************************************************************************
  Run layer  */
 
+/* Compute x' = [x 1] dot (W * M) and apply each unit's activation function. W * M is kept in WM, so nothing is
+   allocated here. */
+unsigned int Dense::run(double* x)
+  {
+    Map<VectorXd> xvec(x, inputs);
+
+    if(factorRank > 0)                                              //  (x U) V, never forming U V
+      {
+        preact = V.transpose() * (U.transpose() * xvec) + factorBias;
+        unmask(x, preact.data());
+      }
+    else
+      {
+        preact.noalias() = WM.topRows(inputs).transpose() * xvec;
+        preact += WM.row(inputs).transpose();
+      }
+    activate(preact.data(), out.data());
+    deltaReady = false;                                             //  'preact' no longer matches 'x0'
+
+    return nodes;
+  }
+
+/* Run B inputs at once: 'X' is (B x inputs), row-major. The whole batch is one matrix product, and the
+   (B x nodes) row-major result is available from batchOutput(). Does not disturb output() or runDelta(). */
+unsigned int Dense::runBatch(double* X, unsigned int B)
+  {
+    unsigned int b;
+    Map<const RowMatrixXd> Xm(X, B, inputs);
+
+    if(factorRank > 0)
+      {
+        outB.noalias() = (Xm * U) * V;
+        outB.rowwise() += factorBias.transpose();
+      }
+    else
+      {
+        outB.noalias() = Xm * WM.topRows(inputs);
+        outB.rowwise() += WM.row(inputs);
+      }
+    for(b = 0; b < B; b++)
+      {
+        if(factorRank > 0)
+          unmask(X + b * inputs, outB.data() + b * nodes);
+        activate(outB.data() + b * nodes, outB.data() + b * nodes);
+      }
+
+    return nodes;
+  }
+
+/*  */
+double* Dense::batchOutput() const
+  {
+    return (double*)outB.data();
+  }
+
+/* Like run(), but update the previous pre-activations with only the inputs that moved by more than 'tol'.
+   Return the number of outputs that moved by more than 'tol' since they were last reported, so that the caller
+   can skip layers downstream of a layer that returns 0. The first call after construction, resetDelta(), or
+   any setter runs in full and reports every output. */
+unsigned int Dense::runDelta(double* x, double tol)
+  {
+    unsigned int i, j, k;
+    unsigned int changed = 0;
+    unsigned int moved = 0;
+    double dx;
+
+    if(!deltaReady)
+      {
+        run(x);
+        x0 = Map<VectorXd>(x, inputs);
+        reported = out;
+        deltaReady = true;
+        deltaRuns = 0;
+        return nodes;
+      }
+
+    for(i = 0; i < inputs; i++)
+      {
+        if(fabs(x[i] - x0(i)) > tol)
+          changed++;
+      }
+    if(changed == 0)
+      return 0;
+
+    if(changed > (unsigned int)(DELTA_DENSITY * inputs) || deltaRuns >= DELTA_REFRESH)
+      {
+        run(x);
+        x0 = Map<VectorXd>(x, inputs);
+        deltaReady = true;
+        deltaRuns = 0;
+      }
+    else
+      {
+        for(i = 0; i < inputs; i++)                                 //  Rank-1 update per changed input
+          {
+            dx = x[i] - x0(i);
+            if(fabs(dx) > tol)
+              {
+                if(factorRank > 0)
+                  {
+                    preact += dx * (U.row(i) * V).transpose();
+                    for(k = maskRow[i]; k < maskRow[i + 1]; k++)
+                      preact(maskCol[k]) -= dx * maskVal[k];
+                  }
+                else
+                  preact += dx * WM.row(i).transpose();
+                x0(i) = x[i];
+              }
+          }
+        activate(preact.data(), out.data());
+        deltaRuns++;
+        partial++;
+      }
+
+    for(j = 0; j < nodes; j++)
+      {
+        if(fabs(out(j) - reported(j)) > tol)
+          {
+            reported(j) = out(j);
+            moved++;
+          }
+      }
+
+    return moved;
+  }
+
 /*  */
-unsigned int Dense::run(double*)
+void Dense::resetDelta()
+  {
+    deltaReady = false;
+    return;
+  }
+
+/* Number of runDelta() calls over the layer's life that updated the outputs in place rather than recomputing
+   them: zero means incremental inference has done no incremental work here. */
+unsigned long long Dense::partialRuns() const
+  {
+    return partial;
+  }
+
+/**************************************************************************************************
+ Low-rank factorization  */
+
+/* Replace the masked weights W o M, for run-time purposes, with the product of an (i x r) matrix U and an
+   (r x n) matrix V, for the smallest rank r whose outputs on the 'samples' row-major inputs in 'X' stay within
+   'tol' of the unfactorized layer's. Connections that M masks stay exactly zero: their entries of U V are
+   subtracted at run time. The bias row is kept as it is. Return r, or 0 (leaving the layer as it was) if no
+   rank meets 'tol' while costing fewer multiplications than the full matrix.
+   W, M and W o M are released: the layer keeps only U, V, the biases and the masked entries. Any later change to
+   weights or masks first unfactorizes, which rebuilds W from U V (see unfactorize()). */
+unsigned int Dense::factorize(double* X, unsigned int samples, double tol)
+  {
+    unsigned int lo, hi, mid;
+    unsigned int full, masked;
+    unsigned int i, j;
+    Map<const RowMatrixXd> Xm(X, samples, inputs);
+    MatrixXd Wm;
+    MatrixXd US;                                                    //  Left singular vectors, scaled
+    MatrixXd Vt;                                                    //  Right singular vectors, transposed
+    RowMatrixXd P;                                                  //  X U, for every rank at once
+    RowMatrixXd ref;                                                //  Unfactorized outputs
+
+    if(samples == 0 || inputs == 0 || nodes == 0)
+      return 0;
+
+    unfactorize();
+    Wm = WM.topRows(inputs);
+    Eigen::BDCSVD<MatrixXd> svd(Wm, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    US = svd.matrixU() * svd.singularValues().asDiagonal();
+    Vt = svd.matrixV().transpose();
+    full = (unsigned int)svd.singularValues().size();
+
+    ref = Xm * Wm;
+    ref.rowwise() += W.row(inputs);
+    for(i = 0; i < samples; i++)
+      activate(ref.data() + i * nodes, ref.data() + i * nodes);
+    P = Xm * US;
+
+    masked = 0;
+    for(i = 0; i < inputs; i++)
+      for(j = 0; j < nodes; j++)
+        masked += (M(i, j) == 0.0);
+
+    if(factorError(X, samples, P, US, Vt, full, ref) > tol)         //  Round-off alone exceeds 'tol'
+      return 0;
+    lo = 1;                                                         //  Error falls as rank rises: bisect
+    hi = full;
+    while(lo < hi)
+      {
+        mid = (lo + hi) / 2;
+        if(factorError(X, samples, P, US, Vt, mid, ref) <= tol)
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+
+    if(lo * (inputs + nodes) + masked >= inputs * nodes)            //  Not worth it
+      return 0;
+
+    U = US.leftCols(lo);
+    V = Vt.topRows(lo);
+    factorRank = lo;
+    buildUnmask();
+    release();
+    deltaReady = false;
+
+    return factorRank;
+  }
+
+/* Return to computing with W o M directly. W and M are rebuilt from what the factorized layer holds: unmasked
+   weights are those of U V, so the weights the layer had before factorize() are NOT recovered, only their
+   approximation; masked weights come back as 0. */
+void Dense::unfactorize()
+  {
+    unsigned int i, k;
+
+    if(factorRank > 0)
+      {
+        W.resize(inputs + 1, nodes);
+        M = MatrixXd::Ones(inputs + 1, nodes);
+        W.topRows(inputs).noalias() = U * V;
+        W.row(inputs) = factorBias.transpose();
+        for(i = 0; i < inputs; i++)
+          for(k = maskRow[i]; k < maskRow[i + 1]; k++)
+            {
+              W(i, maskCol[k]) = 0.0;
+              M(i, maskCol[k]) = 0.0;
+            }
+        WM = W;
+        factorBias.resize(0);
+
+        factorRank = 0;
+        U.resize(0, 0);
+        V.resize(0, 0);
+        free(maskRow);
+        free(maskCol);
+        free(maskVal);
+        maskRow = NULL;
+        maskCol = NULL;
+        maskVal = NULL;
+        deltaReady = false;
+      }
+    return;
+  }
+
+/* Drop the full matrices once the factors, the biases and the masked entries hold everything run() needs. */
+void Dense::release()
+  {
+    factorBias = WM.row(inputs).transpose();
+    W.resize(0, 0);
+    M.resize(0, 0);
+    WM.resize(0, 0);
+    return;
+  }
+
+/* Rank of the factorization in use, or 0 if the layer computes with W o M. */
+unsigned int Dense::rank() const
+  {
+    return factorRank;
+  }
+
+/* Largest output difference, over the samples, between the rank-r factorization and 'ref'. */
+double Dense::factorError(double* X, unsigned int samples, const RowMatrixXd& P, const MatrixXd& US, const MatrixXd& Vt,
+                          unsigned int r, const RowMatrixXd& ref) const
+  {
+    unsigned int s, i, j;
+    double w;
+    RowMatrixXd A = P.leftCols(r) * Vt.topRows(r);
+
+    A.rowwise() += W.row(inputs);
+    for(i = 0; i < inputs; i++)                                     //  Masked connections contribute nothing
+      for(j = 0; j < nodes; j++)
+        {
+          if(M(i, j) == 0.0)
+            {
+              w = US.row(i).head(r).dot(Vt.col(j).head(r));
+              for(s = 0; s < samples; s++)
+                A(s, j) -= X[s * inputs + i] * w;
+            }
+        }
+    for(s = 0; s < samples; s++)
+      activate(A.data() + s * nodes, A.data() + s * nodes);
+
+    return (A - ref).cwiseAbs().maxCoeff();
+  }
+
+/* Record, row by row, the entries of U V that fall on masked connections, so that unmask() can cancel them. */
+void Dense::buildUnmask()
+  {
+    unsigned int i, j, k;
+    unsigned int masked = 0;
+
+    for(i = 0; i < inputs; i++)
+      for(j = 0; j < nodes; j++)
+        masked += (M(i, j) == 0.0);
+
+    if((maskRow = (unsigned int*)malloc((inputs + 1) * sizeof(int))) == NULL ||
+       (maskCol = (unsigned int*)malloc((masked + 1) * sizeof(int))) == NULL ||
+       (maskVal = (double*)malloc((masked + 1) * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Dense layer's masked-entry arrays\n";
+        exit(1);
+      }
+    k = 0;
+    for(i = 0; i < inputs; i++)
+      {
+        maskRow[i] = k;
+        for(j = 0; j < nodes; j++)
+          {
+            if(M(i, j) == 0.0)
+              {
+                maskCol[k] = j;
+                maskVal[k] = U.row(i).dot(V.col(j));
+                k++;
+              }
+          }
+      }
+    maskRow[inputs] = k;
+
+    return;
+  }
+
+/* Subtract from the n pre-activations 'p' what U V contributes, for input 'x', through masked connections. */
+void Dense::unmask(const double* x, double* p) const
+  {
+    unsigned int i, k;
+
+    for(i = 0; i < inputs; i++)
+      for(k = maskRow[i]; k < maskRow[i + 1]; k++)
+        p[maskCol[k]] -= x[i] * maskVal[k];
+
+    return;
+  }
+
+/**************************************************************************************************
+ Pruning  */
+
+/* Whether unit 'j' ignores every input, all its input masks being 0. If so, and 'c' is not NULL, write the constant
+   it outputs to 'c'. SOFTMAX units never qualify, since each one's output depends on the others. */
+bool Dense::constant_i(unsigned int j, double* c) const
+  {
+    unsigned int i;
+    VectorXd b;
+    VectorXd o(nodes);
+
+    if(f[j] == SOFTMAX)
+      return false;
+    for(i = 0; i < inputs; i++)
+      {
+        if(getM_ij(i, j))
+          return false;
+      }
+    if(c != NULL)
+      {
+        if(factorRank > 0)
+          b = factorBias;
+        else
+          b = W.row(inputs).transpose();                            //  Rows of W are not contiguous
+        activate(b.data(), o.data());
+        *c = o(j);
+      }
+
+    return true;
+  }
+
+/* Largest weight magnitude, masks applied, with which input 'i' reaches any unit. */
+double Dense::inputWeight_i(unsigned int i) const
+  {
+    unsigned int k;
+    VectorXd w;
+
+    if(inputs == 0)
+      return 0.0;
+    if(factorRank > 0)
+      {
+        w = (U.row(i) * V).transpose();
+        for(k = maskRow[i]; k < maskRow[i + 1]; k++)
+          w(maskCol[k]) = 0.0;
+        return w.cwiseAbs().maxCoeff();
+      }
+    return WM.row(i).cwiseAbs().maxCoeff();
+  }
+
+/* Remove unit 'j' altogether: its column of W and M, its function and parameter, and its place in 'out'.
+   A factorized layer goes back to W o M first. */
+void Dense::removeUnit(unsigned int j)
+  {
+    unfactorize();
+
+    W.middleCols(j, nodes - j - 1) = W.rightCols(nodes - j - 1).eval();
+    M.middleCols(j, nodes - j - 1) = M.rightCols(nodes - j - 1).eval();
+    memmove(f + j, f + j + 1, (nodes - j - 1) * sizeof(char));
+    memmove(alpha + j, alpha + j + 1, (nodes - j - 1) * sizeof(double));
+    nodes--;
+    W.conservativeResize(inputs + 1, nodes);
+    M.conservativeResize(inputs + 1, nodes);
+    WM = W.cwiseProduct(M);
+    out.resize(nodes);
+    preact.resize(nodes);
+    reported.resize(nodes);
+    deltaReady = false;
+
+    return;
+  }
+
+/* Remove input 'i' altogether, treating it as always equal to 'v': its weighted contribution moves into the
+   biases, exactly if the input really was constant. A factorized layer goes back to W o M first. */
+void Dense::removeInput(unsigned int i, double v)
+  {
+    unfactorize();
+
+    if(v != 0.0)
+      W.row(inputs) += v * WM.row(i);
+    W.middleRows(i, inputs - i) = W.bottomRows(inputs - i).eval();   //  Rows below, biases included, move up
+    M.middleRows(i, inputs - i) = M.bottomRows(inputs - i).eval();
+    inputs--;
+    W.conservativeResize(inputs + 1, nodes);
+    M.conservativeResize(inputs + 1, nodes);
+    WM = W.cwiseProduct(M);
+    x0.resize(inputs);
+    deltaReady = false;
+
+    return;
+  }
+
+/* Number of stored parameters: weights and biases, or the factors and biases if factorized. */
+unsigned int Dense::params() const
+  {
+    if(factorRank > 0)
+      return factorRank * (inputs + nodes) + nodes;
+    return (inputs + 1) * nodes;
+  }
+
+/* Floating-point operations in one run(), counting a multiply-add as two. Activations are not counted. */
+unsigned long long Dense::flops() const
+  {
+    if(factorRank > 0)
+      return 2ULL * factorRank * (inputs + nodes);
+    return 2ULL * inputs * nodes;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': shape, functions, name, masks, and biases, then either the (i x n)
+   weights or, if factorized, the rank and the factors U and V. Return false if writing fails. */
+bool Dense::write(FILE* fp) const
+  {
+    unsigned int i, j;
+    unsigned char m;
+    double w;
+    bool ok = true;
+
+    ok = ok && fwrite(&inputs, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&nodes, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(f, sizeof(char), nodes, fp) == nodes;
+    ok = ok && fwrite(alpha, sizeof(double), nodes, fp) == nodes;
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    for(i = 0; i < inputs && ok; i++)                               //  Row-major throughout
+      for(j = 0; j < nodes && ok; j++)
+        {
+          m = getM_ij(i, j);
+          ok = fwrite(&m, sizeof(char), 1, fp) == 1;
+        }
+    for(j = 0; j < nodes && ok; j++)
+      {
+        w = getW_ij(inputs, j);
+        ok = fwrite(&w, sizeof(double), 1, fp) == 1;
+      }
+    ok = ok && fwrite(&factorRank, sizeof(int), 1, fp) == 1;
+    if(factorRank == 0)
+      {
+        for(i = 0; i < inputs && ok; i++)
+          for(j = 0; j < nodes && ok; j++)
+            {
+              w = W(i, j);
+              ok = fwrite(&w, sizeof(double), 1, fp) == 1;
+            }
+      }
+    else
+      {
+        for(i = 0; i < inputs && ok; i++)
+          for(j = 0; j < factorRank && ok; j++)
+            {
+              w = U(i, j);
+              ok = fwrite(&w, sizeof(double), 1, fp) == 1;
+            }
+        for(i = 0; i < factorRank && ok; i++)
+          for(j = 0; j < nodes && ok; j++)
+            {
+              w = V(i, j);
+              ok = fwrite(&w, sizeof(double), 1, fp) == 1;
+            }
+      }
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same shape. A factorized layer comes back
+   factorized, holding only what it held when written (see factorize()).
+   Return false, leaving the layer unusable, if reading fails or the shape differs. */
+bool Dense::read(FILE* fp)
   {
+    unsigned int i, j;
+    unsigned int in, n, r;
+    unsigned char m;
+    double w;
+    bool ok = true;
+
+    ok = ok && fread(&in, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&n, sizeof(int), 1, fp) == 1;
+    if(!ok || in != inputs || n != nodes)
+      {
+        cout << "ERROR: Stored Dense layer does not match this layer's shape\n";
+        return false;
+      }
+    unfactorize();
+
+    ok = ok && fread(f, sizeof(char), nodes, fp) == nodes;
+    ok = ok && fread(alpha, sizeof(double), nodes, fp) == nodes;
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+    for(i = 0; i < inputs && ok; i++)
+      for(j = 0; j < nodes && ok; j++)
+        {
+          ok = fread(&m, sizeof(char), 1, fp) == 1;
+          M(i, j) = m ? 1.0 : 0.0;
+        }
+    for(j = 0; j < nodes && ok; j++)
+      {
+        ok = fread(&w, sizeof(double), 1, fp) == 1;
+        W(inputs, j) = w;
+      }
+    ok = ok && fread(&r, sizeof(int), 1, fp) == 1;
+    if(ok && r == 0)
+      {
+        for(i = 0; i < inputs && ok; i++)
+          for(j = 0; j < nodes && ok; j++)
+            {
+              ok = fread(&w, sizeof(double), 1, fp) == 1;
+              W(i, j) = w;
+            }
+      }
+    else if(ok)
+      {
+        U.resize(inputs, r);
+        V.resize(r, nodes);
+        for(i = 0; i < inputs && ok; i++)
+          for(j = 0; j < r && ok; j++)
+            {
+              ok = fread(&w, sizeof(double), 1, fp) == 1;
+              U(i, j) = w;
+            }
+        for(i = 0; i < r && ok; i++)
+          for(j = 0; j < nodes && ok; j++)
+            {
+              ok = fread(&w, sizeof(double), 1, fp) == 1;
+              V(i, j) = w;
+            }
+      }
+    WM = W.cwiseProduct(M);
+    if(ok && r > 0)
+      {
+        factorRank = r;
+        buildUnmask();
+        release();
+      }
+    deltaReady = false;
+
+    return ok;
+  }
+
+/* Apply each unit's activation function to the n pre-activations 'p', writing the n outputs 'o'.
+   SOFTMAX normalizes over the SOFTMAX units. 'p' and 'o' may be the same array. */
+void Dense::activate(const double* p, double* o) const
+  {
+    unsigned int j;
+    double s = 0.0;
+
+    for(j = 0; j < nodes; j++)
+      {
+        switch(f[j])
+          {
+            case RELU:                o[j] = (p[j] > 0.0) ? p[j] : 0.0;                                       break;
+            case LEAKY_RELU:          o[j] = (p[j] > 0.0) ? p[j] : p[j] * alpha[j];                           break;
+            case SIGMOID:             o[j] = 1.0 / (1.0 + exp(-p[j] * alpha[j]));                             break;
+            case HYPERBOLIC_TANGENT:  o[j] = (2.0 / (1.0 + exp(-2.0 * p[j] * alpha[j]))) - 1.0;               break;
+            case SOFTMAX:             o[j] = exp(p[j]);
+                                      s += o[j];                                                              break;
+            case SYMMETRICAL_SIGMOID: o[j] = (1.0 - exp(-p[j] * alpha[j])) / (1.0 + exp(-p[j] * alpha[j]));   break;
+            case THRESHOLD:           o[j] = (p[j] > alpha[j]) ? 1.0 : 0.0;                                   break;
+            default:                  o[j] = p[j] * alpha[j];                                                 break;
+          }
+      }
+    for(j = 0; j < nodes && s > 0.0; j++)
+      {
+        if(f[j] == SOFTMAX)
+          o[j] /= s;
+      }
+
+    return;
   }
 
 #endif
\ No newline at end of file
@@ -27,11 +27,31 @@
 
  Not all activation functions need a parameter. It's just a nice feature we like to offer.
 
+ runDelta() is an incremental alternative to run() for inputs that change sparsely between calls.
+ The layer keeps the pre-activations x' and the input they reflect. Only inputs that moved by more than a
+ tolerance contribute a rank-1 update, x'[j] += (x[i] - x_prev[i]) * W'[i, j]. If too many inputs moved,
+ the layer recomputes in full, and it also recomputes every DELTA_REFRESH updates to shed round-off.
+
+ factorize() replaces W o M at run time with a rank-r product U V, U being (i x r) and V (r x n), choosing the
+ smallest r that keeps outputs on sample inputs within a tolerance. Evaluating (x U) V costs r * (i + n)
+ multiplications instead of i * n. Masks still hold exactly, since the few entries of U V that fall on masked
+ connections are cancelled at run time, and f, alpha and the biases are untouched. A factorized layer releases
+ W and M, keeping only U, V, the biases and the masked entries, so it stores r * (i + n) weights instead of
+ i * n. Going back (unfactorize(), or any change to weights or masks) rebuilds W from U V: the original
+ weights are not kept.
+
+ removeUnit() and removeInput() shrink the layer physically, for structured pruning (see NeuralNet::prune()).
+ An input known to be constant can be removed exactly: its contribution is folded into the biases.
+
+ runBatch() runs B inputs stacked as rows of a matrix, so the layer costs one matrix product instead of B
+ matrix-vector products.
+
  Note that this file does NOT seed the randomizer. That should be done by the parent program.
 ***************************************************************************************************/
 
 #include <iostream>
 #include <Eigen/Dense>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -48,16 +68,23 @@
 
 #define LAYER_NAME_LEN  32                                          /* Length of a Layer 'name' string */
 
+#define DELTA_REFRESH  256                                          /* Incremental updates between full recomputations */
+#define DELTA_DENSITY  0.25                                         /* Above this fraction of changed inputs, recompute in full */
+
 /*
 #define __DENSE_DEBUG 1
 */
 
+using Eigen::Map;
 using Eigen::MatrixXd;
+using Eigen::VectorXd;
 using namespace std;
 
 /**************************************************************************************************
  Typedefs  */
 
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrixXd;
+
 
 /**************************************************************************************************
  Dense  */
@@ -76,20 +103,67 @@ class Dense
       void setF_i(unsigned char, unsigned int);                     //  Set activation function of i-th neuron/unit
       void setA_i(double, unsigned int);                            //  Set activation function auxiliary parameter of i-th neuron/unit
       void setName(char*);
+      double getW_ij(unsigned int, unsigned int) const;             //  Get element [i, j] of layer's weight matrix
+      bool getM_ij(unsigned int, unsigned int) const;               //  Get element [i, j] of layer's mask matrix
+      unsigned char getF_i(unsigned int) const;                     //  Get activation function of i-th neuron/unit
+      double getA_i(unsigned int) const;                            //  Get activation function auxiliary parameter of i-th neuron/unit
       char* name() const;
       void print() const;
+      unsigned int inputLen() const;
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      unsigned int runDelta(double*, double);                       //  Incremental run; returns the number of outputs that moved
+      void resetDelta();                                            //  Forget the previous input: next runDelta() is in full
+      unsigned long long partialRuns() const;                       //  runDelta() calls answered by an in-place update
+      unsigned int runBatch(double*, unsigned int);                 //  Run B row-major inputs as one matrix product
+      double* batchOutput() const;                                  //  (B x n) row-major outputs of the last runBatch()
+      unsigned int factorize(double*, unsigned int, double);        //  Low-rank factorization within a tolerance on samples
+      void unfactorize();                                           //  Go back to computing with W o M
+      unsigned int rank() const;                                    //  Rank in use, or 0 if not factorized
+      bool constant_i(unsigned int, double*) const;                 //  Whether the i-th unit ignores all input, and its output
+      double inputWeight_i(unsigned int) const;                     //  Largest weight on the i-th input
+      void removeUnit(unsigned int);                                //  Delete a unit, shrinking the output
+      void removeInput(unsigned int, double);                       //  Delete an input, folding its constant value into the biases
+      unsigned int params() const;                                  //  Stored weights and biases
+      unsigned long long flops() const;                             //  Floating-point operations per run()
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
 
     private:
       unsigned int inputs;                                          //  Number of inputs--NOT COUNTING the added bias-1
       unsigned int nodes;                                           //  Number of processing units in this layer
-      MatrixXf W;                                                   //  ((i + 1) x n) matrix
-      MatrixXf M;                                                   //  ((i + 1) x n) matrix, all either 0.0 or 1.0
+      MatrixXd W;                                                   //  ((i + 1) x n) matrix
+      MatrixXd M;                                                   //  ((i + 1) x n) matrix, all either 0.0 or 1.0
+      MatrixXd WM;                                                  //  ((i + 1) x n) W o M, kept current by every change to either
       unsigned char* f;                                             //  n-array
       double* alpha;                                                //  n-array
       char layerName[LAYER_NAME_LEN];
-      VectorXf out;                                                 //  (n x 1) matrix
+      VectorXd out;                                                 //  (n x 1) matrix
+
+      VectorXd preact;                                              //  (n x 1) pre-activations x' of the last run
+      VectorXd x0;                                                  //  (i x 1) input that 'preact' reflects, for runDelta()
+      VectorXd reported;                                            //  (n x 1) outputs as of the last time each was reported moved
+      bool deltaReady;                                              //  Whether 'preact' and 'x0' are current
+      unsigned int deltaRuns;                                       //  Incremental updates since the last full computation
+      unsigned long long partial;                                   //  Lifetime count of in-place updates, for partialRuns()
+
+      RowMatrixXd outB;                                             //  (B x n) outputs of the last runBatch()
+
+      unsigned int factorRank;                                      //  Rank of U V, or 0 if W o M is used directly
+      MatrixXd U;                                                   //  (i x r) left factor, singular values folded in
+      MatrixXd V;                                                   //  (r x n) right factor
+      unsigned int* maskRow;                                        //  Masked entries of input i: [maskRow[i], maskRow[i + 1])
+      unsigned int* maskCol;                                        //  Unit of each masked entry
+      double* maskVal;                                              //  U V at each masked entry, cancelled at run time
+      VectorXd factorBias;                                          //  (n x 1) biases while factorized, W being released
+
+      void activate(const double*, double*) const;
+      double factorError(double*, unsigned int, const RowMatrixXd&, const MatrixXd&, const MatrixXd&,
+                         unsigned int, const RowMatrixXd&) const;
+      void buildUnmask();
+      void release();                                               //  Drop W, M and W o M once factorized
+      void unmask(const double*, double*) const;
   };
 
 #endif
\ No newline at end of file
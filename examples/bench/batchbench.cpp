@@ -0,0 +1,118 @@
+/**************************************************************************************************
+ Load generator for the request batcher. Client threads each send single-sample requests, first straight to
+ NeuralNet::run() (one at a time, since a network serves one caller), then through a Batcher. Reports throughput,
+ latency percentiles, and the Batcher's queue-depth and batch-size histograms.
+
+ Usage: ./batchbench <network file> <clients> <requests per client> <max batch> <max delay usec>
+***************************************************************************************************/
+
+#include <algorithm>
+#include "batcher.h"
+
+/* Each client's latencies, in microseconds. */
+double* latency;
+
+/* Report throughput and latency percentiles over 'n' requests that took 'seconds' in all. */
+void report(const char* label, unsigned int n, double seconds)
+  {
+    if(n == 0)
+      {
+        printf("%-8s no requests\n", label);
+        return;
+      }
+    sort(latency, latency + n);
+    printf("%-8s %10.0f req/s   p50 %8.1f us   p99 %8.1f us   max %8.1f us\n", label, (double)n / seconds,
+           latency[n / 2], latency[(unsigned int)(n * 0.99)], latency[n - 1]);
+    return;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    Batcher* batcher;
+    unsigned int clients, perClient, maxBatch, maxDelay;
+    unsigned int inputs;
+    unsigned int c, i;
+    double* X;
+    mutex direct;
+    thread* t;
+    chrono::steady_clock::time_point start;
+    double seconds;
+
+    if(argc != 6)
+      {
+        cout << "Usage: " << argv[0] << " <network file> <clients> <requests per client> <max batch> <max delay usec>\n";
+        return 1;
+      }
+
+    nn = new NeuralNet(0);
+    if(!nn->load(argv[1]))
+      {
+        cout << "ERROR: Unable to load " << argv[1] << "\n";
+        delete nn;
+        return 1;
+      }
+    clients = atoi(argv[2]);
+    perClient = atoi(argv[3]);
+    maxBatch = atoi(argv[4]);
+    maxDelay = atoi(argv[5]);
+    inputs = nn->inputLen();
+
+    srand(1);                                                       //  Same inputs for both runs
+    X = (double*)malloc(clients * perClient * inputs * sizeof(double));
+    latency = (double*)malloc(clients * perClient * sizeof(double));
+    for(i = 0; i < clients * perClient * inputs; i++)
+      X[i] = -1.0 + ((double)rand() / ((double)RAND_MAX * 0.5));
+    t = new thread[clients];
+
+    start = chrono::steady_clock::now();                            //  Direct: every call takes its turn
+    for(c = 0; c < clients; c++)
+      t[c] = thread([=, &direct]()
+        {
+          unsigned int r;
+          double* z;
+          chrono::steady_clock::time_point s;
+          for(r = 0; r < perClient; r++)
+            {
+              s = chrono::steady_clock::now();
+              direct.lock();
+              nn->run(X + (c * perClient + r) * inputs, &z);
+              direct.unlock();
+              free(z);
+              latency[c * perClient + r] = chrono::duration<double, micro>(chrono::steady_clock::now() - s).count();
+            }
+        });
+    for(c = 0; c < clients; c++)
+      t[c].join();
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report("direct", clients * perClient, seconds);
+
+    batcher = new Batcher(nn, maxBatch, maxDelay);                  //  Batched
+    start = chrono::steady_clock::now();
+    for(c = 0; c < clients; c++)
+      t[c] = thread([=]()
+        {
+          unsigned int r;
+          BatchResult z;
+          chrono::steady_clock::time_point s;
+          for(r = 0; r < perClient; r++)
+            {
+              s = chrono::steady_clock::now();
+              z = batcher->submit(X + (c * perClient + r) * inputs).get();
+              free(z.z);
+              latency[c * perClient + r] = chrono::duration<double, micro>(chrono::steady_clock::now() - s).count();
+            }
+        });
+    for(c = 0; c < clients; c++)
+      t[c].join();
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report("batched", clients * perClient, seconds);
+    batcher->print();
+
+    delete batcher;
+    delete[] t;
+    free(X);
+    free(latency);
+    delete nn;
+    return 0;
+  }
@@ -0,0 +1,55 @@
+/**************************************************************************************************
+ Write a multilayer perceptron of Dense layers with random weights, for benchmarking: 'layers' hidden layers of
+ 'hidden' ReLU units between 'inputs' inputs and 'outputs' linear outputs. The randomizer is seeded with 1, so
+ the same arguments give the same network.
+
+ Usage: ./mlp <network file> <inputs> <hidden> <layers> <outputs>
+***************************************************************************************************/
+
+#include "neuron.h"
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    unsigned int inputs, hidden, layers, outputs;
+    unsigned int i, j, from;
+
+    if(argc != 6 || (inputs = atoi(argv[2])) == 0 || (hidden = atoi(argv[3])) == 0 ||
+                    (outputs = atoi(argv[5])) == 0)
+      {
+        cout << "Usage: " << argv[0] << " <network file> <inputs> <hidden> <layers> <outputs>\n";
+        return 1;
+      }
+    layers = atoi(argv[4]);
+
+    srand(1);
+    nn = new NeuralNet(inputs);
+    from = inputs;
+    for(i = 0; i < layers; i++)                                     //  Dense layer i: hidden
+      {
+        nn->addDense(from, hidden);
+        if(i == 0)
+          nn->linkLayers(INPUT_ARRAY, 0, 0, inputs, DENSE_ARRAY, 0);
+        else
+          nn->linkLayers(DENSE_ARRAY, i - 1, 0, hidden, DENSE_ARRAY, i);
+        from = hidden;
+      }
+    nn->addDense(from, outputs);                                    //  Dense layer 'layers': output
+    if(layers == 0)
+      nn->linkLayers(INPUT_ARRAY, 0, 0, inputs, DENSE_ARRAY, 0);
+    else
+      nn->linkLayers(DENSE_ARRAY, layers - 1, 0, hidden, DENSE_ARRAY, layers);
+    for(j = 0; j < outputs; j++)
+      nn->getDense(layers)->setF_i(LINEAR, j);
+    nn->sortEdges();
+
+    if(!nn->write(argv[1]))
+      {
+        delete nn;
+        return 1;
+      }
+    cout << "Wrote " << argv[1] << ": " << nn->params() << " parameters\n";
+
+    delete nn;
+    return 0;
+  }
@@ -0,0 +1,35 @@
+/**************************************************************************************************
+ Load a saved network and write it out as a specialized, allocation-free C++ header.
+
+ Usage: ./codegen <network file> <header file> <prefix>
+***************************************************************************************************/
+
+#include "neuron.h"
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+
+    if(argc != 4)
+      {
+        cout << "Usage: " << argv[0] << " <network file> <header file> <prefix>\n";
+        return 1;
+      }
+
+    nn = new NeuralNet(0);
+    if(!nn->load(argv[1]))
+      {
+        cout << "ERROR: Unable to load " << argv[1] << "\n";
+        delete nn;
+        return 1;
+      }
+
+    if(!nn->exportHeader(argv[2], argv[3]))
+      {
+        delete nn;
+        return 1;
+      }
+
+    delete nn;
+    return 0;
+  }
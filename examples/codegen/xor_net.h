@@ -0,0 +1,131 @@
+#ifndef __xornet_NN_H
+#define __xornet_NN_H
+
+/**************************************************************************************************
+ Specialized network "Exclusive-OR", generated by NeuralNet::exportHeader()
+
+ Layer sizes, activations and the edge schedule are compile-time constants and all weights are
+ constexpr arrays (masks already applied). Nothing here allocates.
+ Call xornet::run(x, z) with x of length xornet::INPUTS and z of length xornet::OUTPUTS.
+***************************************************************************************************/
+
+#include <math.h>
+
+namespace xornet
+  {
+    constexpr unsigned int INPUTS = 2;
+    constexpr unsigned int OUTPUTS = 1;
+
+    template<unsigned int N>
+    inline void copy(const double* src, double* dst)
+      {
+        for(unsigned int i = 0; i < N; i++)
+          dst[i] = src[i];
+      }
+
+    template<unsigned int I, unsigned int N>
+    inline void affine(const double* x, const double* W, double* z)
+      {
+        for(unsigned int j = 0; j < N; j++)                         //  Bias row is last
+          z[j] = W[I * N + j];
+        for(unsigned int i = 0; i < I; i++)
+          for(unsigned int j = 0; j < N; j++)
+            z[j] += x[i] * W[i * N + j];
+      }
+
+    inline double act(unsigned char f, double x, double a)
+      {
+        switch(f)
+          {
+            case 0: return (x > 0.0) ? x : 0.0;
+            case 1: return (x > 0.0) ? x : x * a;
+            case 2: return 1.0 / (1.0 + exp(-x * a));
+            case 3: return (2.0 / (1.0 + exp(-2.0 * x * a))) - 1.0;
+            case 4: return exp(x);
+            case 5: return (1.0 - exp(-x * a)) / (1.0 + exp(-x * a));
+            case 6: return (x > a) ? 1.0 : 0.0;
+            default: return x * a;
+          }
+      }
+
+    template<unsigned int N, unsigned char F>                       //  Every unit shares activation F
+    inline void activate(double* z, const double* a)
+      {
+        double s = 0.0;
+        for(unsigned int j = 0; j < N; j++)
+          z[j] = act(F, z[j], a[j]);
+        if(F == 4)
+          {
+            for(unsigned int j = 0; j < N; j++)
+              s += z[j];
+            for(unsigned int j = 0; j < N; j++)
+              z[j] /= s;
+          }
+      }
+
+    template<unsigned int N>                                        //  Units mix activations
+    inline void activate(double* z, const unsigned char* f, const double* a)
+      {
+        double s = 0.0;
+        for(unsigned int j = 0; j < N; j++)
+          {
+            z[j] = act(f[j], z[j], a[j]);
+            if(f[j] == 4)
+              s += z[j];
+          }
+        for(unsigned int j = 0; j < N; j++)
+          {
+            if(f[j] == 4)
+              z[j] /= s;
+          }
+      }
+
+    /* Dense layer 0, "hidden" */
+    constexpr unsigned int L0_IN = 2;
+    constexpr unsigned int L0_OUT = 2;
+    alignas(64) constexpr double L0_W[(L0_IN + 1) * L0_OUT] =
+      {
+        20, -20,
+        20, -20,
+        -10, 30
+      };
+    constexpr unsigned char L0_F[L0_OUT] = { 2, 2 };
+    constexpr double L0_A[L0_OUT] = { 1, 1 };
+
+    /* Dense layer 1, "output" */
+    constexpr unsigned int L1_IN = 2;
+    constexpr unsigned int L1_OUT = 1;
+    alignas(64) constexpr double L1_W[(L1_IN + 1) * L1_OUT] =
+      {
+        20,
+        20,
+        -30
+      };
+    constexpr unsigned char L1_F[L1_OUT] = { 2 };
+    constexpr double L1_A[L1_OUT] = { 1 };
+
+    inline unsigned int run(const double* x, double* z)
+      {
+        double l0[L0_OUT];
+        double l1[L1_OUT];
+
+          {
+            double in[L0_IN];
+            copy<2>(x + 0, in + 0);
+            affine<L0_IN, L0_OUT>(in, L0_W, l0);
+            activate<L0_OUT, 2>(l0, L0_A);
+          }
+
+          {
+            double in[L1_IN];
+            copy<2>(l0 + 0, in + 0);
+            affine<L1_IN, L1_OUT>(in, L1_W, l1);
+            activate<L1_OUT, 2>(l1, L1_A);
+          }
+
+        copy<OUTPUTS>(l1, z);
+        return OUTPUTS;
+      }
+  }
+
+#endif
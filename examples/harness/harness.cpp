@@ -0,0 +1,1025 @@
+/**************************************************************************************************
+ Numerical-equivalence and timing harness. Replays the samples of a fixture file through every way the library
+ can run a network, checks each output against the fixture's reference outputs, and times each mode. The plain
+ run() mode also checks the outputs of any layers the fixture names.
+
+ An element passes if it is within the absolute tolerance OR within the ULP tolerance of its reference. ULPs are
+ counted in single precision, the precision references exported from a trained model usually carry. Tolerances
+ given on the command line override those in the fixture.
+
+ A fixture lists the modes it exercises (all of them if it has no 'modes' line); the others are skipped. A listed
+ mode that cannot take its own path fails rather than quietly repeating run(): incremental inference that never
+ updates a layer in place, a cache that never hits, or packing, pruning or factorization that changes nothing.
+
+ The program exits with 0 if every mode passes and 1 otherwise, so it can gate a build. With -csv, one line per
+ mode (correctness and timing) is appended to the given file, to follow both across changes. With -record, the
+ fixture's reference outputs are overwritten with what run() produces now: pin a known-good build before
+ changing the code beneath it.
+
+ Fixture files are plain text; '#' begins a comment that runs to the end of the line.
+   inputs <n>                       Length of one input sample
+   outputs <n>                      Length of one output
+   samples <n>                      Number of samples
+   tolerance <abs> <ulp>            Optional
+   modes <n> <names>                Optional: the modes this fixture must exercise
+   x <inputs values>                One per sample, in order
+   y <outputs values>               One per sample, in order
+   layer <name> <n> <samples * n values>   Optional, any number: the named layer's output for every sample
+   tiling <w> <h> <n> <names>       For 'tiling': a chain of 2D layers, the first reading the network input and
+                                    the last given by a 'layer' line, run in (w by h) tiles
+   population <source> <n> <names>  For 'population': a chain of Dense layers ending at the network output, fed
+                                    by 'input' or by a layer given by a 'layer' line
+
+ Usage: ./harness <network file> <fixture file> [-abs tol] [-ulp tol] [-repeat n] [-csv file] [-record]
+***************************************************************************************************/
+
+#include <chrono>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "neuron.h"
+#include "registry.h"
+
+#define HARNESS_MAX_LAYERS  64                                      /* Named layers a fixture may check */
+#define HARNESS_TOKEN_LEN   256                                     /* Longest token read from a fixture */
+#define HARNESS_MODES       12                                      /* Length of 'modeName' */
+#define HARNESS_PATH_LEN    512                                     /* Longest path or command built for codegen */
+#define HARNESS_REPLICAS    2                                       /* Copies of the network in the registry */
+
+typedef struct ErrorType
+  {
+    double maxAbs;                                                  //  Greatest absolute difference
+    unsigned long long maxUlp;                                      //  Greatest difference in single-precision ULPs
+    unsigned int failures;                                          //  Elements outside both tolerances
+  } Error;
+
+/* The fixture. */
+unsigned int inputs = 0;
+unsigned int outputs = 0;
+unsigned int samples = 0;
+double* X = NULL;                                                   //  samples x inputs, row-major
+double* Y = NULL;                                                   //  samples x outputs, row-major
+unsigned int layerCount = 0;
+char layerName[HARNESS_MAX_LAYERS][LAYER_NAME_LEN];
+unsigned int layerLen[HARNESS_MAX_LAYERS];
+double* layerRef[HARNESS_MAX_LAYERS];                               //  samples x layerLen[l], row-major
+Error layerErr[HARNESS_MAX_LAYERS];
+
+double tolAbs = 1e-5;
+unsigned long long tolUlp = 4;
+
+const char* modeName[HARNESS_MODES] = { "run", "delta", "sequence", "batch", "cache", "packed", "pruned", "factorized",
+                                        "tiling", "codegen", "registry", "population" };
+bool modeWanted[HARNESS_MODES];                                     //  Which modes the fixture exercises
+bool modesGiven = false;                                            //  Whether the fixture has a 'modes' line
+
+unsigned int tileW = 0;                                             //  Tile dimensions, for 'tiling'
+unsigned int tileH = 0;
+unsigned int tileLen = 0;                                           //  Layers in the tiled chain
+char tileName[HARNESS_MAX_LAYERS][LAYER_NAME_LEN];
+
+char popSource[LAYER_NAME_LEN];                                     //  'input', or the layer feeding the population
+unsigned int popLen = 0;                                            //  Dense layers in the population's chain
+char popName[HARNESS_MAX_LAYERS][LAYER_NAME_LEN];
+double* popInput = NULL;                                            //  samples x (chain's input length), borrowed
+
+/* Distance between 'a' and 'b' in single-precision units in the last place. NaN is infinitely far from anything
+   but NaN. */
+unsigned long long ulps(double a, double b)
+  {
+    float fa = (float)a;
+    float fb = (float)b;
+    int32_t ia, ib;
+
+    if(isnan(fa) || isnan(fb))
+      return (isnan(fa) && isnan(fb)) ? 0 : ULLONG_MAX;
+
+    memcpy(&ia, &fa, sizeof(float));
+    memcpy(&ib, &fb, sizeof(float));
+    if(ia < 0)                                                      //  Order negative floats below positive ones
+      ia = INT32_MIN - ia;
+    if(ib < 0)
+      ib = INT32_MIN - ib;
+
+    return (ia > ib) ? (unsigned long long)((int64_t)ia - ib) : (unsigned long long)((int64_t)ib - ia);
+  }
+
+/* Fold the comparison of 'n' values 'a' against references 'ref' into 'e'. */
+void compare(const double* a, const double* ref, unsigned int n, Error* e)
+  {
+    unsigned int i;
+    unsigned long long u;
+    double d;
+
+    for(i = 0; i < n; i++)
+      {
+        u = ulps(a[i], ref[i]);
+        d = fabs(a[i] - ref[i]);
+        if(isnan(d))
+          d = (u == 0) ? 0.0 : INFINITY;
+        if(d > e->maxAbs)
+          e->maxAbs = d;
+        if(u > e->maxUlp)
+          e->maxUlp = u;
+        if(d > tolAbs && u > tolUlp)
+          e->failures++;
+      }
+    return;
+  }
+
+/* Read the next token of 'fp' into 'tok', skipping comments. Return false at the end of the file. */
+bool token(FILE* fp, char* tok)
+  {
+    while(fscanf(fp, "%255s", tok) == 1)
+      {
+        if(tok[0] != '#')
+          return true;
+        if(fscanf(fp, "%*[^\n]") < 0)
+          return false;
+      }
+    return false;
+  }
+
+/* Read 'n' numbers from 'fp' into 'dst'. */
+bool numbers(FILE* fp, double* dst, unsigned int n)
+  {
+    char tok[HARNESS_TOKEN_LEN];
+    char* end;
+    unsigned int i;
+
+    for(i = 0; i < n; i++)
+      {
+        if(!token(fp, tok))
+          return false;
+        dst[i] = strtod(tok, &end);
+        if(*end != '\0')
+          return false;
+      }
+    return true;
+  }
+
+/* Read the fixture in 'filename' into the globals above. */
+bool loadFixture(char* filename)
+  {
+    FILE* fp;
+    char tok[HARNESS_TOKEN_LEN];
+    unsigned int xs = 0;
+    unsigned int ys = 0;
+    unsigned int l, n, i, m;
+    bool ok = true;
+
+    if((fp = fopen(filename, "r")) == NULL)
+      return false;
+    for(m = 0; m < HARNESS_MODES; m++)
+      modeWanted[m] = false;
+
+    while(ok && token(fp, tok))
+      {
+        if(strcmp(tok, "inputs") == 0)
+          ok = (fscanf(fp, "%u", &inputs) == 1);
+        else if(strcmp(tok, "outputs") == 0)
+          ok = (fscanf(fp, "%u", &outputs) == 1);
+        else if(strcmp(tok, "samples") == 0)
+          ok = (fscanf(fp, "%u", &samples) == 1);
+        else if(strcmp(tok, "tolerance") == 0)
+          ok = (fscanf(fp, "%lf %llu", &tolAbs, &tolUlp) == 2);
+        else if(strcmp(tok, "x") == 0 || strcmp(tok, "y") == 0)
+          {
+            if(inputs == 0 || outputs == 0 || samples == 0)
+              {
+                cout << "ERROR: Fixture gives samples before 'inputs', 'outputs' and 'samples'\n";
+                ok = false;
+              }
+            else if(tok[0] == 'x')
+              {
+                if(X == NULL && (X = (double*)malloc(samples * inputs * sizeof(double))) == NULL)
+                  {
+                    cout << "ERROR: Unable to allocate fixture inputs\n";
+                    exit(1);
+                  }
+                ok = (xs < samples && numbers(fp, X + (xs++) * inputs, inputs));
+              }
+            else
+              {
+                if(Y == NULL && (Y = (double*)malloc(samples * outputs * sizeof(double))) == NULL)
+                  {
+                    cout << "ERROR: Unable to allocate fixture outputs\n";
+                    exit(1);
+                  }
+                ok = (ys < samples && numbers(fp, Y + (ys++) * outputs, outputs));
+              }
+          }
+        else if(strcmp(tok, "modes") == 0)
+          {
+            modesGiven = true;
+            ok = (fscanf(fp, "%u", &n) == 1);
+            for(i = 0; ok && i < n; i++)
+              {
+                ok = token(fp, tok);
+                for(m = 0; ok && m < HARNESS_MODES && strcmp(tok, modeName[m]) != 0; m++);
+                if(ok && m == HARNESS_MODES)
+                  {
+                    cout << "ERROR: Unknown mode '" << tok << "'\n";
+                    ok = false;
+                  }
+                else if(ok)
+                  modeWanted[m] = true;
+              }
+          }
+        else if(strcmp(tok, "tiling") == 0)
+          {
+            ok = (fscanf(fp, "%u %u %u", &tileW, &tileH, &tileLen) == 3 && tileLen > 0 && tileLen <= HARNESS_MAX_LAYERS);
+            for(i = 0; ok && i < tileLen; i++)
+              ok = (fscanf(fp, "%31s", tileName[i]) == 1);
+          }
+        else if(strcmp(tok, "population") == 0)
+          {
+            ok = (fscanf(fp, "%31s %u", popSource, &popLen) == 2 && popLen > 0 && popLen <= HARNESS_MAX_LAYERS);
+            for(i = 0; ok && i < popLen; i++)
+              ok = (fscanf(fp, "%31s", popName[i]) == 1);
+          }
+        else if(strcmp(tok, "layer") == 0)
+          {
+            l = layerCount;
+            if(samples == 0 || l == HARNESS_MAX_LAYERS)
+              ok = false;
+            else if(fscanf(fp, "%31s %u", layerName[l], &layerLen[l]) != 2 || layerLen[l] == 0)
+              ok = false;
+            else
+              {
+                if((layerRef[l] = (double*)malloc(samples * layerLen[l] * sizeof(double))) == NULL)
+                  {
+                    cout << "ERROR: Unable to allocate fixture layer outputs\n";
+                    exit(1);
+                  }
+                layerCount++;
+                ok = numbers(fp, layerRef[l], samples * layerLen[l]);
+              }
+          }
+        else
+          {
+            cout << "ERROR: Unknown fixture keyword '" << tok << "'\n";
+            ok = false;
+          }
+      }
+    fclose(fp);
+    for(m = 0; m < HARNESS_MODES && !modesGiven; m++)               //  No 'modes' line: every mode
+      modeWanted[m] = true;
+
+    return ok && samples > 0 && xs == samples && ys == samples;
+  }
+
+/* Number of modes the fixture exercises. */
+unsigned int modeCount()
+  {
+    unsigned int m, n = 0;
+
+    for(m = 0; m < HARNESS_MODES; m++)
+      n += modeWanted[m];
+    return n;
+  }
+
+/* Whether the fixture exercises 'mode'. */
+bool wants(const char* mode)
+  {
+    unsigned int m;
+
+    for(m = 0; m < HARNESS_MODES && strcmp(mode, modeName[m]) != 0; m++);
+    return m < HARNESS_MODES && modeWanted[m];
+  }
+
+/* Index of the 'layer' line for 'name', or layerCount if the fixture gives none. */
+unsigned int layerRefIndex(const char* name)
+  {
+    unsigned int l;
+
+    for(l = 0; l < layerCount && strcmp(layerName[l], name) != 0; l++);
+    return l;
+  }
+
+/* Overwrite 'filename' with the fixture's inputs and tolerances, and with 'Z' and each layer's outputs as the
+   references. */
+bool writeFixture(char* filename, double* Z)
+  {
+    FILE* fp;
+    unsigned int s, i, l, m;
+
+    if((fp = fopen(filename, "w")) == NULL)
+      return false;
+
+    fprintf(fp, "# Recorded by harness\n");
+    fprintf(fp, "inputs %u\noutputs %u\nsamples %u\ntolerance %.17g %llu\n", inputs, outputs, samples, tolAbs, tolUlp);
+    if(modesGiven)
+      {
+        fprintf(fp, "modes %u", modeCount());
+        for(m = 0; m < HARNESS_MODES; m++)
+          {
+            if(modeWanted[m])
+              fprintf(fp, " %s", modeName[m]);
+          }
+        fprintf(fp, "\n");
+      }
+    if(tileLen > 0)
+      {
+        fprintf(fp, "tiling %u %u %u", tileW, tileH, tileLen);
+        for(l = 0; l < tileLen; l++)
+          fprintf(fp, " %s", tileName[l]);
+        fprintf(fp, "\n");
+      }
+    if(popLen > 0)
+      {
+        fprintf(fp, "population %s %u", popSource, popLen);
+        for(l = 0; l < popLen; l++)
+          fprintf(fp, " %s", popName[l]);
+        fprintf(fp, "\n");
+      }
+    for(s = 0; s < samples; s++)
+      {
+        fprintf(fp, "x");
+        for(i = 0; i < inputs; i++)
+          fprintf(fp, " %.17g", X[s * inputs + i]);
+        fprintf(fp, "\ny");
+        for(i = 0; i < outputs; i++)
+          fprintf(fp, " %.17g", Z[s * outputs + i]);
+        fprintf(fp, "\n");
+      }
+    for(l = 0; l < layerCount; l++)
+      {
+        fprintf(fp, "layer %s %u\n", layerName[l], layerLen[l]);
+        for(s = 0; s < samples; s++)
+          {
+            for(i = 0; i < layerLen[l]; i++)
+              fprintf(fp, "%s%.17g", (i > 0) ? " " : "", layerRef[l][s * layerLen[l] + i]);
+            fprintf(fp, "\n");
+          }
+      }
+    fclose(fp);
+
+    return true;
+  }
+
+/**************************************************************************************************
+ Modes  */
+
+/* Every sample through run(), one at a time, from a reset network. With 'layers', compare (or, with 'record',
+   copy) the named layers' outputs after each sample. Return false if an output has the wrong length. */
+bool replayRun(NeuralNet* nn, double* Z, bool layers, bool record)
+  {
+    unsigned int s, l, n;
+    double* z;
+    double* out;
+
+    nn->reset();
+    for(s = 0; s < samples; s++)
+      {
+        z = NULL;                                                   //  run() sets nothing for an empty network
+        if(nn->run(X + s * inputs, &z) != outputs)
+          {
+            if(z != NULL)
+              free(z);
+            return false;
+          }
+        memcpy(Z + s * outputs, z, outputs * sizeof(double));
+        free(z);
+
+        for(l = 0; layers && l < layerCount; l++)
+          {
+            if((out = nn->outputOf(layerName[l], &n)) == NULL || n != layerLen[l])
+              {
+                layerErr[l].failures++;
+                continue;
+              }
+            if(record)
+              memcpy(layerRef[l] + s * n, out, n * sizeof(double));
+            else
+              compare(out, layerRef[l] + s * n, n, layerErr + l);
+          }
+      }
+    return true;
+  }
+
+/* All samples through runBatch() at once. */
+bool replayBatch(NeuralNet* nn, double* Z)
+  {
+    double* z = NULL;
+
+    if(nn->runBatch(X, samples, &z) != outputs)
+      {
+        free(z);
+        return false;
+      }
+    memcpy(Z, z, samples * outputs * sizeof(double));
+    free(z);
+    return true;
+  }
+
+/* All samples through runSequence() as one sequence, from a reset network. */
+bool replaySequence(NeuralNet* nn, double* Z)
+  {
+    double* z = NULL;
+
+    nn->reset();
+    if(nn->runSequence(X, samples, &z) != outputs)
+      {
+        free(z);
+        return false;
+      }
+    memcpy(Z, z, samples * outputs * sizeof(double));
+    free(z);
+    return true;
+  }
+
+/* Every sample through the registry's published version, one at a time. */
+bool replayRegistry(ModelRegistry* registry, double* Z)
+  {
+    unsigned int s;
+    double* z;
+
+    for(s = 0; s < samples; s++)
+      {
+        if(registry->run(X + s * inputs, &z) != outputs)
+          {
+            if(z != NULL)
+              free(z);
+            return false;
+          }
+        memcpy(Z + s * outputs, z, outputs * sizeof(double));
+        free(z);
+      }
+    return true;
+  }
+
+/* Every sample through the tiled chain, one at a time. */
+bool replayTiling(Tiling* tiling, double* Z)
+  {
+    unsigned int s;
+
+    for(s = 0; s < samples; s++)
+      {
+        if(tiling->run(X + s * inputs, Z + s * tiling->outputLen()) != tiling->outputLen())
+          return false;
+      }
+    return true;
+  }
+
+/* All samples, as one batch, through the population's single genome. */
+bool replayPopulation(Population* pop, double* Z)
+  {
+    pop->evaluate(popInput, samples, Z);
+    return pop->outputLen() == outputs;
+  }
+
+/* Print and log one mode's result: its error 'e' against the references and its best time 'best' for all samples
+   (0 if untimed). Return whether it passed. */
+bool report(const char* mode, Error* e, double best, FILE* csv, char* fixture)
+  {
+    printf("%-11s max abs %10.3e   max ulp %10llu   fail %6u   %10.2f us/sample   %s\n", mode, e->maxAbs,
+           e->maxUlp, e->failures, best / samples, (e->failures == 0) ? "pass" : "FAIL");
+    if(csv != NULL)
+      fprintf(csv, "%s,%s,%.6e,%llu,%u,%.4f\n", fixture, mode, e->maxAbs, e->maxUlp, e->failures, best / samples);
+    return e->failures == 0;
+  }
+
+/* Report a mode that could not run as itself, for the reason 'why'. Always returns false. */
+bool refuse(const char* mode, const char* why, FILE* csv, char* fixture)
+  {
+    printf("%-11s %-72s FAIL\n", mode, why);
+    if(csv != NULL)
+      fprintf(csv, "%s,%s,inf,%llu,%u,0.0000\n", fixture, mode, ULLONG_MAX, samples * outputs);
+    return false;
+  }
+
+/* Report a mode the fixture does not exercise. */
+void skip(const char* mode)
+  {
+    printf("%-11s skipped: not among the fixture's modes\n", mode);
+    return;
+  }
+
+/* Replay 'repeat' + 1 times in the given mode: once to check, then 'repeat' timed passes, the last of which is
+   checked too (catching state that leaks from one pass into the next). 'subject' is what the mode runs: the
+   NeuralNet, or for 'registry', 'tiling' and 'population' the ModelRegistry, Tiling or Population. Each sample's
+   'len' outputs are held to 'ref'. Report the mode and return whether it passed. */
+bool check(const char* mode, void* subject, double* ref, unsigned int len, unsigned int repeat, FILE* csv,
+           char* fixture)
+  {
+    Error e = {0.0, 0, 0};
+    Error last = {0.0, 0, 0};
+    double* Z;
+    double best = INFINITY;
+    double us;
+    unsigned int r;
+    bool ok = true;
+    chrono::steady_clock::time_point start;
+
+    if((Z = (double*)malloc(samples * len * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate harness outputs\n";
+        exit(1);
+      }
+
+    for(r = 0; ok && r <= repeat; r++)
+      {
+        start = chrono::steady_clock::now();
+        if(strcmp(mode, "batch") == 0)
+          ok = replayBatch((NeuralNet*)subject, Z);
+        else if(strcmp(mode, "sequence") == 0)
+          ok = replaySequence((NeuralNet*)subject, Z);
+        else if(strcmp(mode, "registry") == 0)
+          ok = replayRegistry((ModelRegistry*)subject, Z);
+        else if(strcmp(mode, "tiling") == 0)
+          ok = replayTiling((Tiling*)subject, Z);
+        else if(strcmp(mode, "population") == 0)
+          ok = replayPopulation((Population*)subject, Z);
+        else
+          ok = replayRun((NeuralNet*)subject, Z, r == 0 && strcmp(mode, "run") == 0, false);
+        us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+        if(r > 0 && us < best)                                      //  The check pass also warms caches: not timed
+          best = us;
+        if(ok && r == 0)
+          compare(Z, ref, samples * len, &e);
+        else if(ok && r == repeat)
+          compare(Z, ref, samples * len, &last);
+      }
+    free(Z);
+
+    if(!ok)
+      return refuse(mode, "output length differs from the fixture's", csv, fixture);
+
+    if(last.maxAbs > e.maxAbs)                                      //  Count each element once, by its worse pass
+      e.maxAbs = last.maxAbs;
+    if(last.maxUlp > e.maxUlp)
+      e.maxUlp = last.maxUlp;
+    if(last.failures > e.failures)
+      e.failures = last.failures;
+
+    return report(mode, &e, (repeat > 0) ? best : 0.0, csv, fixture);
+  }
+
+/* A second copy of the network, for modes that change it. */
+NeuralNet* copy(char* filename)
+  {
+    NeuralNet* nn = new NeuralNet(0);
+    if(!nn->load(filename))
+      {
+        cout << "ERROR: Unable to reload " << filename << "\n";
+        exit(1);
+      }
+    return nn;
+  }
+
+/* Build the tiled chain the fixture names from the layers of 'nn'. Return NULL, with the reason in 'why', if the
+   chain cannot be tiled or its output has no reference. */
+Tiling* buildTiling(NeuralNet* nn, const char** why)
+  {
+    Tiling* tiling;
+    unsigned int l, i;
+    bool ok = true;
+
+    if(tileLen == 0)
+      {
+        *why = "the fixture names no chain to tile";
+        return NULL;
+      }
+    tiling = new Tiling(tileW, tileH);
+    for(l = 0; l < tileLen && ok; l++)
+      {
+        i = nn->nameIndex(tileName[l]);
+        switch(nn->nameType(tileName[l]))
+          {
+            case CONV2D_ARRAY:  ok = tiling->addConv2D(nn->getConv2D(i));  break;
+            case POOL_ARRAY:    ok = tiling->addPool(nn->getPool(i));      break;
+            case UPRES_ARRAY:   ok = tiling->addUpres(nn->getUpres(i));    break;
+            default:            ok = false;                                break;
+          }
+      }
+    l = layerRefIndex(tileName[tileLen - 1]);
+    if(!ok || tiling->inputWidth() * tiling->inputHeight() != inputs)
+      *why = "the named chain is not a tileable chain of 2D layers reading the input";
+    else if(l == layerCount || layerLen[l] != tiling->outputLen())
+      *why = "the fixture gives no reference for the chain's output";
+    else
+      return tiling;
+    delete tiling;
+    return NULL;
+  }
+
+/* Build a one-genome Population holding the fixture's chain of Dense layers from 'nn', and point 'popInput' at
+   the chain's input for every sample. Return NULL, with the reason in 'why', if that cannot be done. */
+Population* buildPopulation(NeuralNet* nn, const char** why)
+  {
+    Population* pop;
+    Dense* d[HARNESS_MAX_LAYERS];
+    unsigned int inLen, l, i;
+
+    if(popLen == 0)
+      {
+        *why = "the fixture names no chain of Dense layers";
+        return NULL;
+      }
+    if(strcmp(popSource, "input") == 0)
+      {
+        popInput = X;
+        inLen = inputs;
+      }
+    else if((l = layerRefIndex(popSource)) < layerCount)
+      {
+        popInput = layerRef[l];
+        inLen = layerLen[l];
+      }
+    else
+      {
+        *why = "the fixture gives no reference for the population's source";
+        return NULL;
+      }
+
+    for(l = 0; l < popLen; l++)
+      {
+        i = nn->nameIndex(popName[l]);
+        if(nn->nameType(popName[l]) != DENSE_ARRAY ||
+           nn->getDense(i)->inputLen() != ((l == 0) ? inLen : d[l - 1]->outputLen()))
+          {
+            *why = "the named chain is not a chain of Dense layers fed by its source";
+            return NULL;
+          }
+        d[l] = nn->getDense(i);
+      }
+
+    pop = new Population(inLen, 1, 1);
+    for(l = 0; l < popLen; l++)
+      {
+        pop->addDense(d[l]->outputLen());
+        pop->copyFromDense(0, l, d[l]);
+      }
+    return pop;
+  }
+
+/* Export the network as a specialized header, compile it with a small driver, and replay the samples through the
+   compiled run(): the driver times 'repeat' passes after a first, untimed one. Report and return whether every
+   output matched. The header, driver and program are built in a temporary directory, removed afterward. */
+bool checkCodegen(NeuralNet* nn, unsigned int repeat, FILE* csv, char* fixture)
+  {
+    char dir[] = "/tmp/harnessXXXXXX";
+    char header[HARNESS_PATH_LEN];
+    char driver[HARNESS_PATH_LEN];
+    char program[HARNESS_PATH_LEN];
+    char in[HARNESS_PATH_LEN];
+    char out[HARNESS_PATH_LEN];
+    char command[4 * HARNESS_PATH_LEN];
+    char prefix[] = "harnessnet";
+    const char* compiler;
+    const char* why = NULL;
+    Error e = {0.0, 0, 0};
+    double* Z;
+    double best = 0.0;
+    unsigned int i;
+    FILE* fp;
+
+    if(mkdtemp(dir) == NULL)
+      return refuse("codegen", "unable to make a temporary directory", csv, fixture);
+    snprintf(header, HARNESS_PATH_LEN, "%s/net.h", dir);
+    snprintf(driver, HARNESS_PATH_LEN, "%s/driver.cpp", dir);
+    snprintf(program, HARNESS_PATH_LEN, "%s/driver", dir);
+    snprintf(in, HARNESS_PATH_LEN, "%s/x.txt", dir);
+    snprintf(out, HARNESS_PATH_LEN, "%s/z.txt", dir);
+    if((compiler = getenv("CXX")) == NULL)
+      compiler = "g++";
+
+    if((Z = (double*)malloc(samples * outputs * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate harness outputs\n";
+        exit(1);
+      }
+
+    if(!nn->exportHeader(header, prefix))
+      why = "the network cannot be specialized";
+    else if((fp = fopen(driver, "w")) == NULL)
+      why = "unable to write the driver";
+    else
+      {
+        fprintf(fp, "#include <chrono>\n#include <math.h>\n#include <stdio.h>\n#include \"net.h\"\n"
+                    "int main()\n  {\n    unsigned int samples, repeat, s, r, i;\n    double best = INFINITY, us;\n"
+                    "    if(scanf(\"%%u %%u\", &samples, &repeat) != 2)\n      return 1;\n"
+                    "    double* X = new double[samples * %s::INPUTS];\n"
+                    "    double* Z = new double[samples * %s::OUTPUTS];\n"
+                    "    for(i = 0; i < samples * %s::INPUTS; i++)\n"
+                    "      if(scanf(\"%%lf\", X + i) != 1)\n        return 1;\n"
+                    "    for(r = 0; r <= repeat; r++)\n      {\n"
+                    "        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();\n"
+                    "        for(s = 0; s < samples; s++)\n"
+                    "          %s::run(X + s * %s::INPUTS, Z + s * %s::OUTPUTS);\n"
+                    "        us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();\n"
+                    "        if(r > 0 && us < best)\n          best = us;\n      }\n"
+                    "    for(i = 0; i < samples * %s::OUTPUTS; i++)\n      printf(\"%%.17g\\n\", Z[i]);\n"
+                    "    printf(\"%%.17g\\n\", (repeat > 0) ? best : 0.0);\n"
+                    "    delete[] X;\n    delete[] Z;\n    return 0;\n  }\n",
+                prefix, prefix, prefix, prefix, prefix, prefix, prefix);
+        fclose(fp);
+
+        if((fp = fopen(in, "w")) == NULL)
+          why = "unable to write the driver's input";
+        else
+          {
+            fprintf(fp, "%u %u\n", samples, repeat);
+            for(i = 0; i < samples * inputs; i++)
+              fprintf(fp, "%.17g\n", X[i]);
+            fclose(fp);
+
+            snprintf(command, 4 * HARNESS_PATH_LEN, "%s -O2 -o %s %s", compiler, program, driver);
+            if(system(command) != 0)
+              why = "the generated header does not compile";
+            else
+              {
+                snprintf(command, 4 * HARNESS_PATH_LEN, "%s < %s > %s", program, in, out);
+                if(system(command) != 0 || (fp = fopen(out, "r")) == NULL)
+                  why = "the compiled network did not run";
+                else
+                  {
+                    for(i = 0; i < samples * outputs && why == NULL; i++)
+                      {
+                        if(fscanf(fp, "%lf", Z + i) != 1)
+                          why = "output length differs from the fixture's";
+                      }
+                    if(why == NULL && fscanf(fp, "%lf", &best) != 1)
+                      why = "the compiled network reported no time";
+                    fclose(fp);
+                  }
+              }
+          }
+      }
+
+    unlink(out);
+    unlink(in);
+    unlink(program);
+    unlink(driver);
+    unlink(header);
+    rmdir(dir);
+
+    if(why == NULL)
+      compare(Z, Y, samples * outputs, &e);
+    free(Z);
+    if(why != NULL)
+      return refuse("codegen", why, csv, fixture);
+    return report("codegen", &e, best, csv, fixture);
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    NeuralNet* other;
+    ModelRegistry* registry;
+    Tiling* tiling;
+    Population* pop;
+    unsigned int repeat = 100;
+    unsigned int l;
+    unsigned long long before;
+    int i;
+    bool record = false;
+    bool ok = true;
+    bool haveAbs = false, haveUlp = false;
+    double argAbs = 0.0;
+    unsigned long long argUlp = 0;
+    char* csvName = NULL;
+    FILE* csv = NULL;
+    const char* why;
+    double* Z;
+
+    if(argc < 3)
+      {
+        cout << "Usage: " << argv[0] << " <network file> <fixture file> [-abs tol] [-ulp tol] [-repeat n] [-csv file] [-record]\n";
+        return 1;
+      }
+    for(i = 3; i < argc; i++)
+      {
+        if(strcmp(argv[i], "-abs") == 0 && i + 1 < argc)
+          {
+            argAbs = atof(argv[++i]);
+            haveAbs = true;
+          }
+        else if(strcmp(argv[i], "-ulp") == 0 && i + 1 < argc)
+          {
+            argUlp = strtoull(argv[++i], NULL, 10);
+            haveUlp = true;
+          }
+        else if(strcmp(argv[i], "-repeat") == 0 && i + 1 < argc)
+          repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+          csvName = argv[++i];
+        else if(strcmp(argv[i], "-record") == 0)
+          record = true;
+        else
+          {
+            cout << "ERROR: Unknown option " << argv[i] << "\n";
+            return 1;
+          }
+      }
+
+    nn = new NeuralNet(0);
+    if(!nn->load(argv[1]))
+      {
+        cout << "ERROR: Unable to load " << argv[1] << "\n";
+        delete nn;
+        return 1;
+      }
+    if(!loadFixture(argv[2]))
+      {
+        cout << "ERROR: Unable to read fixture " << argv[2] << "\n";
+        delete nn;
+        return 1;
+      }
+    if(haveAbs)                                                     //  The command line overrides the fixture
+      tolAbs = argAbs;
+    if(haveUlp)
+      tolUlp = argUlp;
+    if(nn->inputLen() != inputs)
+      {
+        cout << "ERROR: Network takes " << nn->inputLen() << " inputs; fixture gives " << inputs << "\n";
+        delete nn;
+        return 1;
+      }
+
+    if(record)
+      {
+        if((Z = (double*)malloc(samples * outputs * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate harness outputs\n";
+            exit(1);
+          }
+        if(!replayRun(nn, Z, true, true) || !writeFixture(argv[2], Z))
+          {
+            cout << "ERROR: Unable to record " << argv[2] << "\n";
+            free(Z);
+            delete nn;
+            return 1;
+          }
+        printf("Recorded %u samples and %u layers into %s\n", samples, layerCount, argv[2]);
+        free(Z);
+        delete nn;
+        return 0;
+      }
+
+    if(csvName != NULL)
+      {
+        if((csv = fopen(csvName, "a")) == NULL)
+          {
+            cout << "ERROR: Unable to open " << csvName << "\n";
+            delete nn;
+            return 1;
+          }
+        if(ftell(csv) == 0)
+          fprintf(csv, "fixture,mode,max_abs,max_ulp,failures,us_per_sample\n");
+      }
+
+    printf("%s: %u samples, tolerance %g abs or %llu ulp, best of %u passes\n", argv[2], samples, tolAbs, tolUlp,
+           repeat);
+
+    if(wants("run"))
+      {
+        ok = check("run", nn, Y, outputs, repeat, csv, argv[2]) && ok;
+        for(l = 0; l < layerCount; l++)
+          {
+            printf("  %-9s max abs %10.3e   max ulp %10llu   fail %6u\n", layerName[l], layerErr[l].maxAbs,
+                   layerErr[l].maxUlp, layerErr[l].failures);
+            ok = ok && layerErr[l].failures == 0;
+          }
+      }
+    else
+      skip("run");
+
+    if(wants("delta"))                                              //  Incremental: only moved layers re-run
+      {
+        before = nn->partialRuns();
+        nn->setDelta(true, 0.0);
+        ok = check("delta", nn, Y, outputs, repeat, csv, argv[2]) && ok;
+        nn->setDelta(false, 0.0);
+        if(nn->partialRuns() == before)
+          ok = refuse("delta", "fell back to run(): no layer was ever updated in place", csv, argv[2]) && ok;
+      }
+    else
+      skip("delta");
+
+    if(wants("sequence"))
+      ok = check("sequence", nn, Y, outputs, repeat, csv, argv[2]) && ok;
+    else
+      skip("sequence");
+
+    if(wants("batch"))                                              //  Recurrent networks neither batch nor cache
+      {
+        if(nn->batchable())
+          ok = check("batch", nn, Y, outputs, repeat, csv, argv[2]) && ok;
+        else
+          ok = refuse("batch", "recurrent networks do not batch", csv, argv[2]) && ok;
+      }
+    else
+      skip("batch");
+
+    if(wants("cache"))
+      {
+        if(nn->setCache(samples))
+          {
+            ok = check("cache", nn, Y, outputs, repeat, csv, argv[2]) && ok;  //  All passes after the first are hits
+            if(nn->cacheHits() == 0)
+              ok = refuse("cache", "fell back to run(): no result was ever served from the cache", csv, argv[2]) && ok;
+            nn->setCache(0);
+          }
+        else
+          ok = refuse("cache", "recurrent networks are not cached", csv, argv[2]) && ok;
+      }
+    else
+      skip("cache");
+
+    if(wants("packed"))                                             //  Weights gathered into one Arena
+      {
+        other = copy(argv[1]);
+        if(other->pack() > 0)
+          ok = check("packed", other, Y, outputs, repeat, csv, argv[2]) && ok;
+        else
+          ok = refuse("packed", "fell back to run(): the network has no Conv2D weights to pack", csv, argv[2]) && ok;
+        delete other;
+      }
+    else
+      skip("packed");
+
+    if(wants("pruned"))                                             //  Exact pruning must change nothing
+      {
+        other = copy(argv[1]);
+        if(other->prune(X, samples, 0.0, NULL) > 0)
+          ok = check("pruned", other, Y, outputs, repeat, csv, argv[2]) && ok;
+        else
+          ok = refuse("pruned", "fell back to run(): nothing could be pruned exactly", csv, argv[2]) && ok;
+        delete other;
+      }
+    else
+      skip("pruned");
+
+    if(wants("factorized"))                                         //  Low-rank Dense layers, held to the tolerance
+      {
+        other = copy(argv[1]);
+        if(other->factorize(X, samples, tolAbs) > 0)
+          ok = check("factorized", other, Y, outputs, repeat, csv, argv[2]) && ok;
+        else
+          ok = refuse("factorized", "fell back to run(): no Dense layer factorizes within tolerance", csv, argv[2]) && ok;
+        delete other;
+      }
+    else
+      skip("factorized");
+
+    if(wants("tiling"))                                             //  The chain's output against its 'layer' line
+      {
+        if((tiling = buildTiling(nn, &why)) != NULL)
+          {
+            l = layerRefIndex(tileName[tileLen - 1]);
+            ok = check("tiling", tiling, layerRef[l], layerLen[l], repeat, csv, argv[2]) && ok;
+            delete tiling;
+          }
+        else
+          ok = refuse("tiling", why, csv, argv[2]) && ok;
+      }
+    else
+      skip("tiling");
+
+    if(wants("codegen"))
+      ok = checkCodegen(nn, repeat, csv, argv[2]) && ok;
+    else
+      skip("codegen");
+
+    if(wants("registry"))                                           //  Published copies, warmed on the samples
+      {
+        registry = new ModelRegistry(inputs, HARNESS_REPLICAS);
+        if(!nn->batchable())
+          ok = refuse("registry", "recurrent networks carry state between registry callers", csv, argv[2]) && ok;
+        else if(!registry->loadAsync(argv[1], X, samples) || !registry->wait())
+          ok = refuse("registry", "the registry did not publish the network", csv, argv[2]) && ok;
+        else
+          ok = check("registry", registry, Y, outputs, repeat, csv, argv[2]) && ok;
+        delete registry;
+      }
+    else
+      skip("registry");
+
+    if(wants("population"))                                         //  The Dense chain as a one-genome Population
+      {
+        if((pop = buildPopulation(nn, &why)) != NULL)
+          {
+            ok = check("population", pop, Y, outputs, repeat, csv, argv[2]) && ok;
+            delete pop;
+          }
+        else
+          ok = refuse("population", why, csv, argv[2]) && ok;
+      }
+    else
+      skip("population");
+
+    if(csv != NULL)
+      fclose(csv);
+    for(l = 0; l < layerCount; l++)
+      free(layerRef[l]);
+    free(X);
+    free(Y);
+    delete nn;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+  }
@@ -0,0 +1,168 @@
+/**************************************************************************************************
+ A fixture for the equivalence harness that takes every mode down its own path. The network reads a 10 x 8 image:
+ a 3 x 3 convolution ("conv"), a 2 x 2 max pool ("pool"), 16 sigmoid units ("hidden") and 4 softmax outputs
+ ("output"). The hidden layer's weights have rank 2, so it factorizes; two of its units have every input masked
+ off, so exact pruning removes them; and each sample differs from the one before in one or two pixels, so
+ incremental inference updates the convolution in place. Write the network, and a fixture holding the samples
+ and what run() makes of them, to files.
+
+ Usage: ./sparse [network file] [fixture file]      (defaults: sparse.nn, sparse.fix)
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define SPARSE_W        10                                          /* Input dimensions */
+#define SPARSE_H        8
+#define SPARSE_HIDDEN   16
+#define SPARSE_OUTPUTS  4
+#define SPARSE_SAMPLES  40
+
+/* A pseudo-random number in [-1.0, 1.0]. */
+double uniform()
+  {
+    return 2.0 * (double)rand() / (double)RAND_MAX - 1.0;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    char* filename = (char*)"sparse.nn";
+    char* fixname = (char*)"sparse.fix";
+    char convName[] = "conv";
+    char poolName[] = "pool";
+    char hiddenName[] = "hidden";
+    char outputName[] = "output";
+    char comment[] = "Sparse changes";
+    unsigned int convLen, poolLen;
+    unsigned int i, j, s, k, p;
+    double a[2][(SPARSE_W - 3) * (SPARSE_H - 3)];                   //  Factors of the hidden layer's weights
+    double b[2][SPARSE_HIDDEN];
+    double* w;
+    double* x;
+    double* z;
+    double* out;
+    FILE* fp;
+
+    if(argc > 3)
+      {
+        cout << "Usage: " << argv[0] << " [network file] [fixture file]\n";
+        return 1;
+      }
+    if(argc > 1)
+      filename = argv[1];
+    if(argc > 2)
+      fixname = argv[2];
+
+    srand(29);
+    nn = new NeuralNet(SPARSE_W * SPARSE_H);
+    nn->addConv2D(SPARSE_W, SPARSE_H);
+    nn->getConv2D(0)->addFilter(3, 3);
+    convLen = nn->getConv2D(0)->outputLen();                        //  8 x 6
+    nn->addPool(SPARSE_W - 2, SPARSE_H - 2);
+    nn->getPool(0)->addPool(2, 2);
+    poolLen = nn->getPool(0)->outputLen();                          //  7 x 5
+    nn->addDense(poolLen, SPARSE_HIDDEN);
+    nn->addDense(SPARSE_HIDDEN, SPARSE_OUTPUTS);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, SPARSE_W * SPARSE_H, CONV2D_ARRAY, 0);
+    nn->linkLayers(CONV2D_ARRAY, 0, 0, convLen, POOL_ARRAY, 0);
+    nn->linkLayers(POOL_ARRAY, 0, 0, poolLen, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, SPARSE_HIDDEN, DENSE_ARRAY, 1);
+    nn->sortEdges();
+
+    if((w = (double*)malloc((poolLen + 1) * SPARSE_HIDDEN * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate hidden weights\n";
+        exit(1);
+      }
+    for(k = 0; k < 2; k++)
+      {
+        for(i = 0; i < poolLen; i++)
+          a[k][i] = uniform();
+        for(j = 0; j < SPARSE_HIDDEN; j++)
+          b[k][j] = 0.5 * uniform();
+      }
+    for(i = 0; i <= poolLen; i++)                                   //  Rank 2, biases last
+      for(j = 0; j < SPARSE_HIDDEN; j++)
+        w[i * SPARSE_HIDDEN + j] = (i < poolLen) ? a[0][i] * b[0][j] + a[1][i] * b[1][j] : uniform();
+    nn->getDense(0)->setW(w);
+    free(w);
+    for(i = 0; i < poolLen; i++)                                    //  Units 3 and 11 read nothing
+      {
+        nn->getDense(0)->setM_ij(false, i, 3);
+        nn->getDense(0)->setM_ij(false, i, 11);
+      }
+    for(j = 0; j < SPARSE_HIDDEN; j++)
+      nn->getDense(0)->setF_i(SIGMOID, j);
+    for(j = 0; j < SPARSE_OUTPUTS; j++)
+      nn->getDense(1)->setF_i(SOFTMAX, j);
+
+    nn->getConv2D(0)->setName(convName);
+    nn->getPool(0)->setName(poolName);
+    nn->getDense(0)->setName(hiddenName);
+    nn->getDense(1)->setName(outputName);
+    nn->setComment(comment);
+
+    if(!nn->write(filename))
+      {
+        delete nn;
+        return 1;
+      }
+    cout << "Wrote " << filename << "\n";
+
+    if((x = (double*)malloc(SPARSE_SAMPLES * SPARSE_W * SPARSE_H * sizeof(double))) == NULL ||
+       (z = (double*)malloc(SPARSE_SAMPLES * SPARSE_OUTPUTS * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate samples\n";
+        exit(1);
+      }
+    for(p = 0; p < SPARSE_W * SPARSE_H; p++)                        //  Eighths print exactly
+      x[p] = (double)(rand() % 9) / 8.0;
+    for(s = 1; s < SPARSE_SAMPLES; s++)                             //  Each sample moves one or two pixels
+      {
+        memcpy(x + s * SPARSE_W * SPARSE_H, x + (s - 1) * SPARSE_W * SPARSE_H, SPARSE_W * SPARSE_H * sizeof(double));
+        for(k = 0; k <= s % 2; k++)
+          x[s * SPARSE_W * SPARSE_H + rand() % (SPARSE_W * SPARSE_H)] = (double)(rand() % 9) / 8.0;
+      }
+
+    if((fp = fopen(fixname, "w")) == NULL)
+      {
+        cout << "ERROR: Unable to open " << fixname << "\n";
+        exit(1);
+      }
+    fprintf(fp, "# Written by sparse.cpp with sparse.nn: %u samples, each one or two pixels away from the last, and\n"
+                "# what run() made of them. Every mode but codegen, which only takes networks of Dense layers, must\n"
+                "# take its own path and reproduce these.\n", SPARSE_SAMPLES);
+    fprintf(fp, "inputs %u\noutputs %u\nsamples %u\ntolerance 1e-12 4\n", SPARSE_W * SPARSE_H, SPARSE_OUTPUTS, SPARSE_SAMPLES);
+    fprintf(fp, "modes 11 run delta sequence batch cache packed pruned factorized tiling registry population\n");
+    fprintf(fp, "tiling 3 2 2 %s %s\n", convName, poolName);
+    fprintf(fp, "population %s 2 %s %s\n", poolName, hiddenName, outputName);
+    for(s = 0; s < SPARSE_SAMPLES; s++)
+      {
+        nn->run(x + s * SPARSE_W * SPARSE_H, &out);
+        memcpy(z + s * SPARSE_OUTPUTS, out, SPARSE_OUTPUTS * sizeof(double));
+        free(out);
+        fprintf(fp, "x");
+        for(i = 0; i < SPARSE_W * SPARSE_H; i++)
+          fprintf(fp, " %.17g", x[s * SPARSE_W * SPARSE_H + i]);
+        fprintf(fp, "\ny");
+        for(i = 0; i < SPARSE_OUTPUTS; i++)
+          fprintf(fp, " %.17g", z[s * SPARSE_OUTPUTS + i]);
+        fprintf(fp, "\n");
+      }
+    fprintf(fp, "layer %s %u\n", poolName, poolLen);                //  References for 'tiling' and 'population'
+    for(s = 0; s < SPARSE_SAMPLES; s++)
+      {
+        nn->run(x + s * SPARSE_W * SPARSE_H, &out);
+        free(out);
+        for(i = 0; i < poolLen; i++)
+          fprintf(fp, "%s%.17g", (i > 0) ? " " : "", nn->getPool(0)->output()[i]);
+        fprintf(fp, "\n");
+      }
+    fclose(fp);
+    cout << "Wrote " << fixname << "\n";
+
+    free(x);
+    free(z);
+    delete nn;
+    return 0;
+  }
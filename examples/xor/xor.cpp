@@ -0,0 +1,69 @@
+/**************************************************************************************************
+ Exclusive-OR. Build a 2-2-1 network of sigmoid units whose weights are set by hand: one hidden unit computes OR,
+ the other NAND, and the output unit ANDs them. Print the network's output for the four possible inputs and write
+ the network to a file, for the equivalence harness (see examples/harness) and the code generator.
+
+ Usage: ./xor [network file]      (default: xor.nn)
+***************************************************************************************************/
+
+#include "neuron.h"
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    char* filename = (char*)"xor.nn";
+    char hiddenName[] = "hidden";
+    char outputName[] = "output";
+    char comment[] = "Exclusive-OR";
+                                                                    //  Row-major, one row per input, biases last
+    double hiddenW[] = {  20.0, -20.0,                              //  x1 -> OR, NAND
+                          20.0, -20.0,                              //  x2 -> OR, NAND
+                         -10.0,  30.0 };                            //  Biases
+    double outputW[] = {  20.0,                                     //  OR  -> AND
+                          20.0,                                     //  NAND -> AND
+                         -30.0 };                                   //  Bias
+    double x[8] = { 0.0, 0.0,  0.0, 1.0,  1.0, 0.0,  1.0, 1.0 };
+    double* z;
+    unsigned int i;
+
+    if(argc > 2)
+      {
+        cout << "Usage: " << argv[0] << " [network file]\n";
+        return 1;
+      }
+    if(argc == 2)
+      filename = argv[1];
+
+    nn = new NeuralNet(2);
+    nn->addDense(2, 2);                                             //  Dense layer 0: hidden
+    nn->addDense(2, 1);                                             //  Dense layer 1: output
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 2, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 2, DENSE_ARRAY, 1);
+    nn->sortEdges();
+
+    nn->getDense(0)->setW(hiddenW);
+    nn->getDense(1)->setW(outputW);
+    for(i = 0; i < 2; i++)
+      nn->getDense(0)->setF_i(SIGMOID, i);
+    nn->getDense(1)->setF_i(SIGMOID, 0);
+    nn->getDense(0)->setName(hiddenName);
+    nn->getDense(1)->setName(outputName);
+    nn->setComment(comment);
+
+    for(i = 0; i < 4; i++)
+      {
+        nn->run(x + i * 2, &z);
+        printf("%.0f XOR %.0f = %.6f\n", x[i * 2], x[i * 2 + 1], z[0]);
+        free(z);
+      }
+
+    if(!nn->write(filename))
+      {
+        delete nn;
+        return 1;
+      }
+    cout << "Wrote " << filename << "\n";
+
+    delete nn;
+    return 0;
+  }
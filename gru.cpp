@@ -0,0 +1,572 @@
+#ifndef __GRU_CPP
+#define __GRU_CPP
+
+#include "gru.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Input length 'dimInput', state length 'dimState', and the number of past states kept, 'cacheLen'.
+   Weights and biases are random in [-1.0, 1.0]; the state starts at zero. */
+GRU::GRU(unsigned int dimInput, unsigned int dimState, unsigned int cacheLen)
+  {
+    unsigned int i, j;
+
+    d = dimInput;
+    h = dimState;
+    cache = (cacheLen > 0) ? cacheLen : 1;
+    t = 0;
+
+    Wz.resize(h, d);
+    Wr.resize(h, d);
+    Wh.resize(h, d);
+    Uz.resize(h, h);
+    Ur.resize(h, h);
+    Uh.resize(h, h);
+    bz.resize(h);
+    br.resize(h);
+    bh.resize(h);
+    for(i = 0; i < h; i++)                                          //  Generate random numbers in [ -1.0, 1.0 ]
+      {
+        for(j = 0; j < d; j++)
+          Wz(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < d; j++)
+          Wr(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < d; j++)
+          Wh(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Uz(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Ur(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Uh(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bz(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        br(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bh(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+      }
+
+    H = new History(h, cache);
+    out = VectorXd::Zero(h);
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+GRU::~GRU()
+  {
+    H->release();
+  }
+
+/**************************************************************************************************
+ Weights  */
+
+/* Set the entire (h x d) Wz weight matrix from 'w', row-major. */
+void GRU::setWz(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wz(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void GRU::setWz_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wz(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x d) Wr weight matrix from 'w', row-major. */
+void GRU::setWr(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wr(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void GRU::setWr_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wr(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x d) Wh weight matrix from 'w', row-major. */
+void GRU::setWh(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wh(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void GRU::setWh_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wh(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Uz weight matrix from 'w', row-major. */
+void GRU::setUz(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Uz(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void GRU::setUz_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Uz(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Ur weight matrix from 'w', row-major. */
+void GRU::setUr(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Ur(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void GRU::setUr_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Ur(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Uh weight matrix from 'w', row-major. */
+void GRU::setUh(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Uh(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void GRU::setUh_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Uh(i, j) = (float)w;
+    return;
+  }
+
+/*  */
+void GRU::setbz(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bz(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void GRU::setbz_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bz(i) = (float)w;
+    return;
+  }
+
+/*  */
+void GRU::setbr(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      br(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void GRU::setbr_i(double w, unsigned int i)
+  {
+    if(i < h)
+      br(i) = (float)w;
+    return;
+  }
+
+/*  */
+void GRU::setbh(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bh(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void GRU::setbh_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bh(i) = (float)w;
+    return;
+  }
+
+/*  */
+void GRU::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* GRU::name() const
+  {
+    return (char*)layerName;
+  }
+
+/* Print a matrix or vector, one row per line. */
+static void gru_print(const Eigen::Ref<const MatrixXf>& m)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < (unsigned int)m.rows(); i++)
+      {
+        printf("  [");
+        for(j = 0; j < (unsigned int)m.cols(); j++)
+          printf(" %.5f", m(i, j));
+        printf(" ]\n");
+      }
+    return;
+  }
+
+/*  */
+void GRU::print() const
+  {
+    printf("Input Length = %d, State Length = %d, Cache = %d, t = %d\n", d, h, cache, t);
+    printf("Wz =\n");
+    gru_print(Wz);
+    printf("Wr =\n");
+    gru_print(Wr);
+    printf("Wh =\n");
+    gru_print(Wh);
+    printf("Uz =\n");
+    gru_print(Uz);
+    printf("Ur =\n");
+    gru_print(Ur);
+    printf("Uh =\n");
+    gru_print(Uh);
+    printf("bz =\n");
+    gru_print(bz);
+    printf("br =\n");
+    gru_print(br);
+    printf("bh =\n");
+    gru_print(bh);
+    return;
+  }
+
+/*  */
+unsigned int GRU::inputLen() const
+  {
+    return d;
+  }
+
+/*  */
+unsigned int GRU::outputLen() const
+  {
+    return h;
+  }
+
+/* The most recent hidden state, or zeros before the first run(). */
+double* GRU::output() const
+  {
+    return (double*)out.data();
+  }
+
+/**************************************************************************************************
+ Run layer  */
+
+/* Logistic function, elementwise. */
+static VectorXf gru_sigmoid(const VectorXf& v)
+  {
+    return (1.0f + (-v.array()).exp()).inverse().matrix();
+  }
+
+/* Advance one time step on the d-long input 'x':
+     z = sig(Wz x + Uz h' + bz)    r = sig(Wr x + Ur h' + br)
+     h = z * h' + (1 - z) * tanh(Wh x + Uh (r * h') + bh)
+   where h' is the previous hidden state and products of vectors are elementwise. Return h. */
+unsigned int GRU::run(double* x)
+  {
+    unsigned int col;
+    VectorXf xf = Map<VectorXd>(x, d).cast<float>();
+    Map<MatrixXf> past(H->data(), h, cache);
+    VectorXf prev = (t == 0) ? VectorXf::Zero(h) : VectorXf(past.col(((t < cache) ? t : cache) - 1));
+
+    VectorXf z = gru_sigmoid(Wz * xf + Uz * prev + bz);             //  Update gate
+    VectorXf r = gru_sigmoid(Wr * xf + Ur * prev + br);             //  Reset gate
+    VectorXf next;
+
+    next = z.cwiseProduct(prev) + (VectorXf::Ones(h) - z).cwiseProduct(
+           (Wh * xf + Uh * r.cwiseProduct(prev) + bh).array().tanh().matrix());
+
+    H = H->writable();                                              //  Copy first if a saved state shares it
+    Map<MatrixXf> Hm(H->data(), h, cache);
+    if(t >= cache)                                                  //  Full: shift out the oldest state
+      {
+        Hm.leftCols(cache - 1) = Hm.rightCols(cache - 1).eval();
+        col = cache - 1;
+      }
+    else
+      col = t;
+    Hm.col(col) = next;
+    out = next.cast<double>();
+    t++;
+
+    return h;
+  }
+
+/* Forget all state: back to time step 0. */
+void GRU::reset()
+  {
+    t = 0;
+    if(H->shared())                                                 //  Leave saved states their history
+      {
+        H->release();
+        H = new History(h, cache);
+      }
+    else
+      memset(H->data(), 0, h * cache * sizeof(float));
+    out.setZero();
+    return;
+  }
+
+/* Record the current state in empty 's'. The hidden-state cache is shared, not copied: the next run() copies it
+   before writing, and only if 's' still holds it. */
+void GRU::saveState(LayerState* s) const
+  {
+    NetState::save(s, t, h, NULL, out.data(), H);
+    return;
+  }
+
+/* Return to the state recorded in 's', which keeps its own reference and is left as it was. */
+void GRU::loadState(const LayerState* s)
+  {
+    if(s->len != h || s->H->rows() != h || s->H->cols() != cache)
+      {
+        cout << "ERROR: Saved state does not fit this layer\n";
+        exit(1);
+      }
+    t = s->t;
+    out = Map<VectorXd>(s->out, h);
+    s->H->share();
+    H->release();
+    H = s->H;
+    return;
+  }
+
+/**************************************************************************************************
+ Pruning  */
+
+/* Remove row 'r' of 'A'. */
+static void gru_dropRow(MatrixXf& A, unsigned int r)
+  {
+    A.middleRows(r, A.rows() - r - 1) = A.bottomRows(A.rows() - r - 1).eval();
+    A.conservativeResize(A.rows() - 1, A.cols());
+    return;
+  }
+
+/* Remove column 'k' of 'A'. */
+static void gru_dropCol(MatrixXf& A, unsigned int k)
+  {
+    A.middleCols(k, A.cols() - k - 1) = A.rightCols(A.cols() - k - 1).eval();
+    A.conservativeResize(A.rows(), A.cols() - 1);
+    return;
+  }
+
+/* Remove element 'r' of 'v'. */
+static void gru_dropRow(VectorXf& v, unsigned int r)
+  {
+    v.segment(r, v.size() - r - 1) = v.tail(v.size() - r - 1).eval();
+    v.conservativeResize(v.size() - 1);
+    return;
+  }
+
+/* Largest weight with which input 'j' reaches any gate. */
+double GRU::inputWeight_i(unsigned int j) const
+  {
+    double m = 0.0;
+
+    m = fmax(m, Wz.col(j).cwiseAbs().maxCoeff());
+    m = fmax(m, Wr.col(j).cwiseAbs().maxCoeff());
+    m = fmax(m, Wh.col(j).cwiseAbs().maxCoeff());
+
+    return m;
+  }
+
+/* Largest weight with which unit 'k' reaches any gate of another unit at the next step. */
+double GRU::feedback_i(unsigned int k) const
+  {
+    unsigned int r;
+    double m = 0.0;
+
+    for(r = 0; r < h; r++)
+      {
+        if(r == k)                                                  //  A unit's effect on itself goes with it
+          continue;
+        m = fmax(m, fabs(Uz(r, k)));
+        m = fmax(m, fabs(Ur(r, k)));
+        m = fmax(m, fabs(Uh(r, k)));
+      }
+
+    return m;
+  }
+
+/* Remove state unit 'k' altogether: its gate rows, its recurrent columns, and its row of the state. The recorded
+   history is copied into a new, smaller cache, so saved states (see saveState()) keep their own. */
+void GRU::removeUnit(unsigned int k)
+  {
+    unsigned int j;
+    History* smaller;
+    Map<MatrixXf> past(H->data(), h, cache);
+
+    gru_dropRow(Wz, k);
+    gru_dropRow(Wr, k);
+    gru_dropRow(Wh, k);
+    gru_dropRow(Uz, k);
+    gru_dropCol(Uz, k);
+    gru_dropRow(Ur, k);
+    gru_dropCol(Ur, k);
+    gru_dropRow(Uh, k);
+    gru_dropCol(Uh, k);
+    gru_dropRow(bz, k);
+    gru_dropRow(br, k);
+    gru_dropRow(bh, k);
+
+    smaller = new History(h - 1, cache);
+    for(j = 0; j < cache; j++)
+      {
+        memcpy(smaller->data() + j * (h - 1), past.col(j).data(), k * sizeof(float));
+        memcpy(smaller->data() + j * (h - 1) + k, past.col(j).data() + k + 1, (h - k - 1) * sizeof(float));
+      }
+    H->release();
+    H = smaller;
+    out.segment(k, h - k - 1) = out.tail(h - k - 1).eval();
+    h--;
+    out.conservativeResize(h);
+
+    return;
+  }
+
+/* Remove input 'j' altogether, treating it as always equal to 'v': its weighted contribution moves into the
+   biases, exactly if the input really was constant. */
+void GRU::removeInput(unsigned int j, double v)
+  {
+    if(v != 0.0)
+      {
+        bz += (float)v * Wz.col(j);
+        br += (float)v * Wr.col(j);
+        bh += (float)v * Wh.col(j);
+      }
+    gru_dropCol(Wz, j);
+    gru_dropCol(Wr, j);
+    gru_dropCol(Wh, j);
+    d--;
+
+    return;
+  }
+
+/* Number of stored parameters: input and recurrent weights and biases of every gate. */
+unsigned int GRU::params() const
+  {
+    return 3 * (h * d + h * h + h);
+  }
+
+/* Floating-point operations in one run(), counting a multiply-add as two. Nonlinearities are not counted. */
+unsigned long long GRU::flops() const
+  {
+    return 2ULL * 3 * h * (d + h);
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input length, state length and cache length, then the column-major
+   weight matrices Wz, Wr, Wh, Uz, Ur, Uh and the biases bz, br, bh, as floats, then name. State is not written.
+   Return false if writing fails. */
+bool GRU::write(FILE* fp) const
+  {
+    bool ok = true;
+
+    ok = ok && fwrite(&d, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&h, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&cache, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(Wz.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Wr.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Wh.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Uz.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(Ur.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(Uh.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(bz.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(br.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(bh.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same shape, and clear its state.
+   Return false, leaving the layer unusable, if reading fails or the shape differs. */
+bool GRU::read(FILE* fp)
+  {
+    unsigned int in, st, ca;
+    bool ok = true;
+
+    ok = ok && fread(&in, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&st, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&ca, sizeof(int), 1, fp) == 1;
+    if(!ok || in != d || st != h || ca != cache)
+      {
+        cout << "ERROR: Stored GRU layer does not match this layer's shape\n";
+        return false;
+      }
+    ok = ok && fread(Wz.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Wr.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Wh.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Uz.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(Ur.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(Uh.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(bz.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(br.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(bh.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+    reset();
+
+    return ok;
+  }
+
+#endif
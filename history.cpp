@@ -0,0 +1,188 @@
+#ifndef __HISTORY_CPP
+#define __HISTORY_CPP
+
+#include "history.h"
+
+/**************************************************************************************************
+ History  */
+
+/* A zeroed (rows by cols) block with one reference, held by the caller. */
+History::History(unsigned int rows, unsigned int cols)
+  {
+    r = rows;
+    c = cols;
+    refs = 1;
+    if((states = (float*)calloc((size_t)r * c > 0 ? (size_t)r * c : 1, sizeof(float))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate recurrent state history\n";
+        exit(1);
+      }
+  }
+
+History::~History()
+  {
+    free(states);
+  }
+
+/* Take another reference. */
+History* History::share()
+  {
+    refs.fetch_add(1);
+    return this;
+  }
+
+/* Give up a reference. The last one deletes the History, so the caller must not touch it afterward. */
+void History::release()
+  {
+    if(refs.fetch_sub(1) == 1)
+      delete this;
+    return;
+  }
+
+/* Return a History the caller may write into: this one if the caller holds the only reference, otherwise a
+   private copy, in which case the caller's reference to this one is given up. Call as H = H->writable(). */
+History* History::writable()
+  {
+    History* copy;
+
+    if(refs.load() == 1)
+      return this;
+
+    copy = new History(r, c);
+    memcpy(copy->states, states, (size_t)r * c * sizeof(float));
+    release();
+
+    return copy;
+  }
+
+/*  */
+bool History::shared() const
+  {
+    return refs.load() > 1;
+  }
+
+/*  */
+unsigned int History::references() const
+  {
+    return refs.load();
+  }
+
+/*  */
+unsigned int History::rows() const
+  {
+    return r;
+  }
+
+/*  */
+unsigned int History::cols() const
+  {
+    return c;
+  }
+
+/*  */
+float* History::data() const
+  {
+    return states;
+  }
+
+/**************************************************************************************************
+ NetState  */
+
+/* Room for the state of 'lstms' LSTM layers and 'grus' GRU layers, all empty until filled. */
+NetState::NetState(unsigned int lstms, unsigned int grus)
+  {
+    lstmLen = lstms;
+    gruLen = grus;
+    lstm = NULL;
+    gru = NULL;
+    if(lstmLen > 0 && (lstm = (LayerState*)calloc(lstmLen, sizeof(LayerState))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate LSTM state array\n";
+        exit(1);
+      }
+    if(gruLen > 0 && (gru = (LayerState*)calloc(gruLen, sizeof(LayerState))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate GRU state array\n";
+        exit(1);
+      }
+  }
+
+NetState::~NetState()
+  {
+    unsigned int i;
+
+    for(i = 0; i < lstmLen; i++)
+      clear(lstm + i);
+    for(i = 0; i < gruLen; i++)
+      clear(gru + i);
+    if(lstm != NULL)
+      free(lstm);
+    if(gru != NULL)
+      free(gru);
+  }
+
+/* A new NetState for the same point in every layer's sequence. Only the per-step vectors are copied; every
+   History is shared. The caller must delete the result. */
+NetState* NetState::fork() const
+  {
+    NetState* s = new NetState(lstmLen, gruLen);
+    unsigned int i;
+
+    for(i = 0; i < lstmLen; i++)
+      copy(s->lstm + i, lstm + i);
+    for(i = 0; i < gruLen; i++)
+      copy(s->gru + i, gru + i);
+
+    return s;
+  }
+
+/* Fill 's' (which must be empty or cleared) with time step 't', copies of the 'len'-long vectors 'c' (may be
+   NULL) and 'out', and a new reference to 'H'. */
+void NetState::save(LayerState* s, unsigned int t, unsigned int len, const float* c, const double* out, History* H)
+  {
+    s->t = t;
+    s->len = len;
+    s->c = NULL;
+    if(c != NULL)
+      {
+        if((s->c = (float*)malloc(len * sizeof(float))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate saved cell state\n";
+            exit(1);
+          }
+        memcpy(s->c, c, len * sizeof(float));
+      }
+    if((s->out = (double*)malloc(len * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate saved layer output\n";
+        exit(1);
+      }
+    memcpy(s->out, out, len * sizeof(double));
+    s->H = H->share();
+
+    return;
+  }
+
+/* Make empty 'dst' a second LayerState for the state in 'src'. */
+void NetState::copy(LayerState* dst, const LayerState* src)
+  {
+    save(dst, src->t, src->len, src->c, src->out, src->H);
+    return;
+  }
+
+/* Free the vectors and drop the History reference, leaving 's' empty. */
+void NetState::clear(LayerState* s)
+  {
+    if(s->c != NULL)
+      free(s->c);
+    if(s->out != NULL)
+      free(s->out);
+    if(s->H != NULL)
+      s->H->release();
+    s->c = NULL;
+    s->out = NULL;
+    s->H = NULL;
+    return;
+  }
+
+#endif
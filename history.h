@@ -0,0 +1,95 @@
+#ifndef __HISTORY_H
+#define __HISTORY_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ Recurrent state that can be saved, restored and branched cheaply.
+  rows = the length of one hidden state
+  cols = the number of past states kept (a recurrent layer's 'cache')
+
+ A History is the hidden-state cache of an LSTM or GRU layer, a column-major (rows by cols) block of floats.
+ It is reference-counted and copy-on-write: saving a layer's state takes another reference rather than a copy,
+ and a layer about to write into a History it shares first takes a private copy (see writable()). Any number of
+ saved states and layers may share one History, and the history is copied only by a branch that moves on.
+
+ A LayerState is one layer's saved state: its time step, the small per-step vectors (the LSTM cell state and
+ the latest output), and a reference to its History. A NetState holds one LayerState per recurrent layer of a
+ network (see NeuralNet::snapshot() and NeuralNet::restore()); fork() gives another NetState on the same state.
+
+ Reference counts are atomic, so Histories may be shared between threads. A single LayerState or NetState
+ is not thread-safe.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <atomic>
+#include <iostream>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+#define __HISTORY_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ History  */
+class History
+  {
+    public:
+      History(unsigned int, unsigned int);                          //  Constructor(s): rows, columns; zero-filled, one reference
+
+      History* share();                                             //  Add a reference; return this
+      void release();                                               //  Drop a reference, deleting on the last
+      History* writable();                                          //  This if unshared, else a private copy (dropping this)
+      bool shared() const;
+      unsigned int references() const;
+      unsigned int rows() const;
+      unsigned int cols() const;
+      float* data() const;                                          //  Column-major, rows by cols
+
+    private:
+      ~History();                                                   //  Destructor: only release() deletes
+
+      float* states;                                                //  Column-major (r by c) block
+      unsigned int r;                                               //  Length of one state
+      unsigned int c;                                               //  Number of states
+      atomic<unsigned int> refs;                                    //  Holders of this History
+  };
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct LayerStateType
+  {
+    unsigned int t;                                                 //  Time step
+    unsigned int len;                                               //  Length of 'c' and 'out'
+    float* c;                                                       //  LSTM cell state, or NULL for a GRU
+    double* out;                                                    //  Latest output
+    History* H;                                                     //  Hidden-state cache: one reference held
+  } LayerState;
+
+/**************************************************************************************************
+ NetState  */
+class NetState
+  {
+    public:
+      NetState(unsigned int, unsigned int);                         //  Constructor(s): number of LSTM layers, of GRU layers
+      ~NetState();                                                  //  Destructor: drops every History reference
+
+      NetState* fork() const;                                       //  Another NetState on the same state; delete each
+      static void save(LayerState*, unsigned int, unsigned int, const float*, const double*, History*);
+      static void copy(LayerState*, const LayerState*);             //  Duplicate the vectors, share the History
+      static void clear(LayerState*);                               //  Release what a LayerState holds
+
+      LayerState* lstm;                                             //  One per LSTM layer, in network order
+      unsigned int lstmLen;                                         //  Length of that array
+      LayerState* gru;                                              //  One per GRU layer, in network order
+      unsigned int gruLen;                                          //  Length of that array
+  };
+
+#endif
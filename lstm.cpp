@@ -0,0 +1,667 @@
+#ifndef __LSTM_CPP
+#define __LSTM_CPP
+
+#include "lstm.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Input length 'dimInput', state length 'dimState', and the number of past states kept, 'cacheLen'.
+   Weights and biases are random in [-1.0, 1.0]; the state starts at zero. */
+LSTM::LSTM(unsigned int dimInput, unsigned int dimState, unsigned int cacheLen)
+  {
+    unsigned int i, j;
+
+    d = dimInput;
+    h = dimState;
+    cache = (cacheLen > 0) ? cacheLen : 1;
+    t = 0;
+
+    Wi.resize(h, d);
+    Wo.resize(h, d);
+    Wf.resize(h, d);
+    Wc.resize(h, d);
+    Ui.resize(h, h);
+    Uo.resize(h, h);
+    Uf.resize(h, h);
+    Uc.resize(h, h);
+    bi.resize(h);
+    bo.resize(h);
+    bf.resize(h);
+    bc.resize(h);
+    for(i = 0; i < h; i++)                                          //  Generate random numbers in [ -1.0, 1.0 ]
+      {
+        for(j = 0; j < d; j++)
+          Wi(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < d; j++)
+          Wo(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < d; j++)
+          Wf(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < d; j++)
+          Wc(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Ui(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Uo(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Uf(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        for(j = 0; j < h; j++)
+          Uc(i, j) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bi(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bo(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bf(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+        bc(i) = -1.0f + (float)rand() / ((float)RAND_MAX * 0.5f);
+      }
+
+    c = VectorXf::Zero(h);
+    H = new History(h, cache);
+    out = VectorXd::Zero(h);
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+LSTM::~LSTM()
+  {
+    H->release();
+  }
+
+/**************************************************************************************************
+ Weights  */
+
+/* Set the entire (h x d) Wi weight matrix from 'w', row-major. */
+void LSTM::setWi(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wi(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void LSTM::setWi_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wi(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x d) Wo weight matrix from 'w', row-major. */
+void LSTM::setWo(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wo(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void LSTM::setWo_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wo(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x d) Wf weight matrix from 'w', row-major. */
+void LSTM::setWf(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wf(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void LSTM::setWf_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wf(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x d) Wc weight matrix from 'w', row-major. */
+void LSTM::setWc(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < d; j++)
+        Wc(i, j) = (float)w[i * d + j];
+    return;
+  }
+
+/*  */
+void LSTM::setWc_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < d)
+      Wc(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Ui weight matrix from 'w', row-major. */
+void LSTM::setUi(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Ui(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void LSTM::setUi_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Ui(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Uo weight matrix from 'w', row-major. */
+void LSTM::setUo(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Uo(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void LSTM::setUo_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Uo(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Uf weight matrix from 'w', row-major. */
+void LSTM::setUf(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Uf(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void LSTM::setUf_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Uf(i, j) = (float)w;
+    return;
+  }
+
+/* Set the entire (h x h) Uc weight matrix from 'w', row-major. */
+void LSTM::setUc(double* w)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < h; i++)
+      for(j = 0; j < h; j++)
+        Uc(i, j) = (float)w[i * h + j];
+    return;
+  }
+
+/*  */
+void LSTM::setUc_ij(double w, unsigned int i, unsigned int j)
+  {
+    if(i < h && j < h)
+      Uc(i, j) = (float)w;
+    return;
+  }
+
+/*  */
+void LSTM::setbi(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bi(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void LSTM::setbi_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bi(i) = (float)w;
+    return;
+  }
+
+/*  */
+void LSTM::setbo(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bo(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void LSTM::setbo_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bo(i) = (float)w;
+    return;
+  }
+
+/*  */
+void LSTM::setbf(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bf(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void LSTM::setbf_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bf(i) = (float)w;
+    return;
+  }
+
+/*  */
+void LSTM::setbc(double* w)
+  {
+    unsigned int i;
+
+    for(i = 0; i < h; i++)
+      bc(i) = (float)w[i];
+    return;
+  }
+
+/*  */
+void LSTM::setbc_i(double w, unsigned int i)
+  {
+    if(i < h)
+      bc(i) = (float)w;
+    return;
+  }
+
+/*  */
+void LSTM::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* LSTM::name() const
+  {
+    return (char*)layerName;
+  }
+
+/* Print a matrix or vector, one row per line. */
+static void lstm_print(const Eigen::Ref<const MatrixXf>& m)
+  {
+    unsigned int i, j;
+
+    for(i = 0; i < (unsigned int)m.rows(); i++)
+      {
+        printf("  [");
+        for(j = 0; j < (unsigned int)m.cols(); j++)
+          printf(" %.5f", m(i, j));
+        printf(" ]\n");
+      }
+    return;
+  }
+
+/*  */
+void LSTM::print() const
+  {
+    printf("Input Length = %d, State Length = %d, Cache = %d, t = %d\n", d, h, cache, t);
+    printf("Wi =\n");
+    lstm_print(Wi);
+    printf("Wo =\n");
+    lstm_print(Wo);
+    printf("Wf =\n");
+    lstm_print(Wf);
+    printf("Wc =\n");
+    lstm_print(Wc);
+    printf("Ui =\n");
+    lstm_print(Ui);
+    printf("Uo =\n");
+    lstm_print(Uo);
+    printf("Uf =\n");
+    lstm_print(Uf);
+    printf("Uc =\n");
+    lstm_print(Uc);
+    printf("bi =\n");
+    lstm_print(bi);
+    printf("bo =\n");
+    lstm_print(bo);
+    printf("bf =\n");
+    lstm_print(bf);
+    printf("bc =\n");
+    lstm_print(bc);
+    return;
+  }
+
+/*  */
+unsigned int LSTM::inputLen() const
+  {
+    return d;
+  }
+
+/*  */
+unsigned int LSTM::outputLen() const
+  {
+    return h;
+  }
+
+/* The most recent hidden state, or zeros before the first run(). */
+double* LSTM::output() const
+  {
+    return (double*)out.data();
+  }
+
+/**************************************************************************************************
+ Run layer  */
+
+/* Logistic function, elementwise. */
+static VectorXf lstm_sigmoid(const VectorXf& v)
+  {
+    return (1.0f + (-v.array()).exp()).inverse().matrix();
+  }
+
+/* Advance one time step on the d-long input 'x':
+     i = sig(Wi x + Ui h' + bi)    o = sig(Wo x + Uo h' + bo)    f = sig(Wf x + Uf h' + bf)
+     c = f * c + i * tanh(Wc x + Uc h' + bc)
+     h = o * tanh(c)
+   where h' is the previous hidden state and products of vectors are elementwise. Return h. */
+unsigned int LSTM::run(double* x)
+  {
+    unsigned int col;
+    VectorXf xf = Map<VectorXd>(x, d).cast<float>();
+    Map<MatrixXf> past(H->data(), h, cache);
+    VectorXf prev = (t == 0) ? VectorXf::Zero(h) : VectorXf(past.col(((t < cache) ? t : cache) - 1));
+
+    VectorXf ig = lstm_sigmoid(Wi * xf + Ui * prev + bi);           //  Input gate
+    VectorXf og = lstm_sigmoid(Wo * xf + Uo * prev + bo);           //  Output gate
+    VectorXf fg = lstm_sigmoid(Wf * xf + Uf * prev + bf);           //  Forget gate
+    VectorXf next;
+
+    c = fg.cwiseProduct(c) + ig.cwiseProduct((Wc * xf + Uc * prev + bc).array().tanh().matrix());
+    next = og.cwiseProduct(c.array().tanh().matrix());
+
+    H = H->writable();                                              //  Copy first if a saved state shares it
+    Map<MatrixXf> Hm(H->data(), h, cache);
+    if(t >= cache)                                                  //  Full: shift out the oldest state
+      {
+        Hm.leftCols(cache - 1) = Hm.rightCols(cache - 1).eval();
+        col = cache - 1;
+      }
+    else
+      col = t;
+    Hm.col(col) = next;
+    out = next.cast<double>();
+    t++;
+
+    return h;
+  }
+
+/* Forget all state: back to time step 0. */
+void LSTM::reset()
+  {
+    t = 0;
+    c.setZero();
+    if(H->shared())                                                 //  Leave saved states their history
+      {
+        H->release();
+        H = new History(h, cache);
+      }
+    else
+      memset(H->data(), 0, h * cache * sizeof(float));
+    out.setZero();
+    return;
+  }
+
+/* Record the current state in empty 's'. The hidden-state cache is shared, not copied: the next run() copies it
+   before writing, and only if 's' still holds it. */
+void LSTM::saveState(LayerState* s) const
+  {
+    NetState::save(s, t, h, c.data(), out.data(), H);
+    return;
+  }
+
+/* Return to the state recorded in 's', which keeps its own reference and is left as it was. */
+void LSTM::loadState(const LayerState* s)
+  {
+    if(s->len != h || s->H->rows() != h || s->H->cols() != cache)
+      {
+        cout << "ERROR: Saved state does not fit this layer\n";
+        exit(1);
+      }
+    if(s->c == NULL)
+      {
+        cout << "ERROR: Saved state is not an LSTM state\n";
+        exit(1);
+      }
+    c = Map<VectorXf>(s->c, h);
+    t = s->t;
+    out = Map<VectorXd>(s->out, h);
+    s->H->share();
+    H->release();
+    H = s->H;
+    return;
+  }
+
+/**************************************************************************************************
+ Pruning  */
+
+/* Remove row 'r' of 'A'. */
+static void lstm_dropRow(MatrixXf& A, unsigned int r)
+  {
+    A.middleRows(r, A.rows() - r - 1) = A.bottomRows(A.rows() - r - 1).eval();
+    A.conservativeResize(A.rows() - 1, A.cols());
+    return;
+  }
+
+/* Remove column 'k' of 'A'. */
+static void lstm_dropCol(MatrixXf& A, unsigned int k)
+  {
+    A.middleCols(k, A.cols() - k - 1) = A.rightCols(A.cols() - k - 1).eval();
+    A.conservativeResize(A.rows(), A.cols() - 1);
+    return;
+  }
+
+/* Remove element 'r' of 'v'. */
+static void lstm_dropRow(VectorXf& v, unsigned int r)
+  {
+    v.segment(r, v.size() - r - 1) = v.tail(v.size() - r - 1).eval();
+    v.conservativeResize(v.size() - 1);
+    return;
+  }
+
+/* Largest weight with which input 'j' reaches any gate. */
+double LSTM::inputWeight_i(unsigned int j) const
+  {
+    double m = 0.0;
+
+    m = fmax(m, Wi.col(j).cwiseAbs().maxCoeff());
+    m = fmax(m, Wo.col(j).cwiseAbs().maxCoeff());
+    m = fmax(m, Wf.col(j).cwiseAbs().maxCoeff());
+    m = fmax(m, Wc.col(j).cwiseAbs().maxCoeff());
+
+    return m;
+  }
+
+/* Largest weight with which unit 'k' reaches any gate of another unit at the next step. */
+double LSTM::feedback_i(unsigned int k) const
+  {
+    unsigned int r;
+    double m = 0.0;
+
+    for(r = 0; r < h; r++)
+      {
+        if(r == k)                                                  //  A unit's effect on itself goes with it
+          continue;
+        m = fmax(m, fabs(Ui(r, k)));
+        m = fmax(m, fabs(Uo(r, k)));
+        m = fmax(m, fabs(Uf(r, k)));
+        m = fmax(m, fabs(Uc(r, k)));
+      }
+
+    return m;
+  }
+
+/* Remove state unit 'k' altogether: its gate rows, its recurrent columns, and its row of the state. The recorded
+   history is copied into a new, smaller cache, so saved states (see saveState()) keep their own. */
+void LSTM::removeUnit(unsigned int k)
+  {
+    unsigned int j;
+    History* smaller;
+    Map<MatrixXf> past(H->data(), h, cache);
+
+    lstm_dropRow(Wi, k);
+    lstm_dropRow(Wo, k);
+    lstm_dropRow(Wf, k);
+    lstm_dropRow(Wc, k);
+    lstm_dropRow(Ui, k);
+    lstm_dropCol(Ui, k);
+    lstm_dropRow(Uo, k);
+    lstm_dropCol(Uo, k);
+    lstm_dropRow(Uf, k);
+    lstm_dropCol(Uf, k);
+    lstm_dropRow(Uc, k);
+    lstm_dropCol(Uc, k);
+    lstm_dropRow(bi, k);
+    lstm_dropRow(bo, k);
+    lstm_dropRow(bf, k);
+    lstm_dropRow(bc, k);
+    lstm_dropRow(c, k);
+
+    smaller = new History(h - 1, cache);
+    for(j = 0; j < cache; j++)
+      {
+        memcpy(smaller->data() + j * (h - 1), past.col(j).data(), k * sizeof(float));
+        memcpy(smaller->data() + j * (h - 1) + k, past.col(j).data() + k + 1, (h - k - 1) * sizeof(float));
+      }
+    H->release();
+    H = smaller;
+    out.segment(k, h - k - 1) = out.tail(h - k - 1).eval();
+    h--;
+    out.conservativeResize(h);
+
+    return;
+  }
+
+/* Remove input 'j' altogether, treating it as always equal to 'v': its weighted contribution moves into the
+   biases, exactly if the input really was constant. */
+void LSTM::removeInput(unsigned int j, double v)
+  {
+    if(v != 0.0)
+      {
+        bi += (float)v * Wi.col(j);
+        bo += (float)v * Wo.col(j);
+        bf += (float)v * Wf.col(j);
+        bc += (float)v * Wc.col(j);
+      }
+    lstm_dropCol(Wi, j);
+    lstm_dropCol(Wo, j);
+    lstm_dropCol(Wf, j);
+    lstm_dropCol(Wc, j);
+    d--;
+
+    return;
+  }
+
+/* Number of stored parameters: input and recurrent weights and biases of every gate. */
+unsigned int LSTM::params() const
+  {
+    return 4 * (h * d + h * h + h);
+  }
+
+/* Floating-point operations in one run(), counting a multiply-add as two. Nonlinearities are not counted. */
+unsigned long long LSTM::flops() const
+  {
+    return 2ULL * 4 * h * (d + h);
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input length, state length and cache length, then the column-major
+   weight matrices Wi, Wo, Wf, Wc, Ui, Uo, Uf, Uc and the biases bi, bo, bf, bc, as floats, then name. State is not written.
+   Return false if writing fails. */
+bool LSTM::write(FILE* fp) const
+  {
+    bool ok = true;
+
+    ok = ok && fwrite(&d, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&h, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&cache, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(Wi.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Wo.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Wf.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Wc.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fwrite(Ui.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(Uo.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(Uf.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(Uc.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fwrite(bi.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(bo.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(bf.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(bc.data(), sizeof(float), h, fp) == h;
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same shape, and clear its state.
+   Return false, leaving the layer unusable, if reading fails or the shape differs. */
+bool LSTM::read(FILE* fp)
+  {
+    unsigned int in, st, ca;
+    bool ok = true;
+
+    ok = ok && fread(&in, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&st, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&ca, sizeof(int), 1, fp) == 1;
+    if(!ok || in != d || st != h || ca != cache)
+      {
+        cout << "ERROR: Stored LSTM layer does not match this layer's shape\n";
+        return false;
+      }
+    ok = ok && fread(Wi.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Wo.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Wf.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Wc.data(), sizeof(float), h * d, fp) == h * d;
+    ok = ok && fread(Ui.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(Uo.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(Uf.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(Uc.data(), sizeof(float), h * h, fp) == h * h;
+    ok = ok && fread(bi.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(bo.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(bf.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(bc.data(), sizeof(float), h, fp) == h;
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+    reset();
+
+    return ok;
+  }
+
+#endif
@@ -38,18 +38,25 @@
 
 #include <iostream>
 #include <Eigen/Dense>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "history.h"                                                /* Include shareable recurrent state */
+
 #define LAYER_NAME_LEN  32                                          /* Length of a Layer 'name' string */
 
 /*
 #define __LSTM_DEBUG 1
 */
 
+using Eigen::Map;
 using Eigen::MatrixXd;
+using Eigen::MatrixXf;
+using Eigen::VectorXd;
+using Eigen::VectorXf;
 using namespace std;
 
 /**************************************************************************************************
@@ -91,9 +98,21 @@ class LSTM
       void setName(char*);
       char* name() const;
       void print() const;
+      unsigned int inputLen() const;
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
       void reset();
+      void saveState(LayerState*) const;                            //  Record t, state and a shared reference to H
+      void loadState(const LayerState*);                            //  Return to a recorded state, sharing its H
+      double inputWeight_i(unsigned int) const;                     //  Largest weight on the i-th input
+      double feedback_i(unsigned int) const;                        //  Largest recurrent weight from the i-th unit to others
+      void removeUnit(unsigned int);                                //  Delete a state unit, shrinking the output
+      void removeInput(unsigned int, double);                       //  Delete an input, folding its constant value into the biases
+      unsigned int params() const;                                  //  Stored weights and biases
+      unsigned long long flops() const;                             //  Floating-point operations per run()
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
 
     private:
       unsigned int d;                                               //  Dimensionality of input vector
@@ -118,8 +137,9 @@ class LSTM
       VectorXf bc;                                                  //  Memory cell bias
 
       VectorXf c;                                                   //  Cell state vector, length h
-      MatrixXf H;                                                   //  Hidden state cache matrix (h by cache)
-      char name[LAYER_NAME_LEN];
+      History* H;                                                   //  Hidden state cache (h by cache), copy-on-write
+      char layerName[LAYER_NAME_LEN];
+      VectorXd out;                                                 //  Latest hidden state, as doubles, length h
   };
 
 #endif
\ No newline at end of file
@@ -6,9 +6,2293 @@
 /**************************************************************************************************
  Constructors  */
 
-/* PLACE-HOLDER */
-NeuralNet::NeuralNet()
+/* Create an empty network expecting 'inputs' inputs. */
+NeuralNet::NeuralNet(unsigned int inputs)
   {
+    unsigned int i;
+
+    this->inputs = inputs;
+    edgelist = NULL;
+    len = 0;
+
+    denselayers = NULL;
+    denseLen = 0;
+    convlayers = NULL;
+    convLen = 0;
+    accumlayers = NULL;
+    accumLen = 0;
+    lstmlayers = NULL;
+    lstmLen = 0;
+    grulayers = NULL;
+    gruLen = 0;
+    poollayers = NULL;
+    poolLen = 0;
+    upreslayers = NULL;
+    upresLen = 0;
+    normlayers = NULL;
+    normalLen = 0;
+
+    variables = NULL;
+    vars = 0;
+
+    gen = 0;
+    fit = 0.0;
+    for(i = 0; i < COMMSTR_LEN; i++)                                //  Blank out network comment
+      comment[i] = '\0';
+
+    delta = false;
+    deltaTol = 0.0;
+    moved = NULL;
+    movedLen = 0;
+    buffer = NULL;
+    bufferLen = 0;
+    cache = NULL;
+    arena = NULL;
+
+    seqWorkers = NULL;
+    seqWorkerLen = 0;
+    seqThreads = 0;
+    seq = NULL;
+    seqStopping = false;
+  }
+
+NeuralNet::~NeuralNet()
+  {
+    seqStop();
+    clear();
+  }
+
+/* Destroy every layer, edge and variable, and the cache, leaving an empty network with the same input length.
+   Conv2D layers are destroyed before the Arena that may hold their weights. */
+void NeuralNet::clear()
+  {
+    unsigned int i;
+
+    if(edgelist != NULL)
+      free(edgelist);
+    edgelist = NULL;
+    len = 0;
+
+    for(i = 0; i < denseLen; i++)                                   //  Layers were built in place (see addDense())
+      denselayers[i].~Dense();
+    for(i = 0; i < convLen; i++)
+      convlayers[i].~Conv2D();
+    for(i = 0; i < accumLen; i++)
+      accumlayers[i].~Accum();
+    for(i = 0; i < lstmLen; i++)
+      lstmlayers[i].~LSTM();
+    for(i = 0; i < gruLen; i++)
+      grulayers[i].~GRU();
+    for(i = 0; i < poolLen; i++)
+      poollayers[i].~Pooling();
+    for(i = 0; i < upresLen; i++)
+      upreslayers[i].~Upres();
+    for(i = 0; i < normalLen; i++)
+      normlayers[i].~Normalization();
+    free(denselayers);
+    free(convlayers);
+    free(accumlayers);
+    free(lstmlayers);
+    free(grulayers);
+    free(poollayers);
+    free(upreslayers);
+    free(normlayers);
+    denselayers = NULL;
+    denseLen = 0;
+    convlayers = NULL;
+    convLen = 0;
+    accumlayers = NULL;
+    accumLen = 0;
+    lstmlayers = NULL;
+    lstmLen = 0;
+    grulayers = NULL;
+    gruLen = 0;
+    poollayers = NULL;
+    poolLen = 0;
+    upreslayers = NULL;
+    upresLen = 0;
+    normlayers = NULL;
+    normalLen = 0;
+
+    if(variables != NULL)
+      free(variables);
+    variables = NULL;
+    vars = 0;
+
+    if(moved != NULL)
+      free(moved);
+    moved = NULL;
+    movedLen = 0;
+    if(buffer != NULL)
+      free(buffer);
+    buffer = NULL;
+    bufferLen = 0;
+
+    if(cache != NULL)
+      delete cache;
+    cache = NULL;
+    if(arena != NULL)
+      delete arena;
+    arena = NULL;
+
+    return;
+  }
+
+/**************************************************************************************************
+ Layers  */
+
+/* Each add*() appends a layer, built in place at the end of its array, and returns the new length of that array:
+   the new layer's index is one less. Layers hold their storage through pointers only, so realloc() may move them. */
+
+/* Add a Dense layer of 'nodes' units reading 'inputs' inputs. */
+unsigned int NeuralNet::addDense(unsigned int inputs, unsigned int nodes)
+  {
+    if((denselayers = (Dense*)realloc((void*)denselayers, (denseLen + 1) * sizeof(Dense))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Dense layer array\n";
+        exit(1);
+      }
+    new (denselayers + denseLen) Dense(inputs, nodes);
+    denseLen++;
+    return denseLen;
+  }
+
+/* Add a Conv2D layer over a (w by h) input. Add its filters before linking from it. */
+unsigned int NeuralNet::addConv2D(unsigned int w, unsigned int h)
+  {
+    if((convlayers = (Conv2D*)realloc((void*)convlayers, (convLen + 1) * sizeof(Conv2D))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Conv2D layer array\n";
+        exit(1);
+      }
+    new (convlayers + convLen) Conv2D(w, h);
+    convLen++;
+    return convLen;
+  }
+
+/* Add an Accumulator layer of 'inputs' inputs. */
+unsigned int NeuralNet::addAccum(unsigned int inputs)
+  {
+    if((accumlayers = (Accum*)realloc((void*)accumlayers, (accumLen + 1) * sizeof(Accum))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Accumulator layer array\n";
+        exit(1);
+      }
+    new (accumlayers + accumLen) Accum(inputs);
+    accumLen++;
+    return accumLen;
+  }
+
+/* Add an LSTM layer: input length, state length, and the number of past states kept. */
+unsigned int NeuralNet::addLSTM(unsigned int dimInput, unsigned int dimState, unsigned int cacheLen)
+  {
+    if((lstmlayers = (LSTM*)realloc((void*)lstmlayers, (lstmLen + 1) * sizeof(LSTM))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate LSTM layer array\n";
+        exit(1);
+      }
+    new (lstmlayers + lstmLen) LSTM(dimInput, dimState, cacheLen);
+    lstmLen++;
+    return lstmLen;
+  }
+
+/* Add a GRU layer: input length, state length, and the number of past states kept. */
+unsigned int NeuralNet::addGRU(unsigned int dimInput, unsigned int dimState, unsigned int cacheLen)
+  {
+    if((grulayers = (GRU*)realloc((void*)grulayers, (gruLen + 1) * sizeof(GRU))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate GRU layer array\n";
+        exit(1);
+      }
+    new (grulayers + gruLen) GRU(dimInput, dimState, cacheLen);
+    gruLen++;
+    return gruLen;
+  }
+
+/* Add a Pooling layer over a (w by h) input. Add its pools before linking from it. */
+unsigned int NeuralNet::addPool(unsigned int w, unsigned int h)
+  {
+    if((poollayers = (Pooling*)realloc((void*)poollayers, (poolLen + 1) * sizeof(Pooling))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Pooling layer array\n";
+        exit(1);
+      }
+    new (poollayers + poolLen) Pooling(w, h);
+    poolLen++;
+    return poolLen;
+  }
+
+/* Add an Upres layer over a (w by h) input. Add its parameter sets before linking from it. */
+unsigned int NeuralNet::addUpres(unsigned int w, unsigned int h)
+  {
+    if((upreslayers = (Upres*)realloc((void*)upreslayers, (upresLen + 1) * sizeof(Upres))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer array\n";
+        exit(1);
+      }
+    new (upreslayers + upresLen) Upres(w, h);
+    upresLen++;
+    return upresLen;
+  }
+
+/* Add a Normalization layer of 'inputs' inputs. */
+unsigned int NeuralNet::addNormal(unsigned int inputs)
+  {
+    if((normlayers = (Normalization*)realloc((void*)normlayers, (normalLen + 1) * sizeof(Normalization))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Normalization layer array\n";
+        exit(1);
+      }
+    new (normlayers + normalLen) Normalization(inputs);
+    normalLen++;
+    return normalLen;
+  }
+
+/* Each get*() points to a layer by its index in its array, or returns NULL if there is no such layer. The pointer
+   is good until a layer is added to the same array. */
+
+/*  */
+Dense* NeuralNet::getDense(unsigned int i) const
+  {
+    return (i < denseLen) ? denselayers + i : NULL;
+  }
+
+/*  */
+Conv2D* NeuralNet::getConv2D(unsigned int i) const
+  {
+    return (i < convLen) ? convlayers + i : NULL;
+  }
+
+/*  */
+Accum* NeuralNet::getAccum(unsigned int i) const
+  {
+    return (i < accumLen) ? accumlayers + i : NULL;
+  }
+
+/*  */
+LSTM* NeuralNet::getLSTM(unsigned int i) const
+  {
+    return (i < lstmLen) ? lstmlayers + i : NULL;
+  }
+
+/*  */
+GRU* NeuralNet::getGRU(unsigned int i) const
+  {
+    return (i < gruLen) ? grulayers + i : NULL;
+  }
+
+/*  */
+Pooling* NeuralNet::getPool(unsigned int i) const
+  {
+    return (i < poolLen) ? poollayers + i : NULL;
+  }
+
+/*  */
+Upres* NeuralNet::getUpres(unsigned int i) const
+  {
+    return (i < upresLen) ? upreslayers + i : NULL;
+  }
+
+/*  */
+Normalization* NeuralNet::getNormal(unsigned int i) const
+  {
+    return (i < normalLen) ? normlayers + i : NULL;
+  }
+
+/* Set the network's comment, truncated to fit. */
+void NeuralNet::setComment(char* c)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(c) < COMMSTR_LEN) ? strlen(c) : COMMSTR_LEN - 1;
+    for(i = 0; i < lim; i++)
+      comment[i] = c[i];
+    comment[lim] = '\0';
+  }
+
+/* Number of layers in the array named by 'type': 0 for the input, or for an unknown flag. */
+unsigned int NeuralNet::layerCount(unsigned char type) const
+  {
+    switch(type)
+      {
+        case DENSE_ARRAY:   return denseLen;
+        case CONV2D_ARRAY:  return convLen;
+        case ACCUM_ARRAY:   return accumLen;
+        case LSTM_ARRAY:    return lstmLen;
+        case GRU_ARRAY:     return gruLen;
+        case POOL_ARRAY:    return poolLen;
+        case UPRES_ARRAY:   return upresLen;
+        case NORMAL_ARRAY:  return normalLen;
+      }
+    return 0;
+  }
+
+/**************************************************************************************************
+ Edges  */
+
+/* Append an edge feeding elements [selectorStart, selectorEnd) of the source's output to the destination.
+   The source is the network input (INPUT_ARRAY, index ignored) or any layer; the destination is any layer.
+   The source must already have its final output length: add filters, pools and parameter sets first.
+   A destination's input is the concatenation of its incoming edges, in the order they were linked.
+   Return false, adding nothing, if either end does not exist, the selection is empty or out of range, or the
+   same edge already exists. */
+bool NeuralNet::linkLayers(unsigned char srcFlag, unsigned int src, unsigned int selectorStart, unsigned int selectorEnd,
+                           unsigned char dstFlag, unsigned int dst)
+  {
+    unsigned int i;
+    unsigned int srcLen;
+
+    if(srcFlag == INPUT_ARRAY)
+      {
+        src = 0;
+        srcLen = inputs;
+      }
+    else if(srcFlag <= NORMAL_ARRAY && src < layerCount(srcFlag))
+      srcLen = layerOutputLen(srcFlag, src);
+    else
+      {
+        cout << "ERROR: Edge source does not exist\n";
+        return false;
+      }
+    if(dstFlag == INPUT_ARRAY || dstFlag > NORMAL_ARRAY || dst >= layerCount(dstFlag))
+      {
+        cout << "ERROR: Edge destination does not exist\n";
+        return false;
+      }
+    if(selectorStart >= selectorEnd || selectorEnd > srcLen)
+      {
+        cout << "ERROR: Edge selects [" << selectorStart << ", " << selectorEnd << ") of an output of length " << srcLen << "\n";
+        return false;
+      }
+    for(i = 0; i < len; i++)
+      {
+        if(edgelist[i].srcType == srcFlag && edgelist[i].srcIndex == src &&
+           edgelist[i].selectorStart == selectorStart && edgelist[i].selectorEnd == selectorEnd &&
+           edgelist[i].dstType == dstFlag && edgelist[i].dstIndex == dst)
+          {
+            cout << "ERROR: Edge already exists\n";
+            return false;
+          }
+      }
+
+    if((edgelist = (Edge*)realloc(edgelist, (len + 1) * sizeof(Edge))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate edge list\n";
+        exit(1);
+      }
+    edgelist[len].srcType = srcFlag;
+    edgelist[len].srcIndex = src;
+    edgelist[len].selectorStart = selectorStart;
+    edgelist[len].selectorEnd = selectorEnd;
+    edgelist[len].dstType = dstFlag;
+    edgelist[len].dstIndex = dst;
+    len++;
+
+    return true;
+  }
+
+/* Put the edge list in executable order: the edges into each layer together, and every layer after the layers
+   it reads. Layers run in the order they first appear as destinations wherever the dependencies allow, and the
+   network's output layer (the destination of the last edge) stays last, so the output does not change. Edges
+   into one layer keep their relative order, so each layer's input is assembled as before. Where edges form a
+   cycle, or read the output layer, the earliest remaining layer runs first and reads from the layers not yet
+   run their outputs of the previous run(). */
+void NeuralNet::sortEdges()
+  {
+    unsigned int i, j, k, m, s;
+    unsigned int nodes = 0;
+    unsigned int pick;
+    unsigned int outNode;
+    Node* node;                                                     //  Distinct destinations, by first appearance
+    bool* placed;
+    bool ready;
+    Edge* sorted;
+
+    if(len < 2)
+      return;
+
+    if((node = (Node*)malloc(len * sizeof(Node))) == NULL ||
+       (placed = (bool*)malloc(len * sizeof(bool))) == NULL ||
+       (sorted = (Edge*)malloc(len * sizeof(Edge))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate edge-sorting arrays\n";
+        exit(1);
+      }
+    for(i = 0; i < len; i++)
+      {
+        for(j = 0; j < nodes && (node[j].type != edgelist[i].dstType || node[j].index != edgelist[i].dstIndex); j++);
+        if(j == nodes)
+          {
+            node[nodes].type = edgelist[i].dstType;
+            node[nodes].index = edgelist[i].dstIndex;
+            placed[nodes] = false;
+            nodes++;
+          }
+      }
+    for(outNode = 0; node[outNode].type != edgelist[len - 1].dstType ||
+                     node[outNode].index != edgelist[len - 1].dstIndex; outNode++);
+
+    for(k = 0, m = 0; m < nodes; m++)
+      {
+        pick = nodes;
+        for(j = 0; j < nodes && pick == nodes; j++)                 //  First layer whose sources have all run
+          {
+            if(placed[j] || j == outNode)
+              continue;
+            ready = true;
+            for(i = 0; i < len && ready; i++)
+              {
+                if(edgelist[i].dstType != node[j].type || edgelist[i].dstIndex != node[j].index ||
+                   edgelist[i].srcType == INPUT_ARRAY)
+                  continue;
+                for(s = 0; s < nodes && (node[s].type != edgelist[i].srcType || node[s].index != edgelist[i].srcIndex); s++);
+                ready = (s == nodes || s == j || placed[s]);        //  Sources nothing feeds never change
+              }
+            if(ready)
+              pick = j;
+          }
+        for(j = 0; j < nodes && pick == nodes; j++)                 //  None: break the cycle at its earliest layer
+          {
+            if(!placed[j] && j != outNode)
+              pick = j;
+          }
+        if(pick == nodes)
+          pick = outNode;
+
+        placed[pick] = true;
+        for(i = 0; i < len; i++)
+          {
+            if(edgelist[i].dstType == node[pick].type && edgelist[i].dstIndex == node[pick].index)
+              sorted[k++] = edgelist[i];
+          }
+      }
+
+    memcpy(edgelist, sorted, len * sizeof(Edge));
+    free(node);
+    free(placed);
+    free(sorted);
+
+    return;
+  }
+
+/**************************************************************************************************
+ Run  */
+
+/* Run the network on input 'x': '*z' receives a malloc'd copy of the output, which the caller must free.
+   Return the length of the output.
+   If a cache is set (see setCache()) and 'x' was seen recently, the stored result is returned without running
+   anything. A hit runs no layer, so outputOf() then still reports the inner layers' outputs for the last input
+   that was actually evaluated. With a cache, run() may be called concurrently: hits proceed in parallel while
+   misses take turns evaluating the network. Networks with LSTM or GRU layers are never cached, since their outputs
+   depend on history. */
+unsigned int NeuralNet::run(double* x, double** z)
+  {
+    unsigned int outLen;
+
+    if(cache == NULL || lstmLen > 0 || gruLen > 0)
+      return evaluate(x, z);
+
+    if(cache->lookup(x, z, &outLen))
+      return outLen;
+
+    evalLock.lock();
+    outLen = evaluate(x, z);
+    evalLock.unlock();
+    cache->insert(x, *z, outLen);
+
+    return outLen;
+  }
+
+/* Evaluate the network on input 'x'. Layers run in edge-list order (see sortEdges()), and the edges into any one layer
+   must be consecutive: that layer's input is the concatenation of the slices those edges select.
+   The network output is the output of the last edge's destination; '*z' receives a malloc'd copy, which the
+   caller must free. Return the length of the output.
+
+   In delta mode (see setDelta()) Dense and Conv2D layers run incrementally, and a layer none of whose sources
+   moved by more than the tolerance is skipped entirely, keeping its previous output. LSTM and GRU layers always
+   run, since each run advances their state. */
+unsigned int NeuralNet::evaluate(double* x, double** z)
+  {
+    unsigned int i, j, k;
+    unsigned int inLen;
+    unsigned int outLen;
+    unsigned int total;
+    unsigned char dstType;
+    unsigned int dstIndex;
+    bool anyMoved;
+    double* src;
+
+    if(len == 0)
+      return 0;
+
+    total = 1 + denseLen + convLen + accumLen + lstmLen + gruLen + poolLen + upresLen + normalLen;
+    if(movedLen < total)
+      {
+        movedLen = total;
+        if((moved = (bool*)realloc(moved, movedLen * sizeof(bool))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate network's layer-change array\n";
+            exit(1);
+          }
+      }
+    moved[slot(INPUT_ARRAY, 0)] = true;                             //  Layers fed by the input check it themselves
+
+    i = 0;
+    while(i < len)
+      {
+        dstType = edgelist[i].dstType;
+        dstIndex = edgelist[i].dstIndex;
+
+        inLen = 0;
+        anyMoved = false;
+        for(j = i; j < len && edgelist[j].dstType == dstType && edgelist[j].dstIndex == dstIndex; j++)
+          {
+            inLen += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+            anyMoved = anyMoved || moved[slot(edgelist[j].srcType, edgelist[j].srcIndex)];
+          }
+
+        if(delta && !anyMoved && dstType != LSTM_ARRAY && dstType != GRU_ARRAY)
+          moved[slot(dstType, dstIndex)] = false;
+        else
+          {
+            if(bufferLen < inLen)
+              {
+                bufferLen = inLen;
+                if((buffer = (double*)realloc(buffer, bufferLen * sizeof(double))) == NULL)
+                  {
+                    cout << "ERROR: Unable to re-allocate network's input-assembly buffer\n";
+                    exit(1);
+                  }
+              }
+            for(k = 0; i < j; i++)                                  //  Concatenate the selected slices
+              {
+                src = (edgelist[i].srcType == INPUT_ARRAY) ? x : layerOutput(edgelist[i].srcType, edgelist[i].srcIndex);
+                memcpy(buffer + k, src + edgelist[i].selectorStart,
+                       (edgelist[i].selectorEnd - edgelist[i].selectorStart) * sizeof(double));
+                k += edgelist[i].selectorEnd - edgelist[i].selectorStart;
+              }
+
+            if(delta && dstType == DENSE_ARRAY)
+              moved[slot(dstType, dstIndex)] = (denselayers[dstIndex].runDelta(buffer, deltaTol) > 0);
+            else if(delta && dstType == CONV2D_ARRAY)
+              moved[slot(dstType, dstIndex)] = (convlayers[dstIndex].runDelta(buffer, deltaTol) > 0);
+            else
+              {
+                runLayer(dstType, dstIndex, buffer);
+                moved[slot(dstType, dstIndex)] = true;
+              }
+          }
+        i = j;
+      }
+
+    dstType = edgelist[len - 1].dstType;
+    dstIndex = edgelist[len - 1].dstIndex;
+    outLen = layerOutputLen(dstType, dstIndex);
+    if(((*z) = (double*)malloc(outLen * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate network output array\n";
+        exit(1);
+      }
+    memcpy((*z), layerOutput(dstType, dstIndex), outLen * sizeof(double));
+
+    return outLen;
+  }
+
+/* Run B inputs at once: 'X' is (B x inputs), row-major. '*Z' receives a malloc'd (B x output length) row-major
+   array, which the caller must free. Return the length of one output, or 0 if the network is not batchable().
+   A network made only of Dense layers runs each layer as one matrix product over the batch; any other network
+   runs the samples one after another. Batches bypass the cache, and must not overlap calls to run(). */
+unsigned int NeuralNet::runBatch(double* X, unsigned int B, double** Z)
+  {
+    unsigned int b, i, j, k;
+    unsigned int inLen;
+    unsigned int outLen;
+    unsigned int width;
+    unsigned int dstIndex;
+    double* z;
+    double* src;
+
+    if(!batchable() || len == 0 || B == 0)
+      {
+        (*Z) = NULL;
+        return 0;
+      }
+
+    if(convLen + accumLen + poolLen + upresLen + normalLen > 0)
+      {
+        outLen = evaluate(X, &z);
+        if(((*Z) = (double*)malloc(B * outLen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate network batch output array\n";
+            exit(1);
+          }
+        memcpy((*Z), z, outLen * sizeof(double));
+        free(z);
+        for(b = 1; b < B; b++)
+          {
+            evaluate(X + b * inputs, &z);
+            memcpy((*Z) + b * outLen, z, outLen * sizeof(double));
+            free(z);
+          }
+        return outLen;
+      }
+
+    i = 0;
+    while(i < len)                                                  //  Same schedule as evaluate(), a batch at a time
+      {
+        dstIndex = edgelist[i].dstIndex;
+        inLen = 0;
+        for(j = i; j < len && edgelist[j].dstType == DENSE_ARRAY && edgelist[j].dstIndex == dstIndex; j++)
+          inLen += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+
+        if(bufferLen < B * inLen)
+          {
+            bufferLen = B * inLen;
+            if((buffer = (double*)realloc(buffer, bufferLen * sizeof(double))) == NULL)
+              {
+                cout << "ERROR: Unable to re-allocate network's input-assembly buffer\n";
+                exit(1);
+              }
+          }
+        for(k = 0; i < j; i++)                                      //  Concatenate the selected columns, row by row
+          {
+            if(edgelist[i].srcType == INPUT_ARRAY)
+              {
+                src = X;
+                width = inputs;
+              }
+            else
+              {
+                src = denselayers[edgelist[i].srcIndex].batchOutput();
+                width = denselayers[edgelist[i].srcIndex].outputLen();
+              }
+            for(b = 0; b < B; b++)
+              memcpy(buffer + b * inLen + k, src + b * width + edgelist[i].selectorStart,
+                     (edgelist[i].selectorEnd - edgelist[i].selectorStart) * sizeof(double));
+            k += edgelist[i].selectorEnd - edgelist[i].selectorStart;
+          }
+        denselayers[dstIndex].runBatch(buffer, B);
+      }
+
+    dstIndex = edgelist[len - 1].dstIndex;
+    outLen = denselayers[dstIndex].outputLen();
+    if(((*Z) = (double*)malloc(B * outLen * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate network batch output array\n";
+        exit(1);
+      }
+    memcpy((*Z), denselayers[dstIndex].batchOutput(), B * outLen * sizeof(double));
+
+    return outLen;
+  }
+
+/* Run a sequence of T inputs, 'X' being (T x inputs) row-major. '*Z' receives a malloc'd (T x output length)
+   row-major array of the network's output at each step, which the caller must free. Return the output length.
+   Each group of edges into one layer (see evaluate()) is stepped through time on its own, and group g may run
+   step t as soon as its sources allow: a source earlier in the edge list must have finished step t, and a source
+   at or after g (a back edge, read by run() as it stood after step t - 1) must have finished step t - 1. The
+   schedule is a diagonal wavefront: while a layer runs step t, the layer it feeds runs step t - 1, and a stack of
+   k recurrent layers keeps k cores busy. Steps are run by the calling thread and by a pool of workers that is
+   started on the first call, grows to one fewer than the hardware threads, and lives until the network does;
+   idle workers sleep. The result is the same as calling run() on each input in turn; the cache and delta mode
+   are not used. Recurrent layers carry their state on from before the call. Return 0 if the edges into some
+   layer are not consecutive (see sortEdges()). */
+unsigned int NeuralNet::runSequence(double* X, unsigned int T, double** Z)
+  {
+    unsigned int g, i, j;
+    unsigned int slots;
+    unsigned int want;
+    unsigned int outLen;
+    SequencePlan plan;
+    thread* more;
+
+    (*Z) = NULL;
+    if(len == 0 || T == 0)
+      return 0;
+
+    plan.X = X;
+    plan.T = T;
+    plan.groups = 0;
+    plan.finished = 0;
+    for(i = 0; i < len; i = j)                                      //  Count groups
+      {
+        for(j = i; j < len && edgelist[j].dstType == edgelist[i].dstType && edgelist[j].dstIndex == edgelist[i].dstIndex; j++);
+        plan.groups++;
+      }
+    slots = 1 + denseLen + convLen + accumLen + lstmLen + gruLen + poolLen + upresLen + normalLen;
+    if((plan.start = (unsigned int*)malloc(plan.groups * sizeof(int))) == NULL ||
+       (plan.end = (unsigned int*)malloc(plan.groups * sizeof(int))) == NULL ||
+       (plan.width = (unsigned int*)malloc(plan.groups * sizeof(int))) == NULL ||
+       (plan.next = (unsigned int*)malloc(plan.groups * sizeof(int))) == NULL ||
+       (plan.running = (bool*)malloc(plan.groups * sizeof(bool))) == NULL ||
+       (plan.producer = (unsigned int*)malloc(slots * sizeof(int))) == NULL ||
+       (plan.in = (double**)malloc(plan.groups * sizeof(double*))) == NULL ||
+       (plan.steps = (double**)malloc(plan.groups * sizeof(double*))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate sequence schedule\n";
+        exit(1);
+      }
+    for(i = 0; i < slots; i++)                                      //  Layers no edge leads into never change
+      plan.producer[i] = UINT_MAX;
+    for(i = 0, g = 0; i < len; i = j, g++)
+      {
+        for(j = i, want = 0; j < len && edgelist[j].dstType == edgelist[i].dstType && edgelist[j].dstIndex == edgelist[i].dstIndex; j++)
+          want += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+        plan.start[g] = i;
+        plan.end[g] = j;
+        plan.next[g] = 0;
+        plan.running[g] = false;
+        plan.width[g] = layerOutputLen(edgelist[i].dstType, edgelist[i].dstIndex);
+        if(plan.producer[slot(edgelist[i].dstType, edgelist[i].dstIndex)] != UINT_MAX)
+          {
+            cout << "ERROR: The edges into ";
+            printLayerName(edgelist[i].dstType, edgelist[i].dstIndex);
+            cout << " are not consecutive; sort the edge list before running a sequence\n";
+            plan.groups = g;                                        //  Free only what was allocated
+            break;
+          }
+        plan.producer[slot(edgelist[i].dstType, edgelist[i].dstIndex)] = g;
+        if((plan.in[g] = (double*)malloc(want * sizeof(double))) == NULL ||
+           (plan.steps[g] = (double*)malloc((T + 1) * plan.width[g] * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate sequence outputs\n";
+            exit(1);
+          }
+                                                                    //  Row 0: what run() would read before step 0
+        memcpy(plan.steps[g], layerOutput(edgelist[i].dstType, edgelist[i].dstIndex), plan.width[g] * sizeof(double));
+      }
+
+    outLen = 0;
+    if(i >= len)                                                    //  Every group was laid out
+      {
+        want = (seqThreads > 0) ? seqThreads : thread::hardware_concurrency();
+        want = (want > 1) ? want - 1 : 0;                           //  Workers besides the calling thread
+        if(want > plan.groups - 1)
+          want = plan.groups - 1;
+        if(want > seqWorkerLen)                                     //  Grow the pool; running workers move with it
+          {
+            more = new thread[want];
+            for(j = 0; j < seqWorkerLen; j++)
+              more[j] = move(seqWorkers[j]);
+            for(; j < want; j++)
+              more[j] = thread(&NeuralNet::seqServe, this);
+            delete[] seqWorkers;
+            seqWorkers = more;
+            seqWorkerLen = want;
+          }
+
+        unique_lock<mutex> held(seqLock);
+        seq = &plan;
+        seqReady.notify_all();
+        while(plan.finished < plan.groups)                          //  Take part, and sleep when nothing can run
+          {
+            if(!seqStep(held))
+              seqReady.wait(held);
+          }
+        seq = NULL;
+        held.unlock();
+
+        g = plan.groups - 1;                                        //  The last group's outputs are the result
+        outLen = plan.width[g];
+        if(((*Z) = (double*)malloc(T * outLen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate sequence output array\n";
+            exit(1);
+          }
+        memcpy((*Z), plan.steps[g] + outLen, T * outLen * sizeof(double));
+      }
+
+    for(g = 0; g < plan.groups; g++)
+      {
+        free(plan.in[g]);
+        free(plan.steps[g]);
+      }
+    free(plan.start);
+    free(plan.end);
+    free(plan.width);
+    free(plan.next);
+    free(plan.running);
+    free(plan.producer);
+    free(plan.in);
+    free(plan.steps);
+
+    return outLen;
+  }
+
+/* Let at most 'n' threads, the caller of runSequence() included, work on one sequence; 0 means one per hardware
+   thread. The pool is stopped here and restarted, at the new size, by the next runSequence(). */
+void NeuralNet::setSequenceThreads(unsigned int n)
+  {
+    seqStop();
+    seqThreads = n;
+    return;
+  }
+
+/* Stop the sequence workers and wait for them; they finish no step of their own, since none is in progress
+   outside runSequence(). */
+void NeuralNet::seqStop()
+  {
+    unsigned int i;
+
+    if(seqWorkers == NULL)
+      return;
+    {
+      lock_guard<mutex> held(seqLock);
+      seqStopping = true;
+    }
+    seqReady.notify_all();
+    for(i = 0; i < seqWorkerLen; i++)
+      seqWorkers[i].join();
+    delete[] seqWorkers;
+    seqWorkers = NULL;
+    seqWorkerLen = 0;
+    seqStopping = false;
+    return;
+  }
+
+/* The first group, in edge-list order, that is not running, has steps left, and whose sources have published
+   what its next step reads (see runSequence()); UINT_MAX if there is none. Called holding 'seqLock'. */
+unsigned int NeuralNet::seqRunnable() const
+  {
+    unsigned int g, e, src, t;
+    bool ready;
+
+    for(g = 0; g < seq->groups; g++)
+      {
+        t = seq->next[g];
+        if(seq->running[g] || t == seq->T)
+          continue;
+        ready = true;
+        for(e = seq->start[g]; e < seq->end[g] && ready; e++)
+          {
+            if(edgelist[e].srcType == INPUT_ARRAY)
+              continue;
+            src = seq->producer[slot(edgelist[e].srcType, edgelist[e].srcIndex)];
+            if(src != UINT_MAX && seq->next[src] < t + ((src < g) ? 1 : 0))
+              ready = false;
+          }
+        if(ready)
+          return g;
+      }
+
+    return UINT_MAX;
+  }
+
+/* Run one step of the sequence in 'seq', if any may run now. The lock is released while the layer runs and
+   held again on return. Return whether a step was run. */
+bool NeuralNet::seqStep(unique_lock<mutex>& held)
+  {
+    unsigned int g, e, k, t;
+    unsigned int src;
+    unsigned char dstType;
+    unsigned int dstIndex;
+    SequencePlan* plan = seq;
+    double* x;
+
+    if((g = seqRunnable()) == UINT_MAX)
+      return false;
+    t = plan->next[g];
+    plan->running[g] = true;
+    held.unlock();
+                                                                    //  Rows read below are already written and never change
+    dstType = edgelist[plan->start[g]].dstType;
+    dstIndex = edgelist[plan->start[g]].dstIndex;
+    for(e = plan->start[g], k = 0; e < plan->end[g]; e++)
+      {
+        if(edgelist[e].srcType == INPUT_ARRAY)
+          x = plan->X + t * inputs;
+        else if((src = plan->producer[slot(edgelist[e].srcType, edgelist[e].srcIndex)]) == UINT_MAX)
+          x = layerOutput(edgelist[e].srcType, edgelist[e].srcIndex);
+        else                                                        //  Step t from an earlier group, t - 1 from a back edge
+          x = plan->steps[src] + ((src < g) ? t + 1 : t) * plan->width[src];
+        memcpy(plan->in[g] + k, x + edgelist[e].selectorStart, (edgelist[e].selectorEnd - edgelist[e].selectorStart) * sizeof(double));
+        k += edgelist[e].selectorEnd - edgelist[e].selectorStart;
+      }
+    runLayer(dstType, dstIndex, plan->in[g]);
+    memcpy(plan->steps[g] + (t + 1) * plan->width[g], layerOutput(dstType, dstIndex), plan->width[g] * sizeof(double));
+
+    held.lock();
+    plan->running[g] = false;
+    plan->next[g] = t + 1;
+    if(t + 1 == plan->T)
+      plan->finished++;
+    seqReady.notify_all();
+
+    return true;
+  }
+
+/* Body of a sequence worker: run steps of whatever sequence is in progress, and sleep when none can run. */
+void NeuralNet::seqServe()
+  {
+    unique_lock<mutex> held(seqLock);
+
+    while(!seqStopping)
+      {
+        if(seq == NULL || !seqStep(held))
+          seqReady.wait(held);
+      }
+
+    return;
+  }
+
+/* Run a sequence both ways: this network forward over 'X' (T x inputs, row-major), and 'backward', which takes
+   the same inputs, over 'X' from the last step to the first. The two run at the same time, each with its own
+   wavefront (see runSequence()). Row t of '*Z' (malloc'd; the caller must free it) is this network's output at
+   step t followed by the backward network's output at step t, the one that has seen steps T - 1 down to t.
+   Return the length of one row, or 0, with '*Z' NULL, if the networks' inputs differ or either run fails. */
+unsigned int NeuralNet::runBidirectional(NeuralNet* backward, double* X, unsigned int T, double** Z)
+  {
+    unsigned int t;
+    unsigned int fwdLen = 0;
+    unsigned int bwdLen = 0;
+    double* Xr;
+    double* Zf = NULL;
+    double* Zb = NULL;
+    thread other;
+
+    (*Z) = NULL;
+    if(backward == this || backward->inputs != inputs)
+      {
+        cout << "ERROR: Bidirectional run needs a distinct backward network with the same inputs\n";
+        return 0;
+      }
+    if(T == 0)
+      return 0;
+
+    if((Xr = (double*)malloc(T * inputs * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate reversed sequence\n";
+        exit(1);
+      }
+    for(t = 0; t < T; t++)
+      memcpy(Xr + t * inputs, X + (T - 1 - t) * inputs, inputs * sizeof(double));
+
+    other = thread([&]() { bwdLen = backward->runSequence(Xr, T, &Zb); });
+    fwdLen = runSequence(X, T, &Zf);
+    other.join();
+    free(Xr);
+
+    if(fwdLen == 0 || bwdLen == 0)                                  //  One direction refused to run: no half rows
+      {
+        cout << "ERROR: Bidirectional run failed in the " << ((fwdLen == 0) ? "forward" : "backward") << " network\n";
+        if(Zf != NULL)
+          free(Zf);
+        if(Zb != NULL)
+          free(Zb);
+        return 0;
+      }
+
+    if(((*Z) = (double*)malloc(T * (fwdLen + bwdLen) * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate bidirectional output\n";
+        exit(1);
+      }
+    for(t = 0; t < T; t++)
+      {
+        memcpy((*Z) + t * (fwdLen + bwdLen), Zf + t * fwdLen, fwdLen * sizeof(double));
+        memcpy((*Z) + t * (fwdLen + bwdLen) + fwdLen, Zb + (T - 1 - t) * bwdLen, bwdLen * sizeof(double));
+      }
+    free(Zf);
+    free(Zb);
+
+    return fwdLen + bwdLen;
+  }
+
+/* Factorize every Dense layer for which a low rank suffices (see Dense::factorize()). The 'samples' row-major
+   inputs in 'X' are run through the network, and each Dense layer is fitted to what it received, keeping its
+   outputs within 'tol'. Recurrent state is cleared afterward, and so is the cache if any layer was factorized.
+   Return the number of layers factorized. */
+unsigned int NeuralNet::factorize(double* X, unsigned int samples, double tol)
+  {
+    unsigned int b, i, j, k, l;
+    unsigned int count = 0;
+    unsigned int* inLen;
+    double** layerX;                                                //  Each Dense layer's inputs, samples x inLen[l]
+    double* src;
+    double* z;
+
+    if(denseLen == 0 || samples == 0 || len == 0)
+      return 0;
+
+    if((inLen = (unsigned int*)malloc(denseLen * sizeof(int))) == NULL ||
+       (layerX = (double**)malloc(denseLen * sizeof(double*))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate factorization arrays\n";
+        exit(1);
+      }
+    for(l = 0; l < denseLen; l++)
+      {
+        inLen[l] = denselayers[l].inputLen();
+        if((layerX[l] = (double*)malloc(samples * inLen[l] * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate factorization samples\n";
+            exit(1);
+          }
+      }
+
+    for(b = 0; b < samples; b++)                                    //  Run, then reassemble each Dense layer's input
+      {
+        evaluate(X + b * inputs, &z);
+        free(z);
+        for(i = 0; i < len; i = j)
+          {
+            for(j = i, k = 0; j < len && edgelist[j].dstType == edgelist[i].dstType &&
+                                         edgelist[j].dstIndex == edgelist[i].dstIndex; j++)
+              {
+                if(edgelist[i].dstType == DENSE_ARRAY)
+                  {
+                    src = (edgelist[j].srcType == INPUT_ARRAY) ? X + b * inputs : layerOutput(edgelist[j].srcType, edgelist[j].srcIndex);
+                    memcpy(layerX[edgelist[i].dstIndex] + b * inLen[edgelist[i].dstIndex] + k, src + edgelist[j].selectorStart,
+                           (edgelist[j].selectorEnd - edgelist[j].selectorStart) * sizeof(double));
+                  }
+                k += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+              }
+          }
+      }
+
+    for(l = 0; l < denseLen; l++)
+      {
+        if(denselayers[l].factorize(layerX[l], samples, tol) > 0)
+          count++;
+        free(layerX[l]);
+      }
+    free(layerX);
+    free(inLen);
+    reset();
+    if(count > 0 && cache != NULL)                                  //  Stored results came from the exact network
+      cache->clear();
+
+    return count;
+  }
+
+/* Structured pruning: physically remove the units and filters that matter little, shrinking each layer, its
+   output, and the selectors of every edge downstream. The 'samples' row-major inputs in 'X' are run through the
+   network to find the largest magnitude each output reaches, and weights are judged by what they carry on those
+   inputs. Removed are
+     - Dense units whose input masks are all 0: they output a constant, which is folded into the biases of
+       the layers they feed, so removing them changes nothing;
+     - Conv2D filters whose pre-activation strays at most 'tol' from their bias on the samples (the sum of the
+       filter's weight magnitudes times the largest input): their output is taken as the constant at the bias
+       and folded likewise;
+     - Dense, LSTM and GRU units whose every outgoing weight, recurrent ones included, times the unit's largest
+       output on the samples, is 'tol' or less: each pre-activation reading one moved by 'tol' at most.
+   Each removal is bounded on its own, and on the samples only. Several removed inputs to one unit add up, and a
+   change at one layer passes on through the layers after it, scaled by their weights and activations, so the
+   output may move by more than 'tol'; check the pruned network on held-out inputs. With no samples, only exactly
+   zero weights, filters and constant units qualify.
+   A unit is only removed if every layer reading it is Dense, LSTM or GRU (they can lose an input; 2D layers
+   cannot), if it is not part of the network's output, and if its layer keeps at least one unit. Removal repeats,
+   the magnitudes measured again each time, until nothing more qualifies, since removing inputs can leave units
+   upstream unread. SOFTMAX units of Dense layers are kept, since removing one would renormalize the others. The
+   result is an ordinary, dense network. Recurrent state is cleared afterward. If 'report' is not NULL, fill it
+   in. Return the number of units and filters removed. */
+unsigned int NeuralNet::prune(double* X, unsigned int samples, double tol, PruneReport* report)
+  {
+    unsigned int i, u, k;
+    unsigned int pos;
+    unsigned int slots;
+    unsigned int units = 0;
+    unsigned int filters = 0;
+    unsigned long long params0 = params();
+    unsigned long long flops0 = flops();
+    bool changed = true;
+    double** peak;                                                  //  Per slot(): largest magnitude of each output
+    double* p;
+    double c;
+
+    while(changed)
+      {
+        changed = false;
+        slots = 1 + denseLen + convLen + accumLen + lstmLen + gruLen + poolLen + upresLen + normalLen;
+        peak = peaks(X, samples);
+
+        for(i = 0; i < denseLen; i++)
+          for(u = denselayers[i].outputLen(); u-- > 0 && denselayers[i].outputLen() > 1; )
+            {
+              if(!shrinkable(DENSE_ARRAY, i, u, u + 1))
+                continue;
+              if(denselayers[i].constant_i(u, &c))                  //  Constant: fold it downstream
+                removeOutputs(DENSE_ARRAY, i, u, u + 1, c);
+              else if(denselayers[i].getF_i(u) != SOFTMAX &&
+                      outgoing(DENSE_ARRAY, i, u, u + 1, peak[slot(DENSE_ARRAY, i)]) <= tol)
+                removeOutputs(DENSE_ARRAY, i, u, u + 1, 0.0);
+              else
+                continue;
+              denselayers[i].removeUnit(u);                         //  Units above u were judged already; the
+              units++;                                              //  peaks of those below hold still
+              changed = true;
+            }
+
+        for(i = 0; i < lstmLen; i++)
+          for(u = lstmlayers[i].outputLen(); u-- > 0 && lstmlayers[i].outputLen() > 1; )
+            {
+              p = peak[slot(LSTM_ARRAY, i)];
+              if(shrinkable(LSTM_ARRAY, i, u, u + 1) && (p[u] == 0.0 || lstmlayers[i].feedback_i(u) * p[u] <= tol) &&
+                 outgoing(LSTM_ARRAY, i, u, u + 1, p) <= tol)
+                {
+                  removeOutputs(LSTM_ARRAY, i, u, u + 1, 0.0);
+                  lstmlayers[i].removeUnit(u);
+                  units++;
+                  changed = true;
+                }
+            }
+
+        for(i = 0; i < gruLen; i++)
+          for(u = grulayers[i].outputLen(); u-- > 0 && grulayers[i].outputLen() > 1; )
+            {
+              p = peak[slot(GRU_ARRAY, i)];
+              if(shrinkable(GRU_ARRAY, i, u, u + 1) && (p[u] == 0.0 || grulayers[i].feedback_i(u) * p[u] <= tol) &&
+                 outgoing(GRU_ARRAY, i, u, u + 1, p) <= tol)
+                {
+                  removeOutputs(GRU_ARRAY, i, u, u + 1, 0.0);
+                  grulayers[i].removeUnit(u);
+                  units++;
+                  changed = true;
+                }
+            }
+
+        for(i = 0; i < convLen; i++)
+          for(u = convlayers[i].filterCount(); u-- > 0 && convlayers[i].filterCount() > 1; )
+            {
+              for(k = 0, pos = 0; k < u; k++)                       //  Filter u's map follows the maps before it
+                pos += convlayers[i].outputWidth(k) * convlayers[i].outputHeight(k);
+              k = pos + convlayers[i].outputWidth(u) * convlayers[i].outputHeight(u);
+              if(!shrinkable(CONV2D_ARRAY, i, pos, k))
+                continue;
+              c = convlayers[i].filterNorm_i(u);
+              if(c == 0.0 || c * inputPeak(CONV2D_ARRAY, i, peak) <= tol)
+                removeOutputs(CONV2D_ARRAY, i, pos, k, convlayers[i].constant_i(u));
+              else if(outgoing(CONV2D_ARRAY, i, pos, k, peak[slot(CONV2D_ARRAY, i)]) <= tol)
+                removeOutputs(CONV2D_ARRAY, i, pos, k, 0.0);
+              else
+                continue;
+              convlayers[i].removeFilter(u);
+              filters++;
+              changed = true;
+            }
+
+        for(i = 0; i < slots; i++)
+          free(peak[i]);
+        free(peak);
+      }
+
+    if(units + filters > 0)
+      {
+        for(i = 0; i < denseLen; i++)
+          denselayers[i].resetDelta();
+        for(i = 0; i < convLen; i++)
+          convlayers[i].resetDelta();
+        if(cache != NULL)                                           //  Stored results came from the larger network
+          cache->clear();
+        if(arena != NULL && filters > 0)                            //  Removing filters moved their slabs out
+          pack();
+      }
+
+    if(report != NULL)
+      {
+        report->units = units;
+        report->filters = filters;
+        report->paramsBefore = params0;
+        report->paramsAfter = params();
+        report->flopsBefore = flops0;
+        report->flopsAfter = flops();
+      }
+
+    return units + filters;
+  }
+
+/* Stored parameters of every Dense, Conv2D, LSTM and GRU layer. */
+unsigned long long NeuralNet::params() const
+  {
+    unsigned int i;
+    unsigned long long n = 0;
+
+    for(i = 0; i < denseLen; i++)
+      n += denselayers[i].params();
+    for(i = 0; i < convLen; i++)
+      n += convlayers[i].params();
+    for(i = 0; i < lstmLen; i++)
+      n += lstmlayers[i].params();
+    for(i = 0; i < gruLen; i++)
+      n += grulayers[i].params();
+
+    return n;
+  }
+
+/* Floating-point operations of one run() through every Dense, Conv2D, LSTM and GRU layer. */
+unsigned long long NeuralNet::flops() const
+  {
+    unsigned int i;
+    unsigned long long n = 0;
+
+    for(i = 0; i < denseLen; i++)
+      n += denselayers[i].flops();
+    for(i = 0; i < convLen; i++)
+      n += convlayers[i].flops();
+    for(i = 0; i < lstmLen; i++)
+      n += lstmlayers[i].flops();
+    for(i = 0; i < gruLen; i++)
+      n += grulayers[i].flops();
+
+    return n;
+  }
+
+/* A network is batchable if samples are independent of one another: no LSTM or GRU layer carries state. */
+bool NeuralNet::batchable() const
+  {
+    return lstmLen == 0 && gruLen == 0;
+  }
+
+/*  */
+unsigned int NeuralNet::inputLen() const
+  {
+    return inputs;
+  }
+
+/* Clear the state of every LSTM and GRU layer, and make the next incremental run() compute in full. */
+void NeuralNet::reset()
+  {
+    unsigned int i;
+
+    for(i = 0; i < lstmLen; i++)
+      lstmlayers[i].reset();
+    for(i = 0; i < gruLen; i++)
+      grulayers[i].reset();
+    for(i = 0; i < denseLen; i++)
+      denselayers[i].resetDelta();
+    for(i = 0; i < convLen; i++)
+      convlayers[i].resetDelta();
+    return;
+  }
+
+/* Save the state of every LSTM and GRU layer. Each layer's hidden-state cache is shared with the snapshot rather
+   than copied, so saving is cheap however long the history. The caller must delete the result; fork() it to
+   branch the sequence again, e.g. once per beam in a search. */
+NetState* NeuralNet::snapshot() const
+  {
+    NetState* s = new NetState(lstmLen, gruLen);
+    unsigned int i;
+
+    for(i = 0; i < lstmLen; i++)
+      lstmlayers[i].saveState(s->lstm + i);
+    for(i = 0; i < gruLen; i++)
+      grulayers[i].saveState(s->gru + i);
+
+    return s;
+  }
+
+/* Put every LSTM and GRU layer back in the state saved in 's', which is left as it was and may be restored again.
+   The next incremental run() computes in full. */
+void NeuralNet::restore(const NetState* s)
+  {
+    unsigned int i;
+
+    if(s->lstmLen != lstmLen || s->gruLen != gruLen)
+      {
+        cout << "ERROR: Saved state does not fit this network\n";
+        exit(1);
+      }
+
+    for(i = 0; i < lstmLen; i++)
+      lstmlayers[i].loadState(s->lstm + i);
+    for(i = 0; i < gruLen; i++)
+      grulayers[i].loadState(s->gru + i);
+    for(i = 0; i < denseLen; i++)
+      denselayers[i].resetDelta();
+    for(i = 0; i < convLen; i++)
+      convlayers[i].resetDelta();
+    return;
+  }
+
+/* Turn incremental ("delta") inference on or off. Input and output changes of 'tol' or less are ignored: a layer
+   keeps computing with an input element until it moves by more than 'tol' from the value last used, and a layer
+   whose sources all stayed within 'tol' of what they last reported is not run at all. Each input element a layer
+   uses is within 'tol' of the value its source last reported, which is within 'tol' of the true one, so the
+   pre-activation of Dense unit j is off by at most 2 * tol * sum_i |w_ij * m_ij| (for a Conv2D output, 2 * tol
+   times the sum of its filter's weight magnitudes), before the slope of the activation. That error becomes the next layer's input error, so it compounds with depth: 'tol'
+   must be chosen against the network's weights, not against the accuracy wanted at the output.
+   Switching on makes the next run() compute in full. */
+void NeuralNet::setDelta(bool on, double tol)
+  {
+    unsigned int i;
+
+    delta = on;
+    deltaTol = (tol > 0.0) ? tol : 0.0;
+    for(i = 0; i < denseLen; i++)
+      denselayers[i].resetDelta();
+    for(i = 0; i < convLen; i++)
+      convlayers[i].resetDelta();
+    return;
+  }
+
+/* Put a least-recently-used cache of up to 'capacity' results in front of run(), replacing any existing cache
+   (and its contents). A capacity of 0 removes the cache. Return false, and set no cache, if the network contains
+   LSTM or GRU layers, whose outputs depend on history rather than on the input alone. prune() and factorize()
+   empty the cache; weights changed through get*() do not, so call setCache() again after changing them. */
+bool NeuralNet::setCache(unsigned int capacity)
+  {
+    if(cache != NULL)
+      {
+        delete cache;
+        cache = NULL;
+      }
+
+    if(capacity == 0)
+      return true;
+
+    if(lstmLen > 0 || gruLen > 0)
+      {
+        cout << "WARNING: Results of networks with recurrent layers are not cached\n";
+        return false;
+      }
+
+    cache = new RunCache(inputs, capacity);
+    return true;
+  }
+
+/*  */
+unsigned long long NeuralNet::cacheHits() const
+  {
+    return (cache != NULL) ? cache->hits() : 0;
+  }
+
+/*  */
+unsigned long long NeuralNet::cacheMisses() const
+  {
+    return (cache != NULL) ? cache->misses() : 0;
+  }
+
+/* Number of Dense and Conv2D runs, in delta mode, that updated the layer's outputs in place rather than
+   recomputing them (see Dense::runDelta() and Conv2D::runDelta()). */
+unsigned long long NeuralNet::partialRuns() const
+  {
+    unsigned long long n = 0;
+    unsigned int i;
+
+    for(i = 0; i < denseLen; i++)
+      n += denselayers[i].partialRuns();
+    for(i = 0; i < convLen; i++)
+      n += convlayers[i].partialRuns();
+    return n;
+  }
+
+/* Point to the latest output of the layer named 'name' and write its length to 'len'. Return NULL, and set 'len'
+   to 0, if no layer has that name. The buffer belongs to the layer and changes with the next run() that evaluates
+   the network; a run() answered from the cache leaves it as it was. */
+double* NeuralNet::outputOf(char* name, unsigned int* len)
+  {
+    unsigned char type = nameType(name);
+    unsigned int index = nameIndex(name);
+
+    if(index >= layerCount(type))
+      {
+        (*len) = 0;
+        return NULL;
+      }
+
+    (*len) = layerOutputLen(type, index);
+    return layerOutput(type, index);
+  }
+
+/* Gather the weights of every Conv2D layer into one contiguous Arena, layer after layer, each filter bank sorted
+   by shape (see Conv2D). Call once the network is built or loaded; calling again after adding filters repacks.
+   The previous Arena, if any, is released only after every layer has moved out of it. Return the number of
+   doubles reserved, or 0 if the network has no Conv2D weights and nothing was packed. */
+unsigned int NeuralNet::pack()
+  {
+    unsigned int i;
+    unsigned int total = 0;
+    Arena* packed;
+
+    for(i = 0; i < convLen; i++)
+      total += Arena::padded(convlayers[i].weightsLen());
+    if(total == 0)
+      return 0;
+
+    packed = new Arena();
+    packed->reserve(total);
+    for(i = 0; i < convLen; i++)
+      convlayers[i].pack(packed);
+
+    if(arena != NULL)
+      delete arena;
+    arena = packed;
+
+    return total;
+  }
+
+/* Each layer's flag in 'moved': the input first, then each layer array in flag order.
+   Cases fall through on purpose, accumulating the lengths of every array that comes before. */
+unsigned int NeuralNet::slot(unsigned char type, unsigned int index) const
+  {
+    unsigned int base = 1;
+
+    switch(type)
+      {
+        case INPUT_ARRAY:   return 0;
+        case NORMAL_ARRAY:  base += upresLen;
+        case UPRES_ARRAY:   base += poolLen;
+        case POOL_ARRAY:    base += gruLen;
+        case GRU_ARRAY:     base += lstmLen;
+        case LSTM_ARRAY:    base += accumLen;
+        case ACCUM_ARRAY:   base += convLen;
+        case CONV2D_ARRAY:  base += denseLen;
+        default:            break;
+      }
+
+    return base + index;
+  }
+
+/* Point to the output buffer of the given layer. */
+double* NeuralNet::layerOutput(unsigned char type, unsigned int index) const
+  {
+    switch(type)
+      {
+        case DENSE_ARRAY:   return denselayers[index].output();
+        case CONV2D_ARRAY:  return convlayers[index].output();
+        case ACCUM_ARRAY:   return accumlayers[index].output();
+        case LSTM_ARRAY:    return lstmlayers[index].output();
+        case GRU_ARRAY:     return grulayers[index].output();
+        case POOL_ARRAY:    return poollayers[index].output();
+        case UPRES_ARRAY:   return upreslayers[index].output();
+        case NORMAL_ARRAY:  return normlayers[index].output();
+      }
+    return NULL;
+  }
+
+/* Whether outputs [lo, hi) of the given layer may be removed: the layer is not the network's output, and every
+   layer reading any of them can lose inputs (Dense, LSTM, GRU) and would keep at least one. */
+bool NeuralNet::shrinkable(unsigned char type, unsigned int index, unsigned int lo, unsigned int hi) const
+  {
+    unsigned int e;
+    unsigned int a, b;
+    unsigned int in;
+
+    if(len == 0 || (edgelist[len - 1].dstType == type && edgelist[len - 1].dstIndex == index))
+      return false;
+
+    for(e = 0; e < len; e++)
+      {
+        if(edgelist[e].srcType != type || edgelist[e].srcIndex != index)
+          continue;
+        a = (edgelist[e].selectorStart > lo) ? edgelist[e].selectorStart : lo;
+        b = (edgelist[e].selectorEnd < hi) ? edgelist[e].selectorEnd : hi;
+        if(a >= b)                                                  //  This edge reads none of them
+          continue;
+        switch(edgelist[e].dstType)
+          {
+            case DENSE_ARRAY:  in = denselayers[edgelist[e].dstIndex].inputLen();  break;
+            case LSTM_ARRAY:   in = lstmlayers[edgelist[e].dstIndex].inputLen();   break;
+            case GRU_ARRAY:    in = grulayers[edgelist[e].dstIndex].inputLen();    break;
+            default:           return false;
+          }
+        if(in <= b - a)
+          return false;
+      }
+
+    return true;
+  }
+
+/* Largest weight with which any of outputs [lo, hi) of the given layer reaches a layer downstream, each weight
+   times the largest magnitude 'peak' records for its output: 0 if nothing reads them. A weight of exactly 0
+   counts 0 whatever the peak. Only meaningful where shrinkable() holds. */
+double NeuralNet::outgoing(unsigned char type, unsigned int index, unsigned int lo, unsigned int hi, double* peak) const
+  {
+    unsigned int e, p;
+    unsigned int q;
+    double w = 0.0;
+    double m = 0.0;
+
+    for(e = 0; e < len; e++)
+      {
+        if(edgelist[e].srcType != type || edgelist[e].srcIndex != index)
+          continue;
+        for(p = lo; p < hi; p++)
+          {
+            if(p < edgelist[e].selectorStart || p >= edgelist[e].selectorEnd)
+              continue;
+            q = edgeBase(e) + p - edgelist[e].selectorStart;
+            switch(edgelist[e].dstType)
+              {
+                case DENSE_ARRAY:  w = denselayers[edgelist[e].dstIndex].inputWeight_i(q);  break;
+                case LSTM_ARRAY:   w = lstmlayers[edgelist[e].dstIndex].inputWeight_i(q);   break;
+                case GRU_ARRAY:    w = grulayers[edgelist[e].dstIndex].inputWeight_i(q);    break;
+              }
+            if(w != 0.0)
+              m = fmax(m, w * peak[p]);
+          }
+      }
+
+    return m;
+  }
+
+/* Run the 'samples' row-major inputs in 'X' through the network from a cleared state, and return, per slot(),
+   a malloc'd array of the largest magnitude each output of that layer reached; the caller must free each array
+   and the whole. With no samples, every entry is HUGE_VAL. Recurrent state is cleared afterward. */
+double** NeuralNet::peaks(double* X, unsigned int samples)
+  {
+    unsigned int b, i, j, n, s;
+    unsigned int slots = 1 + denseLen + convLen + accumLen + lstmLen + gruLen + poolLen + upresLen + normalLen;
+    unsigned char t;
+    double** peak;
+    double* out;
+    double* z;
+
+    if((peak = (double**)malloc(slots * sizeof(double*))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate output peak arrays\n";
+        exit(1);
+      }
+    for(t = INPUT_ARRAY; t <= NORMAL_ARRAY; t++)
+      for(i = 0; i < ((t == INPUT_ARRAY) ? 1 : layerCount(t)); i++)
+        {
+          n = (t == INPUT_ARRAY) ? inputs : layerOutputLen(t, i);
+          s = slot(t, i);
+          if((peak[s] = (double*)malloc((n + 1) * sizeof(double))) == NULL)
+            {
+              cout << "ERROR: Unable to allocate output peak array\n";
+              exit(1);
+            }
+          for(j = 0; j < n; j++)
+            peak[s][j] = (samples > 0) ? 0.0 : HUGE_VAL;
+        }
+
+    reset();
+    for(b = 0; b < samples; b++)
+      {
+        evaluate(X + b * inputs, &z);
+        free(z);
+        for(t = INPUT_ARRAY; t <= NORMAL_ARRAY; t++)
+          for(i = 0; i < ((t == INPUT_ARRAY) ? 1 : layerCount(t)); i++)
+            {
+              n = (t == INPUT_ARRAY) ? inputs : layerOutputLen(t, i);
+              out = (t == INPUT_ARRAY) ? X + b * inputs : layerOutput(t, i);
+              s = slot(t, i);
+              for(j = 0; j < n; j++)
+                peak[s][j] = fmax(peak[s][j], fabs(out[j]));
+            }
+      }
+    reset();
+
+    return peak;
+  }
+
+/* Largest magnitude, among the 'peak' arrays (see peaks()), of anything the given layer reads. */
+double NeuralNet::inputPeak(unsigned char type, unsigned int index, double** peak) const
+  {
+    unsigned int e, p;
+    double m = 0.0;
+
+    for(e = 0; e < len; e++)
+      {
+        if(edgelist[e].dstType != type || edgelist[e].dstIndex != index)
+          continue;
+        for(p = edgelist[e].selectorStart; p < edgelist[e].selectorEnd; p++)
+          m = fmax(m, peak[slot(edgelist[e].srcType, edgelist[e].srcIndex)][p]);
+      }
+
+    return m;
+  }
+
+/* Remove outputs [lo, hi) of the given layer from everything downstream, before the layer itself drops them:
+   each reader loses the matching inputs, folding in the constant 'v', and every edge from the layer has its
+   selectors narrowed or shifted. Edges left selecting nothing are deleted. */
+void NeuralNet::removeOutputs(unsigned char type, unsigned int index, unsigned int lo, unsigned int hi, double v)
+  {
+    unsigned int e, p, k;
+    unsigned int q;
+
+    for(p = hi; p-- > lo; )                                         //  From the top, so lower positions hold still
+      for(e = 0; e < len; e++)
+        {
+          if(edgelist[e].srcType != type || edgelist[e].srcIndex != index)
+            continue;
+          if(p >= edgelist[e].selectorStart && p < edgelist[e].selectorEnd)
+            {
+              q = edgeBase(e) + p - edgelist[e].selectorStart;
+              switch(edgelist[e].dstType)
+                {
+                  case DENSE_ARRAY:  denselayers[edgelist[e].dstIndex].removeInput(q, v);  break;
+                  case LSTM_ARRAY:   lstmlayers[edgelist[e].dstIndex].removeInput(q, v);   break;
+                  case GRU_ARRAY:    grulayers[edgelist[e].dstIndex].removeInput(q, v);    break;
+                }
+              edgelist[e].selectorEnd--;
+            }
+          else if(p < edgelist[e].selectorStart)
+            {
+              edgelist[e].selectorStart--;
+              edgelist[e].selectorEnd--;
+            }
+        }
+
+    for(e = 0, k = 0; e < len; e++)
+      {
+        if(edgelist[e].selectorStart < edgelist[e].selectorEnd)
+          edgelist[k++] = edgelist[e];
+      }
+    len = k;
+
+    return;
+  }
+
+/* Where the first element selected by edge 'e' lands in its destination's input: after everything the edges
+   before it, into the same layer, select. */
+unsigned int NeuralNet::edgeBase(unsigned int e) const
+  {
+    unsigned int j;
+    unsigned int base = 0;
+
+    for(j = 0; j < e; j++)
+      {
+        if(edgelist[j].dstType == edgelist[e].dstType && edgelist[j].dstIndex == edgelist[e].dstIndex)
+          base += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+      }
+
+    return base;
+  }
+
+/* Length of the given layer's output. */
+unsigned int NeuralNet::layerOutputLen(unsigned char type, unsigned int index) const
+  {
+    switch(type)
+      {
+        case DENSE_ARRAY:   return denselayers[index].outputLen();
+        case CONV2D_ARRAY:  return convlayers[index].outputLen();
+        case ACCUM_ARRAY:   return accumlayers[index].outputLen();
+        case LSTM_ARRAY:    return lstmlayers[index].outputLen();
+        case GRU_ARRAY:     return grulayers[index].outputLen();
+        case POOL_ARRAY:    return poollayers[index].outputLen();
+        case UPRES_ARRAY:   return upreslayers[index].outputLen();
+        case NORMAL_ARRAY:  return normlayers[index].outputLen();
+      }
+    return 0;
+  }
+
+/* Run the given layer on 'x'. */
+void NeuralNet::runLayer(unsigned char type, unsigned int index, double* x)
+  {
+    switch(type)
+      {
+        case DENSE_ARRAY:   denselayers[index].run(x);  break;
+        case CONV2D_ARRAY:  convlayers[index].run(x);   break;
+        case ACCUM_ARRAY:   accumlayers[index].run(x);  break;
+        case LSTM_ARRAY:    lstmlayers[index].run(x);   break;
+        case GRU_ARRAY:     grulayers[index].run(x);    break;
+        case POOL_ARRAY:    poollayers[index].run(x);   break;
+        case UPRES_ARRAY:   upreslayers[index].run(x);  break;
+        case NORMAL_ARRAY:  normlayers[index].run(x);   break;
+      }
+    return;
+  }
+
+/**************************************************************************************************
+ Names  */
+
+/* Index, within its array, of the layer named 'name' (see nameType() for which array), or UINT_MAX if no layer
+   has that name. Arrays are searched in flag order; unnamed layers never match. */
+unsigned int NeuralNet::nameIndex(char* name)
+  {
+    unsigned char type;
+    unsigned int i;
+
+    if(name == NULL || name[0] == '\0')
+      return UINT_MAX;
+    for(type = DENSE_ARRAY; type <= NORMAL_ARRAY; type++)
+      for(i = 0; i < layerCount(type); i++)
+        {
+          if(strcmp(layerName(type, i), name) == 0)
+            return i;
+        }
+    return UINT_MAX;
+  }
+
+/* Array flag of the layer named 'name', or UCHAR_MAX if no layer has that name. */
+unsigned char NeuralNet::nameType(char* name)
+  {
+    unsigned char type;
+    unsigned int i;
+
+    if(name == NULL || name[0] == '\0')
+      return UCHAR_MAX;
+    for(type = DENSE_ARRAY; type <= NORMAL_ARRAY; type++)
+      for(i = 0; i < layerCount(type); i++)
+        {
+          if(strcmp(layerName(type, i), name) == 0)
+            return type;
+        }
+    return UCHAR_MAX;
+  }
+
+/* Name of the given layer; empty if it was never named. */
+char* NeuralNet::layerName(unsigned char type, unsigned int index) const
+  {
+    switch(type)
+      {
+        case DENSE_ARRAY:   return denselayers[index].name();
+        case CONV2D_ARRAY:  return convlayers[index].name();
+        case ACCUM_ARRAY:   return accumlayers[index].name();
+        case LSTM_ARRAY:    return lstmlayers[index].name();
+        case GRU_ARRAY:     return grulayers[index].name();
+        case POOL_ARRAY:    return poollayers[index].name();
+        case UPRES_ARRAY:   return upreslayers[index].name();
+        case NORMAL_ARRAY:  return normlayers[index].name();
+      }
+    return NULL;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Read 'n' unsigned ints from 'fp' into 'v' and step back over them, so that a layer's read() finds its shape
+   where its write() put it. */
+static bool neuron_peek(FILE* fp, unsigned int* v, unsigned int n)
+  {
+    if(fread(v, sizeof(int), n, fp) != n)
+      return false;
+    return fseek(fp, -(long)(n * sizeof(int)), SEEK_CUR) == 0;
+  }
+
+/* Write the network to the binary file 'filename':
+     inputs, edge count, the number of layers in each array (flag order), variable count (one byte),
+     generation, fitness and comment;
+     each edge: source flag (one byte), source index, selector start and end, destination flag (one byte),
+     destination index;
+     each variable: key and value;
+     each layer, array by array in flag order, as that layer's write() puts it.
+   Return false if the file could not be written. */
+bool NeuralNet::write(char* filename)
+  {
+    FILE* fp;
+    unsigned int i;
+    unsigned char type;
+    bool ok = true;
+
+    if((fp = fopen(filename, "wb")) == NULL)
+      {
+        cout << "ERROR: Unable to open " << filename << " for writing\n";
+        return false;
+      }
+
+    ok = ok && fwrite(&inputs, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&len, sizeof(int), 1, fp) == 1;
+    for(type = DENSE_ARRAY; type <= NORMAL_ARRAY; type++)
+      {
+        i = layerCount(type);
+        ok = ok && fwrite(&i, sizeof(int), 1, fp) == 1;
+      }
+    ok = ok && fwrite(&vars, sizeof(char), 1, fp) == 1;
+    ok = ok && fwrite(&gen, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&fit, sizeof(double), 1, fp) == 1;
+    ok = ok && fwrite(comment, sizeof(char), COMMSTR_LEN, fp) == COMMSTR_LEN;
+
+    for(i = 0; i < len && ok; i++)
+      {
+        ok = ok && fwrite(&edgelist[i].srcType, sizeof(char), 1, fp) == 1;
+        ok = ok && fwrite(&edgelist[i].srcIndex, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&edgelist[i].selectorStart, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&edgelist[i].selectorEnd, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&edgelist[i].dstType, sizeof(char), 1, fp) == 1;
+        ok = ok && fwrite(&edgelist[i].dstIndex, sizeof(int), 1, fp) == 1;
+      }
+    for(i = 0; i < vars && ok; i++)
+      {
+        ok = ok && fwrite(variables[i].key, sizeof(char), VARSTR_LEN, fp) == VARSTR_LEN;
+        ok = ok && fwrite(&variables[i].value, sizeof(double), 1, fp) == 1;
+      }
+
+    for(i = 0; i < denseLen && ok; i++)
+      ok = denselayers[i].write(fp);
+    for(i = 0; i < convLen && ok; i++)
+      ok = convlayers[i].write(fp);
+    for(i = 0; i < accumLen && ok; i++)
+      ok = accumlayers[i].write(fp);
+    for(i = 0; i < lstmLen && ok; i++)
+      ok = lstmlayers[i].write(fp);
+    for(i = 0; i < gruLen && ok; i++)
+      ok = grulayers[i].write(fp);
+    for(i = 0; i < poolLen && ok; i++)
+      ok = poollayers[i].write(fp);
+    for(i = 0; i < upresLen && ok; i++)
+      ok = upreslayers[i].write(fp);
+    for(i = 0; i < normalLen && ok; i++)
+      ok = normlayers[i].write(fp);
+
+    if(fclose(fp) != 0)
+      ok = false;
+    if(!ok)
+      cout << "ERROR: Unable to write network to " << filename << "\n";
+
+    return ok;
+  }
+
+/* Replace this network with the one written to 'filename' by write(). Each layer is built from the shape at the
+   head of its record, then reads the rest itself. Recurrent state starts at zero; the cache, delta mode and
+   packing are not part of the file and are left off. Return false, leaving the network empty, if the file
+   cannot be read or does not describe a valid network. */
+bool NeuralNet::load(char* filename)
+  {
+    FILE* fp;
+    unsigned int i;
+    unsigned int edges;
+    unsigned int count[NORMAL_ARRAY + 1];
+    unsigned int shape[3];
+    unsigned char type;
+    bool ok = true;
+
+    if((fp = fopen(filename, "rb")) == NULL)
+      {
+        cout << "ERROR: Unable to open " << filename << "\n";
+        return false;
+      }
+    clear();
+    delta = false;
+
+    ok = ok && fread(&inputs, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&edges, sizeof(int), 1, fp) == 1;
+    for(type = DENSE_ARRAY; type <= NORMAL_ARRAY; type++)
+      ok = ok && fread(count + type, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&vars, sizeof(char), 1, fp) == 1;
+    ok = ok && fread(&gen, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&fit, sizeof(double), 1, fp) == 1;
+    ok = ok && fread(comment, sizeof(char), COMMSTR_LEN, fp) == COMMSTR_LEN;
+    comment[COMMSTR_LEN - 1] = '\0';
+    if(!ok)
+      vars = 0;
+
+    if(ok && edges > 0)
+      {
+        if((edgelist = (Edge*)malloc(edges * sizeof(Edge))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate edge list\n";
+            exit(1);
+          }
+        for(len = 0; len < edges && ok; len++)
+          {
+            ok = ok && fread(&edgelist[len].srcType, sizeof(char), 1, fp) == 1;
+            ok = ok && fread(&edgelist[len].srcIndex, sizeof(int), 1, fp) == 1;
+            ok = ok && fread(&edgelist[len].selectorStart, sizeof(int), 1, fp) == 1;
+            ok = ok && fread(&edgelist[len].selectorEnd, sizeof(int), 1, fp) == 1;
+            ok = ok && fread(&edgelist[len].dstType, sizeof(char), 1, fp) == 1;
+            ok = ok && fread(&edgelist[len].dstIndex, sizeof(int), 1, fp) == 1;
+          }
+      }
+    if(ok && vars > 0)
+      {
+        if((variables = (Variable*)malloc(vars * sizeof(Variable))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate network variables\n";
+            exit(1);
+          }
+        for(i = 0; i < vars && ok; i++)
+          {
+            ok = ok && fread(variables[i].key, sizeof(char), VARSTR_LEN, fp) == VARSTR_LEN;
+            ok = ok && fread(&variables[i].value, sizeof(double), 1, fp) == 1;
+            variables[i].key[VARSTR_LEN - 1] = '\0';
+          }
+      }
+
+    for(i = 0; ok && i < count[DENSE_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 2);
+        if(ok)
+          addDense(shape[0], shape[1]);
+        ok = ok && denselayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[CONV2D_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 2);
+        if(ok)
+          addConv2D(shape[0], shape[1]);
+        ok = ok && convlayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[ACCUM_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 1);
+        if(ok)
+          addAccum(shape[0]);
+        ok = ok && accumlayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[LSTM_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 3);
+        if(ok)
+          addLSTM(shape[0], shape[1], shape[2]);
+        ok = ok && lstmlayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[GRU_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 3);
+        if(ok)
+          addGRU(shape[0], shape[1], shape[2]);
+        ok = ok && grulayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[POOL_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 2);
+        if(ok)
+          addPool(shape[0], shape[1]);
+        ok = ok && poollayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[UPRES_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 2);
+        if(ok)
+          addUpres(shape[0], shape[1]);
+        ok = ok && upreslayers[i].read(fp);
+      }
+    for(i = 0; ok && i < count[NORMAL_ARRAY]; i++)
+      {
+        ok = neuron_peek(fp, shape, 1);
+        if(ok)
+          addNormal(shape[0]);
+        ok = ok && normlayers[i].read(fp);
+      }
+    fclose(fp);
+
+    for(i = 0; i < len && ok; i++)                                  //  Every edge must connect what was loaded
+      {
+        ok = (edgelist[i].srcType == INPUT_ARRAY || edgelist[i].srcIndex < layerCount(edgelist[i].srcType)) &&
+             edgelist[i].dstType != INPUT_ARRAY && edgelist[i].dstIndex < layerCount(edgelist[i].dstType) &&
+             edgelist[i].selectorStart < edgelist[i].selectorEnd &&
+             edgelist[i].selectorEnd <= ((edgelist[i].srcType == INPUT_ARRAY) ? inputs
+                                                                              : layerOutputLen(edgelist[i].srcType, edgelist[i].srcIndex));
+      }
+
+    if(!ok)
+      {
+        cout << "ERROR: " << filename << " does not hold a valid network\n";
+        clear();
+      }
+    return ok;
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/* Print the network's header, every layer, and the edge list. */
+void NeuralNet::print()
+  {
+    unsigned char type;
+    unsigned int i;
+
+    if(comment[0] != '\0')
+      printf("%s\n", comment);
+    printf("Inputs = %d, Generation = %d, Fitness = %f\n", inputs, gen, fit);
+    for(i = 0; i < vars; i++)
+      printf("  %s = %f\n", variables[i].key, variables[i].value);
+
+    for(type = DENSE_ARRAY; type <= NORMAL_ARRAY; type++)
+      for(i = 0; i < layerCount(type); i++)
+        {
+          printLayerName(type, i);
+          printf(":\n");
+          switch(type)
+            {
+              case DENSE_ARRAY:   denselayers[i].print();  break;
+              case CONV2D_ARRAY:  convlayers[i].print();   break;
+              case ACCUM_ARRAY:   accumlayers[i].print();  break;
+              case LSTM_ARRAY:    lstmlayers[i].print();   break;
+              case GRU_ARRAY:     grulayers[i].print();    break;
+              case POOL_ARRAY:    poollayers[i].print();   break;
+              case UPRES_ARRAY:   upreslayers[i].print();  break;
+              case NORMAL_ARRAY:  normlayers[i].print();   break;
+            }
+        }
+    printEdgeList();
+
+    return;
+  }
+
+/* Print one line per edge: source, selected range, destination. */
+void NeuralNet::printEdgeList()
+  {
+    unsigned int i;
+
+    for(i = 0; i < len; i++)
+      {
+        printf("  ");
+        printLayerName(edgelist[i].srcType, edgelist[i].srcIndex);
+        printf(" [%d, %d) -> ", edgelist[i].selectorStart, edgelist[i].selectorEnd);
+        printLayerName(edgelist[i].dstType, edgelist[i].dstIndex);
+        printf("\n");
+      }
+    return;
+  }
+
+/* Print the layer's name, or its array and index if it has none. */
+void NeuralNet::printLayerName(unsigned char type, unsigned int index)
+  {
+    char* n;
+
+    if(type == INPUT_ARRAY)
+      {
+        printf("Input");
+        return;
+      }
+    if(index >= layerCount(type))
+      {
+        printf("(no such layer)");
+        return;
+      }
+    n = layerName(type, index);
+    if(n[0] != '\0')
+      {
+        printf("%s", n);
+        return;
+      }
+    switch(type)
+      {
+        case DENSE_ARRAY:   printf("Dense[%d]", index);          break;
+        case CONV2D_ARRAY:  printf("Conv2D[%d]", index);         break;
+        case ACCUM_ARRAY:   printf("Accum[%d]", index);          break;
+        case LSTM_ARRAY:    printf("LSTM[%d]", index);           break;
+        case GRU_ARRAY:     printf("GRU[%d]", index);            break;
+        case POOL_ARRAY:    printf("Pool[%d]", index);           break;
+        case UPRES_ARRAY:   printf("Upres[%d]", index);          break;
+        case NORMAL_ARRAY:  printf("Normalization[%d]", index);  break;
+      }
+    return;
+  }
+
+/**************************************************************************************************
+ Code generation  */
+
+/* Write the network to 'filename' as a standalone C++ header with everything specialized at compile time:
+   layer sizes, activation flags and the edge schedule become constants, and all weights (masks folded in)
+   become constexpr arrays. The generated run() allocates nothing; every buffer is a fixed-size stack array.
+   Symbols are placed in namespace 'prefix'.
+   Only networks built entirely of Dense layers (fed by the network input or by other Dense layers) can be
+   specialized. The network output is the output of the destination of the last edge. */
+bool NeuralNet::exportHeader(char* filename, char* prefix)
+  {
+    FILE* fp;
+    unsigned int* order;                                            //  Dense layer indices, in the order they run
+    unsigned int orderLen = 0;
+    bool* done;                                                     //  Track which Dense layers have been scheduled
+    unsigned int i, j, k, l, m;
+    unsigned int offset;
+    unsigned char f;
+    bool uniform;
+    unsigned int outLayer;
+
+    if(prefix == NULL || prefix[0] == '\0' || (prefix[0] >= '0' && prefix[0] <= '9'))
+      {
+        cout << "ERROR: Header prefix must be a valid C++ identifier\n";
+        return false;
+      }
+    for(i = 0; prefix[i] != '\0'; i++)
+      {
+        if(!((prefix[i] >= 'a' && prefix[i] <= 'z') || (prefix[i] >= 'A' && prefix[i] <= 'Z') ||
+             (prefix[i] >= '0' && prefix[i] <= '9') || prefix[i] == '_'))
+          {
+            cout << "ERROR: Header prefix must be a valid C++ identifier\n";
+            return false;
+          }
+      }
+
+    if(len == 0 || denseLen == 0)
+      {
+        cout << "ERROR: Cannot specialize a network with no Dense layers\n";
+        return false;
+      }
+    for(i = 0; i < len; i++)                                        //  Only Input->Dense and Dense->Dense edges qualify
+      {
+        if((edgelist[i].srcType != INPUT_ARRAY && edgelist[i].srcType != DENSE_ARRAY) || edgelist[i].dstType != DENSE_ARRAY)
+          {
+            cout << "ERROR: Only networks of Dense layers can be specialized\n";
+            return false;
+          }
+      }
+
+    if((order = (unsigned int*)malloc(denseLen * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate layer schedule for code generation\n";
+        return false;
+      }
+    if((done = (bool*)malloc(denseLen * sizeof(bool))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate layer schedule for code generation\n";
+        free(order);
+        return false;
+      }
+    for(i = 0; i < denseLen; i++)
+      done[i] = false;
+
+    for(i = 0; i < len; i++)                                        //  A layer runs when it first appears as a destination
+      {
+        if(!done[edgelist[i].dstIndex])
+          {
+            done[edgelist[i].dstIndex] = true;
+            order[orderLen++] = edgelist[i].dstIndex;
+          }
+      }
+
+    for(i = 0; i < orderLen; i++)                                   //  Verify the schedule: every source must already have run,
+      {                                                             //  and the incoming slices must fill the layer's input exactly.
+        offset = 0;
+        for(j = 0; j < len; j++)
+          {
+            if(edgelist[j].dstIndex == order[i])
+              {
+                if(edgelist[j].srcType == DENSE_ARRAY)
+                  {
+                    for(k = 0; k < i && order[k] != edgelist[j].srcIndex; k++);
+                    if(k == i)
+                      {
+                        cout << "ERROR: Edge list is not in executable order; call sortEdges() first\n";
+                        free(order);
+                        free(done);
+                        return false;
+                      }
+                  }
+                offset += edgelist[j].selectorEnd - edgelist[j].selectorStart;
+              }
+          }
+        if(offset != denselayers[order[i]].inputLen())
+          {
+            cout << "ERROR: Inputs to Dense layer " << order[i] << " do not match its input length\n";
+            free(order);
+            free(done);
+            return false;
+          }
+      }
+    outLayer = edgelist[len - 1].dstIndex;
+
+    if((fp = fopen(filename, "w")) == NULL)
+      {
+        cout << "ERROR: Unable to open " << filename << " for writing\n";
+        free(order);
+        free(done);
+        return false;
+      }
+
+    fprintf(fp, "#ifndef __%s_NN_H\n#define __%s_NN_H\n\n", prefix, prefix);
+    fprintf(fp, "/**************************************************************************************************\n");
+    fprintf(fp, " Specialized network \"%s\", generated by NeuralNet::exportHeader()\n\n", comment);
+    fprintf(fp, " Layer sizes, activations and the edge schedule are compile-time constants and all weights are\n");
+    fprintf(fp, " constexpr arrays (masks already applied). Nothing here allocates.\n");
+    fprintf(fp, " Call %s::run(x, z) with x of length %s::INPUTS and z of length %s::OUTPUTS.\n", prefix, prefix, prefix);
+    fprintf(fp, "***************************************************************************************************/\n\n");
+    fprintf(fp, "#include <math.h>\n\n");
+    fprintf(fp, "namespace %s\n  {\n", prefix);
+    fprintf(fp, "    constexpr unsigned int INPUTS = %u;\n", inputs);
+    fprintf(fp, "    constexpr unsigned int OUTPUTS = %u;\n\n", denselayers[outLayer].outputLen());
+
+                                                                    //  Kernels shared by all layers
+    fprintf(fp, "    template<unsigned int N>\n");
+    fprintf(fp, "    inline void copy(const double* src, double* dst)\n      {\n");
+    fprintf(fp, "        for(unsigned int i = 0; i < N; i++)\n          dst[i] = src[i];\n      }\n\n");
+
+    fprintf(fp, "    template<unsigned int I, unsigned int N>\n");
+    fprintf(fp, "    inline void affine(const double* x, const double* W, double* z)\n      {\n");
+    fprintf(fp, "        for(unsigned int j = 0; j < N; j++)                         //  Bias row is last\n");
+    fprintf(fp, "          z[j] = W[I * N + j];\n");
+    fprintf(fp, "        for(unsigned int i = 0; i < I; i++)\n");
+    fprintf(fp, "          for(unsigned int j = 0; j < N; j++)\n");
+    fprintf(fp, "            z[j] += x[i] * W[i * N + j];\n      }\n\n");
+
+    fprintf(fp, "    inline double act(unsigned char f, double x, double a)\n      {\n");
+    fprintf(fp, "        switch(f)\n          {\n");
+    fprintf(fp, "            case %d: return (x > 0.0) ? x : 0.0;\n", RELU);
+    fprintf(fp, "            case %d: return (x > 0.0) ? x : x * a;\n", LEAKY_RELU);
+    fprintf(fp, "            case %d: return 1.0 / (1.0 + exp(-x * a));\n", SIGMOID);
+    fprintf(fp, "            case %d: return (2.0 / (1.0 + exp(-2.0 * x * a))) - 1.0;\n", HYPERBOLIC_TANGENT);
+    fprintf(fp, "            case %d: return exp(x);\n", SOFTMAX);
+    fprintf(fp, "            case %d: return (1.0 - exp(-x * a)) / (1.0 + exp(-x * a));\n", SYMMETRICAL_SIGMOID);
+    fprintf(fp, "            case %d: return (x > a) ? 1.0 : 0.0;\n", THRESHOLD);
+    fprintf(fp, "            default: return x * a;\n");
+    fprintf(fp, "          }\n      }\n\n");
+
+    fprintf(fp, "    template<unsigned int N, unsigned char F>                       //  Every unit shares activation F\n");
+    fprintf(fp, "    inline void activate(double* z, const double* a)\n      {\n");
+    fprintf(fp, "        double s = 0.0;\n");
+    fprintf(fp, "        for(unsigned int j = 0; j < N; j++)\n          z[j] = act(F, z[j], a[j]);\n");
+    fprintf(fp, "        if(F == %d)\n          {\n", SOFTMAX);
+    fprintf(fp, "            for(unsigned int j = 0; j < N; j++)\n              s += z[j];\n");
+    fprintf(fp, "            for(unsigned int j = 0; j < N; j++)\n              z[j] /= s;\n          }\n      }\n\n");
+
+    fprintf(fp, "    template<unsigned int N>                                        //  Units mix activations\n");
+    fprintf(fp, "    inline void activate(double* z, const unsigned char* f, const double* a)\n      {\n");
+    fprintf(fp, "        double s = 0.0;\n");
+    fprintf(fp, "        for(unsigned int j = 0; j < N; j++)\n          {\n");
+    fprintf(fp, "            z[j] = act(f[j], z[j], a[j]);\n");
+    fprintf(fp, "            if(f[j] == %d)\n              s += z[j];\n          }\n", SOFTMAX);
+    fprintf(fp, "        for(unsigned int j = 0; j < N; j++)\n          {\n");
+    fprintf(fp, "            if(f[j] == %d)\n              z[j] /= s;\n          }\n      }\n\n", SOFTMAX);
+
+    for(i = 0; i < orderLen; i++)                                   //  Constants and weights, one block per layer
+      {
+        l = order[i];
+        m = denselayers[l].inputLen();
+        fprintf(fp, "    /* Dense layer %u", l);
+        if(denselayers[l].name()[0] != '\0')
+          fprintf(fp, ", \"%s\"", denselayers[l].name());
+        fprintf(fp, " */\n");
+        fprintf(fp, "    constexpr unsigned int L%u_IN = %u;\n", l, m);
+        fprintf(fp, "    constexpr unsigned int L%u_OUT = %u;\n", l, denselayers[l].outputLen());
+        fprintf(fp, "    alignas(64) constexpr double L%u_W[(L%u_IN + 1) * L%u_OUT] =\n      {\n", l, l, l);
+        for(j = 0; j <= m; j++)
+          {
+            fprintf(fp, "        ");
+            for(k = 0; k < denselayers[l].outputLen(); k++)
+              {
+                fprintf(fp, "%.17g", denselayers[l].getM_ij(j, k) ? denselayers[l].getW_ij(j, k) : 0.0);
+                if(k < denselayers[l].outputLen() - 1)
+                  fprintf(fp, ", ");
+              }
+            fprintf(fp, (j < m) ? ",\n" : "\n");
+          }
+        fprintf(fp, "      };\n");
+        fprintf(fp, "    constexpr unsigned char L%u_F[L%u_OUT] = { ", l, l);
+        for(k = 0; k < denselayers[l].outputLen(); k++)
+          fprintf(fp, (k < denselayers[l].outputLen() - 1) ? "%u, " : "%u };\n", denselayers[l].getF_i(k));
+        fprintf(fp, "    constexpr double L%u_A[L%u_OUT] = { ", l, l);
+        for(k = 0; k < denselayers[l].outputLen(); k++)
+          fprintf(fp, (k < denselayers[l].outputLen() - 1) ? "%.17g, " : "%.17g };\n", denselayers[l].getA_i(k));
+        fprintf(fp, "\n");
+      }
+
+    fprintf(fp, "    inline unsigned int run(const double* x, double* z)\n      {\n");
+    for(i = 0; i < orderLen; i++)
+      fprintf(fp, "        double l%u[L%u_OUT];\n", order[i], order[i]);
+    for(i = 0; i < orderLen; i++)                                   //  The edge schedule, unrolled
+      {
+        l = order[i];
+        fprintf(fp, "\n          {\n");
+        fprintf(fp, "            double in[L%u_IN];\n", l);
+        offset = 0;
+        for(j = 0; j < len; j++)
+          {
+            if(edgelist[j].dstIndex == l)
+              {
+                k = edgelist[j].selectorEnd - edgelist[j].selectorStart;
+                if(edgelist[j].srcType == INPUT_ARRAY)
+                  fprintf(fp, "            copy<%u>(x + %u, in + %u);\n", k, edgelist[j].selectorStart, offset);
+                else
+                  fprintf(fp, "            copy<%u>(l%u + %u, in + %u);\n", k, edgelist[j].srcIndex, edgelist[j].selectorStart, offset);
+                offset += k;
+              }
+          }
+        fprintf(fp, "            affine<L%u_IN, L%u_OUT>(in, L%u_W, l%u);\n", l, l, l, l);
+
+        f = denselayers[l].getF_i(0);                               //  Pick the uniform kernel when every unit agrees
+        uniform = true;
+        for(k = 1; k < denselayers[l].outputLen() && uniform; k++)
+          uniform = (denselayers[l].getF_i(k) == f);
+        if(uniform)
+          fprintf(fp, "            activate<L%u_OUT, %u>(l%u, L%u_A);\n", l, f, l, l);
+        else
+          fprintf(fp, "            activate<L%u_OUT>(l%u, L%u_F, L%u_A);\n", l, l, l, l);
+        fprintf(fp, "          }\n");
+      }
+    fprintf(fp, "\n        copy<OUTPUTS>(l%u, z);\n", outLayer);
+    fprintf(fp, "        return OUTPUTS;\n      }\n  }\n\n#endif\n");
+
+    fclose(fp);
+    free(order);
+    free(done);
+
+    return true;
   }
 
 #endif
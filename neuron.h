@@ -7,19 +7,30 @@
  Note that this file does NOT seed the randomizer. That should be done by the parent program.
 ***************************************************************************************************/
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <limits.h>
+#include <mutex>
+#include <new>
+#include <thread>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "accum.h"                                                  /* Include Accumulator Layer library */
+#include "arena.h"                                                  /* Include contiguous parameter storage */
+#include "cache.h"                                                  /* Include result cache */
 #include "conv2d.h"                                                 /* Include 2D-Convolutional Layer library */
 #include "dense.h"                                                  /* Include Dense Layer library */
 #include "gru.h"                                                    /* Include GRU Layer library */
+#include "history.h"                                                /* Include shareable recurrent state */
 #include "lstm.h"                                                   /* Include LSTM Layer library */
 #include "normalization.h"                                          /* Include Normalization Layer library */
 #include "pooling.h"                                                /* Include Pooling Layer library */
+#include "population.h"                                             /* Include batched evaluation of many Dense genomes */
+#include "tiling.h"                                                 /* Include tiled execution of 2D layer chains */
 #include "upres.h"                                                  /* Include Up-Res (a.k.a. Transpose Convolution) Layer library */
 
 #define INPUT_ARRAY   0                                             /* Flag refers to network input */
@@ -69,6 +80,32 @@ typedef struct EdgeType
     unsigned int dstIndex;                                          //  Index into that array
   } Edge;
 
+typedef struct PruneReportType
+  {
+    unsigned int units;                                             //  Dense, LSTM and GRU units removed
+    unsigned int filters;                                           //  Conv2D filters removed
+    unsigned long long paramsBefore;                                //  See NeuralNet::params()
+    unsigned long long paramsAfter;
+    unsigned long long flopsBefore;                                 //  See NeuralNet::flops()
+    unsigned long long flopsAfter;
+  } PruneReport;
+
+typedef struct SequencePlanType                                     //  One runSequence() call, shared by its workers
+  {
+    double* X;                                                      //  The caller's (T x inputs) inputs
+    unsigned int T;                                                 //  Number of steps
+    unsigned int groups;                                            //  Groups of edges into one layer (see evaluate())
+    unsigned int* start;                                            //  First edge of each group
+    unsigned int* end;                                              //  One past the last edge of each group
+    unsigned int* width;                                            //  Output length of each group's layer
+    unsigned int* producer;                                         //  Per slot(): the group that writes that layer, or UINT_MAX
+    unsigned int* next;                                             //  Steps each group has finished
+    bool* running;                                                  //  Whether a worker is running a group's next step
+    double** in;                                                    //  Each group's input buffer
+    double** steps;                                                 //  (T + 1) x width: row 0 before the call, row t + 1 after step t
+    unsigned int finished;                                          //  Groups that have run all T steps
+  } SequencePlan;
+
 /**************************************************************************************************
  NeuralNet  */
 class NeuralNet
@@ -78,12 +115,34 @@ class NeuralNet
       ~NeuralNet();                                                 //  Destructor
 
       unsigned int run(double*, double**);
+      void reset();                                                 //  Clear recurrent state and incremental history
+      NetState* snapshot() const;                                   //  Save every recurrent layer's state (shares H)
+      void restore(const NetState*);                                //  Return every recurrent layer to a saved state
+      unsigned int runBatch(double*, unsigned int, double**);       //  Run B row-major inputs together
+      bool batchable() const;                                       //  Whether samples may be run together
+      unsigned int inputLen() const;
+      unsigned int factorize(double*, unsigned int, double);        //  Low-rank Dense layers, within a tolerance on samples
+      unsigned int prune(double*, unsigned int, double, PruneReport*);  //  Remove units and filters that matter little on samples
+      unsigned long long params() const;                            //  Stored parameters of all weighted layers
+      unsigned long long flops() const;                             //  Floating-point operations per run()
+      unsigned int runSequence(double*, unsigned int, double**);    //  Run T steps, layers overlapping in a wavefront
+      void setSequenceThreads(unsigned int);                        //  Threads for runSequence(), caller included (0 = all cores)
+                                                                    //  Run T steps forward here and backward in another net
+      unsigned int runBidirectional(NeuralNet*, double*, unsigned int, double**);
+      void setDelta(bool, double);                                  //  Toggle incremental inference, with tolerance
+      bool setCache(unsigned int);                                  //  Cache up to this many results (0 = no cache)
+      unsigned long long cacheHits() const;
+      unsigned long long cacheMisses() const;
+      unsigned long long partialRuns() const;                       //  Layer runs delta mode answered by an in-place update
       bool linkLayers(unsigned char, unsigned int, unsigned int, unsigned int, unsigned char, unsigned int);
       bool load(char*);
       bool write(char*);
+      bool exportHeader(char*, char*);                              //  Write a specialized, allocation-free C++ header
+      unsigned int pack();                                          //  Gather layer weights into one contiguous Arena
       void sortEdges();
       unsigned int nameIndex(char*);
       unsigned char nameType(char*);
+      double* outputOf(char*, unsigned int*);                       //  Latest output of a named layer, and its length
       void printEdgeList();
       void print();
       void printLayerName(unsigned char, unsigned int);
@@ -96,6 +155,16 @@ class NeuralNet
       unsigned int addPool(unsigned int, unsigned int);
       unsigned int addUpres(unsigned int, unsigned int);
       unsigned int addNormal(unsigned int);
+                                                                    //  Layers by index; adding another of the same kind
+      Dense* getDense(unsigned int) const;                          //  may move them, invalidating the pointer
+      Conv2D* getConv2D(unsigned int) const;
+      Accum* getAccum(unsigned int) const;
+      LSTM* getLSTM(unsigned int) const;
+      GRU* getGRU(unsigned int) const;
+      Pooling* getPool(unsigned int) const;
+      Upres* getUpres(unsigned int) const;
+      Normalization* getNormal(unsigned int) const;
+      void setComment(char*);
 
     private:
       unsigned int inputs;                                          //  Number of Network inputs
@@ -103,28 +172,28 @@ class NeuralNet
       Edge* edgelist;                                               //  Edge list
       unsigned int len;                                             //  Length of edge list
 
-      DenseLayer* denselayers;                                      //  Array of Dense Layers
+      Dense* denselayers;                                           //  Array of Dense Layers
       unsigned int denseLen;                                        //  Length of that array
 
-      Conv2DLayer* convlayers;                                      //  Array of Conv2D Layers
+      Conv2D* convlayers;                                           //  Array of Conv2D Layers
       unsigned int convLen;                                         //  Length of that array
 
-      AccumLayer* accumlayers;                                      //  Array of Accum Layers
+      Accum* accumlayers;                                           //  Array of Accum Layers
       unsigned int accumLen;                                        //  Length of that array
 
-      LSTMLayer* lstmlayers;                                        //  Array of LSTM Layers
+      LSTM* lstmlayers;                                             //  Array of LSTM Layers
       unsigned int lstmLen;                                         //  Length of that array
 
-      GRULayer* grulayers;                                          //  Array of GRU Layers
+      GRU* grulayers;                                               //  Array of GRU Layers
       unsigned int gruLen;                                          //  Length of that array
 
-      Pool2DLayer* poollayers;                                      //  Array of Pooling Layers
+      Pooling* poollayers;                                          //  Array of Pooling Layers
       unsigned int poolLen;                                         //  Length of that array
 
-      UpresLayer* upreslayers;                                      //  Array of Upres Layers
+      Upres* upreslayers;                                           //  Array of Upres Layers
       unsigned int upresLen;                                        //  Length of that array
 
-      NormalLayer* normlayers;                                      //  Array of Normal Layers
+      Normalization* normlayers;                                    //  Array of Normal Layers
       unsigned int normalLen;                                       //  Length of that array
 
       Variable* variables;                                          //  Array of Network Variables
@@ -133,6 +202,45 @@ class NeuralNet
       unsigned int gen;                                             //  Network generation/epoch
       double fit;                                                   //  Network fitness
       char comment[COMMSTR_LEN];                                    //  Network comment
+
+      bool delta;                                                   //  Whether run() is incremental (see setDelta())
+      double deltaTol;                                              //  Changes at or below this are ignored
+      bool* moved;                                                  //  Per layer: did its output move during this run()?
+      unsigned int movedLen;                                        //  Length of that array
+      double* buffer;                                               //  Scratch for assembling a layer's input
+      unsigned int bufferLen;                                       //  Length of that array
+
+      RunCache* cache;                                              //  Results of previous runs, or NULL
+      mutex evalLock;                                               //  With a cache, misses evaluate one at a time
+
+      Arena* arena;                                                 //  Packed Conv2D weights (see pack()), or NULL
+
+      thread* seqWorkers;                                           //  Persistent runSequence() workers, started on first use
+      unsigned int seqWorkerLen;                                    //  Length of that array
+      unsigned int seqThreads;                                      //  Most threads on one sequence, caller included; 0 = all cores
+      SequencePlan* seq;                                            //  The sequence being run, or NULL
+      mutex seqLock;                                                //  Guards 'seq' and 'seqStopping'
+      condition_variable seqReady;                                  //  A step finished, a sequence began, or stopping
+      bool seqStopping;
+
+      void clear();                                                 //  Destroy every layer and edge
+      unsigned int layerCount(unsigned char) const;                 //  Length of the array named by a flag
+      char* layerName(unsigned char, unsigned int) const;
+      unsigned int evaluate(double*, double**);                     //  Run the network itself, bypassing the cache
+      unsigned int slot(unsigned char, unsigned int) const;         //  Index into 'moved' for a layer
+      double* layerOutput(unsigned char, unsigned int) const;
+      unsigned int layerOutputLen(unsigned char, unsigned int) const;
+      void runLayer(unsigned char, unsigned int, double*);
+      bool shrinkable(unsigned char, unsigned int, unsigned int, unsigned int) const;
+      double outgoing(unsigned char, unsigned int, unsigned int, unsigned int, double*) const;
+      double** peaks(double*, unsigned int);                        //  Largest magnitude of every output on samples, per slot()
+      double inputPeak(unsigned char, unsigned int, double**) const;  //  Largest magnitude a layer's input reached
+      void removeOutputs(unsigned char, unsigned int, unsigned int, unsigned int, double);
+      unsigned int edgeBase(unsigned int) const;                    //  Where an edge's first element lands in its destination's input
+      unsigned int seqRunnable() const;                             //  A group whose next step may run now, or UINT_MAX
+      bool seqStep(unique_lock<mutex>&);                            //  Run one runnable step, if there is one
+      void seqServe();                                              //  Body of a sequence worker thread
+      void seqStop();                                               //  Stop and join the sequence workers
   };
 
 #endif  
\ No newline at end of file
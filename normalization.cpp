@@ -0,0 +1,199 @@
+#ifndef __NORMAL_CPP
+#define __NORMAL_CPP
+
+#include "normalization.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* An identity normalization until its parameters are set: m = 0, s = 1, g = 1, b = 0. */
+Normalization::Normalization(unsigned int inputs)
+  {
+    unsigned int i;
+
+    this->inputs = inputs;
+    m = 0.0;
+    s = 1.0;
+    g = 1.0;
+    b = 0.0;
+    if((out = (double*)calloc((inputs > 0) ? inputs : 1, sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Normalization layer's output array\n";
+        exit(1);
+      }
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+Normalization::~Normalization()
+  {
+    free(out);
+  }
+
+/**************************************************************************************************
+ Setters  */
+
+/*  */
+void Normalization::setM(double m)
+  {
+    this->m = m;
+    return;
+  }
+
+/* Set the standard deviation; zero is refused, since the layer divides by it. */
+void Normalization::setS(double s)
+  {
+    if(s != 0.0)
+      this->s = s;
+    return;
+  }
+
+/*  */
+void Normalization::setG(double g)
+  {
+    this->g = g;
+    return;
+  }
+
+/*  */
+void Normalization::setB(double b)
+  {
+    this->b = b;
+    return;
+  }
+
+/* Set the name of this layer. */
+void Normalization::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/*  */
+double Normalization::getM() const
+  {
+    return m;
+  }
+
+/*  */
+double Normalization::getS() const
+  {
+    return s;
+  }
+
+/*  */
+double Normalization::getG() const
+  {
+    return g;
+  }
+
+/*  */
+double Normalization::getB() const
+  {
+    return b;
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* Normalization::name() const
+  {
+    return (char*)layerName;
+  }
+
+/*  */
+void Normalization::print() const
+  {
+    printf("Input Length = %d\n", inputs);
+    printf("Mean = %f\n", m);
+    printf("Std.dev = %f\n", s);
+    printf("Coefficient = %f\n", g);
+    printf("Constant = %f\n", b);
+    return;
+  }
+
+/**************************************************************************************************
+ Run  */
+
+/*  */
+unsigned int Normalization::outputLen() const
+  {
+    return inputs;
+  }
+
+/*  */
+double* Normalization::output() const
+  {
+    return out;
+  }
+
+/* y = g * ((x - m) / s) + b, element by element. */
+unsigned int Normalization::run(double* x)
+  {
+    unsigned int i;
+
+    for(i = 0; i < inputs; i++)
+      out[i] = g * ((x[i] - m) / s) + b;
+
+    return inputs;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input length, the four parameters, then name.
+   Return false if writing fails. */
+bool Normalization::write(FILE* fp) const
+  {
+    bool ok = true;
+
+    ok = ok && fwrite(&inputs, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&m, sizeof(double), 1, fp) == 1;
+    ok = ok && fwrite(&s, sizeof(double), 1, fp) == 1;
+    ok = ok && fwrite(&g, sizeof(double), 1, fp) == 1;
+    ok = ok && fwrite(&b, sizeof(double), 1, fp) == 1;
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same input length.
+   Return false if reading fails, the length differs, or the stored deviation is 0. */
+bool Normalization::read(FILE* fp)
+  {
+    unsigned int in;
+    double v[4];
+    bool ok = true;
+
+    ok = ok && fread(&in, sizeof(int), 1, fp) == 1;
+    if(!ok || in != inputs)
+      {
+        cout << "ERROR: Stored Normalization layer does not match this layer's shape\n";
+        return false;
+      }
+    ok = ok && fread(v, sizeof(double), 4, fp) == 4;
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+    if(ok && v[1] == 0.0)
+      {
+        cout << "ERROR: Stored Normalization layer has zero deviation\n";
+        return false;
+      }
+    if(ok)
+      {
+        m = v[0];
+        s = v[1];
+        g = v[2];
+        b = v[3];
+      }
+
+    return ok;
+  }
+
+#endif
@@ -50,12 +50,19 @@ class Normalization
       void setS(double);
       void setG(double);
       void setB(double);
+      double getM() const;
+      double getS() const;
+      double getG() const;
+      double getB() const;
 
       void setName(char*);
       char* name() const;
       void print() const;
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
 
     private:
       unsigned int inputs;                                          //  Number of inputs--ACCUMULATORS GET NO bias-1
@@ -63,6 +70,8 @@ class Normalization
       double s;                                                     //  Sigma: the standard deviation learned during training
       double g;                                                     //  The factor learned during training
       double b;                                                     //  The constant learned during training
-      char name[LAYER_NAME_LEN];
+      char layerName[LAYER_NAME_LEN];
       double* out;
-  };
\ No newline at end of file
+  };
+
+#endif
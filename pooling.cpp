@@ -0,0 +1,403 @@
+#ifndef __POOLING_CPP
+#define __POOLING_CPP
+
+#include "pooling.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Input dimensions are width and height. */
+Pooling::Pooling(unsigned int w, unsigned int h)
+  {
+    unsigned int i;
+
+    inputW = w;
+    inputH = h;
+    pools = NULL;
+    n = 0;
+
+    out = NULL;
+    outlen = 0;
+    window = NULL;
+    windowLen = 0;
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+Pooling::~Pooling()
+  {
+    if(n > 0)
+      free(pools);
+    if(out != NULL)
+      free(out);
+    if(window != NULL)
+      free(window);
+  }
+
+/**************************************************************************************************
+ Pools  */
+
+/* Add a (w by h) MAX_POOL with unit strides. Return the number of pools in this layer. */
+unsigned int Pooling::addPool(unsigned int w, unsigned int h)
+  {
+    n++;
+    if((pools = (Pool2D*)realloc(pools, n * sizeof(Pool2D))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Pooling layer's pool array\n";
+        exit(1);
+      }
+
+    pools[n - 1].w = w;
+    pools[n - 1].h = h;
+    pools[n - 1].stride_h = 1;
+    pools[n - 1].stride_v = 1;
+    pools[n - 1].f = MAX_POOL;
+
+    return n;
+  }
+
+/* Set the width of the i-th pool. */
+void Pooling::setPoolWidth(unsigned int w, unsigned int i)
+  {
+    if(i < n && w > 0)
+      pools[i].w = w;
+    return;
+  }
+
+/* Set the height of the i-th pool. */
+void Pooling::setPoolHeight(unsigned int h, unsigned int i)
+  {
+    if(i < n && h > 0)
+      pools[i].h = h;
+    return;
+  }
+
+/* Set the horizontal stride of the i-th pool. */
+void Pooling::setPoolHorzStride(unsigned int stride, unsigned int i)
+  {
+    if(i < n && stride > 0)
+      pools[i].stride_h = stride;
+    return;
+  }
+
+/* Set the vertical stride of the i-th pool. */
+void Pooling::setPoolVertStride(unsigned int stride, unsigned int i)
+  {
+    if(i < n && stride > 0)
+      pools[i].stride_v = stride;
+    return;
+  }
+
+/* Set the function of the i-th pool, in {MAX_POOL, MIN_POOL, AVG_POOL, MEDIAN_POOL}. */
+void Pooling::setPoolFunc(unsigned char func, unsigned int i)
+  {
+    if(i < n && func <= MEDIAN_POOL)
+      pools[i].f = func;
+    return;
+  }
+
+/*  */
+void Pooling::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* Pooling::name() const
+  {
+    return (char*)layerName;
+  }
+
+/*  */
+void Pooling::print() const
+  {
+    unsigned int i;
+
+    printf("Input Shape = (%d, %d)\n", inputW, inputH);
+    for(i = 0; i < n; i++)
+      {
+        printf("Pool %d\n", i);
+        printf("  Shape  = (%d, %d)\n", pools[i].w, pools[i].h);
+        printf("  Stride = (%d, %d)\n", pools[i].stride_h, pools[i].stride_v);
+        printf("  Func   = ");
+        switch(pools[i].f)
+          {
+            case MAX_POOL:     printf("max");     break;
+            case MIN_POOL:     printf("min");     break;
+            case AVG_POOL:     printf("avg");     break;
+            case MEDIAN_POOL:  printf("median");  break;
+          }
+        printf("\n");
+      }
+    return;
+  }
+
+/*  */
+unsigned int Pooling::poolCount() const
+  {
+    return n;
+  }
+
+/*  */
+unsigned int Pooling::inputWidth() const
+  {
+    return inputW;
+  }
+
+/*  */
+unsigned int Pooling::inputHeight() const
+  {
+    return inputH;
+  }
+
+/*  */
+unsigned int Pooling::outputWidth(unsigned int i) const
+  {
+    return (inputW - pools[i].w) / pools[i].stride_h + 1;
+  }
+
+/*  */
+unsigned int Pooling::outputHeight(unsigned int i) const
+  {
+    return (inputH - pools[i].h) / pools[i].stride_v + 1;
+  }
+
+/*  */
+double* Pooling::output() const
+  {
+    return out;
+  }
+
+/* Sum of the areas of every pool's output. */
+unsigned int Pooling::outputLen() const
+  {
+    unsigned int i;
+    unsigned int len = 0;
+
+    for(i = 0; i < n; i++)
+      len += outputWidth(i) * outputHeight(i);
+
+    return len;
+  }
+
+/**************************************************************************************************
+ Run layer  */
+
+/* Pool the (inputW * inputH) row-major input 'x' with every pool, concatenating the results in 'out'. */
+unsigned int Pooling::run(double* x)
+  {
+    unsigned int i;
+    unsigned int offset = 0;
+
+    if(out == NULL || outlen != outputLen())
+      {
+        outlen = outputLen();
+        if((out = (double*)realloc(out, outlen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Pooling layer's output buffer\n";
+            exit(1);
+          }
+      }
+
+    for(i = 0; i < n; i++)
+      {
+        runRegion(i, x, 0, 0, inputW, 0, 0, outputWidth(i), outputHeight(i), out + offset);
+        offset += outputWidth(i) * outputHeight(i);
+      }
+
+    return outlen;
+  }
+
+/* Write to 'rect' = { x0, y0, x1, y1 } the region of the input (right and bottom bounds excluded) that the i-th
+   pool reads to produce output columns [x0, x1) and rows [y0, y1). */
+void Pooling::inputRegion(unsigned int i, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+                          unsigned int* rect) const
+  {
+    rect[0] = x0 * pools[i].stride_h;
+    rect[1] = y0 * pools[i].stride_v;
+    rect[2] = (x1 - 1) * pools[i].stride_h + pools[i].w;
+    rect[3] = (y1 - 1) * pools[i].stride_v + pools[i].h;
+    return;
+  }
+
+/* Compute output columns [x0, x1) and rows [y0, y1) of the i-th pool into 'dst', row-major and (x1 - x0) wide.
+   'in' holds a region of the input whose top-left corner is (inX, inY) and whose rows are 'inW' long;
+   it must cover at least what inputRegion() reports. */
+void Pooling::runRegion(unsigned int i, double* in, unsigned int inX, unsigned int inY, unsigned int inW,
+                        unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, double* dst)
+  {
+    unsigned int x, y, r, c, k;
+    const Pool2D* p = pools + i;
+    const double* src;
+    double s;
+
+    if(p->f == MEDIAN_POOL && windowLen < p->w * p->h)
+      {
+        windowLen = p->w * p->h;
+        if((window = (double*)realloc(window, windowLen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Pooling layer's median buffer\n";
+            exit(1);
+          }
+      }
+
+    for(y = y0; y < y1; y++)
+      {
+        for(x = x0; x < x1; x++)
+          {
+            src = in + (y * p->stride_v - inY) * inW + (x * p->stride_h - inX);
+            switch(p->f)
+              {
+                case MAX_POOL:    s = src[0];
+                                  for(r = 0; r < p->h; r++)
+                                    for(c = 0; c < p->w; c++)
+                                      if(src[r * inW + c] > s)
+                                        s = src[r * inW + c];
+                                  break;
+                case MIN_POOL:    s = src[0];
+                                  for(r = 0; r < p->h; r++)
+                                    for(c = 0; c < p->w; c++)
+                                      if(src[r * inW + c] < s)
+                                        s = src[r * inW + c];
+                                  break;
+                case AVG_POOL:    s = 0.0;
+                                  for(r = 0; r < p->h; r++)
+                                    for(c = 0; c < p->w; c++)
+                                      s += src[r * inW + c];
+                                  s /= (double)(p->w * p->h);
+                                  break;
+                default:          k = 0;
+                                  for(r = 0; r < p->h; r++)
+                                    for(c = 0; c < p->w; c++)
+                                      window[k++] = src[r * inW + c];
+                                  pooling_quicksort(false, &window, 0, k - 1);
+                                  if(k % 2 == 1)
+                                    s = window[k / 2];
+                                  else
+                                    s = (window[k / 2 - 1] + window[k / 2]) * 0.5;
+                                  break;
+              }
+            dst[(y - y0) * (x1 - x0) + (x - x0)] = s;
+          }
+      }
+
+    return;
+  }
+
+/**************************************************************************************************
+ Sorting  */
+
+/* Sort (*a)[lo] through (*a)[hi], inclusive; descending if 'desc'. */
+void Pooling::pooling_quicksort(bool desc, double** a, unsigned int lo, unsigned int hi)
+  {
+    unsigned int p;
+
+    if(lo < hi)
+      {
+        p = pooling_partition(desc, a, lo, hi);
+        if(p > lo)
+          pooling_quicksort(desc, a, lo, p - 1);
+        pooling_quicksort(desc, a, p + 1, hi);
+      }
+    return;
+  }
+
+/* Lomuto partition around (*a)[hi]. Return the pivot's final index. */
+unsigned int Pooling::pooling_partition(bool desc, double** a, unsigned int lo, unsigned int hi)
+  {
+    double pivot = (*a)[hi];
+    double tmp;
+    unsigned int i = lo;
+    unsigned int j;
+
+    for(j = lo; j < hi; j++)
+      {
+        if((!desc && (*a)[j] < pivot) || (desc && (*a)[j] > pivot))
+          {
+            tmp = (*a)[i];
+            (*a)[i] = (*a)[j];
+            (*a)[j] = tmp;
+            i++;
+          }
+      }
+    tmp = (*a)[i];
+    (*a)[i] = (*a)[hi];
+    (*a)[hi] = tmp;
+
+    return i;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input dimensions, number of pools, each pool's shape, strides and
+   function, then name. Return false if writing fails. */
+bool Pooling::write(FILE* fp) const
+  {
+    unsigned int i;
+    bool ok = true;
+
+    ok = ok && fwrite(&inputW, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&inputH, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&n, sizeof(int), 1, fp) == 1;
+    for(i = 0; i < n && ok; i++)
+      {
+        ok = ok && fwrite(&pools[i].w, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&pools[i].h, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&pools[i].stride_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&pools[i].stride_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&pools[i].f, sizeof(char), 1, fp) == 1;
+      }
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same input dimensions and no pools yet.
+   Return false if reading fails or the layer does not fit. */
+bool Pooling::read(FILE* fp)
+  {
+    unsigned int i;
+    unsigned int w, h, count;
+    Pool2D p;
+    bool ok = true;
+
+    ok = ok && fread(&w, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&h, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&count, sizeof(int), 1, fp) == 1;
+    if(!ok || w != inputW || h != inputH || n > 0)
+      {
+        cout << "ERROR: Stored Pooling layer does not match this layer\n";
+        return false;
+      }
+    for(i = 0; i < count && ok; i++)
+      {
+        ok = ok && fread(&p.w, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.h, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.stride_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.stride_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.f, sizeof(char), 1, fp) == 1;
+        if(ok)
+          {
+            addPool(p.w, p.h);
+            setPoolHorzStride(p.stride_h, i);
+            setPoolVertStride(p.stride_v, i);
+            setPoolFunc(p.f, i);
+          }
+      }
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+
+    return ok;
+  }
+
+#endif
@@ -21,6 +21,8 @@
  [ x51 x52 x53 x54 ]
 
  Pools needn't be arranged from smallest to largest or in any order.
+ Pools are not padded, so the i-th pool's output is ((inputW - w_i) / stride_h_i + 1) wide and
+ ((inputH - h_i) / stride_v_i + 1) tall. Pool outputs are concatenated in 'out' in the order the pools were added.
 
  Note that this file does NOT seed the randomizer. That should be done by the parent program.
 ***************************************************************************************************/
@@ -73,8 +75,21 @@ class Pooling
       void setName(char*);
       char* name() const;
       void print() const;
+      unsigned int poolCount() const;
+      unsigned int inputWidth() const;
+      unsigned int inputHeight() const;
+      unsigned int outputWidth(unsigned int) const;                 //  Width of the i-th pool's output
+      unsigned int outputHeight(unsigned int) const;                //  Height of the i-th pool's output
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
+                                                                    //  Region of the input needed for a region of the i-th output
+      void inputRegion(unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int*) const;
+                                                                    //  Compute a region of the i-th output from a region of the input
+      void runRegion(unsigned int, double*, unsigned int, unsigned int, unsigned int,
+                     unsigned int, unsigned int, unsigned int, unsigned int, double*);
 
     private:
       unsigned int inputW;                                          //  Dimensions of the input
@@ -82,10 +97,12 @@ class Pooling
       Pool2D* pools;                                                //  Array of Pool2Ds
       unsigned int n;                                               //  Length of that array
 
-      double* out;
+      double* out;                                                  //  Allocated by the first full run()
       unsigned int outlen;                                          //  Length of the output buffer
+      double* window;                                               //  Scratch for MEDIAN_POOL
+      unsigned int windowLen;                                       //  Length of that buffer
 
-      char name[LAYER_NAME_LEN];
+      char layerName[LAYER_NAME_LEN];
 
       void pooling_quicksort(bool, double**, unsigned int, unsigned int);
       unsigned int pooling_partition(bool, double**, unsigned int, unsigned int);
@@ -0,0 +1,555 @@
+#ifndef __POPULATION_CPP
+#define __POPULATION_CPP
+
+#include "population.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* A population of 'genomes' networks taking 'inputs' inputs. Work is split among 'threads' worker threads;
+   0 means one per hardware thread. Layers are added with addDense(). */
+Population::Population(unsigned int inputs, unsigned int genomes, unsigned int threads)
+  {
+    unsigned int i;
+
+    this->inputs = inputs;
+    N = (genomes > 0) ? genomes : 1;
+    if(threads == 0)
+      threads = thread::hardware_concurrency();
+    this->threads = (threads > 0) ? threads : 1;
+    if(this->threads > N)
+      this->threads = N;
+
+    len = 0;
+    nodes = NULL;
+    W = NULL;
+    f = NULL;
+    alpha = NULL;
+    A = NULL;
+    gen = 0;
+
+    if((fit = (double*)malloc(N * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Population's fitness array\n";
+        exit(1);
+      }
+    for(i = 0; i < N; i++)
+      fit[i] = 0.0;
+
+    if((rng = (PopulationRNG*)malloc(this->threads * sizeof(PopulationRNG))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Population's random number generators\n";
+        exit(1);
+      }
+    for(i = 0; i < this->threads; i++)                              //  Seed each generator from rand(); never all-zero
+      {
+        rng[i].s[0] = ((unsigned long long)rand() << 32) ^ (unsigned long long)rand() ^ 0x9E3779B97F4A7C15ULL;
+        rng[i].s[1] = ((unsigned long long)rand() << 32) ^ (unsigned long long)rand() ^ ((unsigned long long)(i + 1) << 1);
+      }
+  }
+
+Population::~Population()
+  {
+    unsigned int i;
+
+    for(i = 0; i < len; i++)
+      {
+        free(f[i]);
+        free(alpha[i]);
+      }
+    if(len > 0)
+      {
+        free(nodes);
+        free(f);
+        free(alpha);
+        delete[] W;
+        delete[] A;
+      }
+    free(fit);
+    free(rng);
+  }
+
+/**************************************************************************************************
+ Topology  */
+
+/* Append a Dense layer of 'n' units, fed by the previous layer (or by the input, if this is the first).
+   Every genome gets random weights in [-1.0, 1.0]; every unit starts as ReLU with parameter 1.0.
+   Return the index of the new layer. */
+unsigned int Population::addDense(unsigned int n)
+  {
+    unsigned int i, j;
+    unsigned int in = (len == 0) ? inputs : nodes[len - 1];
+    MatrixXd* tmpW;
+    MatrixXd* tmpA;
+
+    tmpW = new MatrixXd[len + 1];                                   //  Eigen matrices cannot be realloc'd; move them
+    tmpA = new MatrixXd[len + 1];
+    for(i = 0; i < len; i++)
+      {
+        tmpW[i].swap(W[i]);
+        tmpA[i].swap(A[i]);
+      }
+    if(len > 0)
+      {
+        delete[] W;
+        delete[] A;
+      }
+    W = tmpW;
+    A = tmpA;
+
+    len++;
+    if((nodes = (unsigned int*)realloc(nodes, len * sizeof(int))) == NULL ||
+       (f = (unsigned char**)realloc(f, len * sizeof(unsigned char*))) == NULL ||
+       (alpha = (double**)realloc(alpha, len * sizeof(double*))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Population's layer arrays\n";
+        exit(1);
+      }
+    nodes[len - 1] = n;
+    if((f[len - 1] = (unsigned char*)malloc(n * sizeof(char))) == NULL ||
+       (alpha[len - 1] = (double*)malloc(n * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Population's activation arrays\n";
+        exit(1);
+      }
+    for(i = 0; i < n; i++)                                          //  Default all to ReLU with parameter = 1.0
+      {
+        f[len - 1][i] = RELU;
+        alpha[len - 1][i] = 1.0;
+      }
+
+    W[len - 1].resize(in + 1, n * N);
+    for(j = 0; j < n * N; j++)                                      //  Generate random numbers in [ -1.0, 1.0 ]
+      for(i = 0; i <= in; i++)
+        W[len - 1](i, j) = -1.0 + ((double)rand() / ((double)RAND_MAX * 0.5));
+
+    return len - 1;
+  }
+
+/* Set the activation function of the i-th unit of layer l, for every genome. */
+void Population::setF_i(unsigned char func, unsigned int l, unsigned int i)
+  {
+    if(l < len && i < nodes[l] && func <= LINEAR)
+      f[l][i] = func;
+    return;
+  }
+
+/* Set the activation function parameter of the i-th unit of layer l, for every genome. */
+void Population::setA_i(double a, unsigned int l, unsigned int i)
+  {
+    if(l < len && i < nodes[l])
+      alpha[l][i] = a;
+    return;
+  }
+
+/**************************************************************************************************
+ Fitness  */
+
+/*  */
+unsigned int Population::size() const
+  {
+    return N;
+  }
+
+/*  */
+unsigned int Population::outputLen() const
+  {
+    return (len > 0) ? nodes[len - 1] : 0;
+  }
+
+/*  */
+unsigned int Population::generation() const
+  {
+    return gen;
+  }
+
+/*  */
+void Population::setFitness(double fitness, unsigned int g)
+  {
+    if(g < N)
+      fit[g] = fitness;
+    return;
+  }
+
+/*  */
+double Population::fitness(unsigned int g) const
+  {
+    return (g < N) ? fit[g] : 0.0;
+  }
+
+/*  */
+unsigned int Population::best() const
+  {
+    unsigned int g, b = 0;
+
+    for(g = 1; g < N; g++)
+      {
+        if(fit[g] > fit[b])
+          b = g;
+      }
+
+    return b;
+  }
+
+/**************************************************************************************************
+ Evaluation  */
+
+/* Run B samples through every genome. 'X' is (B x inputs), row-major. 'Z' receives (N x B x outputLen()):
+   the output of genome g for sample b begins at Z[(g * B + b) * outputLen()]. */
+void Population::evaluate(double* X, unsigned int B, double* Z)
+  {
+    unsigned int l, t, g, b, k;
+    unsigned int g0, g1;
+    unsigned int out;
+    thread* workers;
+
+    if(len == 0 || B == 0)
+      return;
+
+    for(l = 0; l < len; l++)
+      {
+        if(A[l].rows() != B)
+          A[l].resize(B, nodes[l] * N);
+      }
+
+    if(threads == 1)
+      evaluateRange(X, B, 0, N);
+    else
+      {
+        workers = new thread[threads];
+        for(t = 0; t < threads; t++)                                //  Contiguous runs of genomes per thread
+          {
+            g0 = (unsigned int)(((unsigned long long)N * t) / threads);
+            g1 = (unsigned int)(((unsigned long long)N * (t + 1)) / threads);
+            workers[t] = thread(&Population::evaluateRange, this, X, B, g0, g1);
+          }
+        for(t = 0; t < threads; t++)
+          workers[t].join();
+        delete[] workers;
+      }
+
+    out = nodes[len - 1];
+    for(g = 0; g < N; g++)
+      for(b = 0; b < B; b++)
+        for(k = 0; k < out; k++)
+          Z[(g * B + b) * out + k] = A[len - 1](b, g * out + k);
+
+    return;
+  }
+
+/* Evaluate genomes [g0, g1) on the B samples in 'X'. Threads touch disjoint column ranges of every 'A'. */
+void Population::evaluateRange(double* X, unsigned int B, unsigned int g0, unsigned int g1)
+  {
+    unsigned int l, g;
+    unsigned int n, np;
+    Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> > Xm(X, B, inputs);
+
+    if(g0 >= g1)
+      return;
+
+    n = nodes[0];                                                   //  Shared input: one product for the whole slice
+    A[0].middleCols(g0 * n, (g1 - g0) * n).noalias() = Xm * W[0].topRows(inputs).middleCols(g0 * n, (g1 - g0) * n);
+    A[0].middleCols(g0 * n, (g1 - g0) * n).rowwise() += W[0].row(inputs).segment(g0 * n, (g1 - g0) * n);
+    activate(0, g0, g1);
+
+    for(l = 1; l < len; l++)                                        //  Per-genome inputs: one product per genome
+      {
+        n = nodes[l];
+        np = nodes[l - 1];
+        for(g = g0; g < g1; g++)
+          {
+            A[l].middleCols(g * n, n).noalias() = A[l - 1].middleCols(g * np, np) * W[l].block(0, g * n, np, n);
+            A[l].middleCols(g * n, n).rowwise() += W[l].row(np).segment(g * n, n);
+          }
+        activate(l, g0, g1);
+      }
+
+    return;
+  }
+
+/* Apply layer l's activation functions to genomes [g0, g1) in A[l]. SOFTMAX normalizes, per sample and per genome,
+   over that genome's SOFTMAX units. */
+void Population::activate(unsigned int l, unsigned int g0, unsigned int g1)
+  {
+    unsigned int g, j;
+    unsigned int n = nodes[l];
+    bool soft = false;
+    double a;
+    VectorXd s;
+
+    for(g = g0; g < g1; g++)
+      {
+        for(j = 0; j < n; j++)
+          {
+            Eigen::Ref<VectorXd> c = A[l].col(g * n + j);
+            a = alpha[l][j];
+            switch(f[l][j])
+              {
+                case RELU:                c = c.cwiseMax(0.0);                                              break;
+                case LEAKY_RELU:          c = (c.array() > 0.0).select(c, c * a);                           break;
+                case SIGMOID:             c = (1.0 + (-a * c).array().exp()).inverse().matrix();            break;
+                case HYPERBOLIC_TANGENT:  c = ((2.0 / (1.0 + (-2.0 * a * c).array().exp())) - 1.0).matrix();  break;
+                case SOFTMAX:             c = c.array().exp().matrix();
+                                          soft = true;                                                      break;
+                case SYMMETRICAL_SIGMOID: c = ((1.0 - (-a * c).array().exp()) / (1.0 + (-a * c).array().exp())).matrix();
+                                                                                                            break;
+                case THRESHOLD:           c = (c.array() > a).cast<double>().matrix();                      break;
+                default:                  c *= a;                                                           break;
+              }
+          }
+        if(soft)
+          {
+            s = VectorXd::Zero(A[l].rows());
+            for(j = 0; j < n; j++)
+              {
+                if(f[l][j] == SOFTMAX)
+                  s += A[l].col(g * n + j);
+              }
+            for(j = 0; j < n; j++)
+              {
+                if(f[l][j] == SOFTMAX)
+                  A[l].col(g * n + j).array() /= s.array();
+              }
+          }
+      }
+
+    return;
+  }
+
+/**************************************************************************************************
+ Variation  */
+
+/* With probability 'rate' per weight, add uniform noise in [-sigma, sigma] to the g-th genome. */
+void Population::mutate(unsigned int g, double rate, double sigma)
+  {
+    if(g < N)
+      mutateWith(rng, g, rate, sigma);
+    return;
+  }
+
+/* Overwrite genome 'child' with a uniform crossover of genomes 'a' and 'b': each weight comes from either parent
+   with equal probability. 'child' may be one of the parents. */
+void Population::crossover(unsigned int child, unsigned int a, unsigned int b)
+  {
+    if(child < N && a < N && b < N)
+      crossoverWith(rng, child, a, b);
+    return;
+  }
+
+typedef struct PopulationRankType                                   //  For sorting genomes by fitness
+  {
+    double fit;
+    unsigned int index;
+  } PopulationRank;
+
+/* Sort descending by fitness. */
+static int population_rank_cmp(const void* a, const void* b)
+  {
+    double fa = ((const PopulationRank*)a)->fit;
+    double fb = ((const PopulationRank*)b)->fit;
+    return (fa < fb) ? 1 : ((fa > fb) ? -1 : 0);
+  }
+
+/* Keep the 'elites' fittest genomes as they are. Replace every other genome, in place, with a crossover of two
+   elites chosen at random, then mutate it with 'rate' and 'sigma'. Offspring are bred in parallel, each thread
+   with its own generator. Advances the generation counter. */
+void Population::evolve(unsigned int elites, double rate, double sigma)
+  {
+    unsigned int t, g;
+    unsigned int r0, r1;
+    PopulationRank* rank;
+    thread* workers;
+
+    if(elites == 0)
+      elites = 1;
+    if(elites >= N)
+      {
+        gen++;
+        return;
+      }
+
+    if((rank = (PopulationRank*)malloc(N * sizeof(PopulationRank))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Population's ranking array\n";
+        exit(1);
+      }
+    for(g = 0; g < N; g++)
+      {
+        rank[g].fit = fit[g];
+        rank[g].index = g;
+      }
+    qsort(rank, N, sizeof(PopulationRank), population_rank_cmp);
+
+    workers = new thread[threads];
+    for(t = 0; t < threads; t++)                                    //  Losers are rank[elites] through rank[N - 1]
+      {
+        r0 = elites + (unsigned int)(((unsigned long long)(N - elites) * t) / threads);
+        r1 = elites + (unsigned int)(((unsigned long long)(N - elites) * (t + 1)) / threads);
+        workers[t] = thread([this, rank, elites, rate, sigma, t, r0, r1]()
+          {
+            unsigned int r;
+            for(r = r0; r < r1; r++)
+              {
+                crossoverWith(rng + t, rank[r].index, rank[next(rng + t) % elites].index, rank[next(rng + t) % elites].index);
+                mutateWith(rng + t, rank[r].index, rate, sigma);
+              }
+          });
+      }
+    for(t = 0; t < threads; t++)
+      workers[t].join();
+    delete[] workers;
+
+    free(rank);
+    gen++;
+    return;
+  }
+
+/* Mutate the g-th genome using generator 'r'. Each layer's block is contiguous, and the update is branch-free. */
+void Population::mutateWith(PopulationRNG* r, unsigned int g, double rate, double sigma)
+  {
+    unsigned int l, k;
+    unsigned int blockLen;
+    double* w;
+    double u, v;
+
+    for(l = 0; l < len; l++)
+      {
+        blockLen = layerInputs(l) + 1;
+        blockLen *= nodes[l];
+        w = W[l].data() + (unsigned long long)g * blockLen;
+        for(k = 0; k < blockLen; k++)
+          {
+            u = uniform(r);
+            v = uniform(r);
+            w[k] += (double)(u < rate) * sigma * (2.0 * v - 1.0);
+          }
+      }
+
+    return;
+  }
+
+/* Crossover into genome 'child' using generator 'r'. One 64-bit draw picks the parent for 64 weights. */
+void Population::crossoverWith(PopulationRNG* r, unsigned int child, unsigned int a, unsigned int b)
+  {
+    unsigned int l, k;
+    unsigned int blockLen;
+    unsigned long long bits = 0;
+    double* c;
+    double* pa;
+    double* pb;
+
+    for(l = 0; l < len; l++)
+      {
+        blockLen = layerInputs(l) + 1;
+        blockLen *= nodes[l];
+        c = W[l].data() + (unsigned long long)child * blockLen;
+        pa = W[l].data() + (unsigned long long)a * blockLen;
+        pb = W[l].data() + (unsigned long long)b * blockLen;
+        for(k = 0; k < blockLen; k++)
+          {
+            if((k & 63) == 0)
+              bits = next(r);
+            c[k] = pa[k] + (double)((bits >> (k & 63)) & 1) * (pb[k] - pa[k]);
+          }
+      }
+
+    return;
+  }
+
+/**************************************************************************************************
+ Export  */
+
+/* Write the g-th genome's layer l, weights and activations, into Dense layer 'd', which must have matching shape. */
+void Population::copyToDense(unsigned int g, unsigned int l, Dense* d) const
+  {
+    unsigned int i, j;
+    unsigned int in;
+    double* w;
+
+    if(g >= N || l >= len)
+      return;
+    in = layerInputs(l);
+    if(d->inputLen() != in || d->outputLen() != nodes[l])
+      {
+        cout << "ERROR: Dense layer shape does not match Population layer " << l << "\n";
+        return;
+      }
+
+    if((w = (double*)malloc((in + 1) * nodes[l] * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate weight transfer array\n";
+        exit(1);
+      }
+    for(i = 0; i <= in; i++)                                        //  Dense::setW() takes row-major, biases last
+      for(j = 0; j < nodes[l]; j++)
+        w[i * nodes[l] + j] = W[l](i, g * nodes[l] + j);
+    d->setW(w);
+    free(w);
+
+    for(j = 0; j < nodes[l]; j++)
+      {
+        d->setF_i(f[l][j], j);
+        d->setA_i(alpha[l][j], j);
+      }
+
+    return;
+  }
+
+/* Read the g-th genome's layer l from Dense layer 'd', which must have matching shape. Masked weights are taken as
+   zero. Activations are shared by all genomes, so the layer's activations become d's for every genome. */
+void Population::copyFromDense(unsigned int g, unsigned int l, Dense* d)
+  {
+    unsigned int i, j;
+    unsigned int in;
+
+    if(g >= N || l >= len)
+      return;
+    in = layerInputs(l);
+    if(d->inputLen() != in || d->outputLen() != nodes[l])
+      {
+        cout << "ERROR: Dense layer shape does not match Population layer " << l << "\n";
+        return;
+      }
+
+    for(i = 0; i <= in; i++)                                        //  Bias row last, never masked
+      for(j = 0; j < nodes[l]; j++)
+        W[l](i, g * nodes[l] + j) = (i == in || d->getM_ij(i, j)) ? d->getW_ij(i, j) : 0.0;
+
+    for(j = 0; j < nodes[l]; j++)
+      {
+        f[l][j] = d->getF_i(j);
+        alpha[l][j] = d->getA_i(j);
+      }
+
+    return;
+  }
+
+/**************************************************************************************************
+ Random numbers  */
+
+/* Number of inputs to layer l, NOT counting the bias-1. */
+unsigned int Population::layerInputs(unsigned int l) const
+  {
+    return (l == 0) ? inputs : nodes[l - 1];
+  }
+
+/* xorshift128+ */
+unsigned long long Population::next(PopulationRNG* r)
+  {
+    unsigned long long s1 = r->s[0];
+    const unsigned long long s0 = r->s[1];
+
+    r->s[0] = s0;
+    s1 ^= s1 << 23;
+    r->s[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+
+    return r->s[1] + s0;
+  }
+
+/* Uniform in [0.0, 1.0), from the top 53 bits. */
+double Population::uniform(PopulationRNG* r)
+  {
+    return (double)(next(r) >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef __POPULATION_H
+#define __POPULATION_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ A Population holds N genomes that share one topology: a stack of Dense layers. It does not hold N NeuralNets.
+ Each layer's weights for all genomes live side by side in one matrix, genome g in columns [g * n, (g + 1) * n):
+
+          genome 0        genome 1            genome N-1
+ [ w11 w12 w13 | w11 w12 w13 | ... | w11 w12 w13 ]   (i + 1) rows: i inputs plus the bias row,
+ [ w21 w22 w23 | w21 w22 w23 | ... | w21 w22 w23 ]   n = units in this layer
+ [  b1  b2  b3 |  b1  b2  b3 | ... |  b1  b2  b3 ]
+
+ Eigen stores matrices column-major, so each genome's block is contiguous and each layer is one slab.
+ Activation functions and their parameters belong to the topology, so all genomes share them.
+
+ evaluate() runs a batch of B samples through every genome. Genomes are split among worker threads, and each
+ thread evaluates its genomes' slice of a layer as one matrix product. The first layer's input is the same for
+ every genome, so it is a single (B by i + 1) x (i + 1 by n * genomes-in-slice) product.
+
+ Mutation and crossover work in place on the slabs. Each worker thread has its own xorshift128+ generator,
+ seeded from rand() when the Population is built, so no thread touches the global rand() state.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <iostream>
+#include <Eigen/Dense>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "dense.h"
+
+/*
+#define __POPULATION_DEBUG 1
+*/
+
+using Eigen::MatrixXd;
+using Eigen::VectorXd;
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct PopulationRNGType                                    //  xorshift128+ state, one per worker thread
+  {
+    unsigned long long s[2];
+  } PopulationRNG;
+
+/**************************************************************************************************
+ Population  */
+class Population
+  {
+    public:
+      Population(unsigned int, unsigned int, unsigned int);         //  Constructor(s): inputs, genomes, threads (0 = all cores)
+      ~Population();                                                //  Destructor
+
+      unsigned int addDense(unsigned int);                          //  Append a layer of n units to the shared topology
+      void setF_i(unsigned char, unsigned int, unsigned int);       //  Set activation function of layer l's i-th unit
+      void setA_i(double, unsigned int, unsigned int);              //  Set activation parameter of layer l's i-th unit
+
+      unsigned int size() const;                                    //  Number of genomes
+      unsigned int outputLen() const;                               //  Outputs per genome per sample
+      unsigned int generation() const;
+      void setFitness(double, unsigned int);                        //  Set fitness of the g-th genome
+      double fitness(unsigned int) const;
+      unsigned int best() const;                                    //  Index of the fittest genome
+
+      void evaluate(double*, unsigned int, double*);                //  Run B samples through every genome
+      void mutate(unsigned int, double, double);                    //  Perturb the g-th genome in place
+      void crossover(unsigned int, unsigned int, unsigned int);     //  Overwrite a child with a uniform mix of two parents
+      void evolve(unsigned int, double, double);                    //  Replace all but the fittest with mutated offspring
+      void copyToDense(unsigned int, unsigned int, Dense*) const;   //  Write the g-th genome's layer l into a Dense layer
+      void copyFromDense(unsigned int, unsigned int, Dense*);       //  Read the g-th genome's layer l from a Dense layer
+
+    private:
+      unsigned int inputs;                                          //  Number of inputs--NOT COUNTING the added bias-1
+      unsigned int N;                                               //  Number of genomes
+      unsigned int threads;                                         //  Number of worker threads
+
+      unsigned int len;                                             //  Number of layers
+      unsigned int* nodes;                                          //  Units in each layer, len-array
+      MatrixXd* W;                                                  //  Each layer's ((i + 1) x (n * N)) weight slab, len-array
+      unsigned char** f;                                            //  Each layer's n activation flags, len-array
+      double** alpha;                                               //  Each layer's n activation parameters, len-array
+      MatrixXd* A;                                                  //  Each layer's (B x (n * N)) activations, len-array
+
+      double* fit;                                                  //  Fitness of each genome, N-array
+      unsigned int gen;                                             //  Generation
+      PopulationRNG* rng;                                           //  One generator per thread, threads-array
+
+      unsigned int layerInputs(unsigned int) const;
+      void evaluateRange(double*, unsigned int, unsigned int, unsigned int);
+      void activate(unsigned int, unsigned int, unsigned int);
+      void mutateWith(PopulationRNG*, unsigned int, double, double);
+      void crossoverWith(PopulationRNG*, unsigned int, unsigned int, unsigned int);
+      static unsigned long long next(PopulationRNG*);
+      static double uniform(PopulationRNG*);
+  };
+
+#endif
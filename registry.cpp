@@ -0,0 +1,411 @@
+#ifndef __REGISTRY_CPP
+#define __REGISTRY_CPP
+
+#include "registry.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Serve networks taking 'inputs' inputs to at most 'replicas' concurrent callers. Nothing is published yet. */
+ModelRegistry::ModelRegistry(unsigned int inputs, unsigned int replicas)
+  {
+    unsigned int i;
+
+    this->inputs = inputs;
+    this->replicas = (replicas > 0) ? replicas : 1;
+
+    current = NULL;
+    epoch = 1;
+    readers = new ReaderSlot[this->replicas];
+    for(i = 0; i < this->replicas; i++)
+      {
+        readers[i].active = false;
+        readers[i].epoch = 0;
+        readers[i].calls = 0;
+      }
+    hint = 0;
+
+    topology = NULL;
+    placement = REGISTRY_ANYWHERE;
+    pinning = REGISTRY_PIN_NONE;
+    if((slotNode = (unsigned int*)malloc(this->replicas * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate registry node map\n";
+        exit(1);
+      }
+    for(i = 0; i < this->replicas; i++)
+      slotNode[i] = 0;
+
+    retired = NULL;
+    retiredLen = 0;
+
+    busy = false;
+    published = false;
+    versions = 0;
+  }
+
+/* No caller may be inside run() while the registry is destroyed. */
+ModelRegistry::~ModelRegistry()
+  {
+    unsigned int i;
+
+    if(loader.joinable())
+      loader.join();
+
+    for(i = 0; i < retiredLen; i++)
+      destroy(retired[i]);
+    if(retiredLen > 0)
+      free(retired);
+    if(current.load() != NULL)
+      destroy(current.load());
+
+    delete[] readers;
+    free(slotNode);
+  }
+
+/**************************************************************************************************
+ Loading  */
+
+/* Start loading the network in 'filename' on a background thread. Each copy is run once on each of the 'warmLen'
+   inputs in 'warm' (row-major, warmLen x inputs; may be NULL) before the version is published. Both arguments are
+   copied, so the caller may release them at once. Return false if a load is already in progress. */
+bool ModelRegistry::loadAsync(char* filename, double* warm, unsigned int warmLen)
+  {
+    char* name;
+    double* x = NULL;
+
+    if(busy.load())
+      return false;
+    if(loader.joinable())                                           //  The previous load has finished; collect it
+      loader.join();
+
+    if((name = (char*)malloc((strlen(filename) + 1) * sizeof(char))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate registry file name\n";
+        exit(1);
+      }
+    strcpy(name, filename);
+    if(warm != NULL && warmLen > 0)
+      {
+        if((x = (double*)malloc(warmLen * inputs * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate registry warm-up inputs\n";
+            exit(1);
+          }
+        memcpy(x, warm, warmLen * inputs * sizeof(double));
+      }
+    else
+      warmLen = 0;
+
+    busy = true;
+    published = false;
+    loader = thread(&ModelRegistry::load, this, name, x, warmLen);
+
+    return true;
+  }
+
+/* Block until the background load, if any, finishes. Return whether it was published.
+   Callers of run() should not call this; it is for the thread that manages versions. */
+bool ModelRegistry::wait()
+  {
+    if(loader.joinable())
+      loader.join();
+    return published;
+  }
+
+/*  */
+bool ModelRegistry::loading() const
+  {
+    return busy.load();
+  }
+
+/* Read from a counter, not from 'current': without a reader slot, the version 'current' points to could be freed
+   while it is read. */
+unsigned long long ModelRegistry::version() const
+  {
+    return versions.load();
+  }
+
+/* Loader thread: build every copy, warm it up, publish, then wait out the readers of the version replaced. */
+void ModelRegistry::load(char* filename, double* warm, unsigned int warmLen)
+  {
+    unsigned int i;
+    ModelVersion* v;
+    ModelVersion* old;
+    thread* builders;
+    atomic<bool> ok(true);
+
+    if((v = (ModelVersion*)malloc(sizeof(ModelVersion))) == NULL ||
+       (v->nets = (NeuralNet**)malloc(replicas * sizeof(NeuralNet*))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate model version\n";
+        exit(1);
+      }
+    for(i = 0; i < replicas; i++)
+      v->nets[i] = NULL;
+    v->retired = 0;
+
+    if(placement == REGISTRY_REPLICATE)                             //  One builder per node, each on its own node
+      {
+        builders = new thread[topology->nodes()];
+        for(i = 0; i < topology->nodes(); i++)
+          builders[i] = thread(&ModelRegistry::buildNode, this, v, i, filename, warm, warmLen, &ok);
+        for(i = 0; i < topology->nodes(); i++)
+          builders[i].join();
+        delete[] builders;
+      }
+    else
+      {
+        if(placement == REGISTRY_INTERLEAVE)
+          topology->interleave();
+        for(i = 0; i < replicas && ok; i++)
+          ok = build(v, i, filename, warm, warmLen);
+        if(placement == REGISTRY_INTERLEAVE)
+          topology->restore();
+      }
+    if(!ok)
+      {
+        cout << "ERROR: Unable to load \"" << filename << "\"; the published version is unchanged\n";
+        destroy(v);
+        free(filename);
+        if(warm != NULL)
+          free(warm);
+        busy = false;
+        return;
+      }
+    free(filename);
+    if(warm != NULL)
+      free(warm);
+
+    v->version = versions.load() + 1;
+    old = current.exchange(v);                                      //  Publish: new callers now see 'v'
+    versions.store(v->version);
+    published = true;
+
+    if(old != NULL)
+      {
+        old->retired = epoch.fetch_add(1) + 1;                      //  Anyone who entered before this may hold 'old'
+        retireLock.lock();
+        if((retired = (ModelVersion**)realloc(retired, (retiredLen + 1) * sizeof(ModelVersion*))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate registry's retired list\n";
+            exit(1);
+          }
+        retired[retiredLen++] = old;
+        retireLock.unlock();
+
+        while(!reclaim())
+          this_thread::sleep_for(chrono::microseconds(REGISTRY_RECLAIM_USEC));
+      }
+
+    busy = false;
+    return;
+  }
+
+/* Load copy 'r' of version 'v' from 'filename' and run it on the 'warmLen' warm-up inputs. Return false if the
+   file could not be loaded or its network does not take the registry's number of inputs. */
+bool ModelRegistry::build(ModelVersion* v, unsigned int r, char* filename, double* warm, unsigned int warmLen)
+  {
+    unsigned int j;
+    double* z;
+
+    v->nets[r] = new NeuralNet(inputs);
+    if(!v->nets[r]->load(filename))
+      return false;
+    if(v->nets[r]->inputLen() != inputs)                            //  Callers' buffers hold 'inputs' values
+      {
+        cout << "ERROR: \"" << filename << "\" takes " << v->nets[r]->inputLen() << " inputs; the registry serves "
+             << inputs << "\n";
+        return false;
+      }
+    for(j = 0; j < warmLen; j++)                                    //  First runs allocate each layer's buffers
+      {
+        z = NULL;
+        v->nets[r]->run(warm + j * inputs, &z);
+        if(z != NULL)
+          free(z);
+      }
+    if(warmLen > 0)                                                 //  Recurrent state must not leak into service
+      v->nets[r]->reset();
+
+    return true;
+  }
+
+/* Builder thread for node 'n': pinned to that node and preferring its memory, build the copies that belong there,
+   so that each copy's weights and buffers are first touched, and therefore placed, on its own node. */
+void ModelRegistry::buildNode(ModelVersion* v, unsigned int n, char* filename, double* warm, unsigned int warmLen,
+                              atomic<bool>* ok)
+  {
+    unsigned int i;
+
+    topology->pin(n);
+    topology->prefer(n);
+    for(i = 0; i < replicas && ok->load(); i++)
+      {
+        if(slotNode[i] == n && !build(v, i, filename, warm, warmLen))
+          ok->store(false);
+      }
+    topology->restore();
+
+    return;
+  }
+
+/* Free every retired version that no active reader can still hold. Return true if none remain. */
+bool ModelRegistry::reclaim()
+  {
+    unsigned int i, j;
+    unsigned int kept = 0;
+    bool safe;
+
+    retireLock.lock();
+    for(i = 0; i < retiredLen; i++)
+      {
+        safe = true;
+        for(j = 0; j < replicas && safe; j++)                       //  A stale epoch only errs toward keeping
+          {
+            if(readers[j].active.load() && readers[j].epoch.load() < retired[i]->retired)
+              safe = false;
+          }
+        if(safe)
+          destroy(retired[i]);
+        else
+          retired[kept++] = retired[i];
+      }
+    retiredLen = kept;
+    retireLock.unlock();
+
+    return kept == 0;
+  }
+
+/*  */
+void ModelRegistry::destroy(ModelVersion* v)
+  {
+    unsigned int i;
+
+    for(i = 0; i < replicas; i++)
+      {
+        if(v->nets[i] != NULL)
+          delete v->nets[i];
+      }
+    free(v->nets);
+    free(v);
+    return;
+  }
+
+/**************************************************************************************************
+ NUMA placement  */
+
+/* Place the copies of every version loaded from now on according to 'topo' (borrowed; it must outlive the
+   registry) and 'mode': REGISTRY_REPLICATE assigns copy i to node i mod nodes, REGISTRY_INTERLEAVE spreads each
+   copy over all nodes, and REGISTRY_ANYWHERE (or a NULL 'topo') turns placement off. 'pin' is the policy attach()
+   applies to callers. Call this before the first loadAsync(); return false, changing nothing, after it. */
+bool ModelRegistry::setPlacement(Topology* topo, unsigned char mode, unsigned char pin)
+  {
+    unsigned int i;
+
+    if(busy.load() || versions > 0)
+      return false;
+
+    topology = topo;
+    placement = (topo != NULL) ? mode : REGISTRY_ANYWHERE;
+    pinning = pin;
+    for(i = 0; i < replicas; i++)
+      slotNode[i] = (placement == REGISTRY_REPLICATE) ? i % topology->nodes() : 0;
+
+    return true;
+  }
+
+/* Bind the calling thread as worker number 'worker': worker w belongs to node w mod nodes and, under
+   REGISTRY_PIN_CPU, to CPU w / nodes of that node. Return the node. From then on, run() calls from this thread
+   prefer copies on that node. Without a Topology, do nothing and return 0. */
+unsigned int ModelRegistry::attach(unsigned int worker)
+  {
+    unsigned int n;
+
+    if(topology == NULL)
+      return 0;
+
+    n = worker % topology->nodes();
+    if(pinning == REGISTRY_PIN_CPU)
+      topology->pinCPU(n, worker / topology->nodes());
+    else if(pinning == REGISTRY_PIN_NODE)
+      topology->pin(n);
+    else
+      topology->enter(n);
+
+    return n;
+  }
+
+/*  */
+unsigned int ModelRegistry::node(unsigned int r) const
+  {
+    return (r < replicas) ? slotNode[r] : 0;
+  }
+
+/* Calls served by copy 'r', over every version; with node(), shows whether callers were kept on their node. */
+unsigned long long ModelRegistry::calls(unsigned int r) const
+  {
+    return (r < replicas) ? readers[r].calls.load() : 0;
+  }
+
+/**************************************************************************************************
+ Run  */
+
+/* Run the published version on 'x': '*z' receives a malloc'd copy of the output, which the caller must free.
+   Return the length of the output, or 0 (with '*z' set to NULL) if nothing has been published yet.
+   Safe to call from up to 'replicas' threads at once; more simply take turns for slots. */
+unsigned int ModelRegistry::run(double* x, double** z)
+  {
+    unsigned int s;
+    unsigned int len = 0;
+    ModelVersion* v;
+
+    s = acquire();
+    readers[s].epoch.store(epoch.load());                           //  Announce the epoch before reading 'current'
+    v = current.load();
+    if(v != NULL)
+      {
+        len = v->nets[s]->run(x, z);
+        readers[s].calls.fetch_add(1, memory_order_relaxed);        //  Only the holder writes it; the line is its own
+      }
+    else
+      (*z) = NULL;
+    readers[s].active.store(false);
+
+    return len;
+  }
+
+/* Claim a free reader slot, starting from a rotating hint so that callers spread over the copies. Under
+   REGISTRY_REPLICATE, slots whose copy is on the caller's node are tried first. */
+unsigned int ModelRegistry::acquire()
+  {
+    unsigned int i, s;
+    unsigned int start = hint.fetch_add(1);
+    unsigned int here;
+    bool idle;
+
+    while(true)
+      {
+        if(placement == REGISTRY_REPLICATE)
+          {
+            here = topology->here();
+            for(i = 0; i < replicas; i++)
+              {
+                s = (start + i) % replicas;
+                idle = false;
+                if(slotNode[s] == here && readers[s].active.compare_exchange_strong(idle, true))
+                  return s;
+              }
+          }
+        for(i = 0; i < replicas; i++)
+          {
+            s = (start + i) % replicas;
+            idle = false;
+            if(readers[s].active.compare_exchange_strong(idle, true))
+              return s;
+          }
+        this_thread::yield();                                       //  More callers than slots
+      }
+  }
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef __REGISTRY_H
+#define __REGISTRY_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ A ModelRegistry serves run() calls from many threads while new versions of a model are loaded and swapped in.
+  inputs = length of the networks' input
+  replicas = most run() calls in progress at once; size this to the number of calling threads
+
+ A NeuralNet's run() reuses its layers' buffers, so one network cannot serve two callers at once. Each version
+ therefore holds 'replicas' copies of the network, and each caller borrows a reader slot whose index picks the
+ copy it runs. Recurrent state (LSTM, GRU) belongs to a copy, not to a caller.
+
+ loadAsync() reads a file on a background thread, runs every copy on the given warm-up inputs so that their
+ buffers exist before the first real call, and then publishes the version with one atomic exchange. Calls that
+ began before the exchange finish on the old version; calls that begin after it see the new one. Nothing a caller
+ does ever waits on the loader. A file whose network takes a different number of inputs is refused, and the
+ published version stays.
+
+ setPlacement() makes the copies NUMA-aware. REGISTRY_REPLICATE spreads the copies over the nodes of a Topology
+ and builds each one on a thread pinned to its node, so its weights sit in that node's memory; a caller is then
+ given a copy on its own node whenever one is free. REGISTRY_INTERLEAVE instead spreads every copy's pages over
+ all nodes. Callers declare their node with attach(), which also pins them as the registry's pinning policy says.
+
+ Old versions are reclaimed by epoch: publishing advances a global epoch and retires the old version under it.
+ Each reader slot announces the epoch it entered under. A retired version is freed once no active slot entered
+ before its retirement, which the loader thread waits for, off the callers' path.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "neuron.h"
+#include "topology.h"
+
+#define REGISTRY_RECLAIM_USEC  100                                  /* Loader's wait between attempts to free old versions */
+#define REGISTRY_CACHE_LINE    64                                   /* Bytes; each reader slot gets a line of its own */
+
+#define REGISTRY_ANYWHERE    0                                      /* Placement: wherever the loader's pages land */
+#define REGISTRY_REPLICATE   1                                      /* Placement: copies spread over nodes, callers kept local */
+#define REGISTRY_INTERLEAVE  2                                      /* Placement: every copy's pages spread over all nodes */
+
+#define REGISTRY_PIN_NONE    0                                      /* attach() records the caller's node only */
+#define REGISTRY_PIN_NODE    1                                      /* attach() keeps the caller on its node's CPUs */
+#define REGISTRY_PIN_CPU     2                                      /* attach() keeps the caller on one CPU of its node */
+
+/*
+#define __REGISTRY_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct ModelVersionType
+  {
+    NeuralNet** nets;                                               //  One copy of the network per reader slot
+    unsigned long long version;                                     //  1 for the first version published, then 2, ...
+    unsigned long long retired;                                     //  Epoch under which this version was replaced
+  } ModelVersion;
+
+typedef struct alignas(REGISTRY_CACHE_LINE) ReaderSlotType        //  Padded, so callers in neighbouring slots
+  {                                                                 //  never write to the same cache line
+    atomic<bool> active;                                            //  Held by a caller
+    atomic<unsigned long long> epoch;                               //  Global epoch when the holder entered
+    atomic<unsigned long long> calls;                               //  run() calls served through this slot
+  } ReaderSlot;
+
+/**************************************************************************************************
+ ModelRegistry  */
+class ModelRegistry
+  {
+    public:
+      ModelRegistry(unsigned int, unsigned int);                    //  Constructor(s): inputs, replicas
+      ~ModelRegistry();                                             //  Destructor
+
+      bool loadAsync(char*, double*, unsigned int);                 //  Load, warm up, and publish in the background
+      bool wait();                                                  //  Wait for the current load; was it published?
+      bool loading() const;                                         //  Whether a load is in progress
+      unsigned int run(double*, double**);                          //  Run the current version
+      unsigned long long version() const;                           //  Version now published, or 0 for none
+      bool setPlacement(Topology*, unsigned char, unsigned char);   //  NUMA placement and pinning, for the next load
+      unsigned int attach(unsigned int);                            //  Bind the calling thread as the given worker
+      unsigned int node(unsigned int) const;                        //  Node of the given copy
+      unsigned long long calls(unsigned int) const;                 //  run() calls the given copy has served
+
+    private:
+      unsigned int inputs;                                          //  Length of the networks' input
+      unsigned int replicas;                                        //  Copies of each version = number of reader slots
+
+      atomic<ModelVersion*> current;                                //  Published version, or NULL
+      atomic<unsigned long long> epoch;                             //  Advanced by each publication
+      ReaderSlot* readers;                                          //  replicas-array
+      atomic<unsigned int> hint;                                    //  Where the next caller starts looking for a slot
+
+      Topology* topology;                                           //  Borrowed; NULL for no NUMA placement
+      unsigned char placement;                                      //  REGISTRY_ANYWHERE, _REPLICATE or _INTERLEAVE
+      unsigned char pinning;                                        //  REGISTRY_PIN_NONE, _NODE or _CPU
+      unsigned int* slotNode;                                       //  replicas-array: node of each copy
+
+      ModelVersion** retired;                                       //  Replaced versions not yet freed
+      unsigned int retiredLen;                                      //  Length of that array
+      mutex retireLock;                                             //  Only the loader and the destructor take this
+
+      thread loader;                                                //  Background load, if any
+      atomic<bool> busy;                                            //  Whether 'loader' is still working
+      bool published;                                               //  Whether the last load was published
+      atomic<unsigned long long> versions;                          //  Versions published so far; read by version()
+
+      void load(char*, double*, unsigned int);                      //  Body of the loader thread
+      bool build(ModelVersion*, unsigned int, char*, double*, unsigned int);
+      void buildNode(ModelVersion*, unsigned int, char*, double*, unsigned int, atomic<bool>*);
+      unsigned int acquire();                                       //  Claim a reader slot
+      bool reclaim();                                               //  Free what no reader can see; true if all freed
+      void destroy(ModelVersion*);
+  };
+
+#endif
@@ -0,0 +1,112 @@
+/**************************************************************************************************
+ The request batcher. Four threads submit 250 requests each to a Batcher over a small Dense network; every
+ result must match run() on the same input, the histograms must account for every request and every batch, and
+ a recurrent network must be refused.
+
+ Usage: ./tests/batcher
+***************************************************************************************************/
+
+#include "batcher.h"
+
+#define BATCHER_CLIENTS   4
+#define BATCHER_REQUESTS  250                                       /* Per client */
+#define BATCHER_TOL       1e-12                                     /* A batch sums in another order */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn = new NeuralNet(5);
+    NeuralNet* rnn = new NeuralNet(5);
+    Batcher* batcher;
+    thread clients[BATCHER_CLIENTS];
+    double X[BATCHER_CLIENTS * BATCHER_REQUESTS * 5];
+    double Z[BATCHER_CLIENTS * BATCHER_REQUESTS * 3];               //  run() on each input
+    double B[BATCHER_CLIENTS * BATCHER_REQUESTS * 3];               //  Through the batcher
+    unsigned long long depth[BATCH_HIST_LEN];
+    unsigned long long size[BATCH_HIST_LEN];
+    unsigned long long d = 0, s = 0;
+    atomic<bool> sized(true);
+    BatchResult r;
+    double* z;
+    double m = 0.0;
+    unsigned int c, i;
+
+    srand(9);
+    for(i = 0; i < BATCHER_CLIENTS * BATCHER_REQUESTS * 5; i++)
+      X[i] = -1.0 + 2.0 * (double)rand() / (double)RAND_MAX;
+    nn->addDense(5, 8);
+    nn->addDense(8, 3);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 5, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 8, DENSE_ARRAY, 1);
+    nn->getDense(1)->setF_i(SIGMOID, 0);
+    nn->getDense(1)->setF_i(SOFTMAX, 1);
+    nn->getDense(1)->setF_i(SOFTMAX, 2);
+    nn->sortEdges();
+    for(i = 0; i < BATCHER_CLIENTS * BATCHER_REQUESTS; i++)
+      {
+        nn->run(X + i * 5, &z);
+        memcpy(Z + i * 3, z, 3 * sizeof(double));
+        free(z);
+      }
+
+    batcher = new Batcher(nn, 16, 100);
+    for(c = 0; c < BATCHER_CLIENTS; c++)
+      clients[c] = thread([&X, &B, &sized, batcher, c]()
+        {
+          unsigned int k, n;
+          BatchResult res;
+          for(k = 0; k < BATCHER_REQUESTS; k++)
+            {
+              n = c * BATCHER_REQUESTS + k;
+              res = batcher->submit(X + n * 5).get();
+              if(res.len != 3 || res.z == NULL)
+                sized = false;
+              else
+                memcpy(B + n * 3, res.z, 3 * sizeof(double));
+              free(res.z);
+            }
+        });
+    for(c = 0; c < BATCHER_CLIENTS; c++)
+      clients[c].join();
+
+    check(sized.load(), "every request answered");
+    for(i = 0; i < BATCHER_CLIENTS * BATCHER_REQUESTS * 3; i++)
+      m = fmax(m, fabs(B[i] - Z[i]));
+    printf("      largest difference from run(): %.3e\n", m);
+    check(m <= BATCHER_TOL, "batched results match run()");
+
+    batcher->queueDepthHistogram(depth);
+    batcher->batchSizeHistogram(size);
+    for(i = 0; i < BATCH_HIST_LEN; i++)
+      {
+        d += depth[i];
+        s += size[i];
+      }
+    check(batcher->requests() == BATCHER_CLIENTS * BATCHER_REQUESTS && d == batcher->requests(),
+          "queue-depth histogram counts every request");
+    check(s == batcher->batches() && s > 0, "batch-size histogram counts every batch");
+    delete batcher;
+
+    rnn->addGRU(5, 3, 2);
+    rnn->linkLayers(INPUT_ARRAY, 0, 0, 5, GRU_ARRAY, 0);
+    batcher = new Batcher(rnn, 16, 100);
+    r = batcher->submit(X).get();
+    check(r.z == NULL && r.len == 0, "recurrent network refused");
+    delete batcher;
+
+    delete rnn;
+    delete nn;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,150 @@
+/**************************************************************************************************
+ The result cache. A RunCache of three entries must count hits and misses, evict the least recently used entry
+ when full, and drop its entries, but not its counts, on clear(). In front of a network it must return what the
+ network computes, hit on repeated inputs, be refused for a network with an LSTM layer, and be emptied when
+ prune() or factorize() changes the network. A hit runs no layer, so inner layers still hold the last evaluated
+ input's outputs.
+
+ Usage: ./tests/cache
+***************************************************************************************************/
+
+#include "neuron.h"
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Whether 'cache' holds key 'x' with the one-value output 'v'. Counts as a lookup. */
+bool holds(RunCache* cache, double* x, double v)
+  {
+    double* z;
+    unsigned int n;
+    bool ok;
+
+    if(!cache->lookup(x, &z, &n))
+      return false;
+    ok = (n == 1 && z[0] == v);
+    free(z);
+    return ok;
+  }
+
+/* A 2-3-1 network whose first hidden unit is constant (every input masked off), so prune() can remove it. */
+NeuralNet* build()
+  {
+    NeuralNet* nn = new NeuralNet(2);
+    char hidden[] = "hidden";
+    unsigned int i;
+
+    srand(3);
+    nn->addDense(2, 3);
+    nn->addDense(3, 1);
+    for(i = 0; i < 2; i++)
+      nn->getDense(0)->setM_ij(false, i, 0);
+    nn->getDense(0)->setName(hidden);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 2, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 3, DENSE_ARRAY, 1);
+    nn->sortEdges();
+    return nn;
+  }
+
+int main(int argc, char* argv[])
+  {
+    RunCache* cache = new RunCache(2, 3);
+    NeuralNet* nn = build();
+    NeuralNet* plain = build();
+    NeuralNet* rnn;
+    double keys[8] = { 0.0, 0.0,  0.0, 1.0,  1.0, 0.0,  1.0, 1.0 };
+    double values[4] = { 10.0, 11.0, 12.0, 13.0 };
+    char hidden[] = "hidden";
+    double* z;
+    double* zp;
+    double* h;
+    double first[3];
+    double X[16];
+    unsigned int i, n, hLen;
+    bool ok;
+
+    for(i = 0; i < 3; i++)
+      cache->insert(keys + i * 2, values + i, 1);
+    check(cache->size() == 3 && cache->capacity() == 3, "three entries fill the cache");
+    check(holds(cache, keys, values[0]) && !holds(cache, keys + 6, values[3]), "a stored key hits, an unknown one misses");
+    check(cache->hits() == 1 && cache->misses() == 1, "one hit and one miss counted");
+    cache->insert(keys + 6, values + 3, 1);                         //  Key 1 is now least recently used
+    check(cache->size() == 3 && !holds(cache, keys + 2, values[1]), "inserting into a full cache evicts the oldest");
+    check(holds(cache, keys, values[0]) && holds(cache, keys + 4, values[2]) && holds(cache, keys + 6, values[3]),
+          "the rest survive");
+    cache->clear();
+    check(cache->size() == 0 && !holds(cache, keys, values[0]), "clear() drops every entry");
+    check(cache->hits() == 4 && cache->misses() == 3, "and keeps the counts");
+    delete cache;
+
+    check(nn->setCache(2), "cache set on a Dense network");
+    ok = true;
+    for(i = 0; i < 8; i++)                                          //  Each input twice: miss, then hit
+      {
+        n = nn->run(keys + (i / 2) * 2, &z);
+        plain->run(keys + (i / 2) * 2, &zp);
+        ok = ok && n == 1 && z[0] == zp[0];
+        free(z);
+        free(zp);
+      }
+    check(ok, "cached results equal the network's");
+    check(nn->cacheHits() == 4 && nn->cacheMisses() == 4, "repeats hit, first sightings miss");
+    nn->run(keys, &z);                                              //  Capacity 2: input 0 was evicted
+    free(z);
+    check(nn->cacheMisses() == 5, "an evicted input misses");
+
+    h = nn->outputOf(hidden, &hLen);
+    memcpy(first, h, 3 * sizeof(double));
+    nn->run(keys + 6, &z);                                          //  Hit: nothing runs
+    free(z);
+    h = nn->outputOf(hidden, &hLen);
+    check(nn->cacheHits() == 5 && memcmp(first, h, 3 * sizeof(double)) == 0,
+          "a hit leaves inner layers as the last evaluation left them");
+
+    n = nn->prune(NULL, 0, 1e-9, NULL);
+    check(n == 1 && nn->getDense(0)->outputLen() == 2, "prune() removes the constant unit");
+    nn->run(keys, &z);
+    free(z);
+    check(nn->cacheMisses() == 6, "and empties the cache");
+
+    delete nn;                                                      //  A layer wide enough to factorize
+    nn = new NeuralNet(8);
+    nn->addDense(8, 8);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 8, DENSE_ARRAY, 0);
+    nn->sortEdges();
+    nn->setCache(4);
+    for(i = 0; i < 16; i++)
+      X[i] = (double)(i % 5) / 5.0;
+    nn->run(X, &z);
+    free(z);
+    check(nn->factorize(X, 2, 1e9) == 1, "factorize() replaces the layer");
+    nn->run(X, &z);
+    free(z);
+    check(nn->cacheHits() == 0 && nn->cacheMisses() == 2, "and empties the cache");
+
+    rnn = new NeuralNet(2);
+    rnn->addLSTM(2, 2, 2);
+    rnn->linkLayers(INPUT_ARRAY, 0, 0, 2, LSTM_ARRAY, 0);
+    rnn->sortEdges();
+    check(!rnn->setCache(4), "a network with an LSTM layer is not cached");
+    rnn->run(keys + 6, &z);
+    rnn->run(keys + 6, &zp);
+    check(rnn->cacheHits() == 0 && rnn->cacheMisses() == 0 && z[0] != zp[0], "and repeated inputs still advance it");
+    free(z);
+    free(zp);
+
+    delete rnn;
+    delete nn;
+    delete plain;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
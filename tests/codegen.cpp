@@ -0,0 +1,88 @@
+/**************************************************************************************************
+ The generated header. examples/codegen/xor_net.h, written by exportHeader() from examples/xor/xor.nn, must
+ compile, agree with the library's run() on all four inputs, and still be what exportHeader() writes today.
+
+ Usage: ./tests/codegen     (from the repository's top directory)
+***************************************************************************************************/
+
+#include "neuron.h"
+#include "examples/codegen/xor_net.h"
+
+#define CODEGEN_NET     "examples/xor/xor.nn"
+#define CODEGEN_HEADER  "examples/codegen/xor_net.h"
+#define CODEGEN_TOL     1e-12                                       /* Sums may run in another order */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Read a whole file into a malloc'd buffer; write its length to 'len'. NULL if it cannot be read. */
+char* slurp(const char* filename, long* len)
+  {
+    FILE* fp;
+    char* buf;
+
+    if((fp = fopen(filename, "rb")) == NULL)
+      return NULL;
+    fseek(fp, 0, SEEK_END);
+    *len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if((buf = (char*)malloc(*len + 1)) == NULL || (long)fread(buf, 1, *len, fp) != *len)
+      {
+        fclose(fp);
+        free(buf);
+        return NULL;
+      }
+    fclose(fp);
+    return buf;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn = new NeuralNet(0);
+    char netFile[] = CODEGEN_NET;
+    char fresh[] = "codegen_check.h";
+    char prefix[] = "xornet";
+    double x[8] = { 0.0, 0.0,  0.0, 1.0,  1.0, 0.0,  1.0, 1.0 };
+    double zs[xornet::OUTPUTS];
+    double* z;
+    double d = 0.0;
+    unsigned int i;
+    char* a;
+    char* b;
+    long aLen, bLen;
+
+    if(!nn->load(netFile))
+      {
+        printf("FAIL\n");
+        return 1;
+      }
+    check(nn->inputLen() == xornet::INPUTS, "same input length");
+    for(i = 0; i < 4; i++)
+      {
+        check(nn->run(x + i * 2, &z) == xornet::run(x + i * 2, zs), "same output length");
+        d = fmax(d, fabs(z[0] - zs[0]));
+        free(z);
+      }
+    printf("      largest difference %.3e\n", d);
+    check(d <= CODEGEN_TOL, "generated run() agrees with the library");
+
+    check(nn->exportHeader(fresh, prefix), "header exports");
+    a = slurp(CODEGEN_HEADER, &aLen);
+    b = slurp(fresh, &bLen);
+    check(a != NULL && b != NULL && aLen == bLen && memcmp(a, b, aLen) == 0, "committed header is current");
+    remove(fresh);
+    free(a);
+    free(b);
+    delete nn;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
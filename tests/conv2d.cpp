@@ -0,0 +1,151 @@
+/**************************************************************************************************
+ Build a Conv2D layer filter by filter, with shapes out of order, and check every output against a direct
+ convolution. The layer must then survive writing and reading back, packing into an Arena followed by more
+ filters, and removing a filter, without any filter's output changing.
+
+ Usage: ./tests/conv2d
+***************************************************************************************************/
+
+#include "conv2d.h"
+
+#define CONV2D_FILE     "conv2d.nn"                                 /* Written to, then removed */
+#define CONV2D_W        12                                          /* Input dimensions */
+#define CONV2D_H        9
+#define CONV2D_FILTERS  300                                         /* Filters added one by one */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Shape of the k-th filter: widths and heights cycle out of step, so the slab has sorting to do. */
+void shape(unsigned int k, unsigned int* w, unsigned int* h)
+  {
+    *w = 1 + (k * 7) % 5;
+    *h = 1 + (k * 3) % 4;
+    return;
+  }
+
+/* Give the k-th filter known weights and a linear activation. */
+void setFilter(Conv2D* layer, unsigned int i, unsigned int k)
+  {
+    unsigned int w, h, j;
+    double wt[6 * 5 + 1];
+
+    shape(k, &w, &h);
+    for(j = 0; j < w * h + 1; j++)
+      wt[j] = (double)((k + 3 * j) % 11) / 11.0 - 0.5;
+    layer->setW_i(wt, i);
+    layer->setF_i(LINEAR, i);
+    layer->setHorzStride_i(1 + k % 2, i);
+    return;
+  }
+
+/* Whether the i-th output map of 'layer', starting at 'out', is the k-th filter convolved with 'x'. */
+bool matches(Conv2D* layer, unsigned int i, unsigned int k, double* x, double* out)
+  {
+    unsigned int w, h, ox, oy, r, c;
+    unsigned int sh = 1 + k % 2;
+    double s;
+
+    shape(k, &w, &h);
+    for(oy = 0; oy < layer->outputHeight(i); oy++)
+      for(ox = 0; ox < layer->outputWidth(i); ox++)
+        {
+          s = (double)((k + 3 * w * h) % 11) / 11.0 - 0.5;          //  Bias
+          for(r = 0; r < h; r++)
+            for(c = 0; c < w; c++)
+              s += ((double)((k + 3 * (r * w + c)) % 11) / 11.0 - 0.5) * x[(oy + r) * CONV2D_W + ox * sh + c];
+          if(fabs(s - out[oy * layer->outputWidth(i) + ox]) > 1e-9)
+            return false;
+        }
+    return true;
+  }
+
+/* Check every output map of 'layer', whose i-th filter is the ids[i]-th filter built. */
+bool allMatch(Conv2D* layer, unsigned int* ids, double* x)
+  {
+    unsigned int i;
+    unsigned int pos = 0;
+    double* out;
+
+    layer->run(x);
+    out = layer->output();
+    for(i = 0; i < layer->filterCount(); i++)
+      {
+        if(!matches(layer, i, ids[i], x, out + pos))
+          return false;
+        pos += layer->outputWidth(i) * layer->outputHeight(i);
+      }
+    return true;
+  }
+
+int main(int argc, char* argv[])
+  {
+    Conv2D* layer = new Conv2D(CONV2D_W, CONV2D_H);
+    Conv2D* copy = new Conv2D(CONV2D_W, CONV2D_H);
+    Arena* arena = new Arena();
+    unsigned int ids[CONV2D_FILTERS + 1];
+    unsigned int i, w, h;
+    unsigned int len = 0;
+    double x[CONV2D_W * CONV2D_H];
+    bool ok;
+    FILE* fp;
+
+    srand(7);
+    for(i = 0; i < CONV2D_W * CONV2D_H; i++)
+      x[i] = (double)((i * 13) % 17) / 17.0 - 0.25;
+
+    ok = true;
+    for(i = 0; i < CONV2D_FILTERS; i++)
+      {
+        shape(i, &w, &h);
+        ok = ok && layer->addFilter(w, h) == i + 1;
+        setFilter(layer, i, i);
+        ids[i] = i;
+        len += w * h + 1;
+      }
+    check(ok, "addFilter counts filters");
+    check(layer->weightsLen() == len, "slab holds every filter's weights and bias");
+    check(allMatch(layer, ids, x), "every output map matches a direct convolution");
+
+    ok = (fp = fopen(CONV2D_FILE, "wb")) != NULL && layer->write(fp);
+    if(fp != NULL)
+      fclose(fp);
+    ok = ok && (fp = fopen(CONV2D_FILE, "rb")) != NULL && copy->read(fp);
+    if(fp != NULL)
+      fclose(fp);
+    remove(CONV2D_FILE);
+    check(ok && copy->filterCount() == CONV2D_FILTERS, "layer reads back");
+    check(ok && allMatch(copy, ids, x), "read-back layer matches a direct convolution");
+
+    layer->pack(arena);
+    check(allMatch(layer, ids, x), "packed layer still matches");
+    shape(CONV2D_FILTERS, &w, &h);
+    layer->addFilter(w, h);
+    setFilter(layer, CONV2D_FILTERS, CONV2D_FILTERS);
+    ids[CONV2D_FILTERS] = CONV2D_FILTERS;
+    check(allMatch(layer, ids, x), "filter added after packing matches, and so do the rest");
+
+    layer->removeFilter(1);
+    memmove(ids + 1, ids + 2, (CONV2D_FILTERS - 1) * sizeof(int));
+    check(layer->filterCount() == CONV2D_FILTERS && allMatch(layer, ids, x), "removing a filter leaves the rest intact");
+    shape(CONV2D_FILTERS + 1, &w, &h);
+    layer->addFilter(w, h);
+    setFilter(layer, CONV2D_FILTERS, CONV2D_FILTERS + 1);
+    ids[CONV2D_FILTERS] = CONV2D_FILTERS + 1;
+    check(allMatch(layer, ids, x), "filter added after removal matches, and so do the rest");
+
+    delete layer;
+    delete copy;
+    delete arena;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,112 @@
+/**************************************************************************************************
+ Incremental inference against full inference. Two copies of a Conv2D (two filters) -> Dense(20) -> Dense(5)
+ network, one in delta mode, see the same 300 inputs, each one or two pixels away from the last. Few enough
+ pixels move that the Conv2D layer updates only the receptive fields they cover and the first Dense layer
+ applies rank-1 updates; the outputs must still match run() on the other copy. A larger jump, which makes the
+ layers recompute in full, must match too.
+
+ Usage: ./tests/delta
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define DELTA_W      10                                             /* Input dimensions */
+#define DELTA_H      8
+#define DELTA_STEPS  300                                            /* Inputs, each a small change from the last */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Build the network; the same seed gives the same weights. */
+NeuralNet* build(unsigned int seed)
+  {
+    NeuralNet* nn = new NeuralNet(DELTA_W * DELTA_H);
+    unsigned int convLen, i;
+
+    srand(seed);
+    nn->addConv2D(DELTA_W, DELTA_H);
+    nn->getConv2D(0)->addFilter(3, 3);
+    nn->getConv2D(0)->addFilter(2, 4);
+    convLen = nn->getConv2D(0)->outputLen();
+    nn->addDense(convLen, 20);
+    nn->addDense(20, 5);
+    for(i = 0; i < 20; i++)
+      nn->getDense(0)->setF_i(SIGMOID, i);
+    for(i = 0; i < 5; i++)
+      nn->getDense(1)->setF_i(SOFTMAX, i);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, DELTA_W * DELTA_H, CONV2D_ARRAY, 0);
+    nn->linkLayers(CONV2D_ARRAY, 0, 0, convLen, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 20, DENSE_ARRAY, 1);
+    nn->sortEdges();
+    return nn;
+  }
+
+/* Largest difference between the two networks' outputs on 'x'. */
+double compare(NeuralNet* full, NeuralNet* inc, double* x)
+  {
+    unsigned int i, n, m;
+    double* z;
+    double* zi;
+    double d = 0.0;
+
+    n = full->run(x, &z);
+    m = inc->run(x, &zi);
+    if(n != m || n == 0)
+      d = HUGE_VAL;
+    for(i = 0; i < n && i < m; i++)
+      {
+        if(fabs(z[i] - zi[i]) > d)
+          d = fabs(z[i] - zi[i]);
+      }
+    free(z);
+    free(zi);
+    return d;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* full = build(5);
+    NeuralNet* inc = build(5);
+    unsigned int t, k, p;
+    double x[DELTA_W * DELTA_H];
+    double d, worst = 0.0;
+
+    srand(17);
+    for(p = 0; p < DELTA_W * DELTA_H; p++)
+      x[p] = (double)rand() / (double)RAND_MAX;
+    inc->setDelta(true, 0.0);
+
+    for(t = 0; t < DELTA_STEPS; t++)
+      {
+        for(k = 0; k <= t % 2; k++)                                 //  One or two pixels move
+          {
+            p = rand() % (DELTA_W * DELTA_H);
+            x[p] = (double)rand() / (double)RAND_MAX;
+          }
+        d = compare(full, inc, x);
+        if(d > worst)
+          worst = d;
+      }
+    printf("      largest difference over %d sparse steps: %.3e\n", DELTA_STEPS, worst);
+    check(worst < 1e-9, "incremental outputs match run() over sparse changes");
+    check(inc->partialRuns() > 0 && full->partialRuns() == 0, "and layers were updated in place");
+
+    for(p = 0; p < DELTA_W * DELTA_H; p++)                          //  Every pixel moves: recompute in full
+      x[p] = 1.0 - x[p];
+    check(compare(full, inc, x) < 1e-12, "a dense change matches run()");
+    check(compare(full, inc, x) < 1e-12, "an unchanged input matches run()");
+
+    delete full;
+    delete inc;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,159 @@
+/**************************************************************************************************
+ A Population against Dense layers. Each genome's outputs from evaluate() must equal those of its layers copied
+ into Dense layers and run one sample at a time, softmax output included. Then rank the genomes by fitness and
+ evolve: the elites must come through unchanged and the rest must change. With one elite and no mutation every
+ offspring is a copy of the fittest genome. A genome read back from Dense layers must compute what they do, and
+ with as many elites as genomes only the generation advances.
+
+ Usage: ./tests/population
+***************************************************************************************************/
+
+#include "population.h"
+
+#define POP_INPUTS   4                                              /* Inputs per sample */
+#define POP_GENOMES  6
+#define POP_HIDDEN   5                                              /* Units in the first layer */
+#define POP_OUTPUTS  3                                              /* Units in the (softmax) second layer */
+#define POP_SAMPLES  7
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Largest difference between evaluate()'s outputs in 'Z' and each genome copied into Dense layers and run. */
+double compare(Population* pop, double* X, double* Z)
+  {
+    Dense* hidden = new Dense(POP_INPUTS, POP_HIDDEN);
+    Dense* top = new Dense(POP_HIDDEN, POP_OUTPUTS);
+    unsigned int g, b, i;
+    double* z;
+    double d = 0.0;
+
+    for(g = 0; g < pop->size(); g++)
+      {
+        pop->copyToDense(g, 0, hidden);
+        pop->copyToDense(g, 1, top);
+        for(b = 0; b < POP_SAMPLES; b++)
+          {
+            hidden->run(X + b * POP_INPUTS);
+            top->run(hidden->output());
+            z = Z + (g * POP_SAMPLES + b) * pop->outputLen();
+            for(i = 0; i < POP_OUTPUTS; i++)
+              {
+                if(fabs(z[i] - top->output()[i]) > d)
+                  d = fabs(z[i] - top->output()[i]);
+              }
+          }
+      }
+    delete hidden;
+    delete top;
+    return d;
+  }
+
+/* Whether genome g's outputs in 'Z' equal genome h's in 'Y'. */
+bool same(double* Z, unsigned int g, double* Y, unsigned int h)
+  {
+    unsigned int i;
+
+    for(i = 0; i < POP_SAMPLES * POP_OUTPUTS; i++)
+      {
+        if(fabs(Z[g * POP_SAMPLES * POP_OUTPUTS + i] - Y[h * POP_SAMPLES * POP_OUTPUTS + i]) > 1e-12)
+          return false;
+      }
+    return true;
+  }
+
+int main(int argc, char* argv[])
+  {
+    Population* pop;
+    Dense* hidden;
+    Dense* top;
+    double X[POP_SAMPLES * POP_INPUTS];
+    double Z[POP_GENOMES * POP_SAMPLES * POP_OUTPUTS];
+    double Y[POP_GENOMES * POP_SAMPLES * POP_OUTPUTS];
+    double d, sum;
+    unsigned int g, b, i, fittest;
+    bool ok;
+
+    srand(23);
+    pop = new Population(POP_INPUTS, POP_GENOMES, 2);
+    pop->addDense(POP_HIDDEN);
+    pop->addDense(POP_OUTPUTS);
+    for(i = 0; i < POP_HIDDEN; i++)
+      pop->setF_i((i % 2 == 0) ? SIGMOID : RELU, 0, i);
+    for(i = 0; i < POP_OUTPUTS; i++)
+      pop->setF_i(SOFTMAX, 1, i);
+    for(i = 0; i < POP_SAMPLES * POP_INPUTS; i++)
+      X[i] = (double)rand() / (double)RAND_MAX * 2.0 - 1.0;
+    check(pop->size() == POP_GENOMES && pop->outputLen() == POP_OUTPUTS && pop->generation() == 0,
+          "six genomes of three outputs, generation 0");
+
+    pop->evaluate(X, POP_SAMPLES, Z);
+    d = compare(pop, X, Z);
+    printf("      largest difference from Dense::run: %.3e\n", d);
+    check(d < 1e-12, "evaluate() matches each genome copied into Dense layers");
+    ok = true;
+    for(g = 0; g < POP_GENOMES; g++)
+      for(b = 0; b < POP_SAMPLES; b++)
+        {
+          sum = 0.0;
+          for(i = 0; i < POP_OUTPUTS; i++)
+            sum += Z[(g * POP_SAMPLES + b) * POP_OUTPUTS + i];
+          ok = ok && fabs(sum - 1.0) < 1e-12;
+        }
+    check(ok, "softmax outputs sum to 1");
+
+    for(g = 0; g < POP_GENOMES; g++)                                //  Genome 3 fittest, then 4, 5, 0, 1, 2
+      pop->setFitness((double)((g * 5 + 2) % POP_GENOMES), g);
+    check(pop->fitness(4) == 4.0 && pop->fitness(3) == 5.0 && pop->best() == 3, "fitness set, best found");
+    fittest = pop->best();
+
+    pop->evolve(2, 0.5, 0.1);                                       //  Elites: genomes 3 and 4
+    pop->evaluate(X, POP_SAMPLES, Y);
+    check(pop->generation() == 1, "evolve() advances the generation");
+    check(same(Z, 3, Y, 3) && same(Z, 4, Y, 4), "the elites come through unchanged");
+    ok = true;
+    for(g = 0; g < POP_GENOMES; g++)
+      if(g != 3 && g != 4)
+        ok = ok && !same(Z, g, Y, g);
+    check(ok, "every other genome is replaced");
+    check(compare(pop, X, Y) < 1e-12, "offspring still match their Dense copies");
+
+    pop->evolve(1, 0.0, 0.1);                                       //  One parent, no mutation: clones
+    pop->evaluate(X, POP_SAMPLES, Z);
+    ok = true;
+    for(g = 0; g < POP_GENOMES; g++)
+      ok = ok && same(Z, g, Y, fittest);
+    check(pop->generation() == 2 && ok, "one elite without mutation fills the population with copies");
+
+    hidden = new Dense(POP_INPUTS, POP_HIDDEN);                     //  Genome 5, mutated, into genome 0 through Dense
+    top = new Dense(POP_HIDDEN, POP_OUTPUTS);
+    pop->mutate(5, 1.0, 0.5);
+    pop->copyToDense(5, 0, hidden);
+    pop->copyToDense(5, 1, top);
+    pop->copyFromDense(0, 0, hidden);
+    pop->copyFromDense(0, 1, top);
+    pop->evaluate(X, POP_SAMPLES, Y);
+    check(same(Y, 0, Y, 5) && !same(Y, 0, Z, 0), "a genome read back from Dense layers computes what they do");
+    delete hidden;
+    delete top;
+
+    pop->evolve(POP_GENOMES, 1.0, 0.5);
+    pop->evaluate(X, POP_SAMPLES, Z);
+    ok = true;
+    for(g = 0; g < POP_GENOMES; g++)
+      ok = ok && same(Z, g, Y, g);
+    check(pop->generation() == 3 && ok, "as many elites as genomes: nothing bred, generation advances");
+
+    delete pop;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,119 @@
+/**************************************************************************************************
+ Structured pruning, judged on samples. A Conv2D -> Dense -> Dense network is built with one constant Dense unit,
+ one Dense unit whose outgoing weights are tiny, one whose outgoing weights are just as tiny but whose output is
+ large enough that they matter, and one Conv2D filter whose weights are tiny. Pruning with samples must remove
+ the first two and the filter, keep the third, shrink parameters and FLOPs, and move no output on the samples by
+ more than the removals' bound. Pruning without samples may only remove the constant unit.
+
+ Usage: ./tests/prune
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define PRUNE_SAMPLES  64
+#define PRUNE_TOL      1e-4
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Build the network described above; the same every time. */
+NeuralNet* build()
+  {
+    NeuralNet* nn = new NeuralNet(6);
+    unsigned int i, j;
+
+    srand(5);
+    nn->addConv2D(3, 2);                                            //  Input as 3 x 2
+    nn->getConv2D(0)->addFilter(2, 2);                              //  2 x 1 map
+    nn->getConv2D(0)->addFilter(2, 2);                              //  2 x 1 map, tiny weights
+    nn->getConv2D(0)->addFilter(1, 1);                              //  3 x 2 map
+    for(j = 0; j < 4; j++)
+      nn->getConv2D(0)->setW_ij(1e-6, 1, j);
+    for(i = 0; i < 3; i++)
+      nn->getConv2D(0)->setF_i(LINEAR, i);
+    nn->addDense(10, 8);
+    nn->addDense(8, 4);
+    for(j = 0; j < 8; j++)
+      nn->getDense(0)->setF_i(LINEAR, j);
+    for(j = 0; j < 4; j++)
+      nn->getDense(1)->setF_i(LINEAR, j);
+    for(i = 0; i < 10; i++)
+      {
+        nn->getDense(0)->setM_ij(false, i, 0);                      //  Unit 0: constant
+        nn->getDense(0)->setW_ij((i % 2 == 0) ? 1e5 : -1e5, i, 2);  //  Unit 2: large output
+      }
+    for(j = 0; j < 4; j++)
+      {
+        nn->getDense(1)->setW_ij(1e-6, 1, j);                       //  Unit 1: tiny outgoing weights
+        nn->getDense(1)->setW_ij(1e-6, 2, j);                       //  Unit 2: tiny too, but they carry a lot
+      }
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 6, CONV2D_ARRAY, 0);
+    nn->linkLayers(CONV2D_ARRAY, 0, 0, 10, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 8, DENSE_ARRAY, 1);
+    nn->sortEdges();
+
+    return nn;
+  }
+
+/* Largest difference between the outputs of 'a' and 'b' over the samples. */
+double maxDiff(NeuralNet* a, NeuralNet* b, double* X)
+  {
+    unsigned int s, j, n;
+    double* za;
+    double* zb;
+    double m = 0.0;
+
+    for(s = 0; s < PRUNE_SAMPLES; s++)
+      {
+        n = a->run(X + s * 6, &za);
+        b->run(X + s * 6, &zb);
+        for(j = 0; j < n; j++)
+          m = fmax(m, fabs(za[j] - zb[j]));
+        free(za);
+        free(zb);
+      }
+    return m;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* full = build();
+    NeuralNet* nn = build();
+    PruneReport report;
+    double X[PRUNE_SAMPLES * 6];
+    double d;
+    unsigned int i, removed;
+
+    for(i = 0; i < PRUNE_SAMPLES * 6; i++)
+      X[i] = -1.0 + 2.0 * (double)rand() / (double)RAND_MAX;
+
+    removed = nn->prune(X, PRUNE_SAMPLES, PRUNE_TOL, &report);
+    check(removed == 3 && report.units == 2 && report.filters == 1, "two units and one filter removed");
+    check(nn->getDense(0)->outputLen() == 6, "unit with small weights but large output kept");
+    check(nn->getConv2D(0)->filterCount() == 2 && nn->getDense(0)->inputLen() == 8, "filter map gone from the Dense input");
+    check(report.paramsBefore == full->params() && report.paramsAfter == nn->params() &&
+          report.paramsAfter < report.paramsBefore, "parameters reported and reduced");
+    check(report.flopsAfter < report.flopsBefore, "FLOPs reduced");
+    d = maxDiff(full, nn, X);                                       //  Three removals, each moving a pre-activation
+    printf("      largest change on the samples: %.3e\n", d);       //  by 'tol' at most, through weights below 1
+    check(d <= 3.0 * PRUNE_TOL, "outputs within the removals' bound on the samples");
+    delete nn;
+
+    nn = build();                                                   //  Nothing measured: only the constant unit goes
+    removed = nn->prune(NULL, 0, PRUNE_TOL, &report);
+    check(removed == 1 && report.units == 1 && nn->getConv2D(0)->filterCount() == 3, "without samples, only the constant unit");
+    check(maxDiff(full, nn, X) <= 1e-9, "folding a constant changes nothing");
+    delete nn;
+    delete full;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,171 @@
+/**************************************************************************************************
+ Hot swaps under concurrent readers. Two versions of a 2-2-1 network, XOR and XNOR, are written to files, and a
+ ModelRegistry swaps between them 40 times while four threads call run() without pause. Every output a reader
+ sees must be exactly one version's output for its input, never a mix or garbage; the version a reader sees must
+ never go backward; and once wait() returns, the new version must be the one served. A network taking three
+ inputs must be refused, leaving the published version in place. Reader slots must each fill a cache line of
+ their own.
+
+ Usage: ./tests/registry
+***************************************************************************************************/
+
+#include "registry.h"
+
+#define REGISTRY_READERS  4
+#define REGISTRY_SWAPS    40
+
+static_assert(sizeof(ReaderSlot) == REGISTRY_CACHE_LINE && alignof(ReaderSlot) == REGISTRY_CACHE_LINE,
+              "reader slots must not share cache lines");
+
+unsigned int failures = 0;
+
+double X[8] = { 0.0, 0.0,  0.0, 1.0,  1.0, 0.0,  1.0, 1.0 };
+double expect[2][4];                                                //  Per version (XOR, XNOR), per input
+
+atomic<bool> stop;
+atomic<unsigned long long> calls;
+atomic<unsigned int> wrong;
+atomic<unsigned int> backward;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Write a 2-2-1 sigmoid network computing XOR, or XNOR if 'negate', to 'filename'; record its four outputs. */
+void build(char* filename, bool negate)
+  {
+    NeuralNet* nn = new NeuralNet(2);
+    double hiddenW[] = { 20.0, -20.0,  20.0, -20.0,  -10.0, 30.0 };
+    double outputW[] = { 20.0, 20.0, -30.0 };
+    double* z;
+    unsigned int i;
+
+    if(negate)
+      for(i = 0; i < 3; i++)
+        outputW[i] = -outputW[i];
+    nn->addDense(2, 2);
+    nn->addDense(2, 1);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 2, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 2, DENSE_ARRAY, 1);
+    nn->sortEdges();
+    nn->getDense(0)->setW(hiddenW);
+    nn->getDense(1)->setW(outputW);
+    for(i = 0; i < 2; i++)
+      nn->getDense(0)->setF_i(SIGMOID, i);
+    nn->getDense(1)->setF_i(SIGMOID, 0);
+    for(i = 0; i < 4; i++)
+      {
+        nn->run(X + i * 2, &z);
+        expect[negate ? 1 : 0][i] = z[0];
+        free(z);
+      }
+    nn->write(filename);
+    delete nn;
+    return;
+  }
+
+/* Reader: call run() until told to stop. Each output must be exactly XOR's or XNOR's for its input, and the
+   published version must not go backward from one call to the next. */
+void reader(ModelRegistry* reg, unsigned int seed)
+  {
+    unsigned int i = seed;
+    unsigned int n;
+    unsigned long long seen = 0;
+    unsigned long long v;
+    double* z;
+
+    while(!stop.load())
+      {
+        i = (i * 1103515245 + 12345) & 0x7fffffff;
+        v = reg->version();
+        n = reg->run(X + (i % 4) * 2, &z);
+        if(n != 1 || (z[0] != expect[0][i % 4] && z[0] != expect[1][i % 4]))
+          wrong++;
+        if(v < seen)
+          backward++;
+        seen = v;
+        free(z);
+        calls++;
+      }
+    return;
+  }
+
+int main(int argc, char* argv[])
+  {
+    ModelRegistry* reg = new ModelRegistry(2, REGISTRY_READERS);
+    thread readers[REGISTRY_READERS];
+    char fileA[] = "registry_xor.nn";
+    char fileB[] = "registry_xnor.nn";
+    char fileC[] = "registry_wide.nn";
+    NeuralNet* wide;
+    unsigned long long before;
+    unsigned int i, k;
+    bool published = true;
+    bool served = true;
+    double* z;
+
+    build(fileA, false);
+    build(fileB, true);
+    check(expect[0][1] > 0.99 && expect[1][1] < 0.01, "the two versions differ");
+
+    check(reg->loadAsync(fileA, X, 4) && reg->wait() && reg->version() == 1, "first version published");
+    stop = false;
+    calls = 0;
+    wrong = 0;
+    backward = 0;
+    for(k = 0; k < REGISTRY_READERS; k++)
+      readers[k] = thread(reader, reg, k + 1);
+
+    for(k = 0; k < REGISTRY_SWAPS; k++)
+      {
+        before = calls.load();                                      //  Let the readers get going on this version
+        while(calls.load() < before + 50 * REGISTRY_READERS)
+          this_thread::yield();
+        published = reg->loadAsync((k % 2 == 0) ? fileB : fileA, X, 4) && reg->wait() && published;
+        published = (reg->version() == k + 2) && published;
+        for(i = 0; i < 4; i++)                                      //  The new version serves from now on
+          {
+            reg->run(X + i * 2, &z);
+            served = (z[0] == expect[(k + 1) % 2][i]) && served;
+            free(z);
+          }
+      }
+    stop = true;
+    for(k = 0; k < REGISTRY_READERS; k++)
+      readers[k].join();
+
+    check(published, "40 versions published in turn");
+    check(served, "after wait(), every call sees the new version");
+    printf("      %llu calls during the swaps\n", calls.load());
+    check(wrong.load() == 0, "every output belongs to a version");
+    check(backward.load() == 0, "no reader saw the version go backward");
+
+    wide = new NeuralNet(3);                                        //  One input too many for this registry
+    wide->addDense(3, 1);
+    wide->linkLayers(INPUT_ARRAY, 0, 0, 3, DENSE_ARRAY, 0);
+    wide->sortEdges();
+    wide->write(fileC);
+    delete wide;
+    before = reg->version();
+    served = reg->loadAsync(fileC, X, 4) && !reg->wait() && reg->version() == before;
+    for(i = 0; i < 4; i++)
+      {
+        reg->run(X + i * 2, &z);
+        served = (z[0] == expect[REGISTRY_SWAPS % 2][i]) && served;
+        free(z);
+      }
+    check(served, "a network with another input length is refused; the old version stays");
+
+    delete reg;
+    remove(fileA);
+    remove(fileB);
+    remove(fileC);
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
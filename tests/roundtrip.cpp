@@ -0,0 +1,185 @@
+/**************************************************************************************************
+ Write a network of every layer type to a file, load it into another network, and check that both produce the
+ same outputs, bit for bit, over a sequence. One Dense layer is factorized first, so that the factorized format
+ is covered too, and a factorized layer must hold fewer parameters than the full one. A file truncated part-way
+ must fail to load and leave the network empty.
+
+ Usage: ./tests/roundtrip
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define ROUNDTRIP_FILE  "roundtrip.nn"                              /* Written to, then removed */
+#define ROUNDTRIP_T     6                                           /* Length of the input sequence */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Read a whole file into a malloc'd buffer; write its length to 'len'. NULL if it cannot be read. */
+char* slurp(const char* filename, long* len)
+  {
+    FILE* fp;
+    char* buf;
+
+    if((fp = fopen(filename, "rb")) == NULL)
+      return NULL;
+    fseek(fp, 0, SEEK_END);
+    *len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if((buf = (char*)malloc(*len + 1)) == NULL || (long)fread(buf, 1, *len, fp) != *len)
+      {
+        fclose(fp);
+        free(buf);
+        return NULL;
+      }
+    fclose(fp);
+    return buf;
+  }
+
+/* Run the T inputs in 'X' through 'nn' from a reset state; '*Z' receives the T outputs. Return the output length. */
+unsigned int runAll(NeuralNet* nn, double* X, double** Z)
+  {
+    unsigned int t, n = 0;
+    double* z;
+
+    nn->reset();
+    *Z = NULL;
+    for(t = 0; t < ROUNDTRIP_T; t++)
+      {
+        n = nn->run(X + t * nn->inputLen(), &z);
+        if((*Z = (double*)realloc(*Z, (t + 1) * n * sizeof(double))) == NULL)
+          exit(1);
+        memcpy(*Z + t * n, z, n * sizeof(double));
+        free(z);
+      }
+    return n;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn = new NeuralNet(16);
+    NeuralNet* copy = new NeuralNet(0);
+    char filename[] = ROUNDTRIP_FILE;
+    char comment[] = "Every layer type";
+    char featName[] = "features";
+    char stateName[] = "state";
+    unsigned int upresLen, normLen, outLen, copyLen, i, j;
+    unsigned int before;
+    double X[ROUNDTRIP_T * 16];
+    double S[32 * 12];                                              //  Factorization samples for the first Dense layer
+    double* Z;
+    double* Zc;
+    char* a;
+    char* b;
+    long aLen, bLen;
+    FILE* fp;
+
+    srand(7);
+    for(i = 0; i < ROUNDTRIP_T * 16; i++)
+      X[i] = (double)rand() / (double)RAND_MAX;
+    for(i = 0; i < 32 * 12; i++)
+      S[i] = (double)rand() / (double)RAND_MAX;
+
+    nn->addConv2D(4, 4);                                            //  Input 4 x 4 -> two 2 x 2 maps
+    nn->getConv2D(0)->addFilter(2, 2);
+    nn->getConv2D(0)->addFilter(3, 3);
+    nn->getConv2D(0)->setHorzStride_i(2, 0);
+    nn->getConv2D(0)->setVertStride_i(2, 0);
+    nn->getConv2D(0)->setF_i(SIGMOID, 1);
+    nn->addPool(4, 4);                                              //  Input 4 x 4 -> one 2 x 2 map
+    nn->getPool(0)->addPool(2, 2);
+    nn->getPool(0)->setPoolHorzStride(2, 0);
+    nn->getPool(0)->setPoolVertStride(2, 0);
+    nn->getPool(0)->setPoolFunc(AVG_POOL, 0);
+    nn->addUpres(2, 2);                                             //  Pool map, resampled
+    nn->getUpres(0)->addParams(1, 1);
+    nn->getUpres(0)->setParamsStrideMethod(FILL_INTERP, 0);
+    nn->getUpres(0)->setParamsPaddingMethod(FILL_SAME, 0);
+    upresLen = nn->getUpres(0)->outputLen();
+    nn->addNormal(upresLen);
+    nn->getNormal(0)->setM(0.5);
+    nn->getNormal(0)->setS(2.0);
+    nn->getNormal(0)->setG(1.5);
+    nn->getNormal(0)->setB(-0.1);
+    normLen = nn->getNormal(0)->outputLen();
+    nn->addAccum(12);                                               //  Conv2D maps and pool map together
+    nn->getAccum(0)->setName(featName);
+    nn->addDense(12, 6);
+    nn->getDense(0)->setM_ij(false, 0, 0);
+    nn->getDense(0)->setM_ij(false, 3, 2);
+    nn->getDense(0)->setF_i(HYPERBOLIC_TANGENT, 1);
+    nn->getDense(0)->setF_i(LEAKY_RELU, 2);
+    nn->getDense(0)->setA_i(0.1, 2);
+    nn->addLSTM(6, 5, 3);
+    nn->getLSTM(0)->setName(stateName);
+    nn->addGRU(5, 4, 3);
+    nn->addDense(4 + normLen, 3);
+    for(i = 0; i < 3; i++)
+      nn->getDense(1)->setF_i(SOFTMAX, i);
+    nn->setComment(comment);
+
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 16, CONV2D_ARRAY, 0);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 16, POOL_ARRAY, 0);
+    nn->linkLayers(POOL_ARRAY, 0, 0, 4, UPRES_ARRAY, 0);
+    nn->linkLayers(UPRES_ARRAY, 0, 0, upresLen, NORMAL_ARRAY, 0);
+    nn->linkLayers(CONV2D_ARRAY, 0, 0, 8, ACCUM_ARRAY, 0);
+    nn->linkLayers(POOL_ARRAY, 0, 0, 4, ACCUM_ARRAY, 0);
+    nn->linkLayers(ACCUM_ARRAY, 0, 0, 12, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 6, LSTM_ARRAY, 0);
+    nn->linkLayers(LSTM_ARRAY, 0, 0, 5, GRU_ARRAY, 0);
+    nn->linkLayers(GRU_ARRAY, 0, 0, 4, DENSE_ARRAY, 1);
+    nn->linkLayers(NORMAL_ARRAY, 0, 0, normLen, DENSE_ARRAY, 1);
+    nn->sortEdges();
+
+    before = nn->getDense(0)->params();
+    check(nn->getDense(0)->factorize(S, 32, 10.0) > 0, "first Dense layer factorizes");
+    check(nn->getDense(0)->params() < before, "factorized layer stores fewer parameters");
+    for(i = 0, j = 0; i < 12; i++)                                  //  Masks survive factorization
+      j += !nn->getDense(0)->getM_ij(i, 0) + !nn->getDense(0)->getM_ij(i, 2);
+    check(j == 2 && !nn->getDense(0)->getM_ij(0, 0) && !nn->getDense(0)->getM_ij(3, 2), "factorized layer keeps its masks");
+
+    outLen = runAll(nn, X, &Z);
+    check(outLen == 3, "network runs");
+    check(nn->write(filename), "network writes");
+    check(copy->load(filename), "network loads");
+    check(copy->inputLen() == 16, "loaded input length");
+    check(copy->params() == nn->params(), "loaded parameter count");
+    check(copy->getDense(0) != NULL && copy->getDense(0)->rank() == nn->getDense(0)->rank(), "loaded layer stays factorized");
+
+    copyLen = runAll(copy, X, &Zc);
+    check(copyLen == outLen && memcmp(Z, Zc, ROUNDTRIP_T * outLen * sizeof(double)) == 0, "loaded network gives identical outputs");
+    check(copy->outputOf(featName, &i) != NULL && i == 12, "layer names survive");
+    check(copy->outputOf(stateName, &i) != NULL && i == 5, "recurrent layer names survive");
+    free(Zc);
+
+    a = slurp(filename, &aLen);                                     //  Writing what was loaded gives the same file
+    check(copy->write(filename), "loaded network writes");
+    b = slurp(filename, &bLen);
+    check(a != NULL && b != NULL && aLen == bLen && memcmp(a, b, aLen) == 0, "written, loaded and written again: same bytes");
+
+    if(a != NULL && (fp = fopen(filename, "wb")) != NULL)           //  Cut the file short
+      {
+        fwrite(a, 1, aLen / 2, fp);
+        fclose(fp);
+      }
+    check(!copy->load(filename), "truncated file is refused");
+    check(copy->params() == 0 && copy->getDense(0) == NULL, "refused file leaves the network empty");
+
+    remove(filename);
+    free(a);
+    free(b);
+    free(Z);
+    delete copy;
+    delete nn;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,189 @@
+/**************************************************************************************************
+ runSequence() must give, bit for bit, what run() gives on each input in turn. Checked on an LSTM -> GRU -> Dense
+ stack over 23 steps and then over 10 more (the state carries on), with the caller alone and with 4 threads
+ whatever the machine, and over repeated calls on the same worker pool; then on a network with a back edge (a
+ layer reads a later layer's output from the previous step) and a layer that no edge leads into. A network whose
+ edges into a layer are not consecutive is refused. runBidirectional() must give each direction's runSequence()
+ rows side by side, and nothing at all if either network refuses to run.
+
+ Usage: ./tests/sequence
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define SEQUENCE_T     23                                           /* First sequence */
+#define SEQUENCE_MORE  10                                           /* Continued sequence */
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Run the T inputs in 'X' through 'nn' one run() at a time; '*Z' receives the T outputs. Return the output length. */
+unsigned int stepwise(NeuralNet* nn, double* X, unsigned int T, double** Z)
+  {
+    unsigned int t, n = 0;
+    double* z;
+
+    *Z = NULL;
+    for(t = 0; t < T; t++)
+      {
+        n = nn->run(X + t * nn->inputLen(), &z);
+        if((*Z = (double*)realloc(*Z, (t + 1) * n * sizeof(double))) == NULL)
+          exit(1);
+        memcpy(*Z + t * n, z, n * sizeof(double));
+        free(z);
+      }
+    return n;
+  }
+
+/* Clear recurrent state. reset() leaves Dense outputs alone, and a back edge reads one, so set them all too. */
+void restart(NeuralNet* nn)
+  {
+    double zeros[16] = { 0.0 };
+    unsigned int i;
+
+    nn->reset();
+    for(i = 0; nn->getDense(i) != NULL; i++)
+      nn->getDense(i)->run(zeros);
+    return;
+  }
+
+/* Compare step-by-step run() with runSequence() over 'T' then 'more' steps, each from the same state. */
+bool agree(NeuralNet* nn, double* X, unsigned int T, unsigned int more)
+  {
+    unsigned int n, m;
+    double* A;
+    double* B;
+    double* C;
+    bool ok;
+
+    restart(nn);
+    n = stepwise(nn, X, T + more, &A);
+    restart(nn);
+    m = nn->runSequence(X, T, &B);
+    ok = (m == n && memcmp(A, B, T * n * sizeof(double)) == 0);
+    free(B);
+    if(more > 0)
+      {
+        m = nn->runSequence(X + T * nn->inputLen(), more, &C);
+        ok = ok && (m == n && memcmp(A + T * n, C, more * n * sizeof(double)) == 0);
+        free(C);
+      }
+    free(A);
+    return ok;
+  }
+
+/* An LSTM -> Dense network; the same seed gives the same weights. Unless 'sorted', Dense 0's edges are left out
+   of order, so that runSequence() refuses it. */
+NeuralNet* recurrent(unsigned int seed, bool sorted)
+  {
+    NeuralNet* nn = new NeuralNet(4);
+
+    srand(seed);
+    nn->addLSTM(4, 6, 4);
+    nn->addDense(8, 3);
+    nn->linkLayers(LSTM_ARRAY, 0, 0, 6, DENSE_ARRAY, 0);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 4, LSTM_ARRAY, 0);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 2, DENSE_ARRAY, 0);
+    if(sorted)
+      nn->sortEdges();
+    return nn;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn;
+    NeuralNet* fwd;
+    NeuralNet* bwd;
+    double Xr[SEQUENCE_T * 4];
+    double* F;
+    double* B;
+    unsigned int t, n;
+    double X[(SEQUENCE_T + SEQUENCE_MORE) * 4];
+    double* Z;
+    unsigned int i;
+    bool ok;
+
+    srand(11);
+    for(i = 0; i < (SEQUENCE_T + SEQUENCE_MORE) * 4; i++)
+      X[i] = -1.0 + 2.0 * (double)rand() / (double)RAND_MAX;
+
+    nn = new NeuralNet(4);                                          //  LSTM -> GRU -> Dense
+    nn->addLSTM(4, 6, 4);
+    nn->addGRU(6, 5, 4);
+    nn->addDense(5, 3);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 4, LSTM_ARRAY, 0);
+    nn->linkLayers(LSTM_ARRAY, 0, 0, 6, GRU_ARRAY, 0);
+    nn->linkLayers(GRU_ARRAY, 0, 0, 5, DENSE_ARRAY, 0);
+    nn->sortEdges();
+    check(agree(nn, X, SEQUENCE_T, SEQUENCE_MORE), "LSTM -> GRU -> Dense: 23 steps, then 10 more");
+    nn->setSequenceThreads(4);                                      //  Workers even on a single core
+    check(agree(nn, X, SEQUENCE_T, SEQUENCE_MORE), "4 threads: 23 steps, then 10 more");
+    for(i = 0, ok = true; i < 50; i++)                              //  The same pool serves every call
+      ok = ok && agree(nn, X, 1 + i % SEQUENCE_T, 0);
+    check(ok, "4 threads: 50 calls of varying length");
+    nn->setSequenceThreads(1);
+    check(agree(nn, X, SEQUENCE_T, SEQUENCE_MORE), "calling thread alone: 23 steps, then 10 more");
+    check(nn->runSequence(X, 0, &Z) == 0 && Z == NULL, "zero steps give nothing");
+    delete nn;
+
+    nn = new NeuralNet(4);                                          //  Dense 0 reads Dense 1's previous output
+    nn->addDense(6, 5);
+    nn->addDense(7, 2);
+    nn->addGRU(5, 3, 2);
+    nn->addDense(5, 3);
+    nn->addDense(1, 2);                                             //  Dense 3: no edge leads into it
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 4, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 1, 0, 2, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 5, DENSE_ARRAY, 1);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 5, GRU_ARRAY, 0);
+    nn->linkLayers(GRU_ARRAY, 0, 0, 3, DENSE_ARRAY, 2);
+    nn->linkLayers(DENSE_ARRAY, 1, 0, 2, DENSE_ARRAY, 2);
+    nn->linkLayers(DENSE_ARRAY, 3, 0, 2, DENSE_ARRAY, 1);           //  Dense 1's edges are not consecutive
+    nn->getDense(0)->setF_i(HYPERBOLIC_TANGENT, 0);
+    nn->getDense(1)->setF_i(SIGMOID, 1);
+    nn->setSequenceThreads(3);
+    Z = NULL;
+    check(nn->runSequence(X, SEQUENCE_T, &Z) == 0 && Z == NULL, "edges into a layer out of order are refused");
+    nn->sortEdges();
+    check(agree(nn, X, SEQUENCE_T, SEQUENCE_MORE), "back edge and a layer with no inputs: 23 steps, then 10 more");
+    delete nn;
+
+    for(t = 0; t < SEQUENCE_T; t++)                                 //  What the backward network sees
+      memcpy(Xr + t * 4, X + (SEQUENCE_T - 1 - t) * 4, 4 * sizeof(double));
+    fwd = recurrent(1, true);
+    bwd = recurrent(2, true);
+    fwd->runSequence(X, SEQUENCE_T, &F);
+    bwd->runSequence(Xr, SEQUENCE_T, &B);
+    delete fwd;
+    delete bwd;
+    fwd = recurrent(1, true);
+    bwd = recurrent(2, true);
+    n = fwd->runBidirectional(bwd, X, SEQUENCE_T, &Z);
+    ok = (n == 6);
+    for(t = 0; t < SEQUENCE_T && ok; t++)
+      ok = memcmp(Z + t * 6, F + t * 3, 3 * sizeof(double)) == 0 &&
+           memcmp(Z + t * 6 + 3, B + (SEQUENCE_T - 1 - t) * 3, 3 * sizeof(double)) == 0;
+    check(ok, "bidirectional rows are the two directions' outputs side by side");
+    free(Z);
+    free(F);
+    free(B);
+    delete bwd;
+
+    bwd = recurrent(2, false);
+    Z = NULL;
+    check(fwd->runBidirectional(bwd, X, SEQUENCE_T, &Z) == 0 && Z == NULL, "a backward network that refuses gives nothing");
+    check(bwd->runBidirectional(fwd, X, SEQUENCE_T, &Z) == 0 && Z == NULL, "and so does a forward one");
+    delete fwd;
+    delete bwd;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,137 @@
+/**************************************************************************************************
+ Snapshots, forks and restores of recurrent state. An LSTM -> GRU -> Dense network runs 7 steps and is saved.
+ Continuing from the snapshot, from a fork of it, or from a replay of all the inputs must give the same outputs,
+ bit for bit, and branches must not disturb one another. The History reference counts must follow every save,
+ fork, restore, copy-on-write and delete: 64 forks stepped one at a time share a single History until each
+ writes, and leave the count where it began once deleted.
+
+ Usage: ./tests/snapshot
+***************************************************************************************************/
+
+#include "neuron.h"
+
+#define SNAPSHOT_T      7                                           /* Steps before the snapshot */
+#define SNAPSHOT_MORE   5                                           /* Steps after it */
+#define SNAPSHOT_FORKS  64
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Run T steps of 'X' (3 inputs each) and write the T outputs (2 each) to 'Z'. */
+void steps(NeuralNet* nn, double* X, unsigned int T, double* Z)
+  {
+    unsigned int t;
+    double* z;
+
+    for(t = 0; t < T; t++)
+      {
+        nn->run(X + t * 3, &z);
+        memcpy(Z + t * 2, z, 2 * sizeof(double));
+        free(z);
+      }
+    return;
+  }
+
+/* Whether both recurrent layers' Histories in 's' have 'n' references. */
+bool refs(NetState* s, unsigned int n)
+  {
+    return s->lstm[0].H->references() == n && s->gru[0].H->references() == n;
+  }
+
+int main(int argc, char* argv[])
+  {
+    NeuralNet* nn = new NeuralNet(3);
+    NetState* s;
+    NetState* f;
+    NetState* forks[SNAPSHOT_FORKS];
+    NetState* now;
+    double X[(SNAPSHOT_T + SNAPSHOT_MORE + SNAPSHOT_FORKS) * 3];
+    double A[SNAPSHOT_MORE * 2];                                    //  Continuing straight on
+    double B[SNAPSHOT_MORE * 2];                                    //  Continuing from a restore
+    double Z[(SNAPSHOT_T + SNAPSHOT_MORE) * 2];                     //  Replaying from the start
+    double fz[SNAPSHOT_FORKS * 2];
+    double rz[2];
+    double* Xf = X + (SNAPSHOT_T + SNAPSHOT_MORE) * 3;              //  One input per fork
+    History* H;
+    unsigned int k;
+    bool ok;
+
+    srand(3);
+    for(k = 0; k < (SNAPSHOT_T + SNAPSHOT_MORE + SNAPSHOT_FORKS) * 3; k++)
+      X[k] = -1.0 + 2.0 * (double)rand() / (double)RAND_MAX;
+
+    nn->addLSTM(3, 4, 5);
+    nn->addGRU(4, 3, 5);
+    nn->addDense(3, 2);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 3, LSTM_ARRAY, 0);
+    nn->linkLayers(LSTM_ARRAY, 0, 0, 4, GRU_ARRAY, 0);
+    nn->linkLayers(GRU_ARRAY, 0, 0, 3, DENSE_ARRAY, 0);
+    nn->sortEdges();
+
+    steps(nn, X, SNAPSHOT_T, Z);
+    s = nn->snapshot();
+    check(refs(s, 2), "snapshot shares the layer's History: 2 references");
+    f = s->fork();
+    check(refs(f, 3) && f->lstm[0].H == s->lstm[0].H, "fork shares it too: 3 references");
+
+    steps(nn, X + SNAPSHOT_T * 3, SNAPSHOT_MORE, A);
+    check(refs(s, 2), "the layer copies before writing: snapshot and fork keep 2");
+
+    nn->restore(s);
+    check(refs(s, 3), "restore shares the snapshot's History: 3 references");
+    steps(nn, X + SNAPSHOT_T * 3, SNAPSHOT_MORE, B);
+    check(memcmp(A, B, sizeof(A)) == 0, "continuing from the snapshot repeats the outputs");
+
+    nn->reset();
+    steps(nn, X, SNAPSHOT_T + SNAPSHOT_MORE, Z);
+    check(memcmp(A, Z + SNAPSHOT_T * 2, sizeof(A)) == 0, "a replay from the start gives the same outputs");
+
+    nn->restore(f);                                                 //  Another branch, then back
+    steps(nn, X, SNAPSHOT_MORE, B);
+    nn->restore(s);
+    steps(nn, X + SNAPSHOT_T * 3, SNAPSHOT_MORE, B);
+    check(memcmp(A, B, sizeof(A)) == 0, "a fork that moved on leaves the snapshot intact");
+
+    for(k = 0; k < SNAPSHOT_FORKS; k++)
+      forks[k] = s->fork();
+    check(refs(s, 2 + SNAPSHOT_FORKS), "64 forks share one History: 66 references");
+    for(k = 0, ok = true; k < SNAPSHOT_FORKS; k++)
+      {
+        nn->restore(forks[k]);
+        ok = ok && refs(s, 3 + SNAPSHOT_FORKS);
+        steps(nn, Xf + k * 3, 1, fz + k * 2);
+        ok = ok && refs(s, 2 + SNAPSHOT_FORKS);
+      }
+    check(ok, "each fork's step copies on write and drops its share");
+    for(k = 0, ok = true; k < SNAPSHOT_FORKS; k++)
+      {
+        nn->restore(s);
+        steps(nn, Xf + k * 3, 1, rz);
+        ok = ok && memcmp(rz, fz + k * 2, sizeof(rz)) == 0;
+      }
+    check(ok, "each fork's step equals the same step from the snapshot");
+    for(k = 0; k < SNAPSHOT_FORKS; k++)
+      delete forks[k];
+    check(refs(s, 2), "deleting the forks: back to 2");
+    delete f;
+    check(refs(s, 1), "deleting the first fork: 1");
+
+    nn->restore(s);
+    H = s->lstm[0].H;
+    delete s;
+    now = nn->snapshot();
+    check(now->lstm[0].H == H && refs(now, 2), "deleting the snapshot leaves the restored layer the History");
+    delete now;
+    delete nn;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
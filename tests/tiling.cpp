@@ -0,0 +1,128 @@
+/**************************************************************************************************
+ Run a chain of two Conv2D layers tile by tile and check it against running the layers whole. Then widen the
+ second layer's strides, so that each tile needs a larger region of the first layer's output, and check that the
+ next run grows its scratch to fit and still agrees. Last, tile a mixed chain, an interpolating Upres (stride 2,
+ padding 1), a 3 x 2 pool, and a 3 x 3 convolution with horizontal stride 2, once with 5 x 3 tiles and once
+ with tiles that divide neither output dimension.
+
+ Usage: ./tests/tiling
+***************************************************************************************************/
+
+#include "tiling.h"
+
+#define TILING_W     24                                             /* Input dimensions */
+#define TILING_H     20
+#define TILING_TILE  4                                              /* Tile width and height */
+#define MIXED_W      9                                              /* Mixed chain's input dimensions */
+#define MIXED_H      7
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Whether the tiled chain's output matches the two layers run whole on 'x'. */
+bool agrees(Tiling* tiling, Conv2D* a, Conv2D* b, double* x)
+  {
+    unsigned int i;
+    double* z;
+    bool ok;
+
+    if((z = (double*)malloc(tiling->outputLen() * sizeof(double))) == NULL)
+      exit(1);
+    a->run(x);
+    b->run(a->output());
+    ok = tiling->run(x, z) == b->outputLen();
+    for(i = 0; i < b->outputLen() && ok; i++)
+      ok = fabs(z[i] - b->output()[i]) < 1e-12;
+    free(z);
+    return ok;
+  }
+
+/* Whether an Upres -> Pooling -> Conv2D chain tiled in (w by h) tiles matches the layers run whole on 'x'. */
+bool agreesMixed(Upres* up, Pooling* pool, Conv2D* conv, unsigned int w, unsigned int h, double* x)
+  {
+    Tiling* tiling = new Tiling(w, h);
+    unsigned int i;
+    double* z;
+    bool ok;
+
+    ok = tiling->addUpres(up) && tiling->addPool(pool) && tiling->addConv2D(conv);
+    if((z = (double*)malloc(tiling->outputLen() * sizeof(double))) == NULL)
+      exit(1);
+    up->run(x);
+    pool->run(up->output());
+    conv->run(pool->output());
+    ok = ok && tiling->run(x, z) == conv->outputLen();
+    for(i = 0; i < conv->outputLen() && ok; i++)
+      ok = fabs(z[i] - conv->output()[i]) < 1e-12;
+    free(z);
+    delete tiling;
+    return ok;
+  }
+
+int main(int argc, char* argv[])
+  {
+    Conv2D* a = new Conv2D(TILING_W, TILING_H);
+    Conv2D* b = new Conv2D(TILING_W - 2, TILING_H - 2);
+    Tiling* tiling = new Tiling(TILING_TILE, TILING_TILE);
+    Upres* up = new Upres(MIXED_W, MIXED_H);
+    Pooling* pool = new Pooling(3 * MIXED_W, 3 * MIXED_H);          //  Upres output: n + 2 * (n - 1) + 2 * 1
+    Conv2D* conv = new Conv2D(3 * MIXED_W - 2, 3 * MIXED_H - 1);
+    unsigned int before;
+    unsigned int i;
+    double x[TILING_W * TILING_H];
+
+    srand(11);
+    for(i = 0; i < TILING_W * TILING_H; i++)
+      x[i] = (double)((i * 7) % 13) / 13.0 - 0.5;
+    a->addFilter(3, 3);
+    b->addFilter(3, 3);
+    a->setF_i(LINEAR, 0);
+    b->setF_i(LINEAR, 0);
+
+    check(tiling->addConv2D(a) && tiling->addConv2D(b), "chain built");
+    check(agrees(tiling, a, b, x), "tiled chain matches the layers run whole");
+    before = tiling->scratchLen();
+    check(before == 2 * (TILING_TILE + 2) * (TILING_TILE + 2), "scratch holds the first layer's region for one tile");
+
+    b->setHorzStride_i(3, 0);                                       //  Each tile now reads a (3 * 3 + 3)-square region
+    b->setVertStride_i(3, 0);
+    check(agrees(tiling, a, b, x), "after the strides change, the tiled chain still matches");
+    check(tiling->scratchLen() == 2 * (3 * (TILING_TILE - 1) + 3) * (3 * (TILING_TILE - 1) + 3),
+          "scratch grew to the larger region");
+
+    b->setHorzStride_i(1, 0);
+    b->setVertStride_i(1, 0);
+    check(agrees(tiling, a, b, x) && tiling->scratchLen() > before, "scratch kept when the region shrinks back");
+
+    up->addParams(2, 1);
+    up->setParamsVertStride(2, 0);
+    up->setParamsVertPad(1, 0);
+    up->setParamsStrideMethod(FILL_INTERP, 0);
+    up->setParamsPaddingMethod(FILL_INTERP, 0);
+    pool->addPool(3, 2);
+    conv->addFilter(3, 3);
+    conv->setHorzStride_i(2, 0);
+    conv->setF_i(LINEAR, 0);
+    check(up->outputWidth(0) == pool->inputWidth() && up->outputHeight(0) == pool->inputHeight() &&
+          conv->outputWidth(0) == 12 && conv->outputHeight(0) == 18, "mixed chain: 9 x 7 -> 27 x 21 -> 25 x 20 -> 12 x 18");
+    check(agreesMixed(up, pool, conv, 5, 3, x), "5 x 3 tiles match the layers run whole");
+    check(agreesMixed(up, pool, conv, 7, 4, x), "7 x 4 tiles, dividing neither dimension, match too");
+
+    delete tiling;
+    delete a;
+    delete b;
+    delete up;
+    delete pool;
+    delete conv;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,172 @@
+/**************************************************************************************************
+ NUMA layout and placement. The layout is read from a directory that does not exist (one node holding every
+ CPU) and from a made-up sysfs tree (two nodes with CPUs, one memory-only node skipped). Memory policy calls on
+ the machine's own layout must agree with each other when it has one node, and do nothing when simulated. Then
+ a ModelRegistry replicates a network over a simulated two-node layout, and three attached workers must each
+ be served only by copies on their own node.
+
+ Usage: ./tests/topology
+***************************************************************************************************/
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "registry.h"
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Write 'text' to 'dir'/'name'. */
+void put(const char* dir, const char* name, const char* text)
+  {
+    char path[TOPOLOGY_PATH_LEN];
+    FILE* fp;
+
+    snprintf(path, TOPOLOGY_PATH_LEN, "%s/%s", dir, name);
+    if((fp = fopen(path, "w")) == NULL)
+      exit(1);
+    fputs(text, fp);
+    fclose(fp);
+    return;
+  }
+
+/* Write a 2-2-1 XOR network to 'filename'. */
+void build(char* filename)
+  {
+    NeuralNet* nn = new NeuralNet(2);
+    double hiddenW[] = { 20.0, -20.0,  20.0, -20.0,  -10.0, 30.0 };
+    double outputW[] = { 20.0, 20.0, -30.0 };
+
+    nn->addDense(2, 2);
+    nn->addDense(2, 1);
+    nn->linkLayers(INPUT_ARRAY, 0, 0, 2, DENSE_ARRAY, 0);
+    nn->linkLayers(DENSE_ARRAY, 0, 0, 2, DENSE_ARRAY, 1);
+    nn->sortEdges();
+    nn->getDense(0)->setW(hiddenW);
+    nn->getDense(1)->setW(outputW);
+    nn->getDense(0)->setF_i(SIGMOID, 0);
+    nn->getDense(0)->setF_i(SIGMOID, 1);
+    nn->getDense(1)->setF_i(SIGMOID, 0);
+    nn->write(filename);
+    delete nn;
+    return;
+  }
+
+/* Worker 'w': attach, then make 'n' calls; '*ok' is cleared if a call fails or the worker lands on the wrong node. */
+void worker(ModelRegistry* reg, Topology* topo, unsigned int w, unsigned int n, atomic<bool>* ok)
+  {
+    double x[2] = { 1.0, 0.0 };
+    double* z;
+    unsigned int i;
+
+    if(reg->attach(w) != w % 2 || topo->here() != w % 2)
+      ok->store(false);
+    for(i = 0; i < n; i++)
+      {
+        if(reg->run(x, &z) != 1 || z[0] < 0.99)
+          ok->store(false);
+        free(z);
+      }
+    return;
+  }
+
+int main(int argc, char* argv[])
+  {
+    Topology* topo;
+    ModelRegistry* reg;
+    thread workers[3];
+    unsigned int counts[3] = { 100, 300, 150 };                     //  Workers 0 and 2 on node 0, 1 on node 1
+    unsigned long long onNode[2] = { 0, 0 };
+    unsigned int hardware = thread::hardware_concurrency();
+    unsigned int i;
+    char dir[] = "/tmp/topologyXXXXXX";
+    char sub[TOPOLOGY_PATH_LEN];
+    char filename[] = "topology_xor.nn";
+    atomic<bool> ok(true);
+    bool a, b, c;
+
+    if(hardware == 0)
+      hardware = 1;
+
+    topo = new Topology("/nonexistent/sys/devices/system/node");    //  No sysfs: one node, every CPU
+    check(topo->nodes() == 1 && topo->cpus(0) == hardware && !topo->simulated(), "missing sysfs: one node with every CPU");
+    for(i = 0, a = true; i < hardware; i++)
+      a = a && topo->cpu(0, i) == i && topo->nodeOf(i) == 0;
+    check(a, "missing sysfs: CPUs numbered in order on node 0");
+    delete topo;
+
+    if(mkdtemp(dir) == NULL)                                        //  Made-up sysfs: nodes 0 and 2 have CPUs
+      exit(1);
+    for(i = 0; i < 3; i++)
+      {
+        snprintf(sub, TOPOLOGY_PATH_LEN, "%s/node%u", dir, i);
+        mkdir(sub, 0700);
+      }
+    put(dir, "online", "0-2\n");
+    put(dir, "node0/cpulist", "0-3\n");
+    put(dir, "node1/cpulist", "\n");                                //  Memory only
+    put(dir, "node2/cpulist", "4-5,7\n");
+    topo = new Topology(dir);
+    check(topo->nodes() == 2 && topo->cpus(0) == 4 && topo->cpus(1) == 3, "sysfs tree: two nodes of 4 and 3 CPUs");
+    check(topo->cpu(1, 0) == 4 && topo->cpu(1, 2) == 7 && topo->nodeOf(7) == 1 && topo->nodeOf(3) == 0,
+          "sysfs tree: ranges and lists parsed");
+    delete topo;
+    for(i = 0; i < 3; i++)
+      {
+        snprintf(sub, TOPOLOGY_PATH_LEN, "%s/node%u/cpulist", dir, i);
+        remove(sub);
+        snprintf(sub, TOPOLOGY_PATH_LEN, "%s/node%u", dir, i);
+        rmdir(sub);
+      }
+    snprintf(sub, TOPOLOGY_PATH_LEN, "%s/online", dir);
+    remove(sub);
+    rmdir(dir);
+
+    topo = new Topology();                                          //  This machine
+    if(topo->nodes() == 1)
+      {
+        a = topo->prefer(0);
+        b = topo->interleave();
+        c = topo->restore();
+        check(a == b && b == c, "one node: prefer, interleave and restore agree");
+      }
+    else
+      printf("skip  one node: this machine has %u\n", topo->nodes());
+    delete topo;
+
+    topo = new Topology(2, 2);
+    check(!topo->prefer(0) && !topo->interleave() && !topo->restore(), "simulated layout: memory policy does nothing");
+
+    build(filename);
+    reg = new ModelRegistry(2, 4);
+    check(reg->setPlacement(topo, REGISTRY_REPLICATE, REGISTRY_PIN_NODE), "placement accepted before loading");
+    check(reg->loadAsync(filename, NULL, 0) && reg->wait(), "replicated version published");
+    check(!reg->setPlacement(NULL, REGISTRY_ANYWHERE, REGISTRY_PIN_NONE), "placement refused after loading");
+    for(i = 0, a = true; i < 4; i++)
+      a = a && reg->node(i) == i % 2;
+    check(a, "copies alternate between the nodes");
+    for(i = 0; i < 3; i++)
+      workers[i] = thread(worker, reg, topo, i, counts[i], &ok);
+    for(i = 0; i < 3; i++)
+      workers[i].join();
+    check(ok.load(), "workers attached to their nodes and served correctly");
+    for(i = 0; i < 4; i++)
+      onNode[reg->node(i)] += reg->calls(i);
+    printf("      node 0 copies served %llu calls, node 1 copies %llu\n", onNode[0], onNode[1]);
+    check(onNode[0] == counts[0] + counts[2] && onNode[1] == counts[1], "every call served on the caller's node");
+
+    delete reg;
+    delete topo;
+    remove(filename);
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
@@ -0,0 +1,157 @@
+/**************************************************************************************************
+ Up-res a small input with interpolated strides and duplicated padding and check the output by hand. Then build
+ a layer with a zero-width input, which must be taken as one pixel wide, and check that it runs. Last, up-res a
+ 2D input under three parameter sets, the first and third with the same horizontal settings so that they share
+ a horizontal pass, and check every output pixel against a direct evaluation from its four nearest sources.
+
+ Usage: ./tests/upres
+***************************************************************************************************/
+
+#include "upres.h"
+
+#define UPRES_W  4                                                  /* 2D input dimensions */
+#define UPRES_H  3
+
+unsigned int failures = 0;
+
+/* Report one check. */
+void check(bool ok, const char* what)
+  {
+    printf("%s  %s\n", ok ? "pass" : "FAIL", what);
+    if(!ok)
+      failures++;
+    return;
+  }
+
+/* Where output position 'o' falls along an axis of 'len' sources: the sources to either side, 'a' and 'b', and
+   their weights. Padding counts its distance 'd' from the border; strides their fraction of the way from a to b. */
+void axis(int o, int len, int stride, int pad, unsigned char sMethod, unsigned char pMethod,
+          int* a, double* wa, int* b, double* wb)
+  {
+    int u = o - pad;                                                //  Position in the strided grid
+    int last = (len - 1) * (stride + 1);
+    int d;
+    double t;
+
+    *wb = 0.0;
+    if(u < 0 || u > last)
+      {
+        d = (u < 0) ? -u : u - last;
+        *a = (u < 0) ? 0 : len - 1;
+        *b = *a;
+        if(pMethod == FILL_ZERO)
+          *wa = 0.0;
+        else if(pMethod == FILL_SAME)
+          *wa = 1.0;
+        else
+          *wa = (double)(pad + 1 - d) / (double)(pad + 1);
+        return;
+      }
+    *a = u / (stride + 1);
+    *b = (*a < len - 1) ? *a + 1 : *a;
+    t = (double)(u - *a * (stride + 1)) / (double)(stride + 1);
+    if(t == 0.0)
+      *wa = 1.0;
+    else if(sMethod == FILL_ZERO)
+      *wa = 0.0;
+    else if(sMethod == FILL_SAME)
+      {
+        *wa = (t <= 0.5) ? 1.0 : 0.0;
+        *wb = 1.0 - *wa;
+      }
+    else
+      {
+        *wa = 1.0 - t;
+        *wb = t;
+      }
+    return;
+  }
+
+/* Largest difference between parameter set i's output, which starts at 'z', and its direct evaluation on 'x'. */
+double compare(Upres* layer, unsigned int i, UpresParams* p, double* x, double* z)
+  {
+    unsigned int ox, oy;
+    int xa, xb, ya, yb;
+    double wxa, wxb, wya, wyb;
+    double v, d = 0.0;
+
+    for(oy = 0; oy < layer->outputHeight(i); oy++)
+      for(ox = 0; ox < layer->outputWidth(i); ox++)
+        {
+          axis(ox, UPRES_W, p->stride_h, p->padding_h, p->sMethod, p->pMethod, &xa, &wxa, &xb, &wxb);
+          axis(oy, UPRES_H, p->stride_v, p->padding_v, p->sMethod, p->pMethod, &ya, &wya, &yb, &wyb);
+          v = wya * (wxa * x[ya * UPRES_W + xa] + wxb * x[ya * UPRES_W + xb])
+            + wyb * (wxa * x[yb * UPRES_W + xa] + wxb * x[yb * UPRES_W + xb]);
+          if(fabs(v - z[oy * layer->outputWidth(i) + ox]) > d)
+            d = fabs(v - z[oy * layer->outputWidth(i) + ox]);
+        }
+    return d;
+  }
+
+int main(int argc, char* argv[])
+  {
+    Upres* layer = new Upres(2, 1);
+    Upres* thin = new Upres(0, 2);
+    Upres* grid = new Upres(UPRES_W, UPRES_H);
+    UpresParams p[3] = { { 2, 1, 1, 2, FILL_INTERP, FILL_INTERP },  //  Strides h, v; padding h, v; methods
+                         { 1, 2, 2, 1, FILL_SAME,   FILL_ZERO   },
+                         { 2, 3, 1, 0, FILL_INTERP, FILL_INTERP } };    //  The third shares the first's horizontal pass
+    double X[UPRES_W * UPRES_H];
+    unsigned int offset, r;
+    double x[2] = { 1.0, 3.0 };
+    double expect[5] = { 1.0, 1.0, 2.0, 3.0, 3.0 };                 //  Pad, source, stride, source, pad
+    unsigned int i;
+    double d;
+    bool ok;
+
+    layer->addParams(1, 0);
+    layer->setParamsHorzPad(1, 0);
+    layer->setParamsStrideMethod(FILL_INTERP, 0);
+    layer->setParamsPaddingMethod(FILL_SAME, 0);
+    check(layer->outputWidth(0) == 5 && layer->outputHeight(0) == 1, "stride 1, padding 1: 5 x 1");
+    ok = layer->run(x) == 5;
+    for(i = 0; i < 5 && ok; i++)
+      ok = fabs(layer->output()[i] - expect[i]) < 1e-12;
+    check(ok, "interpolated stride, duplicated padding");
+
+    thin->addParams(1, 1);
+    thin->setParamsPaddingMethod(FILL_SAME, 0);
+    check(thin->inputWidth() == 1 && thin->inputHeight() == 2, "zero-width input taken as one pixel");
+    check(thin->outputWidth(0) == 3 && thin->outputHeight(0) == 5, "its output is 3 x 5");
+    ok = thin->run(x) == 15;
+    for(i = 0; i < 15 && ok; i++)
+      ok = isfinite(thin->output()[i]);
+    check(ok && thin->output()[4] == 1.0 && thin->output()[13] == 3.0, "and it runs");
+
+    for(i = 0; i < 3; i++)
+      {
+        grid->addParams(p[i].stride_h, p[i].padding_h);
+        grid->setParamsVertStride(p[i].stride_v, i);
+        grid->setParamsVertPad(p[i].padding_v, i);
+        grid->setParamsStrideMethod(p[i].sMethod, i);
+        grid->setParamsPaddingMethod(p[i].pMethod, i);
+      }
+    for(r = 0; r < 2; r++)                                          //  A second input must refresh the shared pass
+      {
+        for(i = 0; i < UPRES_W * UPRES_H; i++)
+          X[i] = (double)((i * (5 + r)) % 7) - 3.0;
+        ok = grid->run(X) == grid->outputLen();
+        offset = 0;
+        for(i = 0; i < 3; i++)
+          {
+            d = compare(grid, i, p + i, X, grid->output() + offset);
+            printf("      input %d, parameter set %d (%d x %d): largest difference %.3e\n", r, i,
+                   grid->outputWidth(i), grid->outputHeight(i), d);
+            ok = ok && d < 1e-12;
+            offset += grid->outputWidth(i) * grid->outputHeight(i);
+          }
+        check(ok, (r == 0) ? "2D outputs match a direct per-pixel evaluation" : "and again on a second input");
+      }
+
+    delete layer;
+    delete thin;
+    delete grid;
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+  }
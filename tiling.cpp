@@ -0,0 +1,314 @@
+#ifndef __TILING_CPP
+#define __TILING_CPP
+
+#include "tiling.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Tile dimensions are measured in pixels of the chain's final output. */
+Tiling::Tiling(unsigned int w, unsigned int h)
+  {
+    stages = NULL;
+    n = 0;
+
+    tileW = (w > 0) ? w : 1;
+    tileH = (h > 0) ? h : 1;
+
+    bufA = NULL;
+    bufB = NULL;
+    bufLen = 0;
+  }
+
+Tiling::~Tiling()
+  {
+    if(n > 0)
+      free(stages);
+    if(bufA != NULL)
+      free(bufA);
+    if(bufB != NULL)
+      free(bufB);
+  }
+
+/**************************************************************************************************
+ Building the chain  */
+
+/* Append a Conv2D stage. The layer must have exactly one filter (and run() checks that it is not SOFTMAX). */
+bool Tiling::addConv2D(Conv2D* layer)
+  {
+    if(layer->filterCount() != 1)
+      {
+        cout << "ERROR: Only single-filter Conv2D layers can be tiled\n";
+        return false;
+      }
+    return append(TILE_CONV2D, (void*)layer, layer->inputWidth(), layer->inputHeight(),
+                  layer->outputWidth(0), layer->outputHeight(0));
+  }
+
+/* Append a Pooling stage. The layer must have exactly one pool. */
+bool Tiling::addPool(Pooling* layer)
+  {
+    if(layer->poolCount() != 1)
+      {
+        cout << "ERROR: Only single-pool Pooling layers can be tiled\n";
+        return false;
+      }
+    return append(TILE_POOL, (void*)layer, layer->inputWidth(), layer->inputHeight(),
+                  layer->outputWidth(0), layer->outputHeight(0));
+  }
+
+/* Append an Upres stage. The layer must have exactly one parameter set. */
+bool Tiling::addUpres(Upres* layer)
+  {
+    if(layer->paramsCount() != 1)
+      {
+        cout << "ERROR: Only single-parameter Upres layers can be tiled\n";
+        return false;
+      }
+    return append(TILE_UPRES, (void*)layer, layer->inputWidth(), layer->inputHeight(),
+                  layer->outputWidth(0), layer->outputHeight(0));
+  }
+
+/* Append a stage after checking that its input dimensions match the previous stage's output. */
+bool Tiling::append(unsigned char type, void* layer, unsigned int inW, unsigned int inH, unsigned int outW, unsigned int outH)
+  {
+    unsigned int w, h;
+
+    if(n > 0)
+      {
+        stageOutput(n - 1, &w, &h);
+        if(w != inW || h != inH)
+          {
+            cout << "ERROR: Tiled stage expects a " << inW << " x " << inH << " input but follows a "
+                 << w << " x " << h << " output\n";
+            return false;
+          }
+      }
+    if(outW == 0 || outH == 0)
+      {
+        cout << "ERROR: Tiled stage produces no output\n";
+        return false;
+      }
+
+    n++;
+    if((stages = (TileStage*)realloc(stages, n * sizeof(TileStage))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Tiling stage array\n";
+        exit(1);
+      }
+    stages[n - 1].type = type;
+    stages[n - 1].layer = layer;
+
+    return true;
+  }
+
+/**************************************************************************************************
+ Dimensions  */
+
+/* Write the width and height of the i-th stage's output. */
+void Tiling::stageOutput(unsigned int i, unsigned int* w, unsigned int* h) const
+  {
+    switch(stages[i].type)
+      {
+        case TILE_CONV2D:  *w = ((Conv2D*)stages[i].layer)->outputWidth(0);
+                           *h = ((Conv2D*)stages[i].layer)->outputHeight(0);
+                           break;
+        case TILE_POOL:    *w = ((Pooling*)stages[i].layer)->outputWidth(0);
+                           *h = ((Pooling*)stages[i].layer)->outputHeight(0);
+                           break;
+        default:           *w = ((Upres*)stages[i].layer)->outputWidth(0);
+                           *h = ((Upres*)stages[i].layer)->outputHeight(0);
+                           break;
+      }
+    return;
+  }
+
+/*  */
+unsigned int Tiling::inputWidth() const
+  {
+    if(n == 0)
+      return 0;
+    switch(stages[0].type)
+      {
+        case TILE_CONV2D:  return ((Conv2D*)stages[0].layer)->inputWidth();
+        case TILE_POOL:    return ((Pooling*)stages[0].layer)->inputWidth();
+        default:           return ((Upres*)stages[0].layer)->inputWidth();
+      }
+  }
+
+/*  */
+unsigned int Tiling::inputHeight() const
+  {
+    if(n == 0)
+      return 0;
+    switch(stages[0].type)
+      {
+        case TILE_CONV2D:  return ((Conv2D*)stages[0].layer)->inputHeight();
+        case TILE_POOL:    return ((Pooling*)stages[0].layer)->inputHeight();
+        default:           return ((Upres*)stages[0].layer)->inputHeight();
+      }
+  }
+
+/*  */
+unsigned int Tiling::outputWidth() const
+  {
+    unsigned int w = 0, h = 0;
+    if(n > 0)
+      stageOutput(n - 1, &w, &h);
+    return w;
+  }
+
+/*  */
+unsigned int Tiling::outputHeight() const
+  {
+    unsigned int w = 0, h = 0;
+    if(n > 0)
+      stageOutput(n - 1, &w, &h);
+    return h;
+  }
+
+/*  */
+unsigned int Tiling::outputLen() const
+  {
+    return outputWidth() * outputHeight();
+  }
+
+/* Each of the two ping-pong buffers is 'bufLen' long. */
+unsigned int Tiling::scratchLen() const
+  {
+    return 2 * bufLen;
+  }
+
+/**************************************************************************************************
+ Run chain  */
+
+/* Work backward from the final-output region [x0, x1) x [y0, y1), filling in every stage's output and input regions. */
+void Tiling::regions(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+  {
+    unsigned int i = n;
+
+    stages[n - 1].out[0] = x0;
+    stages[n - 1].out[1] = y0;
+    stages[n - 1].out[2] = x1;
+    stages[n - 1].out[3] = y1;
+
+    while(i > 0)
+      {
+        i--;
+        switch(stages[i].type)
+          {
+            case TILE_CONV2D:  ((Conv2D*)stages[i].layer)->inputRegion(0, stages[i].out[0], stages[i].out[1],
+                                                                        stages[i].out[2], stages[i].out[3], stages[i].in);
+                               break;
+            case TILE_POOL:    ((Pooling*)stages[i].layer)->inputRegion(0, stages[i].out[0], stages[i].out[1],
+                                                                         stages[i].out[2], stages[i].out[3], stages[i].in);
+                               break;
+            default:           ((Upres*)stages[i].layer)->inputRegion(0, stages[i].out[0], stages[i].out[1],
+                                                                       stages[i].out[2], stages[i].out[3], stages[i].in);
+                               break;
+          }
+        if(i > 0)
+          memcpy(stages[i - 1].out, stages[i].in, sizeof(stages[i].in));
+      }
+
+    return;
+  }
+
+/* Make the scratch buffers hold the largest region any stage produces for the current tile. Checked for every tile
+   of every run, since the layers' strides and filters may have changed since the last one. */
+void Tiling::grow()
+  {
+    unsigned int i;
+    unsigned int len = bufLen;
+
+    for(i = 0; i < n; i++)
+      {
+        if((stages[i].out[2] - stages[i].out[0]) * (stages[i].out[3] - stages[i].out[1]) > len)
+          len = (stages[i].out[2] - stages[i].out[0]) * (stages[i].out[3] - stages[i].out[1]);
+      }
+    if(len > bufLen)
+      {
+        bufLen = len;
+        if((bufA = (double*)realloc(bufA, bufLen * sizeof(double))) == NULL ||
+           (bufB = (double*)realloc(bufB, bufLen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Tiling scratch buffers\n";
+            exit(1);
+          }
+      }
+
+    return;
+  }
+
+/* Run the chain on the (inputWidth() * inputHeight()) row-major input 'x', writing the final
+   (outputWidth() * outputHeight()) row-major output to 'z'. The first stage reads straight from 'x'.
+   Return the length of the output. */
+unsigned int Tiling::run(double* x, double* z)
+  {
+    unsigned int w, h;
+    unsigned int tx, ty, tx1, ty1;
+    unsigned int i, y;
+    unsigned int inW;                                               //  Row length of the current stage's input
+    double* src;
+    double* dst;
+    double* tmp;
+
+    if(n == 0)
+      return 0;
+
+    for(i = 0; i < n; i++)                                          //  SOFTMAX cannot be normalized tile by tile
+      {
+        if(stages[i].type == TILE_CONV2D && ((Conv2D*)stages[i].layer)->getF_i(0) == SOFTMAX)
+          {
+            cout << "ERROR: SOFTMAX Conv2D filters cannot be tiled\n";
+            return 0;
+          }
+      }
+
+    w = outputWidth();
+    h = outputHeight();
+
+    for(ty = 0; ty < h; ty += tileH)
+      {
+        ty1 = (ty + tileH < h) ? ty + tileH : h;
+        for(tx = 0; tx < w; tx += tileW)
+          {
+            tx1 = (tx + tileW < w) ? tx + tileW : w;
+            regions(tx, ty, tx1, ty1);
+            grow();
+
+            src = x;                                                //  The first stage reads the whole input in place
+            inW = inputWidth();
+            dst = bufA;
+            for(i = 0; i < n; i++)
+              {
+                switch(stages[i].type)
+                  {
+                    case TILE_CONV2D:  ((Conv2D*)stages[i].layer)->runRegion(0, src,
+                                         (i == 0) ? 0 : stages[i].in[0], (i == 0) ? 0 : stages[i].in[1], inW,
+                                         stages[i].out[0], stages[i].out[1], stages[i].out[2], stages[i].out[3], dst);
+                                       break;
+                    case TILE_POOL:    ((Pooling*)stages[i].layer)->runRegion(0, src,
+                                         (i == 0) ? 0 : stages[i].in[0], (i == 0) ? 0 : stages[i].in[1], inW,
+                                         stages[i].out[0], stages[i].out[1], stages[i].out[2], stages[i].out[3], dst);
+                                       break;
+                    default:           ((Upres*)stages[i].layer)->runRegion(0, src,
+                                         (i == 0) ? 0 : stages[i].in[0], (i == 0) ? 0 : stages[i].in[1], inW,
+                                         stages[i].out[0], stages[i].out[1], stages[i].out[2], stages[i].out[3], dst);
+                                       break;
+                  }
+                inW = stages[i].out[2] - stages[i].out[0];
+                src = dst;
+                tmp = (dst == bufA) ? bufB : bufA;
+                dst = tmp;
+              }
+
+            for(y = ty; y < ty1; y++)                               //  Scatter the finished tile
+              memcpy(z + y * w + tx, src + (y - ty) * (tx1 - tx), (tx1 - tx) * sizeof(double));
+          }
+      }
+
+    return w * h;
+  }
+
+#endif
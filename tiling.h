@@ -0,0 +1,98 @@
+#ifndef __TILING_H
+#define __TILING_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ Run a chain of 2D layers (Conv2D, Pooling, Upres) one output tile at a time.
+ Each layer's run() materializes its entire output before the next layer starts; for large images those
+ intermediates are too big for cache, or even for RAM. A Tiling instead walks the final output in
+ (tileW by tileH) tiles. For each tile it works backward through the chain to find the region (tile plus halo)
+ every stage must produce, then runs the stages forward on just those regions while they are cache-resident.
+
+   input          stage 0            stage 1            stage 2 = final output
+ [ . . . . ]    [ . . . . ]        [ . . . . ]        [ # # . . ]
+ [ . # # # ] -> [ . # # # ]   ->   [ # # # . ]   ->   [ # # . . ]
+ [ . # # # ]    [ . # # # ]        [ # # # . ]        [ . . . . ]
+ [ . # # # ]    [ . . . . ]        [ . . . . ]        [ . . . . ]
+
+ Scratch memory is two buffers, each as large as the largest region any stage produces for one tile.
+ No full-size intermediate is ever allocated; the stages' own output buffers are left untouched.
+
+ Every stage must produce exactly one map: one filter, one pool, or one parameter set. Each stage's output
+ dimensions must match the next stage's input dimensions. SOFTMAX filters are refused because they
+ normalize over the whole map.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <iostream>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conv2d.h"
+#include "pooling.h"
+#include "upres.h"
+
+#define TILE_CONV2D  0                                              /* Stage is a Conv2D layer */
+#define TILE_POOL    1                                              /* Stage is a Pooling layer */
+#define TILE_UPRES   2                                              /* Stage is an Upres layer */
+
+/*
+#define __TILING_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Typedefs  */
+
+typedef struct TileStageType
+  {
+    unsigned char type;                                             //  In {TILE_CONV2D, TILE_POOL, TILE_UPRES}
+    void* layer;                                                    //  Points to the Conv2D, Pooling, or Upres
+
+    unsigned int in[4];                                             //  Input region { x0, y0, x1, y1 } for the current tile
+    unsigned int out[4];                                            //  Output region { x0, y0, x1, y1 } for the current tile
+  } TileStage;
+
+/**************************************************************************************************
+ Tiling  */
+class Tiling
+  {
+    public:
+      Tiling(unsigned int, unsigned int);                           //  Constructor(s): tile width and height
+      ~Tiling();                                                    //  Destructor
+
+      bool addConv2D(Conv2D*);                                      //  Append a stage to the chain
+      bool addPool(Pooling*);
+      bool addUpres(Upres*);
+
+      unsigned int inputWidth() const;
+      unsigned int inputHeight() const;
+      unsigned int outputWidth() const;
+      unsigned int outputHeight() const;
+      unsigned int outputLen() const;
+      unsigned int scratchLen() const;                              //  Number of doubles of scratch space in use
+      unsigned int run(double*, double*);                           //  Run the chain on an input, writing the final output
+
+    private:
+      TileStage* stages;                                            //  Array of stages, in the order they run
+      unsigned int n;                                               //  Length of that array
+
+      unsigned int tileW;                                           //  Tile dimensions, in final-output pixels
+      unsigned int tileH;
+
+      double* bufA;                                                 //  Ping-pong buffers for stage outputs
+      double* bufB;
+      unsigned int bufLen;                                          //  Length of each buffer; only ever grows
+
+      bool append(unsigned char, void*, unsigned int, unsigned int, unsigned int, unsigned int);
+      void stageOutput(unsigned int, unsigned int*, unsigned int*) const;
+      void regions(unsigned int, unsigned int, unsigned int, unsigned int);
+      void grow();                                                  //  Fit the scratch buffers to the current tile
+  };
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef __TOPOLOGY_CPP
+#define __TOPOLOGY_CPP
+
+#include "topology.h"
+
+static thread_local int topology_here = -1;                         //  Node this thread was pinned to, if any
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Read the layout from sysfs. Without it (not Linux, or no NUMA support), report one node holding every CPU. */
+Topology::Topology() : Topology(TOPOLOGY_SYSFS)
+  {
+  }
+
+/* Read the layout from 'dir', which holds an "online" node list and a "node<n>/cpulist" per node, as sysfs does.
+   Without it, report one node holding every CPU. */
+Topology::Topology(const char* dir)
+  {
+    unsigned int i, n;
+    unsigned int* online = NULL;
+    unsigned int* list;
+    unsigned int len;
+    unsigned int onlineLen = 0;
+    char path[TOPOLOGY_PATH_LEN];
+    char line[TOPOLOGY_LINE_LEN];
+    FILE* fp;
+
+    hardware = thread::hardware_concurrency();
+    if(hardware == 0)
+      hardware = 1;
+    fake = false;
+    nodeLen = 0;
+    start = NULL;
+    cpuList = NULL;
+    nodeIds = NULL;
+
+    snprintf(path, TOPOLOGY_PATH_LEN, "%s/online", dir);
+    if((fp = fopen(path, "r")) != NULL)
+      {
+        if(fgets(line, TOPOLOGY_LINE_LEN, fp) != NULL)
+          onlineLen = parseList(line, &online);
+        fclose(fp);
+      }
+
+    if((start = (unsigned int*)malloc(((onlineLen > 0) ? onlineLen : 1) * sizeof(int) + sizeof(int))) == NULL ||
+       (nodeIds = (unsigned int*)malloc(((onlineLen > 0) ? onlineLen : 1) * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate topology\n";
+        exit(1);
+      }
+    start[0] = 0;
+
+    for(i = 0; i < onlineLen; i++)                                  //  Gather each node's CPUs
+      {
+        snprintf(path, TOPOLOGY_PATH_LEN, "%s/node%u/cpulist", dir, online[i]);
+        if((fp = fopen(path, "r")) == NULL)
+          continue;
+        len = 0;
+        list = NULL;
+        if(fgets(line, TOPOLOGY_LINE_LEN, fp) != NULL)
+          len = parseList(line, &list);
+        fclose(fp);
+        if(len == 0)                                                //  Memory-only nodes run nothing
+          {
+            if(list != NULL)
+              free(list);
+            continue;
+          }
+
+        if((cpuList = (unsigned int*)realloc(cpuList, (start[nodeLen] + len) * sizeof(int))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate topology CPU list\n";
+            exit(1);
+          }
+        memcpy(cpuList + start[nodeLen], list, len * sizeof(int));
+        free(list);
+        nodeIds[nodeLen] = online[i];
+        start[nodeLen + 1] = start[nodeLen] + len;
+        nodeLen++;
+      }
+    if(online != NULL)
+      free(online);
+
+    if(nodeLen == 0)                                                //  No NUMA information: one node, every CPU
+      {
+        if((cpuList = (unsigned int*)malloc(hardware * sizeof(int))) == NULL)
+          {
+            cout << "ERROR: Unable to allocate topology CPU list\n";
+            exit(1);
+          }
+        for(n = 0; n < hardware; n++)
+          cpuList[n] = n;
+        nodeIds[0] = 0;
+        start[1] = hardware;
+        nodeLen = 1;
+      }
+  }
+
+/* Simulate 'nodes' nodes of 'cpusPerNode' CPUs each, numbered node by node. */
+Topology::Topology(unsigned int nodes, unsigned int cpusPerNode)
+  {
+    unsigned int i;
+
+    hardware = thread::hardware_concurrency();
+    if(hardware == 0)
+      hardware = 1;
+    fake = true;
+    nodeLen = (nodes > 0) ? nodes : 1;
+    if(cpusPerNode == 0)
+      cpusPerNode = 1;
+
+    if((start = (unsigned int*)malloc((nodeLen + 1) * sizeof(int))) == NULL ||
+       (nodeIds = (unsigned int*)malloc(nodeLen * sizeof(int))) == NULL ||
+       (cpuList = (unsigned int*)malloc(nodeLen * cpusPerNode * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate simulated topology\n";
+        exit(1);
+      }
+    for(i = 0; i <= nodeLen; i++)
+      start[i] = i * cpusPerNode;
+    for(i = 0; i < nodeLen; i++)
+      nodeIds[i] = i;
+    for(i = 0; i < nodeLen * cpusPerNode; i++)
+      cpuList[i] = i;
+  }
+
+Topology::~Topology()
+  {
+    free(start);
+    free(nodeIds);
+    free(cpuList);
+  }
+
+/**************************************************************************************************
+ Layout  */
+
+/*  */
+unsigned int Topology::nodes() const
+  {
+    return nodeLen;
+  }
+
+/*  */
+unsigned int Topology::cpus(unsigned int node) const
+  {
+    if(node >= nodeLen)
+      return 0;
+    return start[node + 1] - start[node];
+  }
+
+/* The k-th CPU of 'node', wrapping around if k exceeds its count. */
+unsigned int Topology::cpu(unsigned int node, unsigned int k) const
+  {
+    node %= nodeLen;
+    return cpuList[start[node] + k % (start[node + 1] - start[node])];
+  }
+
+/* Node holding CPU 'c', or 0 if no node lists it. */
+unsigned int Topology::nodeOf(unsigned int c) const
+  {
+    unsigned int n, i;
+
+    for(n = 0; n < nodeLen; n++)
+      for(i = start[n]; i < start[n + 1]; i++)
+        {
+          if(cpuList[i] == c)
+            return n;
+        }
+
+    return 0;
+  }
+
+/*  */
+bool Topology::simulated() const
+  {
+    return fake;
+  }
+
+/*  */
+void Topology::print() const
+  {
+    unsigned int n, i;
+
+    for(n = 0; n < nodeLen; n++)
+      {
+        printf("Node %u%s:", nodeIds[n], fake ? " (simulated)" : "");
+        for(i = start[n]; i < start[n + 1]; i++)
+          printf(" %u", cpuList[i]);
+        printf("\n");
+      }
+    return;
+  }
+
+/**************************************************************************************************
+ Threads and memory  */
+
+/* Let the calling thread run on any CPU of 'node', and remember that it belongs there. Return false if the
+   operating system refused or cannot pin threads; the node is remembered either way. */
+bool Topology::pin(unsigned int node) const
+  {
+    node %= nodeLen;
+    return setAffinity(cpuList + start[node], start[node + 1] - start[node], node);
+  }
+
+/* Let the calling thread run only on the k-th CPU of 'node'. */
+bool Topology::pinCPU(unsigned int node, unsigned int k) const
+  {
+    unsigned int c;
+
+    node %= nodeLen;
+    c = cpu(node, k);
+    return setAffinity(&c, 1, node);
+  }
+
+/* Count the calling thread as belonging to 'node' (see here()) without restricting where it runs. */
+void Topology::enter(unsigned int node) const
+  {
+    topology_here = (int)(node % nodeLen);
+    return;
+  }
+
+/* Ask that pages the calling thread touches first from now on come from 'node'. */
+bool Topology::prefer(unsigned int node) const
+  {
+    return setPolicy(TOPOLOGY_MPOL_PREFERRED, 1UL << (nodeIds[node % nodeLen] % TOPOLOGY_MAX_NODES));
+  }
+
+/* Spread pages the calling thread touches first from now on over every node, page by page. */
+bool Topology::interleave() const
+  {
+    unsigned long mask = 0;
+    unsigned int n;
+
+    for(n = 0; n < nodeLen; n++)
+      mask |= 1UL << (nodeIds[n] % TOPOLOGY_MAX_NODES);
+    return setPolicy(TOPOLOGY_MPOL_INTERLEAVE, mask);
+  }
+
+/* Undo prefer() or interleave() for the calling thread. */
+bool Topology::restore() const
+  {
+    return setPolicy(TOPOLOGY_MPOL_DEFAULT, 0);
+  }
+
+/* The node the calling thread was last pinned to through any Topology; failing that, the node of the CPU it is
+   on now (real layouts only); failing that, 0. */
+unsigned int Topology::here() const
+  {
+#ifdef __linux__
+    int c;
+#endif
+
+    if(topology_here >= 0)
+      return (unsigned int)topology_here % nodeLen;
+
+#ifdef __linux__
+    if(!fake && (c = sched_getcpu()) >= 0)
+      return nodeOf((unsigned int)c);
+#endif
+
+    return 0;
+  }
+
+/* Restrict the calling thread to the 'len' CPUs in 'list', recording that it belongs to 'node'. Simulated CPUs
+   map onto real ones modulo the number present. */
+bool Topology::setAffinity(unsigned int* list, unsigned int len, unsigned int node) const
+  {
+#ifdef __linux__
+    cpu_set_t set;
+    unsigned int i;
+#endif
+
+    topology_here = (int)node;
+
+#ifdef __linux__
+    CPU_ZERO(&set);
+    for(i = 0; i < len; i++)
+      CPU_SET((fake ? list[i] % hardware : list[i]) % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+    return false;
+#endif
+  }
+
+/* Set the calling thread's memory policy. Does nothing, and returns false, under a simulated layout or where
+   the system call is unavailable. */
+bool Topology::setPolicy(int mode, unsigned long mask) const
+  {
+    if(fake)
+      return false;
+
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    return syscall(SYS_set_mempolicy, mode, (mode == TOPOLOGY_MPOL_DEFAULT) ? NULL : &mask,
+                                            (mode == TOPOLOGY_MPOL_DEFAULT) ? 0 : TOPOLOGY_MAX_NODES + 1) == 0;
+#else
+    return false;
+#endif
+  }
+
+/* Parse a Linux list such as "0-3,8,10-11" into a malloc'd array at '*list' (the caller frees it); return its
+   length. */
+unsigned int Topology::parseList(const char* str, unsigned int** list)
+  {
+    unsigned int len = 0;
+    unsigned long a, b, i;
+    char* end;
+
+    (*list) = NULL;
+    while(*str != '\0' && *str != '\n')
+      {
+        a = strtoul(str, &end, 10);
+        if(end == str)
+          break;
+        b = a;
+        str = end;
+        if(*str == '-')
+          {
+            b = strtoul(str + 1, &end, 10);
+            str = end;
+          }
+        if(b < a)
+          b = a;
+        if(((*list) = (unsigned int*)realloc((*list), (len + (b - a + 1)) * sizeof(int))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate parsed list\n";
+            exit(1);
+          }
+        for(i = a; i <= b; i++)
+          (*list)[len++] = (unsigned int)i;
+        if(*str == ',')
+          str++;
+      }
+
+    return len;
+  }
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef __TOPOLOGY_H
+#define __TOPOLOGY_H
+
+/**************************************************************************************************
+ Neural Network library, by Eric C. Joyce
+
+ The machine's NUMA nodes and their CPUs, and the means to keep a thread and its memory on one of them.
+  nodes = number of NUMA nodes
+  cpus(n) = number of CPUs on node n; cpu(n, k) is the k-th of them
+
+ Topology() reads the layout from Linux's /sys/devices/system/node, falling back to a single node holding every
+ CPU. Topology(directory) reads it from another directory laid out the same way. Topology(nodes, cpusPerNode) simulates a layout instead, so that placement logic can be exercised on a
+ single-node machine: simulated CPU k is the real CPU k modulo the number of CPUs present, and memory policy
+ calls do nothing.
+
+ Pages are placed by the policy of the thread that first touches them. prefer() asks that the calling thread's
+ new pages come from one node; interleave() spreads them over every node; restore() returns to the default.
+ A network loaded by a thread pinned to node n and preferring it therefore has its weights on node n.
+
+ Pinning through this class also records, per thread, the node pinned to (see here()), so that work can be
+ routed to data on the same node even under a simulated layout.
+
+ Note that this file does NOT seed the randomizer. That should be done by the parent program.
+***************************************************************************************************/
+
+#include <iostream>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define TOPOLOGY_SYSFS      "/sys/devices/system/node"              /* Where Linux describes NUMA nodes */
+#define TOPOLOGY_LINE_LEN   4096                                    /* Longest CPU list read from sysfs */
+#define TOPOLOGY_PATH_LEN   1024                                    /* Longest file path built under it */
+#define TOPOLOGY_MAX_NODES  64                                      /* Nodes addressable by a memory policy mask */
+
+#define TOPOLOGY_MPOL_DEFAULT     0                                 /* Linux memory policies, from <linux/mempolicy.h> */
+#define TOPOLOGY_MPOL_PREFERRED   1
+#define TOPOLOGY_MPOL_INTERLEAVE  3
+
+/*
+#define __TOPOLOGY_DEBUG 1
+*/
+
+using namespace std;
+
+/**************************************************************************************************
+ Topology  */
+class Topology
+  {
+    public:
+      Topology();                                                   //  Constructor(s): the machine's own layout
+      Topology(const char*);                                        //  The layout under a sysfs-style directory
+      Topology(unsigned int, unsigned int);                         //  Simulated: nodes, CPUs per node
+      ~Topology();                                                  //  Destructor
+
+      unsigned int nodes() const;
+      unsigned int cpus(unsigned int) const;                        //  CPUs on the given node
+      unsigned int cpu(unsigned int, unsigned int) const;           //  The k-th CPU of a node
+      unsigned int nodeOf(unsigned int) const;                      //  Node holding the given CPU
+      bool simulated() const;
+
+      bool pin(unsigned int) const;                                 //  Keep the calling thread on a node's CPUs
+      bool pinCPU(unsigned int, unsigned int) const;                //  Keep the calling thread on one CPU of a node
+      void enter(unsigned int) const;                               //  Count the calling thread as on a node, unpinned
+      bool prefer(unsigned int) const;                              //  Take the calling thread's new pages from a node
+      bool interleave() const;                                      //  Spread the calling thread's new pages over all nodes
+      bool restore() const;                                         //  Default memory policy for the calling thread
+      unsigned int here() const;                                    //  Node the calling thread runs on
+      void print() const;
+
+    private:
+      unsigned int nodeLen;                                         //  Number of nodes
+      unsigned int* start;                                          //  (nodeLen + 1)-array: node n's CPUs are
+      unsigned int* cpuList;                                        //  cpuList[start[n]] to cpuList[start[n + 1] - 1]
+      unsigned int* nodeIds;                                        //  The operating system's number for each node
+      unsigned int hardware;                                        //  CPUs actually present
+      bool fake;                                                    //  Whether the layout is simulated
+
+      bool setAffinity(unsigned int*, unsigned int, unsigned int) const;
+      bool setPolicy(int, unsigned long) const;
+      static unsigned int parseList(const char*, unsigned int**);
+  };
+
+#endif
@@ -0,0 +1,628 @@
+#ifndef __UPRES_CPP
+#define __UPRES_CPP
+
+#include "upres.h"
+
+/**************************************************************************************************
+ Constructor(s)/Destructor  */
+
+/* Input dimensions are width and height; a zero dimension is taken as one. */
+Upres::Upres(unsigned int w, unsigned int h)
+  {
+    unsigned int i;
+
+    inputW = (w > 0) ? w : 1;
+    inputH = (h > 0) ? h : 1;
+    params = NULL;
+    n = 0;
+
+    hKernels = NULL;
+    vKernels = NULL;
+    hShare = NULL;
+    hOffset = NULL;
+    rows = NULL;
+    tileRows = NULL;
+    tileRowsLen = 0;
+    kernelsReady = false;
+
+    outlen = 0;
+    out = NULL;
+
+    for(i = 0; i < LAYER_NAME_LEN; i++)                             //  Blank out layer name
+      layerName[i] = '\0';
+  }
+
+Upres::~Upres()
+  {
+    unsigned int i;
+
+    for(i = 0; i < n; i++)
+      {
+        freeKernel(hKernels + i);
+        freeKernel(vKernels + i);
+      }
+    if(n > 0)
+      {
+        free(params);
+        free(hKernels);
+        free(vKernels);
+        free(hShare);
+        free(hOffset);
+      }
+    if(rows != NULL)
+      free(rows);
+    if(tileRows != NULL)
+      free(tileRows);
+    if(out != NULL)
+      free(out);
+  }
+
+/**************************************************************************************************
+ Parameters  */
+
+/* Add a parameter set with the given stride and padding (applied both horizontally and vertically).
+   Strides and padding are filled with zeroes until told otherwise.
+   Return the number of parameter sets in this layer. */
+unsigned int Upres::addParams(unsigned int stride, unsigned int padding)
+  {
+    n++;
+    if((params = (UpresParams*)realloc(params, n * sizeof(UpresParams))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's parameter array\n";
+        exit(1);
+      }
+    if((hKernels = (UpresKernel*)realloc(hKernels, n * sizeof(UpresKernel))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's horizontal kernel array\n";
+        exit(1);
+      }
+    if((vKernels = (UpresKernel*)realloc(vKernels, n * sizeof(UpresKernel))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's vertical kernel array\n";
+        exit(1);
+      }
+    if((hShare = (unsigned int*)realloc(hShare, n * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's kernel-sharing array\n";
+        exit(1);
+      }
+    if((hOffset = (unsigned int*)realloc(hOffset, n * sizeof(int))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's kernel-offset array\n";
+        exit(1);
+      }
+
+    params[n - 1].stride_h = stride;
+    params[n - 1].stride_v = stride;
+    params[n - 1].padding_h = padding;
+    params[n - 1].padding_v = padding;
+    params[n - 1].sMethod = FILL_ZERO;
+    params[n - 1].pMethod = FILL_ZERO;
+
+    hKernels[n - 1].len = 0;                                        //  Kernels are built lazily, on the next run
+    hKernels[n - 1].i0 = NULL;
+    hKernels[n - 1].i1 = NULL;
+    hKernels[n - 1].w0 = NULL;
+    hKernels[n - 1].w1 = NULL;
+    vKernels[n - 1] = hKernels[n - 1];
+    kernelsReady = false;
+
+    return n;
+  }
+
+/* Set the horizontal stride of the i-th parameter set. */
+void Upres::setParamsHorzStride(unsigned int stride, unsigned int i)
+  {
+    if(i < n)
+      {
+        params[i].stride_h = stride;
+        kernelsReady = false;
+      }
+  }
+
+/* Set the vertical stride of the i-th parameter set. */
+void Upres::setParamsVertStride(unsigned int stride, unsigned int i)
+  {
+    if(i < n)
+      {
+        params[i].stride_v = stride;
+        kernelsReady = false;
+      }
+  }
+
+/* Set the horizontal padding of the i-th parameter set. */
+void Upres::setParamsHorzPad(unsigned int pad, unsigned int i)
+  {
+    if(i < n)
+      {
+        params[i].padding_h = pad;
+        kernelsReady = false;
+      }
+  }
+
+/* Set the vertical padding of the i-th parameter set. */
+void Upres::setParamsVertPad(unsigned int pad, unsigned int i)
+  {
+    if(i < n)
+      {
+        params[i].padding_v = pad;
+        kernelsReady = false;
+      }
+  }
+
+/* Set the stride-filling method of the i-th parameter set, in {FILL_ZERO, FILL_SAME, FILL_INTERP}. */
+void Upres::setParamsStrideMethod(unsigned char m, unsigned int i)
+  {
+    if(i < n && m <= FILL_INTERP)
+      {
+        params[i].sMethod = m;
+        kernelsReady = false;
+      }
+  }
+
+/* Set the padding-filling method of the i-th parameter set, in {FILL_ZERO, FILL_SAME, FILL_INTERP}. */
+void Upres::setParamsPaddingMethod(unsigned char m, unsigned int i)
+  {
+    if(i < n && m <= FILL_INTERP)
+      {
+        params[i].pMethod = m;
+        kernelsReady = false;
+      }
+  }
+
+/**************************************************************************************************
+ Kernels  */
+
+/* (Re)build both kernels of every parameter set, find which parameter sets can share a horizontal pass,
+   and size the row and output buffers. */
+void Upres::buildKernels()
+  {
+    unsigned int i, j;
+    unsigned int rowslen = 0;
+
+    outlen = 0;
+    for(i = 0; i < n; i++)
+      {
+        freeKernel(hKernels + i);
+        freeKernel(vKernels + i);
+        buildKernel(hKernels + i, inputW, params[i].stride_h, params[i].padding_h, params[i].sMethod, params[i].pMethod);
+        buildKernel(vKernels + i, inputH, params[i].stride_v, params[i].padding_v, params[i].sMethod, params[i].pMethod);
+
+        for(j = 0; j < i; j++)                                      //  Same horizontal settings = same horizontal pass
+          {
+            if(hShare[j] == j && params[j].stride_h == params[i].stride_h && params[j].padding_h == params[i].padding_h &&
+               params[j].sMethod == params[i].sMethod && params[j].pMethod == params[i].pMethod)
+              break;
+          }
+        hShare[i] = j;
+        if(j == i)
+          {
+            hOffset[i] = rowslen;
+            rowslen += hKernels[i].len * inputH;
+          }
+        else
+          hOffset[i] = hOffset[j];
+
+        outlen += hKernels[i].len * vKernels[i].len;
+      }
+
+    if((rows = (double*)realloc(rows, rowslen * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's row buffer\n";
+        exit(1);
+      }
+    if((out = (double*)realloc(out, outlen * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to re-allocate Upres layer's output buffer\n";
+        exit(1);
+      }
+
+    kernelsReady = true;
+    return;
+  }
+
+/* Build the 1D kernel for a source of length 'srclen', stretched by 'stride' and padded by 'pad' on both ends.
+   Output position o draws on source positions i0[o] and i1[o] with weights w0[o] and w1[o]. */
+void Upres::buildKernel(UpresKernel* k, unsigned int srclen, unsigned int stride, unsigned int pad,
+                        unsigned char sMethod, unsigned char pMethod)
+  {
+    unsigned int o;
+    unsigned int span = (srclen - 1) * (stride + 1);                //  Index of the last source value in the strided grid
+    unsigned int u, q, r, d;
+
+    k->len = srclen + (srclen - 1) * stride + 2 * pad;
+    if((k->i0 = (unsigned int*)malloc(k->len * sizeof(int))) == NULL ||
+       (k->i1 = (unsigned int*)malloc(k->len * sizeof(int))) == NULL ||
+       (k->w0 = (double*)malloc(k->len * sizeof(double))) == NULL ||
+       (k->w1 = (double*)malloc(k->len * sizeof(double))) == NULL)
+      {
+        cout << "ERROR: Unable to allocate Upres layer's kernel\n";
+        exit(1);
+      }
+
+    for(o = 0; o < k->len; o++)
+      {
+        k->w1[o] = 0.0;
+        if(o < pad || o - pad > span)                               //  Padding
+          {
+            if(o < pad)
+              {
+                d = pad - o;
+                k->i0[o] = 0;
+              }
+            else
+              {
+                d = o - pad - span;
+                k->i0[o] = srclen - 1;
+              }
+            k->i1[o] = k->i0[o];
+            if(pMethod == FILL_SAME)
+              k->w0[o] = 1.0;
+            else if(pMethod == FILL_INTERP)                         //  Ramp down to zero one pixel beyond the padding
+              k->w0[o] = 1.0 - (double)d / (double)(pad + 1);
+            else
+              k->w0[o] = 0.0;
+          }
+        else
+          {
+            u = o - pad;
+            q = u / (stride + 1);
+            r = u % (stride + 1);
+            k->i0[o] = q;
+            if(r == 0)                                              //  Source value
+              {
+                k->i1[o] = q;
+                k->w0[o] = 1.0;
+              }
+            else                                                    //  Stride, between source values q and q + 1
+              {
+                k->i1[o] = q + 1;
+                if(sMethod == FILL_SAME)                            //  Nearest neighbor; ties go to the left
+                  {
+                    if(2 * r <= stride + 1)
+                      k->w0[o] = 1.0;
+                    else
+                      {
+                        k->w0[o] = 0.0;
+                        k->w1[o] = 1.0;
+                      }
+                  }
+                else if(sMethod == FILL_INTERP)
+                  {
+                    k->w1[o] = (double)r / (double)(stride + 1);
+                    k->w0[o] = 1.0 - k->w1[o];
+                  }
+                else
+                  k->w0[o] = 0.0;
+              }
+          }
+      }
+
+    return;
+  }
+
+/* Release a kernel's tables. */
+void Upres::freeKernel(UpresKernel* k)
+  {
+    if(k->i0 != NULL)
+      free(k->i0);
+    if(k->i1 != NULL)
+      free(k->i1);
+    if(k->w0 != NULL)
+      free(k->w0);
+    if(k->w1 != NULL)
+      free(k->w1);
+    k->i0 = NULL;
+    k->i1 = NULL;
+    k->w0 = NULL;
+    k->w1 = NULL;
+    k->len = 0;
+    return;
+  }
+
+/**************************************************************************************************
+ Other setters  */
+
+/*  */
+void Upres::setName(char* n)
+  {
+    unsigned char i;
+    unsigned char lim;
+    lim = (strlen(n) < LAYER_NAME_LEN) ? strlen(n) : LAYER_NAME_LEN - 1;
+    for(i = 0; i < lim; i++)
+      layerName[i] = n[i];
+    layerName[lim] = '\0';
+  }
+
+/**************************************************************************************************
+ Display  */
+
+/*  */
+char* Upres::name() const
+  {
+    return (char*)layerName;
+  }
+
+/*  */
+void Upres::print() const
+  {
+    unsigned int i;
+
+    printf("Input Shape = (%d, %d)\n", inputW, inputH);
+    for(i = 0; i < n; i++)
+      {
+        printf("Parameters %d\n", i);
+        printf("  H.stride  = %d\n", params[i].stride_h);
+        printf("  V.stride  = %d\n", params[i].stride_v);
+        printf("  H.padding = %d\n", params[i].padding_h);
+        printf("  V.padding = %d\n", params[i].padding_v);
+        printf("  Stride    = ");
+        switch(params[i].sMethod)
+          {
+            case FILL_ZERO:   printf("zero");         break;
+            case FILL_SAME:   printf("same");         break;
+            case FILL_INTERP: printf("interpolate");  break;
+          }
+        printf("\n  Padding   = ");
+        switch(params[i].pMethod)
+          {
+            case FILL_ZERO:   printf("zero");         break;
+            case FILL_SAME:   printf("same");         break;
+            case FILL_INTERP: printf("interpolate");  break;
+          }
+        printf("\n");
+      }
+    return;
+  }
+
+/*  */
+unsigned int Upres::paramsCount() const
+  {
+    return n;
+  }
+
+/*  */
+unsigned int Upres::inputWidth() const
+  {
+    return inputW;
+  }
+
+/*  */
+unsigned int Upres::inputHeight() const
+  {
+    return inputH;
+  }
+
+/*  */
+unsigned int Upres::outputWidth(unsigned int i) const
+  {
+    return inputW + (inputW - 1) * params[i].stride_h + 2 * params[i].padding_h;
+  }
+
+/*  */
+unsigned int Upres::outputHeight(unsigned int i) const
+  {
+    return inputH + (inputH - 1) * params[i].stride_v + 2 * params[i].padding_v;
+  }
+
+/*  */
+double* Upres::output() const
+  {
+    return out;
+  }
+
+/* Sum of the areas of every parameter set's output. */
+unsigned int Upres::outputLen() const
+  {
+    unsigned int i;
+    unsigned int len = 0;
+
+    for(i = 0; i < n; i++)
+      len += outputWidth(i) * outputHeight(i);
+
+    return len;
+  }
+
+/**************************************************************************************************
+ Run layer  */
+
+/* Up-res the (inputW * inputH) row-major input 'x' under every parameter set, concatenating the results in 'out'.
+   The horizontal pass is a two-tap gather along each source row; the vertical pass blends two whole
+   expanded rows at a time, which Eigen vectorizes. */
+unsigned int Upres::run(double* x)
+  {
+    unsigned int i, y, o;
+    unsigned int w;                                                 //  Width of the current parameter set's output
+    unsigned int offset = 0;                                        //  Offset into 'out'
+    UpresKernel* hk;
+    UpresKernel* vk;
+    double* src;
+    double* dst;
+
+    if(!kernelsReady)
+      buildKernels();
+
+    for(i = 0; i < n; i++)                                          //  Horizontal passes, once per distinct setting
+      {
+        if(hShare[i] != i)
+          continue;
+
+        hk = hKernels + i;
+        for(y = 0; y < inputH; y++)
+          {
+            src = x + y * inputW;
+            dst = rows + hOffset[i] + y * hk->len;
+            for(o = 0; o < hk->len; o++)
+              dst[o] = hk->w0[o] * src[hk->i0[o]] + hk->w1[o] * src[hk->i1[o]];
+          }
+      }
+
+    for(i = 0; i < n; i++)                                          //  Vertical passes
+      {
+        w = hKernels[i].len;
+        vk = vKernels + i;
+        for(o = 0; o < vk->len; o++)
+          {
+            Map<VectorXd> dstRow(out + offset + o * w, w);
+            Map<VectorXd> row0(rows + hOffset[i] + vk->i0[o] * w, w);
+            Map<VectorXd> row1(rows + hOffset[i] + vk->i1[o] * w, w);
+
+            if(vk->w1[o] == 0.0)
+              {
+                if(vk->w0[o] == 0.0)
+                  dstRow.setZero();
+                else if(vk->w0[o] == 1.0)
+                  dstRow = row0;
+                else
+                  dstRow = vk->w0[o] * row0;
+              }
+            else if(vk->w0[o] == 0.0)
+              dstRow = vk->w1[o] * row1;
+            else
+              dstRow = vk->w0[o] * row0 + vk->w1[o] * row1;
+          }
+        offset += w * vk->len;
+      }
+
+    return outlen;
+  }
+
+/* Write to 'rect' = { x0, y0, x1, y1 } the region of the input (right and bottom bounds excluded) that the i-th
+   parameter set reads to produce output columns [x0, x1) and rows [y0, y1). Kernel taps never decrease along
+   an axis, so the first output's first tap and the last output's second tap bound the region. */
+void Upres::inputRegion(unsigned int i, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+                        unsigned int* rect)
+  {
+    if(!kernelsReady)
+      buildKernels();
+
+    rect[0] = hKernels[i].i0[x0];
+    rect[1] = vKernels[i].i0[y0];
+    rect[2] = hKernels[i].i1[x1 - 1] + 1;
+    rect[3] = vKernels[i].i1[y1 - 1] + 1;
+    return;
+  }
+
+/* Compute output columns [x0, x1) and rows [y0, y1) of the i-th parameter set into 'dst', row-major and
+   (x1 - x0) wide. 'in' holds a region of the input whose top-left corner is (inX, inY) and whose rows are
+   'inW' long; it must cover at least what inputRegion() reports. */
+void Upres::runRegion(unsigned int i, double* in, unsigned int inX, unsigned int inY, unsigned int inW,
+                      unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, double* dst)
+  {
+    unsigned int o, y;
+    unsigned int w = x1 - x0;
+    unsigned int top, bottom;                                       //  Source rows [top, bottom] feed this region
+    UpresKernel* hk;
+    UpresKernel* vk;
+    double* src;
+    double* row;
+
+    if(!kernelsReady)
+      buildKernels();
+
+    hk = hKernels + i;
+    vk = vKernels + i;
+    top = vk->i0[y0];
+    bottom = vk->i1[y1 - 1];
+
+    if(tileRowsLen < (bottom - top + 1) * w)
+      {
+        tileRowsLen = (bottom - top + 1) * w;
+        if((tileRows = (double*)realloc(tileRows, tileRowsLen * sizeof(double))) == NULL)
+          {
+            cout << "ERROR: Unable to re-allocate Upres layer's tile row buffer\n";
+            exit(1);
+          }
+      }
+
+    for(y = top; y <= bottom; y++)                                  //  Horizontal pass over the source rows in range
+      {
+        src = in + (y - inY) * inW;
+        row = tileRows + (y - top) * w;
+        for(o = x0; o < x1; o++)
+          row[o - x0] = hk->w0[o] * src[hk->i0[o] - inX] + hk->w1[o] * src[hk->i1[o] - inX];
+      }
+
+    for(o = y0; o < y1; o++)                                        //  Vertical pass
+      {
+        Map<VectorXd> dstRow(dst + (o - y0) * w, w);
+        Map<VectorXd> row0(tileRows + (vk->i0[o] - top) * w, w);
+        Map<VectorXd> row1(tileRows + (vk->i1[o] - top) * w, w);
+
+        if(vk->w1[o] == 0.0)
+          dstRow = vk->w0[o] * row0;
+        else
+          dstRow = vk->w0[o] * row0 + vk->w1[o] * row1;
+      }
+
+    return;
+  }
+
+/**************************************************************************************************
+ File  */
+
+/* Write the layer to the binary file 'fp': input dimensions, number of parameter sets, each set's strides,
+   padding and fill methods, then name. Return false if writing fails. */
+bool Upres::write(FILE* fp) const
+  {
+    unsigned int i;
+    bool ok = true;
+
+    ok = ok && fwrite(&inputW, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&inputH, sizeof(int), 1, fp) == 1;
+    ok = ok && fwrite(&n, sizeof(int), 1, fp) == 1;
+    for(i = 0; i < n && ok; i++)
+      {
+        ok = ok && fwrite(&params[i].stride_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&params[i].stride_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&params[i].padding_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&params[i].padding_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fwrite(&params[i].sMethod, sizeof(char), 1, fp) == 1;
+        ok = ok && fwrite(&params[i].pMethod, sizeof(char), 1, fp) == 1;
+      }
+    ok = ok && fwrite(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+
+    return ok;
+  }
+
+/* Read a layer written by write() into this one, which must have the same input dimensions and no parameter sets
+   yet. Return false if reading fails or the layer does not fit. */
+bool Upres::read(FILE* fp)
+  {
+    unsigned int i;
+    unsigned int w, h, count;
+    UpresParams p;
+    bool ok = true;
+
+    ok = ok && fread(&w, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&h, sizeof(int), 1, fp) == 1;
+    ok = ok && fread(&count, sizeof(int), 1, fp) == 1;
+    if(!ok || w != inputW || h != inputH || n > 0)
+      {
+        cout << "ERROR: Stored Upres layer does not match this layer\n";
+        return false;
+      }
+    for(i = 0; i < count && ok; i++)
+      {
+        ok = ok && fread(&p.stride_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.stride_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.padding_h, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.padding_v, sizeof(int), 1, fp) == 1;
+        ok = ok && fread(&p.sMethod, sizeof(char), 1, fp) == 1;
+        ok = ok && fread(&p.pMethod, sizeof(char), 1, fp) == 1;
+        if(ok)
+          {
+            addParams(p.stride_h, p.padding_h);
+            setParamsVertStride(p.stride_v, i);
+            setParamsVertPad(p.padding_v, i);
+            setParamsStrideMethod(p.sMethod, i);
+            setParamsPaddingMethod(p.pMethod, i);
+          }
+      }
+    ok = ok && fread(layerName, sizeof(char), LAYER_NAME_LEN, fp) == LAYER_NAME_LEN;
+    layerName[LAYER_NAME_LEN - 1] = '\0';
+
+    return ok;
+  }
+
+#endif
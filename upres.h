@@ -21,10 +21,18 @@
                                                      [ 0 x51 0 x52 0 x53 0 x54 0 ]
                                                      [ 0  0  0  0  0  0  0  0  0 ]
 
+ FILL_INTERP fills strides by linear interpolation between the two neighboring source values and fills
+ padding by ramping linearly from the border value down to zero. Every fill is applied one axis at a time,
+ so in 2D the strides are filled bilinearly. Each parameter set gets a pair of precomputed 1D kernels
+ (one per axis, two taps per output position): the layer runs a horizontal pass over the source rows, then
+ a vertical pass that blends whole expanded rows. Parameter sets with identical horizontal settings share
+ the horizontal pass.
+
  Note that this file does NOT seed the randomizer. That should be done by the parent program.
 ***************************************************************************************************/
 
 #include <iostream>
+#include <Eigen/Dense>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -40,6 +48,8 @@
 #define __UPRES_DEBUG 1
 */
 
+using Eigen::Map;
+using Eigen::VectorXd;
 using namespace std;
 
 /**************************************************************************************************
@@ -56,6 +66,15 @@ typedef struct UpresParamsType
     unsigned char pMethod;
   } UpresParams;
 
+typedef struct UpresKernelType                                      //  Separable 1D resampling along one axis
+  {
+    unsigned int len;                                               //  Length of the output along this axis
+    unsigned int* i0;                                               //  Source index of the first tap, len-array
+    unsigned int* i1;                                               //  Source index of the second tap, len-array
+    double* w0;                                                     //  Weight of the first tap, len-array
+    double* w1;                                                     //  Weight of the second tap, len-array
+  } UpresKernel;
+
 /**************************************************************************************************
  Upres  */
 class Upres
@@ -75,8 +94,21 @@ class Upres
       void setName(char*);
       char* name() const;
       void print() const;
+      unsigned int paramsCount() const;
+      unsigned int inputWidth() const;
+      unsigned int inputHeight() const;
+      unsigned int outputWidth(unsigned int) const;                 //  Width of the i-th parameter set's output
+      unsigned int outputHeight(unsigned int) const;                //  Height of the i-th parameter set's output
       unsigned int outputLen() const;
+      double* output() const;
       unsigned int run(double*);
+      bool write(FILE*) const;                                      //  Write to a binary file
+      bool read(FILE*);                                             //  Read from a binary file
+                                                                    //  Region of the input needed for a region of the i-th output
+      void inputRegion(unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int*);
+                                                                    //  Compute a region of the i-th output from a region of the input
+      void runRegion(unsigned int, double*, unsigned int, unsigned int, unsigned int,
+                     unsigned int, unsigned int, unsigned int, unsigned int, double*);
 
     private:
       unsigned int inputW;                                          //  Dimensions of the input
@@ -84,9 +116,23 @@ class Upres
       UpresParams* params;                                          //  Array of Up-resolution parameters structures
       unsigned int n;                                               //  Number of up-ressings in this layer
 
-      char name[LAYER_NAME_LEN];
+      UpresKernel* hKernels;                                        //  Horizontal kernel of each parameter set, n-array
+      UpresKernel* vKernels;                                        //  Vertical kernel of each parameter set, n-array
+      unsigned int* hShare;                                         //  Index of the first parameter set whose horizontal pass
+                                                                    //  this one reuses (itself if none), n-array
+      unsigned int* hOffset;                                        //  Offset of each parameter set's horizontal pass in 'rows'
+      double* rows;                                                 //  Source rows after the horizontal pass(es)
+      double* tileRows;                                             //  Source rows after the horizontal pass, for runRegion()
+      unsigned int tileRowsLen;                                     //  Length of that buffer
+      bool kernelsReady;                                            //  False whenever a parameter changes
+
+      char layerName[LAYER_NAME_LEN];
       unsigned int outlen;                                          //  Length of the output buffer
       double* out;
+
+      void buildKernels();
+      void buildKernel(UpresKernel*, unsigned int, unsigned int, unsigned int, unsigned char, unsigned char);
+      void freeKernel(UpresKernel*);
   };
 
 #endif
\ No newline at end of file